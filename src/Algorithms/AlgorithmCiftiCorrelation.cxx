@@ -31,10 +31,115 @@
 #include <fstream>
 #include <utility>
 #include <algorithm>
+#include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int BLOCK_ROWS = 64;//input rows read per unit of work
+    const int PANEL_ROWS = 256;//output rows per kernel call, to keep the results and packed rows in cache
+    const int KERNEL_DEPTH = 256;//row elements per packing pass, partial sums are float only within this length
+    const int KERNEL_ROWS = 4, KERNEL_COLS = 8;//register tile, the inner loop over KERNEL_COLS is what gets vectorized
+    
+    //interleave rows into depth-major order, padding missing rows with zeros, so the kernel reads both inputs sequentially
+    void packRows(const float* const* rows, const int& numRows, const int& groupSize, const int& kStart, const int& kLength, vector<float>& packed)
+    {
+        int numGroups = (numRows + groupSize - 1) / groupSize;
+        packed.resize(numGroups * groupSize * KERNEL_DEPTH);
+        for (int group = 0; group < numGroups; ++group)
+        {
+            float* dest = packed.data() + group * groupSize * KERNEL_DEPTH;
+            for (int r = 0; r < groupSize; ++r)
+            {
+                int row = group * groupSize + r;
+                if (row < numRows)
+                {
+                    const float* src = rows[row] + kStart;
+                    for (int k = 0; k < kLength; ++k)
+                    {
+                        dest[k * groupSize + r] = src[k];
+                    }
+                } else {
+                    for (int k = 0; k < kLength; ++k)
+                    {
+                        dest[k * groupSize + r] = 0.0f;
+                    }
+                }
+            }
+        }
+    }
+    
+    //results[i * numB + j] = dot(rowsA[i], rowsB[j]), like a GEMM of A times B transpose
+    void dotProductBlock(const float* const* rowsA, const int& numA, const float* const* rowsB, const int& numB, const int& length, double* results, vector<float>& packA, vector<float>& packB)
+    {
+        int groupsA = (numA + KERNEL_ROWS - 1) / KERNEL_ROWS, groupsB = (numB + KERNEL_COLS - 1) / KERNEL_COLS;
+        for (int i = 0; i < numA * numB; ++i)
+        {
+            results[i] = 0.0;
+        }
+        for (int kStart = 0; kStart < length; kStart += KERNEL_DEPTH)
+        {
+            int kLength = min(KERNEL_DEPTH, length - kStart);
+            packRows(rowsA, numA, KERNEL_ROWS, kStart, kLength, packA);
+            packRows(rowsB, numB, KERNEL_COLS, kStart, kLength, packB);
+            for (int groupA = 0; groupA < groupsA; ++groupA)
+            {
+                const float* pa = packA.data() + groupA * KERNEL_ROWS * KERNEL_DEPTH;
+                for (int groupB = 0; groupB < groupsB; ++groupB)
+                {
+                    const float* pb = packB.data() + groupB * KERNEL_COLS * KERNEL_DEPTH;
+                    float accum[KERNEL_ROWS][KERNEL_COLS];
+                    for (int r = 0; r < KERNEL_ROWS; ++r)
+                    {
+                        for (int c = 0; c < KERNEL_COLS; ++c)
+                        {
+                            accum[r][c] = 0.0f;
+                        }
+                    }
+                    for (int k = 0; k < kLength; ++k)
+                    {
+                        for (int r = 0; r < KERNEL_ROWS; ++r)
+                        {
+                            float aval = pa[k * KERNEL_ROWS + r];
+                            for (int c = 0; c < KERNEL_COLS; ++c)
+                            {
+                                accum[r][c] += aval * pb[k * KERNEL_COLS + c];
+                            }
+                        }
+                    }
+                    for (int r = 0; r < KERNEL_ROWS; ++r)
+                    {
+                        int row = groupA * KERNEL_ROWS + r;
+                        if (row >= numA) break;
+                        for (int c = 0; c < KERNEL_COLS; ++c)
+                        {
+                            int col = groupB * KERNEL_COLS + c;
+                            if (col >= numB) break;
+                            results[row * numB + col] += accum[r][c];//accumulate the float partial sums in double, for numerical stability on long rows
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    float finishCorrelation(double r, const bool& fisherZ)
+    {
+        if (fisherZ)
+        {
+            if (r > 0.999999) r = 0.999999;//prevent inf
+            if (r < -0.999999) r = -0.999999;//prevent -inf
+            return 0.5 * log((1 + r) / (1 - r));
+        } else {
+            if (r > 1.0) r = 1.0;//don't output anything silly
+            if (r < -1.0) r = -1.0;
+            return r;
+        }
+    }
+}
+
 AString AlgorithmCiftiCorrelation::getCommandSwitch()
 {
     return "-cifti-correlation";
@@ -70,12 +175,16 @@ OperationParameters* AlgorithmCiftiCorrelation::getParameters()
     OptionalParameter* memLimitOpt = ret->createOptionalParameter(6, "-mem-limit", "restrict memory usage");
     memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
     
+    OptionalParameter* quantizeOpt = ret->createOptionalParameter(7, "-quantize", "write the output with each row quantized, see -cifti-change-layout");
+    quantizeOpt->addIntegerParameter(1, "bits", "bits per value, 8 or 16");
+    
     ret->setHelpText(
         AString("For each row (or each row inside an roi if -roi-override is specified), correlate to all other rows.\n\n") +
         "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r), to do further math on this output, consider using -cifti-math.\n\n" +
         "Restricting the memory usage will make it calculate the output in chunks, and if the input file size is more than 70% of the memory limit, " +
         "it will also read through the input file as rows are required, resulting in several passes through the input file (once per chunk).  " +
-        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow)."
+        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow).\n\n" +
+        "The -quantize option makes the output 2 or 4 times smaller on disk, at the cost of precision, the output can then only be read by workbench."
     );
     return ret;
 }
@@ -148,6 +257,16 @@ void AlgorithmCiftiCorrelation::useParameters(OperationParameters* myParams, Pro
             throw AlgorithmException("memory limit cannot be negative");
         }
     }
+    OptionalParameter* quantizeOpt = myParams->getOptionalParameter(7);
+    if (quantizeOpt->m_present)
+    {
+        int quantizeBits = (int)quantizeOpt->getInteger(1);
+        if (quantizeBits != 8 && quantizeBits != 16)
+        {
+            throw AlgorithmException("quantization must be 8 or 16 bits");
+        }
+        myCiftiOut->setWritingQuantization(quantizeBits);
+    }
     if (roiOverrideMode)
     {
         AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoi, rightRoi, cerebRoi, volRoi, weights, fisherZ, memLimitGB);
@@ -188,11 +307,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
+    vector<int> indexReverse(numRows, -1), chunkRows;
     for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numRows) endrow = numRows;
         outRows.resize(endrow - startrow);
+        chunkRows.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -203,41 +324,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
+            chunkRows[i - startrow] = i;
+            indexReverse[i] = i - startrow;
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
-                {
-                    if (j >= myrow)//if so, only compute one half, and store both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
-        }
+        computeChunk(chunkRows, indexReverse, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], i);
+            indexReverse[i] = -1;
         }
         if (!cacheFullInput)
         {
@@ -369,13 +463,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
-    CaretArray<int> indexReverse(numRows, -1);
+    vector<int> indexReverse(numRows, -1), chunkRows;
     for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numSelected) endrow = numSelected;
         outRows.resize(endrow - startrow);
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        chunkRows.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -386,38 +480,10 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
-            indexReverse[ciftiIndexList[i].first] = i;
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
-                {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
+            chunkRows[i - startrow] = ciftiIndexList[i].first;
+            indexReverse[ciftiIndexList[i].first] = i - startrow;
         }
+        computeChunk(chunkRows, indexReverse, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
@@ -434,41 +500,75 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     }
 }
 
-float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
-{
-    double r;
-    if (row1 == row2)
+void AlgorithmCiftiCorrelation::computeChunk(const vector<int>& chunkRows, const vector<int>& indexReverse, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{//chunkRows are the (cached) input rows whose output rows are in memory, indexReverse maps input row to position in chunkRows, or -1
+    int numRows = m_inputCifti->getNumberOfRows(), numChunk = (int)chunkRows.size();
+    int rowLength = getNormalizedLength();
+    vector<const float*> chunkPointers(numChunk);
+    for (int i = 0; i < numChunk; ++i)
     {
-        r = 1.0;//short circuit for same row
-    } else {
-        if (m_weightedMode)
+        chunkPointers[i] = getNormalizedRow(chunkRows[i], NULL);
+    }
+    int numBlocks = (numRows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    int curBlock = 0;//because we can't trust the order threads hit the critical section
+#pragma omp CARET_PAR
+    {
+        vector<float> scratch(BLOCK_ROWS * m_numCols), packA, packB;
+        vector<double> results(BLOCK_ROWS * PANEL_ROWS);
+        const float* movingRows[BLOCK_ROWS];
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            int numWeights = (int)m_weightIndexes.size();
-            double accum = 0.0;
-            for (int i = 0; i < numWeights; ++i)//because we compacted the data in the row to not include any zero weights
+            int blockStart;
+#pragma omp critical
+            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+                blockStart = curBlock * BLOCK_ROWS;//so, manually force it to read sequentially
+                ++curBlock;
+                int blockEnd = min(blockStart + BLOCK_ROWS, numRows);
+                for (int i = blockStart; i < blockEnd; ++i)
+                {
+                    movingRows[i - blockStart] = getNormalizedRow(i, scratch.data() + (i - blockStart) * m_numCols);
+                }
+            }
+            int numMoving = min(BLOCK_ROWS, numRows - blockStart);
+            int panelStart = numChunk;//where all moving rows are also output rows, we only need to compute one triangle
+            for (int i = 0; i < numMoving; ++i)
             {
-                accum += row1[i] * row2[i];//these have already had the weighted row means subtracted out, and weights applied
+                int myPos = indexReverse[blockStart + i];
+                if (myPos == -1)
+                {
+                    panelStart = 0;
+                    break;
+                }
+                if (myPos < panelStart) panelStart = myPos;
             }
-            r = accum / (rrs1 * rrs2);//as do these
-        } else {
-            double accum = 0.0;
-            for (int i = 0; i < m_numCols; ++i)
+            for (; panelStart < numChunk; panelStart += PANEL_ROWS)
             {
-                accum += row1[i] * row2[i];//these have already had the row means subtracted out
+                int numPanel = min(PANEL_ROWS, numChunk - panelStart);
+                dotProductBlock(movingRows, numMoving, chunkPointers.data() + panelStart, numPanel, rowLength, results.data(), packA, packB);
+                for (int i = 0; i < numMoving; ++i)
+                {
+                    int myrow = blockStart + i, myPos = indexReverse[myrow];
+                    const double* myResults = results.data() + i * numPanel;
+                    if (myPos == -1)
+                    {
+                        for (int j = 0; j < numPanel; ++j)
+                        {
+                            outRows[panelStart + j][myrow] = finishCorrelation(myResults[j], fisherZ);
+                        }
+                    } else {
+                        for (int j = max(0, myPos - panelStart); j < numPanel; ++j)//only compute one half, and store both places
+                        {
+                            int pos = panelStart + j;
+                            float value = finishCorrelation((pos == myPos) ? 1.0 : myResults[j], fisherZ);//short circuit for same row
+                            outRows[pos][myrow] = value;
+                            outRows[myPos][chunkRows[pos]] = value;
+                        }
+                    }
+                }
             }
-            r = accum / (rrs1 * rrs2);
         }
     }
-    if (fisherZ)
-    {
-        if (r > 0.999999) r = 0.999999;//prevent inf
-        if (r < -0.999999) r = -0.999999;//prevent -inf
-        return 0.5 * log((1 + r) / (1 - r));
-    } else {
-        if (r > 1.0) r = 1.0;//don't output anything silly
-        if (r < -1.0) r = -1.0;
-        return r;
-    }
 }
 
 void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>* weights)
@@ -529,7 +629,7 @@ void AlgorithmCiftiCorrelation::cacheRow(const int& ciftiIndex)
         computeRowStats(myPtr, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
         m_rowInfo[ciftiIndex].m_haveCalculated = true;
     }
-    doSubtract(myPtr, m_rowInfo[ciftiIndex].m_mean);
+    normalizeRow(myPtr, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
     m_rowInfo[ciftiIndex].m_cacheIndex = m_cacheUsed;
     ++m_cacheUsed;
 }
@@ -543,30 +643,26 @@ void AlgorithmCiftiCorrelation::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelation::getNormalizedRow(const int& ciftiIndex, float* scratch)
 {
-    float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
     if (m_rowInfo[ciftiIndex].m_cacheIndex != -1)
     {
-        ret = m_rowCache[m_rowInfo[ciftiIndex].m_cacheIndex].m_row.data();
-    } else {
-        CaretAssert(!mustBeCached);
-        if (mustBeCached)//largely so it doesn't give warning about unused when compiled in release
-        {
-            throw AlgorithmException("something very bad happened, notify the developers");
-        }
-        ret = getTempRow();
-        m_inputCifti->getRow(ret, ciftiIndex);
-        if (!m_rowInfo[ciftiIndex].m_haveCalculated)
-        {
-            computeRowStats(ret, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
-            m_rowInfo[ciftiIndex].m_haveCalculated = true;
-        }
-        doSubtract(ret, m_rowInfo[ciftiIndex].m_mean);
+        return m_rowCache[m_rowInfo[ciftiIndex].m_cacheIndex].m_row.data();
     }
-    rootResidSqr = m_rowInfo[ciftiIndex].m_rootResidSqr;
-    return ret;
+    CaretAssert(scratch != NULL);
+    if (scratch == NULL)//largely so it doesn't give warning about unused when compiled in release
+    {
+        throw AlgorithmException("something very bad happened, notify the developers");
+    }
+    m_inputCifti->getRow(scratch, ciftiIndex);
+    if (!m_rowInfo[ciftiIndex].m_haveCalculated)
+    {
+        computeRowStats(scratch, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
+        m_rowInfo[ciftiIndex].m_haveCalculated = true;
+    }
+    normalizeRow(scratch, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
+    return scratch;
 }
 
 void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, float& rootResidSqr)
@@ -629,8 +725,9 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
     }
 }
 
-void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
-{
+void AlgorithmCiftiCorrelation::normalizeRow(float* row, const float& mean, const float& rootResidSqr)
+{//after this, correlation is just the dot product of the rows (constant rows get inf scale, and therefore NaN correlation, same as 0/0)
+    float scale = 1.0f / rootResidSqr;
     if (m_weightedMode)
     {
         int weightsize = (int)m_weightIndexes.size();
@@ -638,44 +735,20 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
         {
             for (int i = 0; i < weightsize; ++i)
             {
-                row[i] = row[m_weightIndexes[i]] - mean;
+                row[i] = (row[m_weightIndexes[i]] - mean) * scale;
             }
         } else {
             for (int i = 0; i < weightsize; ++i)
             {
-                row[i] = sqrt(m_weights[i]) * (row[m_weightIndexes[i]] - mean);//multiply by square root of weight, so that the numerator of correlation doesn't get the square of the weight
+                row[i] = sqrt(m_weights[i]) * (row[m_weightIndexes[i]] - mean) * scale;//multiply by square root of weight, so that the numerator of correlation doesn't get the square of the weight
             }
         }
     } else {
         for (int i = 0; i < m_numCols; ++i)
         {
-            row[i] -= mean;
-        }
-    }
-}
-
-float* AlgorithmCiftiCorrelation::getTempRow()
-{
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRows.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
-    {
-        m_tempRows.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
-        {
-            m_tempRows[i] = CaretArray<float>(m_numCols);
+            row[i] = (row[i] - mean) * scale;
         }
     }
-    return m_tempRows[threadNum].getArray();
-#else
-    if (m_tempRows.size() == 0)
-    {
-        m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRows[0].getArray();
-#endif
 }
 
 int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cacheFullInput)
@@ -684,10 +757,13 @@ int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cach
     int inrowBytes = m_numCols * sizeof(float), outrowBytes = numRows * sizeof(float);
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * m_numCols * 4;//count in-memory input against the total too
+    int64_t threadBytes = (int64_t)BLOCK_ROWS * inrowBytes//moving rows that aren't references to cache
+                          + (int64_t)BLOCK_ROWS * PANEL_ROWS * sizeof(double)//block of dot products
+                          + (int64_t)(BLOCK_ROWS + PANEL_ROWS + KERNEL_ROWS + KERNEL_COLS) * KERNEL_DEPTH * sizeof(float);//packed kernel inputs
 #ifdef CARET_OMP
-    targetBytes -= inrowBytes * omp_get_max_threads();
+    targetBytes -= threadBytes * omp_get_max_threads();
 #else
-    targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+    targetBytes -= threadBytes;
 #endif
     targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
     int64_t perRowBytes = inrowBytes + outrowBytes;//cache and memory collation for output rows
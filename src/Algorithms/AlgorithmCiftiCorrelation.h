@@ -50,7 +50,6 @@ namespace caret {
         };
         std::vector<CacheRow> m_rowCache;
         std::vector<RowInfo> m_rowInfo;
-        std::vector<CaretArray<float> > m_tempRows;//reuse return values in getRow instead of reallocating
         std::vector<float> m_weights;
         std::vector<int> m_weightIndexes;
         bool m_binaryWeights, m_weightedMode;
@@ -59,11 +58,11 @@ namespace caret {
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
         void cacheRow(const int& ciftiIndex);
         void computeRowStats(const float* row, float& mean, float& rootResidSqr);
-        void doSubtract(float* row, const float& mean);
+        void normalizeRow(float* row, const float& mean, const float& rootResidSqr);
         void clearCache();
-        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
-        float* getTempRow();
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        const float* getNormalizedRow(const int& ciftiIndex, float* scratch);//scratch must hold a full input row, may be NULL if the row is known to be cached
+        int getNormalizedLength() const { return m_weightedMode ? (int)m_weightIndexes.size() : m_numCols; }
+        void computeChunk(const std::vector<int>& chunkRows, const std::vector<int>& indexReverse, std::vector<CaretArray<float> >& outRows, const bool& fisherZ);
         void init(const CiftiFile* input, const std::vector<float>* weights);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
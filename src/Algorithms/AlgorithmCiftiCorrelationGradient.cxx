@@ -32,6 +32,7 @@
 #include "Vector3D.h"
 #include "VolumeFile.h"
 #include <cmath>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
@@ -285,6 +286,11 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi));//computes the smoothing weights only once per surface
     }
+    vector<int> scanRows(mapSize);
+    for (int i = 0; i < mapSize; ++i)
+    {
+        scanRows[i] = myMap[i].m_ciftiIndex;
+    }
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -298,6 +304,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
+        startReading(scanRows);//the loop below requests uncached rows in map order
         int curRow = 0;//because we can't trust the order threads hit the critical section
         MetricFile computeMetric;
         computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
@@ -333,6 +340,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 }
             }
         }
+        stopReading();
         int numMetricCols = endpos - startpos;
         MetricFile outputMetric, outputMetric2;
         for (int j = 0; j < numMetricCols; ++j)
@@ -412,6 +420,11 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi));//computes the smoothing weights only once per surface
     }
+    vector<int> scanRows(mapSize);
+    for (int i = 0; i < mapSize; ++i)
+    {
+        scanRows[i] = myMap[i].m_ciftiIndex;
+    }
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -426,15 +439,19 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             cacheRows(rowsToCache);
         }
         int numSurfNodes = mySurf->getNumberOfNodes();
+        vector<int32_t> excludeRoots(endpos - startpos);
+        for (int i = startpos; i < endpos; ++i)
+        {
+            excludeRoots[i - startpos] = myMap[i].m_surfaceNode;
+        }
+        vector<vector<float> > excludeDists;
+        mySurf->getGeodesicHelper()->getNodesToGeoDist(excludeRoots, surfExclude, excludeNodes, excludeDists);//batched, uses multiple threads internally
 #pragma omp CARET_PAR
         {
-            vector<float> distances;
-            CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
 #pragma omp CARET_FOR
             for (int i = startpos; i < endpos; ++i)
             {
                 vector<int32_t>& excludeRef = excludeNodes[i - startpos];
-                myGeoHelp->getNodesToGeoDist(myMap[i].m_surfaceNode, surfExclude, excludeRef, distances);
                 vector<bool>& lookupRef = roiLookup[i - startpos];
                 lookupRef.resize(numSurfNodes);
                 for (int j = 0; j < numSurfNodes; ++j)
@@ -448,6 +465,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 }
             }
         }
+        startReading(scanRows);//the loop below requests uncached rows in map order
         int curRow = 0;//because we can't trust the order threads hit the critical section
         MetricFile computeMetric;
         computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
@@ -486,6 +504,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 }
             }
         }
+        stopReading();
         int numMetricCols = endpos - startpos;
         MetricFile outputMetric, outputMetric2;
         MetricFile excludeRoi = myRoi;
@@ -603,6 +622,11 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
     {
         cacheRows(rowsToCache);
     }
+    vector<int> scanRows(mapSize);
+    for (int i = 0; i < mapSize; ++i)
+    {
+        scanRows[i] = myMap[i].m_ciftiIndex;
+    }
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -616,6 +640,7 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
             }
             cacheRows(rowsToCache);
         }
+        startReading(scanRows);//the loop below requests uncached rows in map order
         int curRow = 0;//because we can't trust the order threads hit the critical section
         vector<int64_t> computeDims = newdims;
         computeDims.push_back(endpos - startpos);
@@ -652,6 +677,7 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
                 }
             }
         }
+        stopReading();
         VolumeFile outputVol;
         int numSubvols = endpos - startpos;
         for (int j = 0; j < numSubvols; ++j)
@@ -741,6 +767,11 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
     {
         cacheRows(rowsToCache);
     }
+    vector<int> scanRows(mapSize);
+    for (int i = 0; i < mapSize; ++i)
+    {
+        scanRows[i] = myMap[i].m_ciftiIndex;
+    }
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -754,6 +785,7 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
             }
             cacheRows(rowsToCache);
         }
+        startReading(scanRows);//the loop below requests uncached rows in map order
         int curRow = 0;//because we can't trust the order threads hit the critical section
         vector<int64_t> computeDims = newdims;
         computeDims.push_back(endpos - startpos);
@@ -797,6 +829,7 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
                 }
             }
         }
+        stopReading();
         VolumeFile outputVol, excludeRoi(newdims, ciftiSform);
         excludeRoi.setFrame(volRoi.getFrame());
         int numSubvols = endpos - startpos;
@@ -1049,6 +1082,7 @@ void AlgorithmCiftiCorrelationGradient::cacheRows(const vector<int>& ciftiIndice
     clearCache();//clear first, to be sure we never keep a cache around too long
     int curIndex = 0, numIndices = (int)ciftiIndices.size();//manually in-order
     m_rowCache.reserve(m_cacheUsed + numIndices);//so that pointers to members don't change
+    startReading(ciftiIndices);//the background thread does the IO while the threads below do the adjusting
 #pragma omp CARET_PAR
     {
         int myIndex;
@@ -1071,7 +1105,9 @@ void AlgorithmCiftiCorrelationGradient::cacheRows(const vector<int>& ciftiIndice
                     }
                     m_rowCache[m_cacheUsed].m_ciftiIndex = ciftiIndices[myIndex];
                     myPtr = m_rowCache[m_cacheUsed].m_row.data();
-                    m_inputCifti->getRow(myPtr, ciftiIndices[myIndex]);
+                    const float* inRow = m_rowReader->nextRow();
+                    CaretAssert(m_rowReader->getCurrentIndex()[0] == ciftiIndices[myIndex]);
+                    memcpy(myPtr, inRow, m_numCols * sizeof(float));
                     m_rowInfo[ciftiIndices[myIndex]].m_cacheIndex = m_cacheUsed;
                     ++m_cacheUsed;
                 }
@@ -1082,6 +1118,7 @@ void AlgorithmCiftiCorrelationGradient::cacheRows(const vector<int>& ciftiIndice
             }
         }
     }
+    stopReading();
 }
 
 void AlgorithmCiftiCorrelationGradient::clearCache()
@@ -1093,6 +1130,28 @@ void AlgorithmCiftiCorrelationGradient::clearCache()
     m_cacheUsed = 0;
 }
 
+void AlgorithmCiftiCorrelationGradient::startReading(const vector<int>& ciftiIndices)
+{
+    vector<int64_t> toRead;
+    vector<bool> queued(m_rowInfo.size(), false);//a row is only read once, after that it is in the cache
+    for (int i = 0; i < (int)ciftiIndices.size(); ++i)
+    {
+        int thisIndex = ciftiIndices[i];
+        CaretAssertVectorIndex(m_rowInfo, thisIndex);
+        if (m_rowInfo[thisIndex].m_cacheIndex == -1 && !queued[thisIndex])
+        {
+            toRead.push_back(thisIndex);
+            queued[thisIndex] = true;
+        }
+    }
+    m_rowReader.grabNew(new CiftiRowReader(m_inputCifti, toRead));
+}
+
+void AlgorithmCiftiCorrelationGradient::stopReading()
+{
+    m_rowReader.grabNew(NULL);
+}
+
 const float* AlgorithmCiftiCorrelationGradient::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
 {
     float* ret;
@@ -1107,7 +1166,14 @@ const float* AlgorithmCiftiCorrelationGradient::getRow(const int& ciftiIndex, fl
             throw AlgorithmException("something very bad happened, notify the developers");
         }
         ret = getTempRow();
-        m_inputCifti->getRow(ret, ciftiIndex);
+        if (m_rowReader != NULL)
+        {
+            const float* inRow = m_rowReader->nextRow();
+            CaretAssert(m_rowReader->getCurrentIndex()[0] == ciftiIndex);
+            memcpy(ret, inRow, m_numCols * sizeof(float));
+        } else {
+            m_inputCifti->getRow(ret, ciftiIndex);
+        }
         adjustRow(ret, ciftiIndex);
     }
     rootResidSqr = m_rowInfo[ciftiIndex].m_rootResidSqr;
@@ -23,6 +23,7 @@
 
 #include "AbstractAlgorithm.h"
 #include "CaretPointer.h"
+#include "CiftiRowReader.h"
 #include "StructureEnum.h"
 
 namespace caret {
@@ -54,8 +55,11 @@ namespace caret {
         int m_numCols;
         bool m_undoFisherInput, m_applyFisher;
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
+        CaretPointer<CiftiRowReader> m_rowReader;//when set, getRow takes uncached rows from this instead of m_inputCifti
         void cacheRows(const std::vector<int>& ciftiIndices);//grabs the rows and does whatever it needs to, using as much IO bandwidth and CPU resources as available/needed
         void clearCache();
+        void startReading(const std::vector<int>& ciftiIndices);//start reading ahead the rows in this list that aren't cached, getRow must then request them in this order
+        void stopReading();
         const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
         void adjustRow(float* rowOut, const int& ciftiIndex);//does the reverse fisher transform, computes stuff, subtracts mean
         float* getTempRow();
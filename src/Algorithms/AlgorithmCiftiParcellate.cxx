@@ -21,6 +21,8 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CiftiFile.h"
+#include "CiftiRowReader.h"
+#include "CiftiRowWriter.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include <map>
@@ -122,7 +124,6 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     myOutXML.setMap(direction, outParcelMap);
     myCiftiOut->setCiftiXML(myOutXML);
     int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW), numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    vector<float> scratchRow(numCols);
     vector<int64_t> parcelCounts(numParcels, 0);
     for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
     {
@@ -136,16 +137,18 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     if (direction == CiftiXML::ALONG_ROW)
     {
         vector<float> scratchOutRow(numParcels);
+        CiftiRowReader myReader(myCiftiIn);//overlap reading and writing with the computation
+        CiftiRowWriter myWriter(myCiftiOut);
         for (int64_t i = 0; i < numRows; ++i)
         {
             vector<double> scratchAccum(numParcels, 0.0);
-            myCiftiIn->getRow(scratchRow.data(), i);
+            const float* inRow = myReader.nextRow();
             for (int64_t j = 0; j < numCols; ++j)
             {
                 int parcel = indexToParcel[j];
                 if (parcel != -1)
                 {
-                    scratchAccum[parcel] += scratchRow[j];
+                    scratchAccum[parcel] += inRow[j];
                 }
             }
             for (int j = 0; j < numParcels; ++j)
@@ -157,23 +160,30 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                     scratchOutRow[j] = 0.0f;
                 }
             }
-            myCiftiOut->setRow(scratchOutRow.data(), i);
+            myWriter.setRow(scratchOutRow.data(), i);
         }
+        myWriter.finish();
     } else if (direction == CiftiXML::ALONG_COLUMN) {
         vector<vector<double> > accumRows(numParcels, vector<double>(numCols, 0.0f));
+        vector<int64_t> rowsToRead;//skip rows that aren't in any parcel
         for (int64_t i = 0; i < numRows; ++i)
         {
-            int parcel = indexToParcel[i];
-            if (parcel != -1)
+            if (indexToParcel[i] != -1)
             {
-                myCiftiIn->getRow(scratchRow.data(), i);
-                vector<double>& parcelRowRef = accumRows[parcel];
-                for (int64_t j = 0; j < numCols; ++j)
-                {
-                    parcelRowRef[j] += scratchRow[j];
-                }
+                rowsToRead.push_back(i);
+            }
+        }
+        CiftiRowReader myReader(myCiftiIn, rowsToRead);
+        for (int64_t r = 0; r < (int64_t)rowsToRead.size(); ++r)
+        {
+            const float* inRow = myReader.nextRow();
+            vector<double>& parcelRowRef = accumRows[indexToParcel[rowsToRead[r]]];
+            for (int64_t j = 0; j < numCols; ++j)
+            {
+                parcelRowRef[j] += inRow[j];
             }
         }
+        CiftiRowWriter myWriter(myCiftiOut);
         vector<float> scratchOutRow(numCols);
         for (int i = 0; i < numParcels; ++i)
         {
@@ -191,8 +201,9 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                     scratchOutRow[j] = 0.0f;
                 }
             }
-            myCiftiOut->setRow(scratchOutRow.data(), i);
+            myWriter.setRow(scratchOutRow.data(), i);
         }
+        myWriter.finish();
     } else {
         throw AlgorithmException("AlgorithmCiftiParcellate doesn't support this direction");
     }
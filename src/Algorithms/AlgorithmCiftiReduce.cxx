@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiReduce.h"
 #include "AlgorithmException.h"
 #include "CiftiFile.h"
+#include "CiftiRowReader.h"
 #include "ReductionOperation.h"
 
 #include <vector>
@@ -85,11 +86,12 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     myOutXML.resetRowsToScalars(1);
     myOutXML.setMapNameForRowIndex(0, ReductionEnum::toName(myReduce));
     ciftiOut->setCiftiXML(myOutXML);
-    vector<float> scratchRow(numCols), outCol(numRows);
+    vector<float> outCol(numRows);
+    CiftiRowReader myReader(ciftiIn);//reads ahead in the background while we reduce
     for (int64_t i = 0; i < numRows; ++i)
     {
-        ciftiIn->getRow(scratchRow.data(), i);
-        outCol[i] = ReductionOperation::reduce(scratchRow.data(), numCols, myReduce);
+        const float* inRow = myReader.nextRow();
+        outCol[i] = ReductionOperation::reduce(inRow, numCols, myReduce);
     }
     ciftiOut->setColumn(outCol.data(), 0);
 }
@@ -104,11 +106,12 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     myOutXML.resetRowsToScalars(1);
     myOutXML.setMapNameForRowIndex(0, ReductionEnum::toName(myReduce));
     ciftiOut->setCiftiXML(myOutXML);
-    vector<float> scratchRow(numCols), outCol(numRows);
+    vector<float> outCol(numRows);
+    CiftiRowReader myReader(ciftiIn);//reads ahead in the background while we reduce
     for (int64_t i = 0; i < numRows; ++i)
     {
-        ciftiIn->getRow(scratchRow.data(), i);
-        outCol[i] = ReductionOperation::reduceExcludeDev(scratchRow.data(), numCols, myReduce, sigmaBelow, sigmaAbove);
+        const float* inRow = myReader.nextRow();
+        outCol[i] = ReductionOperation::reduceExcludeDev(inRow, numCols, myReduce, sigmaBelow, sigmaAbove);
     }
     ciftiOut->setColumn(outCol.data(), 0);
 }
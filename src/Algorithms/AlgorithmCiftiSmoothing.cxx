@@ -73,13 +73,18 @@ OperationParameters* AlgorithmCiftiSmoothing::getParameters()
     
     ret->createOptionalParameter(11, "-fix-zeros-surface", "treat values of zero on the surface as missing data");
     
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(12, "-kernel-cache", "reuse surface smoothing kernels across runs");
+    cacheOpt->addStringParameter(1, "directory", "the directory to store and look up kernel files in");
+    
     ret->setHelpText(
         AString("The input cifti file must have a brain models mapping on the chosen dimension, columns for .dtseries, and either for .dconn.  ") +
         "Data in different structures is smoothed independently, so volume structures that touch do not smooth across this boundary.  " +
         "Surface smoothing uses the GEO_GAUSS_AREA smoothing method.  " +
         "The fix zeros options will treat values of zero as lack of data, and not use that value when generating the smoothed values, but will fill zeros with extrapolated values.  " +
         "The ROI should have a brain models mapping along columns, exactly matching the mapping of the chosen direction in the input file.  " +
-        "Data outside the ROI is ignored."
+        "Data outside the ROI is ignored.  " +
+        "The -kernel-cache option saves the surface smoothing kernels in the specified directory, named by a hash of their inputs, so that later runs load them instead of recomputing them, " +
+        "see -metric-smoothing for details."
     );
     return ret;
 }
@@ -140,14 +145,21 @@ void AlgorithmCiftiSmoothing::useParameters(OperationParameters* myParams, Progr
     }
     bool fixZerosVol = myParams->getOptionalParameter(10)->m_present;
     bool fixZerosSurf = myParams->getOptionalParameter(11)->m_present;
-    AlgorithmCiftiSmoothing(myProgObj, myCifti, surfKern, volKern, myDir, myCiftiOut, myLeftSurf, myLeftAreas, myRightSurf, myRightAreas, myCerebSurf, myCerebAreas, roiCifti, fixZerosVol, fixZerosSurf);
+    AString kernelCacheDir;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(12);
+    if (cacheOpt->m_present)
+    {
+        kernelCacheDir = cacheOpt->getString(1);
+    }
+    AlgorithmCiftiSmoothing(myProgObj, myCifti, surfKern, volKern, myDir, myCiftiOut, myLeftSurf, myLeftAreas, myRightSurf, myRightAreas, myCerebSurf, myCerebAreas, roiCifti, fixZerosVol, fixZerosSurf,
+                            kernelCacheDir);
 }
 
 AlgorithmCiftiSmoothing::AlgorithmCiftiSmoothing(ProgressObject* myProgObj, const CiftiFile* myCifti, const float& surfKern, const float& volKern, const int& myDir, CiftiFile* myCiftiOut,
                                                  const SurfaceFile* myLeftSurf, const MetricFile* myLeftAreas,
                                                  const SurfaceFile* myRightSurf, const MetricFile* myRightAreas,
                                                  const SurfaceFile* myCerebSurf, const MetricFile* myCerebAreas,
-                                                 const CiftiFile* roiCifti, bool fixZerosVol, bool fixZerosSurf) : AbstractAlgorithm(myProgObj)
+                                                 const CiftiFile* roiCifti, bool fixZerosVol, bool fixZerosSurf, const AString& kernelCacheDir) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXMLOld& myXML = myCifti->getCiftiXMLOld();
@@ -244,7 +256,7 @@ AlgorithmCiftiSmoothing::AlgorithmCiftiSmoothing(ProgressObject* myProgObj, cons
         {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
             AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXMLOld::ALONG_COLUMN, surfaceList[whichStruct], &myRoi);
         }
-        AlgorithmMetricSmoothing(NULL, mySurf, &myMetric, surfKern, &myMetricOut, &myRoi, false, fixZerosSurf, -1, myAreas);
+        AlgorithmMetricSmoothing(NULL, mySurf, &myMetric, surfKern, &myMetricOut, &myRoi, false, fixZerosSurf, -1, myAreas, MetricSmoothingObject::GEO_GAUSS_AREA, kernelCacheDir);
         AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetricOut);
     }
     for (int whichStruct = 0; whichStruct < (int)volumeList.size(); ++whichStruct)
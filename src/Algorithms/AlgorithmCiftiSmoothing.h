@@ -36,7 +36,7 @@ namespace caret {
                                 const SurfaceFile* myLeftSurf = NULL, const MetricFile* myLeftAreas = NULL,
                                 const SurfaceFile* myRightSurf = NULL, const MetricFile* myRightAreas = NULL,
                                 const SurfaceFile* myCerebSurf = NULL, const MetricFile* myCerebAreas = NULL,
-                                const CiftiFile* roiCifti = NULL, bool fixZerosVol = false, bool fixZerosSurf = false);
+                                const CiftiFile* roiCifti = NULL, bool fixZerosVol = false, bool fixZerosSurf = false, const AString& kernelCacheDir = "");
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
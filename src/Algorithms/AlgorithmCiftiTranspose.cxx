@@ -20,7 +20,15 @@
 
 #include "AlgorithmCiftiTranspose.h"
 #include "AlgorithmException.h"
+#include "CaretBinaryFile.h"
+#include "CaretOMP.h"
+#include "CaretTemporaryFile.h"
 #include "CiftiFile.h"
+#include "CiftiRowReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -47,7 +55,10 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.  " +
+        "The input is read only once.  " +
+        "If the output does not fit within the memory limit, the transposed data is stored in a temporary file as large as the input, " +
+        "in the system's temporary directory, and the output rows are then assembled from it."
     );
     return ret;
 }
@@ -69,6 +80,31 @@ void AlgorithmCiftiTranspose::useParameters(OperationParameters* myParams, Progr
     AlgorithmCiftiTranspose(myProgObj, ciftiIn, ciftiOut, memLimitGB);
 }
 
+namespace
+{
+    const int64_t TILE_SIZE = 64;//a tile of input plus output is 32KB, so both stay in cache while transposing
+    
+    //out[col * outStride + row] = in[row * rowLength + col], done tile by tile to avoid cache misses on the strided side
+    void transposeBlock(const float* in, const int64_t& numRows, const int64_t& rowLength, float* out, const int64_t& outStride)
+    {
+        int64_t numTileRows = (numRows + TILE_SIZE - 1) / TILE_SIZE, numTileCols = (rowLength + TILE_SIZE - 1) / TILE_SIZE;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t tile = 0; tile < numTileRows * numTileCols; ++tile)
+        {
+            int64_t rowStart = (tile % numTileRows) * TILE_SIZE, colStart = (tile / numTileRows) * TILE_SIZE;
+            int64_t rowEnd = min(rowStart + TILE_SIZE, numRows), colEnd = min(colStart + TILE_SIZE, rowLength);
+            for (int64_t col = colStart; col < colEnd; ++col)
+            {
+                float* outCol = out + col * outStride;
+                for (int64_t row = rowStart; row < rowEnd; ++row)
+                {
+                    outCol[row] = in[row * rowLength + col];
+                }
+            }
+        }
+    }
+}
+
 AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
@@ -79,32 +115,73 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     }//TODO: check for cifti with 3 or more dimensions
     outXML.swapMappings(CiftiXMLOld::ALONG_ROW, CiftiXMLOld::ALONG_COLUMN);
     ciftiOut->setCiftiXML(outXML);
-    int rowSize = outXML.getNumberOfColumns(), colSize = outXML.getNumberOfRows();
-    int64_t outRowBytes = rowSize * sizeof(float);
-    int numCacheRows = colSize;
+    int64_t rowSize = outXML.getNumberOfColumns(), colSize = outXML.getNumberOfRows();//output dimensions, input has colSize as row length and rowSize rows
+    int64_t memLimitBytes = -1;
     if (memLimitGB >= 0.0f)
     {
-        numCacheRows = memLimitGB * 1024 * 1024 * 1024 / outRowBytes;
-        if (numCacheRows < 1) numCacheRows = 1;
-        if (numCacheRows > colSize) numCacheRows = colSize;
+        memLimitBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
+    }
+    const int64_t inRowBytes = colSize * sizeof(float), outRowBytes = rowSize * sizeof(float);
+    CiftiRowReader myReader(ciftiIn);//all input rows, once, in file order, read ahead in the background
+    if (memLimitBytes < 0 || outRowBytes * colSize + TILE_SIZE * inRowBytes <= memLimitBytes)
+    {//entire output fits in memory, transpose blocks of input rows straight into it
+        vector<float> outData(rowSize * colSize), inBlock(TILE_SIZE * colSize);
+        for (int64_t blockStart = 0; blockStart < rowSize; blockStart += TILE_SIZE)
+        {
+            int64_t blockRows = min(TILE_SIZE, rowSize - blockStart);
+            for (int64_t i = 0; i < blockRows; ++i)
+            {
+                memcpy(inBlock.data() + i * colSize, myReader.nextRow(), inRowBytes);
+            }
+            transposeBlock(inBlock.data(), blockRows, colSize, outData.data() + blockStart, rowSize);
+        }
+        for (int64_t k = 0; k < colSize; ++k)
+        {
+            ciftiOut->setRow(outData.data() + k * rowSize, k);
+        }
+        return;
+    }
+    //out of core: first pass transposes blocks of input rows into a temporary file, in block order, with the part of every output row from a block contiguous
+    //second pass assembles groups of output rows, reading one contiguous piece per input block
+    int64_t blockRows = memLimitBytes / 2 / inRowBytes;//input block and its transpose
+    if (blockRows < 1) blockRows = 1;
+    if (blockRows > rowSize) blockRows = rowSize;
+    CaretTemporaryFile tempFile;//deleted when it goes out of scope
+    tempFile.createEmptyFile();
+    CaretBinaryFile tempIO(tempFile.getFileName(), CaretBinaryFile::READ_WRITE_TRUNCATE);
+    {
+        vector<float> inBlock(blockRows * colSize), outBlock(blockRows * colSize);
+        for (int64_t blockStart = 0; blockStart < rowSize; blockStart += blockRows)
+        {
+            int64_t thisBlockRows = min(blockRows, rowSize - blockStart);
+            for (int64_t i = 0; i < thisBlockRows; ++i)
+            {
+                memcpy(inBlock.data() + i * colSize, myReader.nextRow(), inRowBytes);
+            }
+            transposeBlock(inBlock.data(), thisBlockRows, colSize, outBlock.data(), thisBlockRows);
+            tempIO.write(outBlock.data(), thisBlockRows * inRowBytes);//data in the temporary file is native byte order, it never leaves this machine
+        }
     }
-    vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
-    vector<float> scratchInRow(colSize);
-    for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
+    int64_t groupRows = memLimitBytes / ((rowSize + blockRows) * sizeof(float));//output rows, plus one piece from a block
+    if (groupRows < 1) groupRows = 1;
+    if (groupRows > colSize) groupRows = colSize;
+    vector<float> outGroup(groupRows * rowSize), piece(groupRows * blockRows);
+    for (int64_t groupStart = 0; groupStart < colSize; groupStart += groupRows)
     {
-        int end = i + numCacheRows;
-        if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
+        int64_t thisGroupRows = min(groupRows, colSize - groupStart);
+        for (int64_t blockStart = 0; blockStart < rowSize; blockStart += blockRows)
         {
-            ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
+            int64_t thisBlockRows = min(blockRows, rowSize - blockStart);
+            tempIO.seek((blockStart * colSize + groupStart * thisBlockRows) * sizeof(float));
+            tempIO.read(piece.data(), thisGroupRows * thisBlockRows * sizeof(float));
+            for (int64_t k = 0; k < thisGroupRows; ++k)
             {
-                cacheRows[k - i][j] = scratchInRow[k];
+                memcpy(outGroup.data() + k * rowSize + blockStart, piece.data() + k * thisBlockRows, thisBlockRows * sizeof(float));
             }
         }
-        for (int k = i; k < end; ++k)
+        for (int64_t k = 0; k < thisGroupRows; ++k)
         {
-            ciftiOut->setRow(cacheRows[k - i].data(), k);
+            ciftiOut->setRow(outGroup.data() + k * rowSize, groupStart + k);
         }
     }
 }
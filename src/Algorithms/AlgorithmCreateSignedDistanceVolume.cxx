@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <set>
 
 using namespace caret;
@@ -70,10 +71,14 @@ OperationParameters* AlgorithmCreateSignedDistanceVolume::getParameters()
     OptionalParameter* windingMethodOpt = ret->createOptionalParameter(8, "-winding", "winding method for point inside surface test");
     windingMethodOpt->addStringParameter(1, "method", "name of the method (default EVEN_ODD)");
     
+    ret->createOptionalParameter(10, "-fast-sweep", "use fast sweeping instead of dijkstra's method for the approximate region");
+    
     ret->setHelpText(
         AString("Computes the signed distance function of the surface.  Exact distance is calculated by finding the closest point on any surface triangle ") +
         "to the center of the voxel.  Approximate distance is calculated starting with these distances, using dijkstra's method with a neighborhood of voxels.  " +
-        "Specifying too small of an exact distance may produce unexpected results.  Valid specifiers for winding methods are as follows:\n\n" +
+        "Specifying too small of an exact distance may produce unexpected results.  " +
+        "The -fast-sweep option instead solves for distance with repeated sweeps through the volume in all 8 combinations of axis directions, which takes time proportional to the number of voxels, " +
+        "so it is much faster for large approximate limits, but it is less accurate far from the exact region, and ignores -approx-neighborhood.  Valid specifiers for winding methods are as follows:\n\n" +
         "EVEN_ODD (default)\nNEGATIVE\nNONZERO\nNORMALS\n\nThe NORMALS method uses the normals of triangles and edges, or the closest triangle hit by a ray from the point.  " +
         "This method may be slightly faster, but is only reliable for a closed surface that does not cross through itself.  All other methods count entry (positive) and " +
         "exit (negative) crossings of a vertical ray from the point, then counts as inside if the total is odd, negative, or nonzero, respectively."
@@ -144,11 +149,13 @@ void AlgorithmCreateSignedDistanceVolume::useParameters(OperationParameters* myP
     {
         myRoiOut = roiOutOpt->getOutputVolume(1);
     }
-    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding);
+    bool fastSweep = myParams->getOptionalParameter(10)->m_present;
+    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding, fastSweep);
 }
 
 AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(ProgressObject* myProgObj, const SurfaceFile* mySurf, VolumeFile* myVolOut, VolumeFile* myRoiOut, const float& fillValue,
-                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding) : AbstractAlgorithm(myProgObj)
+                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding,
+                                                                         const bool& fastSweep) : AbstractAlgorithm(myProgObj)
 {
     if (exactLim <= 0.0f)
     {
@@ -285,7 +292,101 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
         }
     }
     myProgress.reportProgress(markweight + exactweight);
-    if (approxLim > exactLim)
+    if (approxLim > exactLim && fastSweep)
+    {
+        myProgress.setTask("approximating distances in extended region");
+        const float UNSET = numeric_limits<float>::infinity();
+        const float spacing[3] = { ivec.length(), jvec.length(), kvec.length() };//first order upwind scheme, treats the voxel axes as orthogonal
+        const float tolerance = min(min(spacing[0], spacing[1]), spacing[2]) * 0.0001f;
+        const int64_t steps[3] = { 1, myDims[0], myDims[0] * myDims[1] };
+        vector<float> absDist(frameSize, UNSET);
+        vector<signed char> distSign(frameSize, 0);
+        int numExact = (int)exactVoxelList.size();
+        for (int i = 0; i < numExact; i += 3)
+        {
+            int64_t thisIndex = myVolOut->getIndex(exactVoxelList.data() + i);
+            float tempf = myVolOut->getValue(exactVoxelList.data() + i);
+            absDist[thisIndex] = abs(tempf);
+            distSign[thisIndex] = (tempf < 0.0f ? -1 : 1);
+        }
+        bool changed = true;
+        for (int round = 0; changed && round < 100; ++round)
+        {//each round is the 8 sweep directions, repeat until nothing improves, which usually takes 2 or 3 rounds
+            changed = false;
+            for (int sweep = 0; sweep < 8; ++sweep)
+            {
+                for (int64_t kcount = 0; kcount < myDims[2]; ++kcount)
+                {
+                    ijk[2] = ((sweep & 4) ? myDims[2] - 1 - kcount : kcount);
+                    for (int64_t jcount = 0; jcount < myDims[1]; ++jcount)
+                    {
+                        ijk[1] = ((sweep & 2) ? myDims[1] - 1 - jcount : jcount);
+                        for (int64_t icount = 0; icount < myDims[0]; ++icount)
+                        {
+                            ijk[0] = ((sweep & 1) ? myDims[0] - 1 - icount : icount);
+                            int64_t thisIndex = ijk[0] + steps[1] * ijk[1] + steps[2] * ijk[2];
+                            if ((volMarked[thisIndex] & 4) != 0) continue;//exact values don't change
+                            float neighDist[3], neighSpacing[3];
+                            signed char neighSign[3];
+                            for (int axis = 0; axis < 3; ++axis)
+                            {//smaller of the two neighbors along each axis
+                                neighDist[axis] = UNSET;
+                                neighSign[axis] = 0;
+                                neighSpacing[axis] = spacing[axis];
+                                if (ijk[axis] > 0 && absDist[thisIndex - steps[axis]] < neighDist[axis])
+                                {
+                                    neighDist[axis] = absDist[thisIndex - steps[axis]];
+                                    neighSign[axis] = distSign[thisIndex - steps[axis]];
+                                }
+                                if (ijk[axis] < myDims[axis] - 1 && absDist[thisIndex + steps[axis]] < neighDist[axis])
+                                {
+                                    neighDist[axis] = absDist[thisIndex + steps[axis]];
+                                    neighSign[axis] = distSign[thisIndex + steps[axis]];
+                                }
+                            }
+                            for (int a = 1; a < 3; ++a)
+                            {//stupid sort, by distance
+                                for (int b = a; b > 0 && neighDist[b] < neighDist[b - 1]; --b)
+                                {
+                                    swap(neighDist[b], neighDist[b - 1]);
+                                    swap(neighSign[b], neighSign[b - 1]);
+                                    swap(neighSpacing[b], neighSpacing[b - 1]);
+                                }
+                            }
+                            if (neighDist[0] == UNSET) continue;
+                            float newDist = neighDist[0] + neighSpacing[0];
+                            float weightSum = 0.0f, weightedDist = 0.0f, weightedSqr = 0.0f;
+                            for (int used = 0; used < 3 && newDist > neighDist[used]; ++used)
+                            {//solve sum over used axes of ((u - neighDist) / spacing)^2 = 1, adding axes while the answer is larger than their neighbor
+                                float weight = 1.0f / (neighSpacing[used] * neighSpacing[used]);
+                                weightSum += weight;
+                                weightedDist += weight * neighDist[used];
+                                weightedSqr += weight * neighDist[used] * neighDist[used];
+                                float discriminant = weightedDist * weightedDist - weightSum * (weightedSqr - 1.0f);
+                                newDist = (weightedDist + sqrt(max(discriminant, 0.0f))) / weightSum;
+                            }
+                            if (newDist < absDist[thisIndex])
+                            {
+                                if (absDist[thisIndex] - newDist > tolerance) changed = true;
+                                absDist[thisIndex] = newDist;
+                                distSign[thisIndex] = neighSign[0];//the sign can't change without crossing the exact region
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if ((volMarked[i] & 4) == 0 && absDist[i] <= approxLim)
+            {
+                float tempf = absDist[i] * distSign[i];
+                myVolOut->setValue(tempf, i % steps[1], (i / steps[1]) % myDims[1], i / steps[2]);
+                volMarked[i] |= (tempf < 0.0f ? 16 : 2) | 4;//valid and frozen, the same as the dijkstra method leaves it
+            }
+        }
+    }
+    if (approxLim > exactLim && !fastSweep)
     {
         myProgress.setTask("approximating distances in extended region");
         int faceNeigh[] = { 1, 0, 0, 
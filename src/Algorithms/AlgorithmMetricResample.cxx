@@ -27,6 +27,8 @@
 #include "SurfaceFile.h"
 #include "SurfaceResamplingHelper.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -69,6 +71,9 @@ OperationParameters* AlgorithmMetricResample::getParameters()
     
     ret->createOptionalParameter(10, "-largest", "use only the value of the vertex with the largest weight");
     
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(11, "-weights-cache", "reuse resampling weights across runs");
+    cacheOpt->addStringParameter(1, "directory", "the directory to store and look up weight files in");
+    
     AString myHelpText =
         AString("Resamples a metric file, given two spherical surfaces that are in register.  ") +
         "If the method does area correction, exactly one of -area-surfs or -area-metrics must be specified.\n\n" +
@@ -76,6 +81,8 @@ OperationParameters* AlgorithmMetricResample::getParameters()
         "when using -current-roi.\n\n" +
         "The -largest option results in nearest vertex behavior when used with BARYCENTRIC, instead of doing a weighted average, it uses the value " +
         "of the source vertex that has the largest weight for each target vertex.  This is mainly intended for resampling ROI metrics.\n\n" +
+        "The -weights-cache option saves the resampling weights in the specified directory, in a file named by a hash of the spheres, method, area data and roi, " +
+        "and later runs with the same inputs load them from there instead of recomputing them.\n\n" +
         "The <method> argument must be one of the following:\n\n";
     
     vector<SurfaceResamplingMethodEnum::Enum> allEnums;
@@ -158,12 +165,19 @@ void AlgorithmMetricResample::useParameters(OperationParameters* myParams, Progr
         validRoiOut = validRoiOutOpt->getOutputMetric(1);
     }
     bool largest = myParams->getOptionalParameter(10)->m_present;
-    AlgorithmMetricResample(myProgObj, metricIn, curSphere, newSphere, myMethod, metricOut, curAreas, newAreas, currentRoi, validRoiOut, largest);
+    AString cacheDir;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(11);
+    if (cacheOpt->m_present)
+    {
+        cacheDir = cacheOpt->getString(1);
+    }
+    AlgorithmMetricResample(myProgObj, metricIn, curSphere, newSphere, myMethod, metricOut, curAreas, newAreas, currentRoi, validRoiOut, largest, cacheDir);
 }
 
 AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, const MetricFile* metricIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                  const SurfaceResamplingMethodEnum::Enum& myMethod, MetricFile* metricOut, const MetricFile* curAreas, const MetricFile* newAreas,
-                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest) : AbstractAlgorithm(myProgObj)
+                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest,
+                                                 const AString& cacheDir) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (metricIn->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("input metric has different number of nodes than input sphere");
@@ -186,7 +200,7 @@ AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, cons
     vector<float> colScratch(numNewNodes, 0.0f);
     const float* roiCol = NULL;
     if (currentRoi != NULL) roiCol = currentRoi->getValuePointerForColumn(0);
-    SurfaceResamplingHelper myHelp(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol);
+    SurfaceResamplingHelper myHelp(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol, cacheDir);
     if (validRoiOut != NULL)
     {
         validRoiOut->setNumberOfNodesAndColumns(numNewNodes, 1);
@@ -199,13 +213,37 @@ AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, cons
     {
         metricOut->setColumnName(i, metricIn->getColumnName(i));
         *metricOut->getPaletteColorMapping(i) = *metricIn->getPaletteColorMapping(i);
-        if (largest)
+    }
+    if (largest)
+    {
+        for (int i = 0; i < numColumns; ++i)
         {
             myHelp.resampleLargest(metricIn->getValuePointerForColumn(i), colScratch.data());
-        } else {
-            myHelp.resampleNormal(metricIn->getValuePointerForColumn(i), colScratch.data());
+            metricOut->setValuesForColumn(i, colScratch.data());
+        }
+    } else {
+        const int COLUMN_CHUNK = 32;//resample several columns per pass over the weights, but don't make a full copy of the output
+        int chunkSize = min(COLUMN_CHUNK, numColumns);
+        colScratch.resize((int64_t)numNewNodes * chunkSize);
+        vector<const float*> inPointers(chunkSize);
+        vector<float*> outPointers(chunkSize);
+        for (int i = 0; i < chunkSize; ++i)
+        {
+            outPointers[i] = colScratch.data() + (int64_t)i * numNewNodes;
+        }
+        for (int start = 0; start < numColumns; start += chunkSize)
+        {
+            int thisChunk = min(chunkSize, numColumns - start);
+            for (int i = 0; i < thisChunk; ++i)
+            {
+                inPointers[i] = metricIn->getValuePointerForColumn(start + i);
+            }
+            myHelp.resampleNormal(inPointers.data(), outPointers.data(), thisChunk);
+            for (int i = 0; i < thisChunk; ++i)
+            {
+                metricOut->setValuesForColumn(start + i, outPointers[i]);
+            }
         }
-        metricOut->setValuesForColumn(i, colScratch.data());
     }
 }
 
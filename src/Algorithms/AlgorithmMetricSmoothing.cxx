@@ -68,6 +68,9 @@ OperationParameters* AlgorithmMetricSmoothing::getParameters()
     OptionalParameter* methodSelect = ret->createOptionalParameter(9, "-method", "select smoothing method, default GEO_GAUSS_AREA");
     methodSelect->addStringParameter(1, "method", "the name of the smoothing method");
     
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(10, "-kernel-cache", "reuse smoothing kernels across runs");
+    cacheOpt->addStringParameter(1, "directory", "the directory to store and look up kernel files in");
+    
     ret->setHelpText(
         AString("Smooth a metric file on a surface.  ") +
         "By default, smooths all input columns on the entire surface, specify -column to use only one input column, and -roi to smooth only where " +
@@ -88,7 +91,10 @@ OperationParameters* AlgorithmMetricSmoothing::getParameters()
         "The GEO_GAUSS_AREA method is the default because it is usually the correct choice.  " +
         "GEO_GAUSS_EQUAL may be the correct choice when the sum of vertex values is more meaningful then the surface integral (sum of values .* areas), " +
         "for instance when smoothing vertex areas (the sum is the total surface area, while the surface integral is the sum of squares of the vertex areas).  " +
-        "The GEO_GAUSS method is not recommended, it exists mainly to replicate methods of studies done with caret5's smoothing."
+        "The GEO_GAUSS method is not recommended, it exists mainly to replicate methods of studies done with caret5's smoothing.\n\n" +
+        "The -kernel-cache option saves the smoothing kernels in the specified directory, named by a hash of the surface, kernel size, method, roi and vertex areas, " +
+        "so that later runs with the same inputs load them instead of recomputing them.  " +
+        "Use -metric-smoothing-precompute to build them ahead of time."
     );
     return ret;
 }
@@ -141,12 +147,19 @@ void AlgorithmMetricSmoothing::useParameters(OperationParameters* myParams, Prog
             throw AlgorithmException("unknown smoothing method name");
         }
     }
-    AlgorithmMetricSmoothing(myProgObj, mySurf, myMetric, myKernel, myMetricOut, myRoi, matchRoiColumns, fixZeros, columnNum, corrAreaMetric, myMethod);
+    AString kernelCacheDir;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(10);
+    if (cacheOpt->m_present)
+    {
+        kernelCacheDir = cacheOpt->getString(1);
+    }
+    AlgorithmMetricSmoothing(myProgObj, mySurf, myMetric, myKernel, myMetricOut, myRoi, matchRoiColumns, fixZeros, columnNum, corrAreaMetric, myMethod, kernelCacheDir);
 }
 
 AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric,
                                                    const double myKernel, MetricFile* myMetricOut, const MetricFile* myRoi, const bool matchRoiColumns,
-                                                   const bool fixZeros, const int64_t columnNum, const MetricFile* corrAreaMetric, const MetricSmoothingObject::Method myMethod) : AbstractAlgorithm(myProgObj)
+                                                   const bool fixZeros, const int64_t columnNum, const MetricFile* corrAreaMetric, const MetricSmoothingObject::Method myMethod,
+                                                   const AString& kernelCacheDir) : AbstractAlgorithm(myProgObj)
 {
     float precomputeWeightWork = 5.0f;//TODO: adjust this based on number of columns to smooth, if we ever end up using progress indicators
     LevelProgress myProgress(myProgObj, 1.0f + precomputeWeightWork);
@@ -185,9 +198,9 @@ AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, co
     myProgress.setTask("Precomputing Smoothing Weights");
     if (matchRoiColumns)
     {
-        mySmoothObj.grabNew(new MetricSmoothingObject(mySurf, myKernel, NULL, myMethod, areaData));//don't use an ROI to build weights when the ROI changes each time
+        mySmoothObj.grabNew(new MetricSmoothingObject(mySurf, myKernel, NULL, myMethod, areaData, kernelCacheDir));//don't use an ROI to build weights when the ROI changes each time
     } else {
-        mySmoothObj.grabNew(new MetricSmoothingObject(mySurf, myKernel, myRoi, myMethod, areaData));
+        mySmoothObj.grabNew(new MetricSmoothingObject(mySurf, myKernel, myRoi, myMethod, areaData, kernelCacheDir));
     }
     myProgress.reportProgress(precomputeWeightWork);
     if (columnNum == -1)
@@ -25,6 +25,8 @@
 #include "CaretOMP.h"
 #include "Vector3D.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -132,33 +134,71 @@ AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myP
             *(outVol->getMapLabelTable(i)) = *(inVol->getMapLabelTable(i));
         }
     }
-    for (int64_t c = 0; c < numComponents; ++c)
+    const int64_t CHUNK_COORDS = 1 << 20;//compute weights for about this many output voxels at once, 64MB of cubic weights
+    const int64_t planeSize = outDims[0] * outDims[1];
+    const int64_t chunkPlanes = max((int64_t)1, CHUNK_COORDS / max(planeSize, (int64_t)1));
+    const int64_t numChunks = (outDims[2] + chunkPlanes - 1) / chunkPlanes;
+    const int64_t numFrames = numMaps * numComponents;
+    const bool isCubic = (myMethod == VolumeFile::CUBIC);
+    const bool frameMajor = isCubic && numChunks > 1;//keeping every frame's spline would double the memory, so for large cubic outputs, recompute weights per frame instead
+    const int64_t outerCount = frameMajor ? numFrames : numChunks, innerCount = frameMajor ? numChunks : numFrames;
+    if (isCubic && numFrames > 1)
+    {
+        inVol->validateAllSplines();//for small inputs, compute the splines in parallel across frames, each is still freed once its frame is done
+    }
+    VolumeFile::InterpolationStencils stencils;
+    vector<float> coords, values;
+    int64_t preparedChunk = -1;
+    for (int64_t outer = 0; outer < outerCount; ++outer)
     {
-        for (int64_t b = 0; b < numMaps; ++b)
+        for (int64_t inner = 0; inner < innerCount; ++inner)
         {
-            if (myMethod == VolumeFile::CUBIC)
+            const int64_t chunk = frameMajor ? inner : outer, frame = frameMajor ? outer : inner;
+            const int64_t b = frame % numMaps, c = frame / numMaps;
+            const int64_t kstart = chunk * chunkPlanes, kend = min(kstart + chunkPlanes, outDims[2]);
+            const int64_t numCoords = (kend - kstart) * planeSize;
+            if (chunk != preparedChunk)
+            {
+                coords.resize(numCoords * 3);
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int64_t k = kstart; k < kend; ++k)
+                {
+                    for (int64_t j = 0; j < outDims[1]; ++j)
+                    {
+                        for (int64_t i = 0; i < outDims[0]; ++i)
+                        {
+                            Vector3D outCoord, inCoord;
+                            outVol->indexToSpace(i, j, k, outCoord);
+                            inCoord = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
+                            float* coordOut = coords.data() + ((k - kstart) * planeSize + j * outDims[0] + i) * 3;
+                            coordOut[0] = inCoord[0];
+                            coordOut[1] = inCoord[1];
+                            coordOut[2] = inCoord[2];
+                        }
+                    }
+                }
+                inVol->prepareInterpolation(coords.data(), numCoords, myMethod, stencils);
+                values.resize(numCoords);
+                preparedChunk = chunk;
+            }
+            inVol->interpolateFrame(stencils, values.data(), b, c);
+            if (isCubic && chunk == numChunks - 1)
             {
-                inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
+                inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
             }
 #pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
+            for (int64_t k = kstart; k < kend; ++k)
             {
+                int64_t index = (k - kstart) * planeSize;
                 for (int64_t j = 0; j < outDims[1]; ++j)
                 {
                     for (int64_t i = 0; i < outDims[0]; ++i)
                     {
-                        Vector3D outCoord, inCoord;
-                        outVol->indexToSpace(i, j, k, outCoord);
-                        inCoord = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
-                        float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                        outVol->setValue(interpVal, i, j, k, b, c);
+                        outVol->setValue(values[index], i, j, k, b, c);
+                        ++index;
                     }
                 }
             }
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
-            }
         }
     }
 }
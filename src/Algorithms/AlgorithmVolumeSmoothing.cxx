@@ -25,11 +25,144 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    struct RecursiveGaussCoefs
+    {//Young and van Vliet recursive gaussian: forward w[n] = B * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3], then the same backward
+        double B, a1, a2, a3;
+        int64_t pad;//zeros to run the forward pass into before starting the backward pass, so the right edge behaves like zero padding
+    };
+    
+    RecursiveGaussCoefs computeRecursiveCoefs(const double& sigma)
+    {//sigma is in voxels, the approximation is good for sigma >= 0.5
+        double q;
+        if (sigma >= 2.5)
+        {
+            q = 0.98711 * sigma - 0.96330;
+        } else {
+            q = 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+        }
+        double q2 = q * q, q3 = q2 * q;
+        double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        RecursiveGaussCoefs ret;
+        ret.a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+        ret.a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+        ret.a3 = 0.422205 * q3 / b0;
+        ret.B = 1.0 - (ret.a1 + ret.a2 + ret.a3);//unit gain
+        ret.pad = (int64_t)ceil(4.0 * sigma) + 3;
+        return ret;
+    }
+    
+    const int RECURSIVE_LINES = 16;//lines filtered together, so the inner loops run across lines and vectorize
+    
+    //filters numLines lines in place, line l starts at (l % innerCount) * innerStride + (l / innerCount) * outerStride and steps by posStride
+    void recursiveGaussAxis(float* data, const int64_t& length, const int64_t& posStride, const int64_t& numLines,
+                            const int64_t& innerCount, const int64_t& innerStride, const int64_t& outerStride, const RecursiveGaussCoefs& coefs)
+    {
+        const double B = coefs.B, a1 = coefs.a1, a2 = coefs.a2, a3 = coefs.a3;
+        int64_t numBatches = (numLines + RECURSIVE_LINES - 1) / RECURSIVE_LINES;
+        int64_t bufLength = 3 + length + coefs.pad + 3;//3 rows of zeros at each end are the initial conditions
+#pragma omp CARET_PAR
+        {
+            vector<double> buffer(bufLength * RECURSIVE_LINES, 0.0);//row n holds position n - 3 of every line in the batch
+            int64_t lineStart[RECURSIVE_LINES];
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t batch = 0; batch < numBatches; ++batch)
+            {
+                int64_t firstLine = batch * RECURSIVE_LINES;
+                int batchLines = (int)min((int64_t)RECURSIVE_LINES, numLines - firstLine);
+                for (int w = 0; w < batchLines; ++w)
+                {
+                    int64_t line = firstLine + w;
+                    lineStart[w] = (line % innerCount) * innerStride + (line / innerCount) * outerStride;
+                }
+                for (int64_t n = 0; n < length; ++n)
+                {
+                    double* row = buffer.data() + (n + 3) * RECURSIVE_LINES;
+                    for (int w = 0; w < batchLines; ++w)
+                    {
+                        row[w] = data[lineStart[w] + n * posStride];
+                    }
+                }
+                for (int64_t n = 3 + length; n < bufLength - 3; ++n)
+                {//the previous batch left its output in the padding
+                    double* row = buffer.data() + n * RECURSIVE_LINES;
+                    for (int w = 0; w < RECURSIVE_LINES; ++w)
+                    {
+                        row[w] = 0.0;
+                    }
+                }
+                for (int64_t n = 3; n < bufLength - 3; ++n)//lanes past batchLines hold finite leftovers, filtering them is harmless
+                {
+                    double* row = buffer.data() + n * RECURSIVE_LINES;
+                    const double* prev1 = row - RECURSIVE_LINES, *prev2 = prev1 - RECURSIVE_LINES, *prev3 = prev2 - RECURSIVE_LINES;
+                    for (int w = 0; w < RECURSIVE_LINES; ++w)
+                    {
+                        row[w] = B * row[w] + a1 * prev1[w] + a2 * prev2[w] + a3 * prev3[w];
+                    }
+                }
+                for (int64_t n = bufLength - 4; n >= 3; --n)
+                {
+                    double* row = buffer.data() + n * RECURSIVE_LINES;
+                    const double* next1 = row + RECURSIVE_LINES, *next2 = next1 + RECURSIVE_LINES, *next3 = next2 + RECURSIVE_LINES;
+                    for (int w = 0; w < RECURSIVE_LINES; ++w)
+                    {
+                        row[w] = B * row[w] + a1 * next1[w] + a2 * next2[w] + a3 * next3[w];
+                    }
+                }
+                for (int64_t n = 0; n < length; ++n)
+                {
+                    const double* row = buffer.data() + (n + 3) * RECURSIVE_LINES;
+                    for (int w = 0; w < batchLines; ++w)
+                    {
+                        data[lineStart[w] + n * posStride] = row[w];
+                    }
+                }
+            }
+        }
+    }
+    
+    //normalized convolution: smooth the data with excluded voxels zeroed, smooth the mask of used voxels, and divide, same as the explicit kernel does with its weight sums
+    void smoothFrameRecursive(const float* inFrame, const vector<int64_t>& myDims, const float* roiFrame, const bool& fixZeros,
+                              const RecursiveGaussCoefs coefs[3], const float& minWeight, float* outFrame, float* weightFrame)
+    {
+        int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            if ((roiFrame == NULL || roiFrame[v] > 0.0f) && (!fixZeros || inFrame[v] != 0.0f))
+            {
+                outFrame[v] = inFrame[v];
+                weightFrame[v] = 1.0f;
+            } else {
+                outFrame[v] = 0.0f;
+                weightFrame[v] = 0.0f;
+            }
+        }
+        float* arrays[2] = { outFrame, weightFrame };
+        for (int a = 0; a < 2; ++a)
+        {
+            recursiveGaussAxis(arrays[a], myDims[0], 1, myDims[1] * myDims[2], myDims[1] * myDims[2], myDims[0], 0, coefs[0]);
+            recursiveGaussAxis(arrays[a], myDims[1], myDims[0], myDims[0] * myDims[2], myDims[0], 1, myDims[0] * myDims[1], coefs[1]);
+            recursiveGaussAxis(arrays[a], myDims[2], myDims[0] * myDims[1], myDims[0] * myDims[1], myDims[0] * myDims[1], 1, 0, coefs[2]);
+        }
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            if ((roiFrame == NULL || roiFrame[v] > 0.0f) && weightFrame[v] > minWeight)
+            {
+                outFrame[v] /= weightFrame[v];
+            } else {
+                outFrame[v] = 0.0f;
+            }
+        }
+    }
+}
+
 //makes the program issue warning only once per launch, prevents repeated calls by other algorithms from spamming
 bool AlgorithmVolumeSmoothing::haveWarned = false;
 
@@ -60,13 +193,19 @@ OperationParameters* AlgorithmVolumeSmoothing::getParameters()
     OptionalParameter* subvolSelect = ret->createOptionalParameter(6, "-subvolume", "select a single subvolume to smooth");
     subvolSelect->addStringParameter(1, "subvol", "the subvolume number or name");
     
+    ret->createOptionalParameter(7, "-recursive", "use a recursive approximation of the gaussian, faster for large kernels");
+    
     ret->setHelpText(
         AString("Gaussian smoothing for volumes.  By default, smooths all subvolumes with no ROI, if ROI is given, only ") +
         "positive voxels in the ROI volume have their values used, and all other voxels are set to zero.  Smoothing a non-orthogonal volume will " +
         "be significantly slower, because the operation cannot be separated into 1-dimensional smoothings without distorting the kernel shape.\n\n" +
         "The -fix-zeros option causes the smoothing to not use an input value if it is zero, but still write a smoothed value to the voxel.  " +
         "This is useful for zeros that indicate lack of information, preventing them from pulling down the intensity of nearby voxels, while " +
-        "giving the zero an extrapolated value."
+        "giving the zero an extrapolated value.\n\n" +
+        "The -recursive option uses a recursive filter (Young and van Vliet) that approximates the gaussian with a cost per voxel that does not depend on the kernel size, " +
+        "instead of explicitly convolving with the gaussian truncated at 3 sigma.  " +
+        "The results differ slightly, mainly where -fix-zeros or -roi leave few voxels with data nearby.  " +
+        "It only applies to orthogonal volumes with a kernel of at least one voxel along each axis, otherwise the explicit kernel is used."
     );
     return ret;
 }
@@ -94,10 +233,12 @@ void AlgorithmVolumeSmoothing::useParameters(OperationParameters* myParams, Prog
             throw AlgorithmException("invalid subvolume specified");
         }
     }
-    AlgorithmVolumeSmoothing(myProgObj, myVol, myKernel, myOutVol, roiVol, fixZeros, subvolNum);
+    bool recursive = myParams->getOptionalParameter(7)->m_present;
+    AlgorithmVolumeSmoothing(myProgObj, myVol, myKernel, myOutVol, roiVol, fixZeros, subvolNum, recursive);
 }
 
-AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros, const int& subvol) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros, const int& subvol,
+                                                   const bool& recursive) : AbstractAlgorithm(myProgObj)
 {
     CaretAssert(inVol != NULL);
     CaretAssert(outVol != NULL);
@@ -124,7 +265,62 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     ivec[1] = volSpace[1][0]; jvec[1] = volSpace[1][1]; kvec[1] = volSpace[1][2]; origin[1] = volSpace[1][3];
     ivec[2] = volSpace[2][0]; jvec[2] = volSpace[2][1]; kvec[2] = volSpace[2][2]; origin[2] = volSpace[2][3];
     const float ORTH_TOLERANCE = 0.001f;//tolerate this much deviation from orthogonal (dot product divided by product of lengths) to use orthogonal assumptions to smooth
-    if (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE)
+    bool isOrthogonal = (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE);
+    if (recursive)
+    {
+        float spacing[3] = { ivec.length(), jvec.length(), kvec.length() };
+        if (!isOrthogonal)
+        {
+            CaretLogWarning("recursive smoothing requires an orthogonal volume, using the explicit kernel");
+        } else if (kernel < spacing[0] || kernel < spacing[1] || kernel < spacing[2]) {
+            CaretLogInfo("kernel is smaller than a voxel, using the explicit kernel instead of recursive smoothing");
+        } else {
+            RecursiveGaussCoefs coefs[3];
+            float minWeight = 1.0f;//treat voxels as having no data when the weight is less than one voxel at 3 sigma on every axis would give, like the truncated kernel
+            for (int a = 0; a < 3; ++a)
+            {
+                double sigmaVox = kernel / spacing[a];
+                coefs[a] = computeRecursiveCoefs(sigmaVox);
+                minWeight *= exp(-4.5) / (sqrt(2.0 * 3.14159265358979) * sigmaVox);
+            }
+            vector<int64_t> origDims = inVol->getOriginalDimensions();
+            vector<int> subvolList;
+            if (subvol == -1)
+            {
+                outVol->reinitialize(origDims, volSpace, myDims[4]);
+                for (int s = 0; s < myDims[3]; ++s)
+                {
+                    outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
+                    subvolList.push_back(s);
+                }
+            } else {
+                origDims.resize(3);
+                outVol->reinitialize(origDims, volSpace, myDims[4]);
+                outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
+                subvolList.push_back(subvol);
+            }
+            const float* roiFrame = NULL;
+            if (roiVol != NULL) roiFrame = roiVol->getFrame();
+            int numFrames = (int)subvolList.size() * myDims[4];
+            int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+#pragma omp CARET_PAR if (numFrames > 1)
+            {//frames in parallel, the axis filtering only uses multiple threads when there is one frame (nested parallel regions get one thread)
+                vector<float> outFrame(frameSize), weightFrame(frameSize);
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int f = 0; f < numFrames; ++f)
+                {
+                    int whichSubvol = f / myDims[4], c = f % myDims[4];
+                    smoothFrameRecursive(inVol->getFrame(subvolList[whichSubvol], c), myDims, roiFrame, fixZeros, coefs, minWeight, outFrame.data(), weightFrame.data());
+#pragma omp critical
+                    {
+                        outVol->setFrame(outFrame.data(), whichSubvol, c);
+                    }
+                }
+            }
+            return;
+        }
+    }
+    if (isOrthogonal)
     {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
         CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights(myDims[0] * myDims[1] * myDims[2]), scratchWeights2(myDims[0] * myDims[1] * myDims[2]), scratchFrame3;
         if (roiVol != NULL)
@@ -42,7 +42,7 @@ namespace caret {
         void smoothFrameNonOrth(const float* inFrame, const std::vector<int64_t>& myDims, CaretArray<float>& scratchFrame, const VolumeFile* inVol, const VolumeFile* roiVol, const CaretArray<float**>& weights, const int& irange, const int& jrange, const int& krange, const bool& fixZeros);
     public:
         AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol,
-                                 const VolumeFile* roiVol = NULL, const bool& fixZeros = false, const int& subvol = -1);
+                                 const VolumeFile* roiVol = NULL, const bool& fixZeros = false, const int& subvol = -1, const bool& recursive = false);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
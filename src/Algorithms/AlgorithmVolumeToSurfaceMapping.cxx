@@ -48,6 +48,9 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "AlgorithmVolumeToSurfaceMapping.h"
 #include "AlgorithmException.h"
 
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretBinaryFile.h"
 #include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
@@ -57,7 +60,9 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "Vector3D.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
@@ -97,6 +102,10 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     OptionalParameter* ribbonWeights = ribbonOpt->createOptionalParameter(5, "-output-weights", "write the voxel weights for a vertex to a volume file");
     ribbonWeights->addIntegerParameter(1, "vertex", "the vertex number to get the voxel weights for, 0-based");
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
+    OptionalParameter* ribbonSave = ribbonOpt->createOptionalParameter(6, "-save-weights", "save the voxel weights of all vertices, to reuse with -load-weights");
+    ribbonSave->addStringParameter(1, "weights-file-out", "output - file to write the weights to");//HACK: fake the output format, there is no file type for this
+    OptionalParameter* ribbonLoad = ribbonOpt->createOptionalParameter(7, "-load-weights", "use weights saved by -save-weights instead of computing them");
+    ribbonLoad->addStringParameter(1, "weights-file", "the saved weights file");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -114,7 +123,10 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "The volume ROI is useful to exclude partial volume effects of voxels the surfaces pass through, and will cause the mapping to ignore " +
         "voxels that don't have a positive value in the mask.  The subdivision number specifies how it approximates the amount of the volume the polyhedron " +
         "intersects, by splitting each voxel into NxNxN pieces, and checking whether the center of each piece is inside the polyhedron.  If you have very large " +
-        "voxels, consider increasing this if you get zeros in your output.\n\n" +
+        "voxels, consider increasing this if you get zeros in your output.  " +
+        "Computing the weights often takes longer than applying them, so when mapping many volumes in the same space with the same surfaces, " +
+        "use -save-weights once and -load-weights for the rest.  Only the number of vertices and the volume space are checked when loading, " +
+        "so the saved weights must have been computed from the same surfaces, volume ROI and subdivisions.\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels closer than the thickness at the vertex " +
         "that are within the ribbon ROI, and less than half the thickness value away from the vertex along the direction of the surface normal, and apply a gaussian kernel " +
         "with the specified sigma to them to get the weights to use."
@@ -228,7 +240,19 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 weightsOutVertex = (int)ribbonWeights->getInteger(1);
                 weightsOut = ribbonWeights->getOutputVolume(2);
             }
-            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, mySubVol, weightsOutVertex, weightsOut);
+            AString weightsSaveFile, weightsLoadFile;
+            OptionalParameter* ribbonSave = ribbonOpt->getOptionalParameter(6);
+            if (ribbonSave->m_present)
+            {
+                weightsSaveFile = ribbonSave->getString(1);
+            }
+            OptionalParameter* ribbonLoad = ribbonOpt->getOptionalParameter(7);
+            if (ribbonLoad->m_present)
+            {
+                weightsLoadFile = ribbonLoad->getString(1);
+            }
+            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, mySubVol, weightsOutVertex, weightsOut,
+                                            weightsSaveFile, weightsLoadFile);
             break;
         }
         case MYELIN_STYLE:
@@ -279,16 +303,18 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             methodName = " enclosing voxel";
             break;
     }
+    VolumeFile::InterpolationStencils stencils;
+    myVolume->prepareInterpolation(mySurface->getCoordinateData(), numNodes, myMethod, stencils);//same coordinates for every frame
     if (mySubVol == -1)
     {
+        if (myMethod == VolumeFile::CUBIC && myVolDims[3] * myVolDims[4] > 1)
+        {
+            myVolume->validateAllSplines();//for small inputs, compute the splines in parallel across frames, each is still freed once its frame is done
+        }
         for (int64_t i = 0; i < myVolDims[3]; ++i)
         {
             for (int64_t j = 0; j < myVolDims[4]; ++j)
             {
-                if (myMethod == VolumeFile::CUBIC)
-                {
-                    myVolume->validateSpline(i, j);//to do spline deconvolution in parallel
-                }
                 AString metricLabel = myVolume->getMapName(i);
                 if (myVolDims[4] != 1)
                 {
@@ -297,11 +323,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
                 metricLabel += methodName;
                 int64_t thisCol = i * myVolDims[4] + j;
                 myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myArray[node] = myVolume->interpolateValue(mySurface->getCoordinate(node), myMethod, NULL, i, j);
-                }
+                myVolume->interpolateFrame(stencils, myArray.data(), i, j);
                 if (myMethod == VolumeFile::CUBIC)
                 {
                     myVolume->freeSpline(i, j);//release memory we no longer need, if we allocated it
@@ -312,10 +334,6 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     } else {
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                myVolume->validateSpline(mySubVol, j);//to do spline deconvolution in parallel
-            }
             AString metricLabel = myVolume->getMapName(mySubVol);
             if (myVolDims[4] != 1)
             {
@@ -324,11 +342,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             metricLabel += methodName;
             int64_t thisCol = j;
             myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                myArray[node] = myVolume->interpolateValue(mySurface->getCoordinate(node), myMethod, NULL, mySubVol, j);
-            }
+            myVolume->interpolateFrame(stencils, myArray.data(), mySubVol, j);
             if (myMethod == VolumeFile::CUBIC)
             {
                 myVolume->freeSpline(mySubVol, j);//release memory we no longer need, if we allocated it
@@ -341,7 +355,8 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 //ribbon mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol,
-                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut,
+                                                                 const AString& weightsSaveFile, const AString& weightsLoadFile) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -375,89 +390,32 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
         weightDims.resize(3);
         weightsOut->reinitialize(weightDims, myVolume->getSform());
     }
-    vector<vector<VoxelWeight> > myWeights;
-    precomputeWeightsRibbon(myWeights, myVolume, innerSurf, outerSurf, roiVol, subdivisions);
-    if (weightsOut != NULL)
+    VoxelWeightMatrix myMatrix;
+    if (weightsLoadFile != "")
     {
-        weightsOut->setValueAllVoxels(0.0f);
-        const vector<VoxelWeight>& vertexWeights = myWeights[weightsOutVertex];
-        int numWeights = (int)vertexWeights.size();
-        for (int i = 0; i < numWeights; ++i)
-        {
-            weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
-        }
+        myMatrix.readFile(weightsLoadFile);
+        if (myMatrix.getNumberOfVertices() != numNodes) throw AlgorithmException("saved weights file has a different number of vertices than the surface");
+        if (!myMatrix.m_space.matches(myVolume->getVolumeSpace())) throw AlgorithmException("saved weights file was made for a different volume space than the input volume");
+    } else {
+        vector<vector<VoxelWeight> > myWeights;
+        precomputeWeightsRibbon(myWeights, myVolume, innerSurf, outerSurf, roiVol, subdivisions);
+        myMatrix.build(myWeights, myVolume->getVolumeSpace());
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
+    if (weightsSaveFile != "")
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
+        myMatrix.writeFile(weightsSaveFile);
+    }
+    if (weightsOut != NULL)
+    {
+        weightsOut->setValueAllVoxels(0.0f);
+        int64_t frameSize = myVolDims[0] * myVolDims[1];
+        for (int64_t i = myMatrix.m_rowStart[weightsOutVertex]; i < myMatrix.m_rowStart[weightsOutVertex + 1]; ++i)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
-            if (myVolDims[4] != 1)
-            {
-                metricLabel += " component " + AString::number(j);
-            }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
+            int64_t voxel = myMatrix.m_voxels[i];
+            weightsOut->setValue(myMatrix.m_weights[i], voxel % myVolDims[0], (voxel % frameSize) / myVolDims[0], voxel / frameSize);
         }
     }
+    applyWeights(myMatrix, myVolume, myMetricOut, mySubVol, " ribbon constrained", true);
 }
 
 //myelin style mapping
@@ -487,62 +445,223 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     myMetricOut->setStructure(mySurface->getStructure());
     vector<vector<VoxelWeight> > myWeights;
     precomputeWeightsMyelin(myWeights, mySurface, roiVol, thickness, sigma);
-    vector<float> myScratch(numNodes);
-    if (mySubVol == -1)
+    VoxelWeightMatrix myMatrix;
+    myMatrix.build(myWeights, myVolume->getVolumeSpace());
+    applyWeights(myMatrix, myVolume, myMetricOut, mySubVol, " ribbon constrained", false);//weights have already been normalized in precompute, for this method
+}
+
+void AlgorithmVolumeToSurfaceMapping::applyWeights(const VoxelWeightMatrix& myMatrix, const VolumeFile* myVolume, MetricFile* myMetricOut, const int64_t& mySubVol,
+                                                   const AString& methodName, const bool& divideByTotal)
+{
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    int64_t numNodes = myMatrix.getNumberOfVertices();
+    vector<int64_t> frameBricks, frameComponents;//frames to map, in output column order
+    for (int64_t i = 0; i < myVolDims[3]; ++i)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
+        if (mySubVol != -1 && i != mySubVol) continue;
+        for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
+            frameBricks.push_back(i);
+            frameComponents.push_back(j);
+        }
+    }
+    int64_t numFrames = (int64_t)frameBricks.size();
+    vector<int32_t> usedVoxels(myMatrix.m_voxels.begin(), myMatrix.m_voxels.end());//only the voxels some vertex uses get gathered
+    sort(usedVoxels.begin(), usedVoxels.end());
+    usedVoxels.erase(unique(usedVoxels.begin(), usedVoxels.end()), usedVoxels.end());
+    int64_t numUsed = (int64_t)usedVoxels.size(), numEntries = (int64_t)myMatrix.m_voxels.size();
+    vector<int64_t> gatherIndex(numEntries);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+    for (int64_t i = 0; i < numEntries; ++i)
+    {
+        gatherIndex[i] = lower_bound(usedVoxels.begin(), usedVoxels.end(), myMatrix.m_voxels[i]) - usedVoxels.begin();
+    }
+    const int64_t BLOCK_FRAMES = 64;//a block of frames is gathered voxel-major, so each weight reads the values for all frames in the block contiguously
+    int64_t blockSize = min(BLOCK_FRAMES, numFrames);
+    vector<float> gathered(numUsed * blockSize), outBlock(numNodes * blockSize);
+    vector<const float*> framePointers(blockSize);
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockSize)
+    {
+        int64_t blockFrames = min(blockSize, numFrames - blockStart);
+        for (int64_t f = 0; f < blockFrames; ++f)
+        {
+            framePointers[f] = myVolume->getFrame(frameBricks[blockStart + f], frameComponents[blockStart + f]);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+        for (int64_t u = 0; u < numUsed; ++u)
+        {
+            float* gatherOut = gathered.data() + u * blockFrames;
+            for (int64_t f = 0; f < blockFrames; ++f)
             {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
+                gatherOut[f] = framePointers[f][usedVoxels[u]];
+            }
+        }
+#pragma omp CARET_PAR
+        {
+            vector<double> accum(blockFrames);
+#pragma omp CARET_FOR schedule(dynamic, 64)
+            for (int64_t node = 0; node < numNodes; ++node)
+            {
+                accum.assign(blockFrames, 0.0);
+                float totalWeight = 0.0f;
+                for (int64_t e = myMatrix.m_rowStart[node]; e < myMatrix.m_rowStart[node + 1]; ++e)
                 {
-                    metricLabel += " component " + AString::number(j);
+                    float thisWeight = myMatrix.m_weights[e];
+                    totalWeight += thisWeight;
+                    const float* values = gathered.data() + gatherIndex[e] * blockFrames;
+                    for (int64_t f = 0; f < blockFrames; ++f)
+                    {
+                        accum[f] += thisWeight * values[f];
+                    }
                 }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
+                for (int64_t f = 0; f < blockFrames; ++f)
                 {
-                    double accum = 0.0;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
+                    if (!divideByTotal)
                     {
-                        accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);//weights have already been normalized in precompute, for this method
+                        outBlock[f * numNodes + node] = accum[f];
+                    } else if (totalWeight != 0.0f) {
+                        outBlock[f * numNodes + node] = accum[f] / totalWeight;
+                    } else {
+                        outBlock[f * numNodes + node] = 0.0f;
                     }
-                    myScratch[node] = accum;
                 }
-                myMetricOut->setValuesForColumn(thisCol, myScratch.data());
             }
         }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
+        for (int64_t f = 0; f < blockFrames; ++f)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            int64_t thisCol = blockStart + f;
+            AString metricLabel = myVolume->getMapName(frameBricks[thisCol]);
             if (myVolDims[4] != 1)
             {
-                metricLabel += " component " + AString::number(j);
+                metricLabel += " component " + AString::number(frameComponents[thisCol]);
             }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
+            metricLabel += methodName;
             myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                double accum = 0.0;
-                int numVoxels = (int)myWeights[node].size();
-                for (int voxel = 0; voxel < numVoxels; ++voxel)
-                {
-                    accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);//weights have already been normalized in precompute, for this method
-                }
-                myScratch[node] = accum;
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch.data());
+            myMetricOut->setValuesForColumn(thisCol, outBlock.data() + f * numNodes);
+        }
+    }
+}
+
+namespace
+{
+    const char RIBBON_WEIGHTS_MAGIC[] = "wbvxwts1";//8 bytes, version number included
+}
+
+void VoxelWeightMatrix::build(const vector<vector<VoxelWeight> >& weights, const VolumeSpace& space)
+{
+    m_space = space;
+    const int64_t* dims = space.getDims();
+    if (dims[0] * dims[1] * dims[2] > numeric_limits<int32_t>::max()) throw AlgorithmException("volume is too large for voxel weights matrix");
+    int64_t numNodes = (int64_t)weights.size();
+    m_rowStart.resize(numNodes + 1);
+    m_rowStart[0] = 0;
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        m_rowStart[node + 1] = m_rowStart[node] + weights[node].size();
+    }
+    m_voxels.resize(m_rowStart[numNodes]);
+    m_weights.resize(m_rowStart[numNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        int64_t numWeights = (int64_t)weights[node].size();
+        for (int64_t i = 0; i < numWeights; ++i)
+        {
+            m_voxels[m_rowStart[node] + i] = (int32_t)space.getIndex(weights[node][i].ijk);
+            m_weights[m_rowStart[node] + i] = weights[node][i].weight;
         }
     }
 }
 
+void VoxelWeightMatrix::writeFile(const AString& fileName) const
+{//magic, number of vertices, volume dims, sform, number of weights per vertex, voxel indices, weights - all little endian
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::WRITE_TRUNCATE);
+    myFile.write(RIBBON_WEIGHTS_MAGIC, 8);
+    int64_t numNodes = getNumberOfVertices();
+    int64_t header[4] = { numNodes, m_space.getDims()[0], m_space.getDims()[1], m_space.getDims()[2] };
+    float sform[12];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            sform[i * 4 + j] = m_space.getSform()[i][j];
+        }
+    }
+    vector<int32_t> counts(numNodes);
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        counts[node] = (int32_t)(m_rowStart[node + 1] - m_rowStart[node]);
+    }
+    vector<int32_t> voxels = m_voxels;
+    vector<float> weights = m_weights;
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+        ByteSwapping::swapBytes(sform, 12);
+        ByteSwapping::swapBytes(counts.data(), counts.size());
+        ByteSwapping::swapBytes(voxels.data(), voxels.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+    }
+    myFile.write(header, sizeof(header));
+    myFile.write(sform, sizeof(sform));
+    myFile.write(counts.data(), counts.size() * sizeof(int32_t));
+    myFile.write(voxels.data(), voxels.size() * sizeof(int32_t));
+    myFile.write(weights.data(), weights.size() * sizeof(float));
+    myFile.close();
+}
+
+void VoxelWeightMatrix::readFile(const AString& fileName)
+{
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::READ);
+    char magic[8];
+    myFile.read(magic, 8);
+    for (int i = 0; i < 8; ++i)
+    {
+        if (magic[i] != RIBBON_WEIGHTS_MAGIC[i]) throw AlgorithmException("file '" + fileName + "' is not a saved voxel weights file");
+    }
+    int64_t header[4];
+    float sform[12];
+    myFile.read(header, sizeof(header));
+    myFile.read(sform, sizeof(sform));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+        ByteSwapping::swapBytes(sform, 12);
+    }
+    int64_t numNodes = header[0];
+    if (numNodes < 0 || header[1] < 1 || header[2] < 1 || header[3] < 1) throw AlgorithmException("saved voxel weights file '" + fileName + "' has an invalid header");
+    m_space.setSpace(header + 1, sform);
+    vector<int32_t> counts(numNodes);
+    myFile.read(counts.data(), numNodes * sizeof(int32_t));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(counts.data(), counts.size());
+    }
+    m_rowStart.resize(numNodes + 1);
+    m_rowStart[0] = 0;
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        if (counts[node] < 0) throw AlgorithmException("saved voxel weights file '" + fileName + "' has an invalid weight count");
+        m_rowStart[node + 1] = m_rowStart[node] + counts[node];
+    }
+    int64_t numEntries = m_rowStart[numNodes];
+    m_voxels.resize(numEntries);
+    m_weights.resize(numEntries);
+    myFile.read(m_voxels.data(), numEntries * sizeof(int32_t));
+    myFile.read(m_weights.data(), numEntries * sizeof(float));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(m_voxels.data(), m_voxels.size());
+        ByteSwapping::swapBytes(m_weights.data(), m_weights.size());
+    }
+    int64_t frameSize = header[1] * header[2] * header[3];
+    for (int64_t i = 0; i < numEntries; ++i)
+    {
+        if (m_voxels[i] < 0 || m_voxels[i] >= frameSize) throw AlgorithmException("saved voxel weights file '" + fileName + "' has an invalid voxel index");
+    }
+}
+
 void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<VoxelWeight> >& myWeights, const VolumeFile* myVolume, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                                               const VolumeFile* roiVol, const int& numDivisions)
 {
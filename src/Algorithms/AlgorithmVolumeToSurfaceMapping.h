@@ -25,6 +25,7 @@
 
 #include "Vector3D.h"
 #include "VolumeFile.h"
+#include "VolumeSpace.h"
 
 #include <vector>
 
@@ -44,6 +45,18 @@ namespace caret {
         }
     };
     
+    struct VoxelWeightMatrix
+    {//compressed sparse rows of per-vertex voxel weights, so they can be saved, reloaded, and applied to many frames at once
+        std::vector<int64_t> m_rowStart;//weights for vertex n are elements m_rowStart[n] through m_rowStart[n + 1] - 1
+        std::vector<int32_t> m_voxels;//index of the voxel within a frame
+        std::vector<float> m_weights;
+        VolumeSpace m_space;//the volume space the voxel indices refer to
+        void build(const std::vector<std::vector<VoxelWeight> >& weights, const VolumeSpace& space);
+        int64_t getNumberOfVertices() const { return (int64_t)m_rowStart.size() - 1; }
+        void writeFile(const AString& fileName) const;
+        void readFile(const AString& fileName);
+    };
+    
     struct TriInfo
     {
         Vector3D m_xyz[3];
@@ -75,6 +88,7 @@ namespace caret {
         void precomputeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeFile* myVol, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol, const int& numDivisions);//surfaces MUST be in node correspondence, otherwise SEVERE strangeness, possible crashes
         float computeVoxelFraction(const VolumeFile* myVolume, const int64_t* ijk, PolyInfo& myPoly, const int divisions, const Vector3D& ivec, const Vector3D& jvec, const Vector3D& kvec);
         void precomputeWeightsMyelin(std::vector<std::vector<VoxelWeight> >& myWeights, const SurfaceFile* mySurface, const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma);
+        void applyWeights(const VoxelWeightMatrix& myMatrix, const VolumeFile* myVolume, MetricFile* myMetricOut, const int64_t& mySubVol, const AString& methodName, const bool& divideByTotal);
         enum Method
         {
             TRILINEAR,
@@ -91,7 +105,8 @@ namespace caret {
                                         const int64_t& mySubVol = -1);
         AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                         const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol = NULL, const int32_t& subdivisions = 3,
-                                        const int64_t& mySubVol = -1, const int& weightsOutVertex = -1, VolumeFile* weightsOut = NULL);
+                                        const int64_t& mySubVol = -1, const int& weightsOutVertex = -1, VolumeFile* weightsOut = NULL,
+                                        const AString& weightsSaveFile = "", const AString& weightsLoadFile = "");
         AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                         const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol = -1);
         static OperationParameters* getParameters();
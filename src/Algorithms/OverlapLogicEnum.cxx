@@ -25,9 +25,15 @@
 #undef __OVERLAP_LOGIC_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::OverlapLogicEnum 
@@ -76,7 +82,10 @@ OverlapLogicEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(OverlapLogicEnum(ALLOW, 
                                     0, 
@@ -93,6 +102,7 @@ OverlapLogicEnum::initialize()
                                     "EXCLUDE", 
                                     "Exclude"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
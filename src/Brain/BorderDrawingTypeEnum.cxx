@@ -25,9 +25,15 @@
 #undef __BORDER_DRAWING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::BorderDrawingTypeEnum 
@@ -72,7 +78,10 @@ BorderDrawingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(BorderDrawingTypeEnum(DRAW_AS_LINES, 
                                     "DRAW_AS_LINES", 
@@ -90,6 +99,7 @@ BorderDrawingTypeEnum::initialize()
                                     "DRAW_AS_POINTS_AND_LINES", 
                                     "Spheres and Lines"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
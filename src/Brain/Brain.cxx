@@ -31,6 +31,7 @@
 #include "BrainStructure.h"
 #include "BrowserTabContent.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "ChartingDataManager.h"
 #include "ChartableBrainordinateInterface.h"
@@ -103,6 +104,22 @@
 
 using namespace caret;
 
+bool Brain::s_deferGiftiDataArrayDecoding = false;
+
+/**
+ * Set deferred decoding of compressed data arrays in metric and label
+ * files read by any brain.  The GUI uses this since it only shows a few
+ * maps of a file at a time, wb_command always decodes while reading.
+ *
+ * @param deferDecoding
+ *    New status of deferred decoding.
+ */
+void
+Brain::setDeferGiftiDataArrayDecoding(const bool deferDecoding)
+{
+    s_deferGiftiDataArrayDecoding = deferDecoding;
+}
+
 /**
  *  Constructor.
  */
@@ -817,6 +834,7 @@ Brain::addReadOrReloadLabelFile(const FileModeAddReadReload fileMode,
     
     if (readFlag) {
         try {
+            labelFile->setDeferDataArrayDecoding(s_deferGiftiDataArrayDecoding);
             labelFile->readFile(filename);
         }
         catch (const DataFileException& dfe) {
@@ -949,6 +967,7 @@ Brain::addReadOrReloadMetricFile(const FileModeAddReadReload fileMode,
     
     if (readFlag) {
         try {
+            metricFile->setDeferDataArrayDecoding(s_deferGiftiDataArrayDecoding);
             metricFile->readFile(filename);
         }
         catch (const DataFileException& dfe) {
@@ -4098,6 +4117,225 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Read, on worker threads, the data files that can be read independently
+ * of the brain (surfaces, GIFTI data files, volumes, borders, foci, and
+ * CIFTI files).  The files are only read, they are NOT added to the brain,
+ * use addPreReadDataFile(), in the same order as the files in the spec file,
+ * for that.  Files that are not read here (other types, network files,
+ * missing files) are left with a NULL file and no error message, so that
+ * the normal reading process handles them and reports any errors.
+ *
+ * @param preReadFiles
+ *    The files, on exit those that were read successfully contain the file.
+ */
+void
+Brain::preReadDataFiles(std::vector<PreReadDataFile>& preReadFiles)
+{
+    ElapsedTimer timer;
+    timer.start();
+    
+    /*
+     * Files are created here, since some file constructors
+     * register with the event manager
+     */
+    std::vector<int32_t> filesToRead;
+    const int32_t numFiles = static_cast<int32_t>(preReadFiles.size());
+    for (int32_t i = 0; i < numFiles; i++) {
+        PreReadDataFile& prf = preReadFiles[i];
+        prf.m_caretDataFile = NULL;
+        prf.m_errorMessage  = "";
+        if (DataFile::isFileOnNetwork(prf.m_fileName)) {
+            continue;
+        }
+        
+        CaretDataFile* caretDataFile = NULL;
+        switch (prf.m_dataFileType) {
+            case DataFileTypeEnum::BORDER:
+                caretDataFile = new BorderFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE:
+                caretDataFile = new CiftiConnectivityMatrixDenseFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+                caretDataFile = new CiftiBrainordinateLabelFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+                caretDataFile = new CiftiConnectivityMatrixDenseParcelFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+                caretDataFile = new CiftiBrainordinateScalarFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+                caretDataFile = new CiftiBrainordinateDataSeriesFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
+            case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
+                /*
+                 * These send events while loading
+                 */
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+                caretDataFile = new CiftiConnectivityMatrixParcelFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+                caretDataFile = new CiftiConnectivityMatrixParcelDenseFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+                caretDataFile = new CiftiParcelScalarFile();
+                break;
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+                caretDataFile = new CiftiParcelSeriesFile();
+                break;
+            case DataFileTypeEnum::FOCI:
+                caretDataFile = new FociFile();
+                break;
+            case DataFileTypeEnum::LABEL:
+            {
+                LabelFile* labelFile = new LabelFile();
+                labelFile->setDeferDataArrayDecoding(s_deferGiftiDataArrayDecoding);
+                caretDataFile = labelFile;
+                break;
+            }
+            case DataFileTypeEnum::METRIC:
+            {
+                MetricFile* metricFile = new MetricFile();
+                metricFile->setDeferDataArrayDecoding(s_deferGiftiDataArrayDecoding);
+                caretDataFile = metricFile;
+                break;
+            }
+            case DataFileTypeEnum::PALETTE:
+                break;
+            case DataFileTypeEnum::RGBA:
+                caretDataFile = new RgbaFile();
+                break;
+            case DataFileTypeEnum::SCENE:
+                break;
+            case DataFileTypeEnum::SPECIFICATION:
+                break;
+            case DataFileTypeEnum::SURFACE:
+                caretDataFile = new Surface();
+                break;
+            case DataFileTypeEnum::UNKNOWN:
+                break;
+            case DataFileTypeEnum::VOLUME:
+                caretDataFile = new VolumeFile();
+                break;
+        }
+        if (caretDataFile == NULL) {
+            continue;
+        }
+        
+        const AString dataFileName = updateFileNameForReading(prf.m_fileName);
+        FileInformation fileInfoFullPath(dataFileName);
+        if (fileInfoFullPath.exists() == false) {
+            delete caretDataFile;
+            continue;
+        }
+        
+        prf.m_fileName = dataFileName;
+        prf.m_caretDataFile = caretDataFile;
+        filesToRead.push_back(i);
+    }
+    
+    const int32_t numToRead = static_cast<int32_t>(filesToRead.size());
+#pragma omp CARET_PARFOR schedule(dynamic) if (numToRead > 1)
+    for (int32_t i = 0; i < numToRead; i++) {
+        PreReadDataFile& prf = preReadFiles[filesToRead[i]];
+        try {
+            prf.m_caretDataFile->readFile(prf.m_fileName);
+        }
+        catch (const CaretException& e) {
+            prf.m_errorMessage = e.whatString();
+        }
+        catch (const std::exception& e) {
+            prf.m_errorMessage = (prf.m_fileName
+                                  + ": "
+                                  + e.what());
+        }
+    }
+    
+    for (int32_t i = 0; i < numToRead; i++) {
+        PreReadDataFile& prf = preReadFiles[filesToRead[i]];
+        if ( ! prf.m_errorMessage.isEmpty()) {
+            delete prf.m_caretDataFile;
+            prf.m_caretDataFile = NULL;
+        }
+    }
+    
+    CaretLogInfo("Time to read "
+                 + AString::number(numToRead)
+                 + " files in parallel was "
+                 + AString::number(timer.getElapsedTimeSeconds())
+                 + " seconds.");
+}
+
+/**
+ * Add a file that was read by preReadDataFiles() to the brain.  After this
+ * call, the brain owns the file or the file has been deleted.
+ *
+ * @param preReadFile
+ *    The file that was read, its file is set to NULL.
+ * @return
+ *    Pointer to the file that was added.
+ * @throws DataFileException
+ *    If there is an error adding the file.
+ */
+CaretDataFile*
+Brain::addPreReadDataFile(PreReadDataFile& preReadFile) throw (DataFileException)
+{
+    CaretDataFile* caretDataFile = preReadFile.m_caretDataFile;
+    CaretAssert(caretDataFile);
+    preReadFile.m_caretDataFile = NULL;
+    
+    CaretDataFile* caretDataFileAdded = NULL;
+    try {
+        /*
+         * Same as done after reading a CIFTI file in the addReadOrReload methods
+         */
+        CiftiMappableDataFile* ciftiMapFile = dynamic_cast<CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            ciftiMapFile->clearModified();
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        caretDataFileAdded = addReadOrReloadDataFile(FILE_MODE_ADD,
+                                                     caretDataFile,
+                                                     preReadFile.m_dataFileType,
+                                                     preReadFile.m_structure,
+                                                     preReadFile.m_fileName,
+                                                     false);
+    }
+    catch (const DataFileException& dfe) {
+        if (isFileValid(caretDataFile) == false) {
+            delete caretDataFile;
+        }
+        throw dfe;
+    }
+    
+    return caretDataFileAdded;
+}
+
+/**
+ * Delete any files that were read by preReadDataFiles() but not
+ * added to the brain.
+ *
+ * @param preReadFiles
+ *    The files.
+ */
+void
+Brain::deletePreReadDataFiles(std::vector<PreReadDataFile>& preReadFiles)
+{
+    for (std::vector<PreReadDataFile>::iterator iter = preReadFiles.begin();
+         iter != preReadFiles.end();
+         iter++) {
+        if (iter->m_caretDataFile != NULL) {
+            delete iter->m_caretDataFile;
+            iter->m_caretDataFile = NULL;
+        }
+    }
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -4160,6 +4398,7 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
      */
+    std::vector<PreReadDataFile> filesToLoad;
     const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
     for (int32_t ig = -1; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = ((ig == -1)
@@ -4175,42 +4414,67 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
             if (dataFileInfo->isLoadingSelected()) {
-                const AString filename = dataFileInfo->getFileName();
-                const StructureEnum::Enum structure = dataFileInfo->getStructure();
-
-                /*
-                 * Send event indicating progress of file reading
-                 */
-                FileInformation fileInfo(dataFileInfo->getFileName());
-                progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
-                                            + fileInfo.getFileName()));
-                EventManager::get()->sendEvent(progressUpdate.getPointer());
-                
-                /*
-                 * If user cancelled, reset brain and get out!
-                 */
-                if (progressUpdate.isCancelled()) {
-                    resetBrain();
-                    return;
-                }
-                
-                try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
-                }
-                catch (const DataFileException& e) {
-                    if (errorMessage.isEmpty() == false) {
-                        errorMessage += "\n";
-                    }
-                    errorMessage += e.whatString();
-                }
-                
-                fileReadCounter++;
+                filesToLoad.push_back(PreReadDataFile(dataFileType,
+                                                      dataFileInfo->getStructure(),
+                                                      dataFileInfo->getFileName()));
+            }
+        }
+    }
+    
+    /*
+     * Read the files in parallel, they are added to the brain
+     * below in the order of the spec file
+     */
+    progressUpdate.setProgress(fileReadCounter,
+                               "Reading files");
+    EventManager::get()->sendEvent(progressUpdate.getPointer());
+    preReadDataFiles(filesToLoad);
+    
+    for (std::vector<PreReadDataFile>::iterator iter = filesToLoad.begin();
+         iter != filesToLoad.end();
+         iter++) {
+        PreReadDataFile& fileToLoad = *iter;
+        
+        /*
+         * Send event indicating progress of file reading
+         */
+        FileInformation fileInfo(fileToLoad.m_fileName);
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + fileInfo.getFileName()));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        
+        /*
+         * If user cancelled, reset brain and get out!
+         */
+        if (progressUpdate.isCancelled()) {
+            deletePreReadDataFiles(filesToLoad);
+            resetBrain();
+            return;
+        }
+        
+        try {
+            if (fileToLoad.m_caretDataFile != NULL) {
+                addPreReadDataFile(fileToLoad);
+            }
+            else if ( ! fileToLoad.m_errorMessage.isEmpty()) {
+                throw DataFileException(fileToLoad.m_errorMessage);
+            }
+            else {
+                readDataFile(fileToLoad.m_dataFileType,
+                             fileToLoad.m_structure,
+                             fileToLoad.m_fileName,
+                             false);
+            }
+        }
+        catch (const DataFileException& e) {
+            if (errorMessage.isEmpty() == false) {
+                errorMessage += "\n";
             }
+            errorMessage += e.whatString();
         }
+        
+        fileReadCounter++;
     }
     
     m_specFile->clearModified();
@@ -4415,6 +4679,33 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     m_nonModifiedFilesForRestoringScene.clear();
     
     
+    /*
+     * Read the files that are not already in memory in parallel,
+     * they are added to the brain below in the order of the spec file.
+     * Files of a scene on the network are read in the loop below.
+     */
+    std::vector<PreReadDataFile> preReadFiles;
+    std::map<const SpecFileDataFile*, int32_t> specFileEntryToPreReadIndex;
+    if ( ! sceneFileOnNetwork) {
+        const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
+        for (int32_t ig = 0; ig < numFileGroups; ig++) {
+            const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
+            const int32_t numFiles = group->getNumberOfFiles();
+            for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+                const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
+                if (fileInfo->isLoadingSelected()
+                    && (specFilesEntryToNonModifiedFile.find(fileInfo) == specFilesEntryToNonModifiedFile.end())) {
+                    specFileEntryToPreReadIndex.insert(std::make_pair(fileInfo,
+                                                                      static_cast<int32_t>(preReadFiles.size())));
+                    preReadFiles.push_back(PreReadDataFile(group->getDataFileType(),
+                                                           fileInfo->getStructure(),
+                                                           fileInfo->getFileName()));
+                }
+            }
+        }
+        preReadDataFiles(preReadFiles);
+    }
+    
     /*
      * Load new files and add existing files that were previously loaded.
      */
@@ -4437,6 +4728,7 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deletePreReadDataFiles(preReadFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
@@ -4458,26 +4750,44 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deletePreReadDataFiles(preReadFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
                         }
                         
-                        if (sceneFileOnNetwork) {
-                            if (DataFile::isFileOnNetwork(filename) == false) {
-                                const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
-                                if (lastSlashIndex >= 0) {
-                                    const AString newName = (sceneFileName.left(lastSlashIndex)
-                                                             + "/"
-                                                             + filename);
-                                    filename = newName;
+                        PreReadDataFile* preReadFile = NULL;
+                        std::map<const SpecFileDataFile*, int32_t>::iterator preReadIter = specFileEntryToPreReadIndex.find(fileInfo);
+                        if (preReadIter != specFileEntryToPreReadIndex.end()) {
+                            CaretAssertVectorIndex(preReadFiles, preReadIter->second);
+                            preReadFile = &preReadFiles[preReadIter->second];
+                        }
+                        
+                        if ((preReadFile != NULL)
+                            && (preReadFile->m_caretDataFile != NULL)) {
+                            addPreReadDataFile(*preReadFile);
+                        }
+                        else if ((preReadFile != NULL)
+                                 && ( ! preReadFile->m_errorMessage.isEmpty())) {
+                            throw DataFileException(preReadFile->m_errorMessage);
+                        }
+                        else {
+                            if (sceneFileOnNetwork) {
+                                if (DataFile::isFileOnNetwork(filename) == false) {
+                                    const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
+                                    if (lastSlashIndex >= 0) {
+                                        const AString newName = (sceneFileName.left(lastSlashIndex)
+                                                                 + "/"
+                                                                 + filename);
+                                        filename = newName;
+                                    }
                                 }
                             }
+                            readDataFile(dataFileType,
+                                         structure,
+                                         filename,
+                                         false);
                         }
-                        readDataFile(dataFileType,
-                                     structure,
-                                     filename,
-                                     false);
                     }
                 }
                 catch (const DataFileException& e) {
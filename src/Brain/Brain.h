@@ -99,7 +99,12 @@ namespace caret {
         Brain(const Brain&);
         Brain& operator=(const Brain&);
         
+        /** Decode metric and label maps when first used, set by the GUI only */
+        static bool s_deferGiftiDataArrayDecoding;
+        
     public:
+        static void setDeferGiftiDataArrayDecoding(const bool deferDecoding);
+        
         int getNumberOfBrainStructures() const;
         
         void addBrainStructure(BrainStructure* brainStructure);
@@ -378,6 +383,31 @@ namespace caret {
             FILE_MODE_RELOAD
         };
         
+        /**
+         * A data file from a spec file that may be read on a worker
+         * thread before it is added to the brain
+         */
+        struct PreReadDataFile {
+            PreReadDataFile(const DataFileTypeEnum::Enum dataFileType,
+                            const StructureEnum::Enum structure,
+                            const AString& fileName)
+            : m_dataFileType(dataFileType),
+              m_structure(structure),
+              m_fileName(fileName),
+              m_caretDataFile(NULL) { }
+            
+            /** Type of the data file */
+            DataFileTypeEnum::Enum m_dataFileType;
+            /** Structure from the spec file */
+            StructureEnum::Enum m_structure;
+            /** Name of the file, updated for reading if the file was read */
+            AString m_fileName;
+            /** File that was read and is not yet added to the brain, NULL if not read */
+            CaretDataFile* m_caretDataFile;
+            /** Error from reading the file */
+            AString m_errorMessage;
+        };
+        
         void addDataFile(CaretDataFile* caretDataFile) throw (DataFileException);
         
         bool removeWithoutDeleteDataFile(const CaretDataFile* caretDataFile);
@@ -405,6 +435,12 @@ namespace caret {
                           const AString& dataFileName,
                           const bool markDataFileAsModified) throw (DataFileException);
         
+        void preReadDataFiles(std::vector<PreReadDataFile>& preReadFiles);
+        
+        CaretDataFile* addPreReadDataFile(PreReadDataFile& preReadFile) throw (DataFileException);
+        
+        void deletePreReadDataFiles(std::vector<PreReadDataFile>& preReadFiles);
+        
         CaretDataFile* addReadOrReloadDataFile(const FileModeAddReadReload fileMode,
                                             CaretDataFile* caretDataFile,
                                             const DataFileTypeEnum::Enum dataFileType,
@@ -25,6 +25,7 @@
 
 #include "Brain.h"
 #include "CaretAssert.h"
+#include "CaretPreferences.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #include "EventManager.h"
@@ -33,8 +34,10 @@
 #include "SceneClass.h"
 #include "SceneClassArray.h"
 #include "ScenePrimitiveArray.h"
+#include "SessionManager.h"
 #include "Surface.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
 using namespace caret;
 
@@ -121,6 +124,21 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
     
     PaletteFile* paletteFile = brain->getPaletteFile();
     
+    const int64_t rowCacheMemoryBudget = (static_cast<int64_t>(SessionManager::get()->getCaretPreferences()->getConnectivityRowCacheMegabytes())
+                                          * 1024 * 1024);
+    
+    /*
+     * Nodes near the selected node are the most likely to be selected
+     * next so their rows are read in the background.
+     */
+    std::vector<int32_t> prefetchNodeIndices;
+    if ( ! ciftiMatrixFiles.empty()) {
+        const int32_t prefetchNeighborDepth = 2;
+        surfaceFile->getTopologyHelper()->getNodeNeighborsToDepth(nodeIndex,
+                                                                  prefetchNeighborDepth,
+                                                                  prefetchNodeIndices);
+    }
+    
     bool haveData = false;
     for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
          iter != ciftiMatrixFiles.end();
@@ -128,6 +146,7 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
         CiftiMappableConnectivityMatrixDataFile* cmf = *iter;
         if (cmf->isEmpty() == false) {
             const int32_t mapIndex = 0;
+            cmf->setRowCacheMemoryBudget(rowCacheMemoryBudget);
             const int64_t rowIndex = cmf->loadMapDataForSurfaceNode(mapIndex,
                                                                     surfaceFile->getNumberOfNodes(),
                                                                     surfaceFile->getStructure(),
@@ -137,6 +156,10 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
             haveData = true;
             
             if (rowIndex >= 0) {
+                cmf->prefetchMapDataForSurfaceNodes(surfaceFile->getNumberOfNodes(),
+                                                    surfaceFile->getStructure(),
+                                                    prefetchNodeIndices);
+
                 /*
                  * Get row/column info for node
                  */
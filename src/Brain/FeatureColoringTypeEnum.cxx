@@ -25,9 +25,15 @@
 #undef __FEATURE_COLORING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::FeatureColoringTypeEnum 
@@ -72,7 +78,10 @@ FeatureColoringTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(FeatureColoringTypeEnum(FEATURE_COLORING_TYPE_CLASS,
                                                "FEATURE_COLORING_TYPE_CLASS",
@@ -81,6 +90,7 @@ FeatureColoringTypeEnum::initialize()
     enumData.push_back(FeatureColoringTypeEnum(FEATURE_COLORING_TYPE_NAME,
                                                "FEATURE_COLORING_TYPE_NAME",
                                                "Name"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
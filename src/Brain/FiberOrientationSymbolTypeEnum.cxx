@@ -25,9 +25,15 @@
 #undef __FIBER_ORIENTATION_SYMBOL_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::FiberOrientationSymbolTypeEnum 
@@ -72,7 +78,10 @@ FiberOrientationSymbolTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(FiberOrientationSymbolTypeEnum(FIBER_SYMBOL_FANS,
                                     "FIBER_SYMBOL_FANS", 
@@ -82,6 +91,7 @@ FiberOrientationSymbolTypeEnum::initialize()
                                     "FIBER_SYMBOL_LINES", 
                                     "Lines"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __FOCI_DRAWING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::FociDrawingTypeEnum 
@@ -72,7 +78,10 @@ FociDrawingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(FociDrawingTypeEnum(DRAW_AS_SPHERES, 
                                     "DRAW_AS_SPHERES", 
@@ -82,6 +91,7 @@ FociDrawingTypeEnum::initialize()
                                     "DRAW_AS_SQUARES", 
                                     "Squares"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
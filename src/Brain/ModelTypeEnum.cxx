@@ -24,9 +24,15 @@
 #undef __MODEL_DISPLAY_CONTROLLER_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -68,7 +74,10 @@ ModelTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ModelTypeEnum(MODEL_TYPE_INVALID, 
                                     0, 
@@ -100,6 +109,7 @@ ModelTypeEnum::initialize()
                                     "MODEL_TYPE_WHOLE_BRAIN", 
                                     "Whole Brain"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
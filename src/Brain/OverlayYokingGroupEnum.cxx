@@ -25,10 +25,16 @@
 #undef __OVERLAY_YOKING_GROUP_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "EventManager.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::OverlayYokingGroupEnum 
@@ -73,7 +79,10 @@ OverlayYokingGroupEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(OverlayYokingGroupEnum(OVERLAY_YOKING_GROUP_OFF, 
                                     "OVERLAY_YOKING_GROUP_OFF", 
@@ -119,6 +128,7 @@ OverlayYokingGroupEnum::initialize()
                                               "OVERLAY_YOKING_GROUP_10",
                                               "X"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
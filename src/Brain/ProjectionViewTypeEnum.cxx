@@ -25,9 +25,15 @@
 #undef __PROJECTION_VIEW_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ProjectionViewTypeEnum 
@@ -71,7 +77,10 @@ ProjectionViewTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ProjectionViewTypeEnum(PROJECTION_VIEW_CEREBELLUM_ANTERIOR,
                                               "PROJECTION_VIEW_CEREBELLUM_ANTERIOR",
@@ -117,6 +126,7 @@ ProjectionViewTypeEnum::initialize()
                                               "PROJECTION_VIEW_RIGHT_FLAT_SURFACE",
                                               "Right Flat"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __SELECTION_ITEM_DATA_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -65,7 +71,10 @@ SelectionItemDataTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SelectionItemDataTypeEnum(INVALID, 
                                     "INVALID", 
@@ -119,6 +128,7 @@ SelectionItemDataTypeEnum::initialize()
                                     "VOXEL", 
                                     "Voxel"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __SURFACE_DRAWING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::SurfaceDrawingTypeEnum 
@@ -72,7 +78,10 @@ SurfaceDrawingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SurfaceDrawingTypeEnum(DRAW_HIDE,
                                               "DRAW_HIDE",
@@ -90,6 +99,7 @@ SurfaceDrawingTypeEnum::initialize()
                                     "DRAW_AS_TRIANGLES", 
                                     "Triangles"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
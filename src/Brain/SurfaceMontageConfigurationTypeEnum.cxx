@@ -25,9 +25,15 @@
 #undef __SURFACE_MONTAGE_CONFIGURATION_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::SurfaceMontageConfigurationTypeEnum 
@@ -106,7 +112,10 @@ SurfaceMontageConfigurationTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SurfaceMontageConfigurationTypeEnum(CEREBELLAR_CORTEX_CONFIGURATION, 
                                     "CEREBELLAR_CORTEX_CONFIGURATION", 
@@ -120,6 +129,7 @@ SurfaceMontageConfigurationTypeEnum::initialize()
                                     "FLAT_CONFIGURATION", 
                                     "Flat Maps"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
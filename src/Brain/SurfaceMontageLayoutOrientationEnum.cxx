@@ -25,9 +25,15 @@
 #undef __SURFACE_MONTAGE_LAYOUT_ORIENTATION_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::SurfaceMontageLayoutOrientationEnum 
@@ -106,7 +112,10 @@ SurfaceMontageLayoutOrientationEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SurfaceMontageLayoutOrientationEnum(LANDSCAPE_LAYOUT_ORIENTATION, 
                                     "LANDSCAPE_LAYOUT_ORIENTATION", 
@@ -116,6 +125,7 @@ SurfaceMontageLayoutOrientationEnum::initialize()
                                     "PORTRAIT_LAYOUT_ORIENTATION", 
                                     "Portrait"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __VOLUME_SLICE_DRAWING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::VolumeSliceDrawingTypeEnum 
@@ -106,7 +112,10 @@ VolumeSliceDrawingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(VolumeSliceDrawingTypeEnum(VOLUME_SLICE_DRAW_MONTAGE, 
                                     "VOLUME_SLICE_DRAW_MONTAGE", 
@@ -116,6 +125,7 @@ VolumeSliceDrawingTypeEnum::initialize()
                                     "VOLUME_SLICE_DRAW_SINGLE", 
                                     "Draw a single slice"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __VOLUME_SLICE_PROJECTION_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::VolumeSliceProjectionTypeEnum 
@@ -106,7 +112,10 @@ VolumeSliceProjectionTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(VolumeSliceProjectionTypeEnum(VOLUME_SLICE_PROJECTION_OBLIQUE, 
                                     "VOLUME_SLICE_PROJECTION_OBLIQUE", 
@@ -116,6 +125,7 @@ VolumeSliceProjectionTypeEnum::initialize()
                                     "VOLUME_SLICE_PROJECTION_ORTHOGONAL", 
                                     "Orthogonal"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __VOLUME_SLICE_VIEW_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class VolumeSliceViewModeEnum 
@@ -76,7 +82,10 @@ VolumeSliceViewModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(VolumeSliceViewModeEnum(MONTAGE, 
                                                "MONTAGE", 
@@ -92,6 +101,7 @@ VolumeSliceViewModeEnum::initialize()
                                                "ORTHOGONAL", 
                                                "Orthogonal",
                                                "S"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
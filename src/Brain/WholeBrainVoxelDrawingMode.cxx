@@ -25,9 +25,15 @@
 #undef __WHOLE_BRAIN_VOXEL_DRAWING_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::WholeBrainVoxelDrawingMode 
@@ -71,7 +77,10 @@ WholeBrainVoxelDrawingMode::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(WholeBrainVoxelDrawingMode(DRAW_VOXELS_AS_THREE_D_CUBES, 
                                     "DRAW_VOXELS_AS_THREE_D_CUBES", 
@@ -85,6 +94,7 @@ WholeBrainVoxelDrawingMode::initialize()
                                     "DRAW_VOXELS_ON_TWO_D_SLICES", 
                                     "Draw Voxels on Slices (2D)"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
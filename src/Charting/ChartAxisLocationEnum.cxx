@@ -25,9 +25,15 @@
 #undef __CHART_AXIS_LOCATION_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartAxisLocationEnum 
@@ -104,7 +110,10 @@ ChartAxisLocationEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartAxisLocationEnum(CHART_AXIS_LOCATION_BOTTOM, 
                                     "CHART_AXIS_LOCATION_BOTTOM", 
@@ -122,6 +131,7 @@ ChartAxisLocationEnum::initialize()
                                     "CHART_AXIS_LOCATION_TOP", 
                                     "Top"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
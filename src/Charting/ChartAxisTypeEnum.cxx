@@ -25,9 +25,15 @@
 #undef __CHART_AXIS_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartAxisTypeEnum 
@@ -104,7 +110,10 @@ ChartAxisTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartAxisTypeEnum(CHART_AXIS_TYPE_NONE, 
                                     "CHART_AXIS_TYPE_NONE", 
@@ -114,6 +123,7 @@ ChartAxisTypeEnum::initialize()
                                     "CHART_AXIS_TYPE_CARTESIAN", 
                                     "Cartesian Axis"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __CHART_AXIS_UNITS_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartAxisUnitsEnum 
@@ -104,7 +110,10 @@ ChartAxisUnitsEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartAxisUnitsEnum(CHART_AXIS_UNITS_NONE, 
                                     "CHART_AXIS_UNITS_NONE", 
@@ -114,6 +123,7 @@ ChartAxisUnitsEnum::initialize()
                                     "CHART_AXIS_UNITS_TIME_SECONDS", 
                                     "Time"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __CHART_DATA_SOURCE_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartDataSourceModeEnum 
@@ -106,7 +112,10 @@ ChartDataSourceModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartDataSourceModeEnum(CHART_DATA_SOURCE_MODE_INVALID, 
                                     "CHART_DATA_SOURCE_MODE_INVALID", 
@@ -124,6 +133,7 @@ ChartDataSourceModeEnum::initialize()
                                     "CHART_DATA_SOURCE_MODE_VOXEL_IJK", 
                                     ""));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
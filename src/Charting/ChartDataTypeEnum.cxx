@@ -25,9 +25,15 @@
 #undef __CHART_DATA_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartDataTypeEnum 
@@ -104,7 +110,10 @@ ChartDataTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartDataTypeEnum(CHART_DATA_TYPE_INVALID,
                                          "CHART_DATA_TYPE_INVALID",
@@ -122,6 +131,7 @@ ChartDataTypeEnum::initialize()
                                     "CHART_DATA_TYPE_TIME_SERIES", 
                                     "Time Series"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
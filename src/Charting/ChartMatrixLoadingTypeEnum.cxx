@@ -25,9 +25,15 @@
 #undef __CHART_MATRIX_LOADING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartMatrixLoadingTypeEnum 
@@ -104,7 +110,10 @@ ChartMatrixLoadingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartMatrixLoadingTypeEnum( CHART_MATRIX_LOAD_BY_COLUMN,
                                     " CHART_MATRIX_LOAD_BY_COLUMN", 
@@ -114,6 +123,7 @@ ChartMatrixLoadingTypeEnum::initialize()
                                     "CHART_MATRIX_LOAD_BY_ROW", 
                                     "Row"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
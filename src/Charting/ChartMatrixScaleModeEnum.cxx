@@ -25,9 +25,15 @@
 #undef __CHART_MATRIX_SCALE_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartMatrixScaleModeEnum 
@@ -106,7 +112,10 @@ ChartMatrixScaleModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartMatrixScaleModeEnum(CHART_MATRIX_SCALE_AUTO, 
                                     "CHART_MATRIX_SCALE_AUTO", 
@@ -116,6 +125,7 @@ ChartMatrixScaleModeEnum::initialize()
                                     "CHART_MATRIX_SCALE_MANUAL", 
                                     "Manual"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
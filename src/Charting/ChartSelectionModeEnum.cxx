@@ -25,9 +25,15 @@
 #undef __CHART_SELECTION_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ChartSelectionModeEnum 
@@ -104,7 +110,10 @@ ChartSelectionModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ChartSelectionModeEnum(CHART_SELECTION_MODE_ANY, 
                                     "CHART_SELECTION_MODE_ANY", 
@@ -114,6 +123,7 @@ ChartSelectionModeEnum::initialize()
                                     "CHART_SELECTION_MODE_SINGLE", 
                                     "Only one item can be selected"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
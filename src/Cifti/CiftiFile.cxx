@@ -26,13 +26,95 @@
 #include "CaretLogger.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
+#include "MathFunctions.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 using namespace std;
 using namespace caret;
 
+namespace
+{//the tile extension contents: 8 byte magic string, then rows per tile and columns per tile as int64, in the byte order of the header
+    //the nifti datatype is NIFTI_TYPE_WORKBENCH_ENCODED, so that other readers refuse the file, the elements are float32
+    const char TILE_EXTENSION_MAGIC[8] = { 'w', 'b', 't', 'i', 'l', 'e', 's', '1' };
+    const int TILE_EXTENSION_SIZE = 8 + 2 * sizeof(int64_t);
+    
+    //the quantized rows extension contents: 8 byte magic string, then the number of bytes in each stored row and the bits per code (16 or 8) as int64, in the byte order of the header
+    //the nifti datatype is NIFTI_TYPE_WORKBENCH_ENCODED, so that other readers refuse the file
+    //each stored row is a float32 offset and a float32 step, then one code per element, as int16 or uint8
+    //the value of an element is offset + step * code, except that the NaN code (the lowest int16, or the highest uint8) means NaN
+    const char QUANTIZE_EXTENSION_MAGIC[8] = { 'w', 'b', 'q', 'u', 'a', 'n', 't', '1' };
+    const int QUANTIZE_EXTENSION_SIZE = 8 + 2 * sizeof(int64_t);
+    const int64_t QUANTIZE_ROW_HEADER_BYTES = 2 * sizeof(float);
+    
+    template<typename T>
+    struct QuantizeCodes
+    {
+    };
+    
+    template<>
+    struct QuantizeCodes<int16_t>
+    {
+        static int32_t minCode() { return -32767; }
+        static int32_t maxCode() { return 32767; }
+        static int32_t nanCode() { return -32768; }
+    };
+    
+    template<>
+    struct QuantizeCodes<uint8_t>
+    {
+        static int32_t minCode() { return 0; }
+        static int32_t maxCode() { return 254; }
+        static int32_t nanCode() { return 255; }
+    };
+    
+    template<typename T>
+    void quantizeRow(const float* dataIn, const int64_t& rowLength, float& offsetOut, float& stepOut, T* codesOut)
+    {//spread the finite range of the row over the codes, non-finite values become NaN
+        const int32_t minCode = QuantizeCodes<T>::minCode(), maxCode = QuantizeCodes<T>::maxCode(), nanCode = QuantizeCodes<T>::nanCode();
+        bool haveValue = false;
+        double minVal = 0.0, maxVal = 0.0;
+        for (int64_t i = 0; i < rowLength; ++i)
+        {
+            if (!MathFunctions::isNumeric(dataIn[i])) continue;
+            if (!haveValue || dataIn[i] < minVal) minVal = dataIn[i];
+            if (!haveValue || dataIn[i] > maxVal) maxVal = dataIn[i];
+            haveValue = true;
+        }
+        double step = (maxVal - minVal) / (maxCode - minCode);
+        stepOut = (float)step;
+        offsetOut = (float)(minVal - step * minCode);//code 0 is the center of the range for int16
+        double scale = (step > 0.0 ? 1.0 / stepOut : 0.0);
+        for (int64_t i = 0; i < rowLength; ++i)
+        {
+            if (!MathFunctions::isNumeric(dataIn[i]))
+            {
+                codesOut[i] = (T)nanCode;
+            } else {
+                int32_t code = (int32_t)floor(0.5 + (dataIn[i] - offsetOut) * scale);
+                codesOut[i] = (T)min(maxCode, max(minCode, code));
+            }
+        }
+    }
+    
+    template<typename T>
+    void dequantizeRow(const T* codesIn, const int64_t& rowLength, const float& offset, const float& step, float* dataOut)
+    {
+        const T nanCode = (T)QuantizeCodes<T>::nanCode();
+        const float nanValue = numeric_limits<float>::quiet_NaN();
+        for (int64_t i = 0; i < rowLength; ++i)
+        {
+            dataOut[i] = (codesIn[i] == nanCode ? nanValue : offset + step * codesIn[i]);
+        }
+    }
+}
+
 //private implementation classes
 namespace caret
 {
@@ -40,13 +122,27 @@ namespace caret
     {
         mutable NiftiIO m_nifti;//because file objects aren't stateless (current position), so reading "changes" them
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
+        int64_t m_tileRows, m_tileCols;//0 means normal row-major data, otherwise the 2D matrix is stored as padded row-major tiles, in row-major tile order
+        int64_t m_numTileCols;
+        mutable std::vector<float> m_tileScratch;
+        int m_quantizeBits;//0 means plain data, otherwise each row is stored quantized to 8 or 16 bits, see the extension description above
+        int64_t m_quantizedRowBytes;
+        mutable std::vector<char> m_quantizedScratch;
+        int64_t getTileOffset(const int64_t& tileRow, const int64_t& tileCol) const { return (tileRow * m_numTileCols + tileCol) * m_tileRows * m_tileCols; }
+        void readTileExtension(const NiftiExtension& extension, const bool& swapped);
+        void readQuantizeExtension(const NiftiExtension& extension, const bool& swapped);
+        void readQuantizedRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const;
+        void writeQuantizedRow(const float* dataIn, const int64_t& index);
     public:
         CiftiOnDiskImpl(const QString& filename);//read-only
-        CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version);//make new empty file with read/write
+        CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const int64_t& tileRows = 0, const int64_t& tileCols = 0,
+                        const int& quantizeBits = 0);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
+        bool hasLayout(const int64_t& tileRows, const int64_t& tileCols, const int& quantizeBits) const { return m_tileRows == tileRows && m_tileCols == tileCols && m_quantizeBits == quantizeBits; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
@@ -58,6 +154,7 @@ namespace caret
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
@@ -89,9 +186,19 @@ CiftiFile::WriteImplInterface::~WriteImplInterface()
 
 CiftiFile::CiftiFile(const QString& fileName)
 {
+    m_writingTileRows = 0;
+    m_writingTileCols = 0;
+    m_writingQuantizeBits = 0;
     openFile(fileName);
 }
 
+CiftiFile::CiftiFile()
+{
+    m_writingTileRows = 0;
+    m_writingTileCols = 0;
+    m_writingQuantizeBits = 0;
+}
+
 void CiftiFile::openFile(const QString& fileName)
 {
     m_writingImpl.grabNew(NULL);
@@ -131,6 +238,27 @@ void CiftiFile::setWritingFile(const QString& fileName)
     m_writingImpl.grabNew(NULL);//prevent writing to previous writing implementation, let the next set...() set up for writing
 }
 
+void CiftiFile::setWritingTileSize(const int64_t& rowsPerTile, const int64_t& columnsPerTile)
+{
+    if (rowsPerTile < 0 || columnsPerTile < 0 || (rowsPerTile == 0) != (columnsPerTile == 0))
+    {
+        throw DataFileException("tile dimensions must both be positive, or both be zero for the standard layout");
+    }
+    m_writingTileRows = rowsPerTile;
+    m_writingTileCols = columnsPerTile;
+    m_writingImpl.grabNew(NULL);//like setWritingFile, let the next set...() start the file with the new layout
+}
+
+void CiftiFile::setWritingQuantization(const int& bits)
+{
+    if (bits != 0 && bits != 8 && bits != 16)
+    {
+        throw DataFileException("quantization must be 8 or 16 bits, or 0 for float32");
+    }
+    m_writingQuantizeBits = bits;
+    m_writingImpl.grabNew(NULL);//like setWritingFile, let the next set...() start the file with the new layout
+}
+
 void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVersion)
 {
     if (m_readingImpl == NULL || m_dims.empty()) throw DataFileException("writeFile called on uninitialized CiftiFile");
@@ -141,13 +269,13 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
     bool collision = false;
     if (testImpl != NULL && canonicalFilename != "" && FileInformation(testImpl->getFilename()).getCanonicalFilePath() == canonicalFilename)
     {//empty string test is so that we don't say collision if both are nonexistant - could happen if file is removed/unlinked while reading on some filesystems
-        if (m_writingVersion == writingVersion) return;//don't need to copy to itself
+        if (m_writingVersion == writingVersion && testImpl->hasLayout(m_writingTileRows, m_writingTileCols, m_writingQuantizeBits)) return;//don't need to copy to itself
         collision = true;//we need to copy to memory temporarily
         CaretPointer<WriteImplInterface> tempMemory(new CiftiMemoryImpl(m_xml));//because tempRead is a ReadImpl, can't be used to copy to
         copyImplData(m_readingImpl, tempMemory, m_dims);
         tempRead = tempMemory;//set it to read from the memory rather than m_readingImpl
     }
-    CaretPointer<WriteImplInterface> tempWrite(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath(), m_xml, writingVersion));//NOTE: this makes m_readingImpl/m_writingImpl unusable if collision is true!
+    CaretPointer<WriteImplInterface> tempWrite(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath(), m_xml, writingVersion, m_writingTileRows, m_writingTileCols, m_writingQuantizeBits));//NOTE: this makes m_readingImpl/m_writingImpl unusable if collision is true!
     copyImplData(tempRead, tempWrite, m_dims);
     if (collision)//if we rewrote the file, we need the handle to the new file, the old one has the wrong version and vox_offset in it
     {
@@ -204,6 +332,22 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;//no data exists yet
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
+const float* CiftiFile::getRowPointer(const int64_t& index) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowPointer with single index called on non-2D CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    vector<int64_t> tempvec(1, index);
+    return m_readingImpl->getRowPointer(tempvec);
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata, const CiftiVersion& writingVersion)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -328,7 +472,7 @@ void CiftiFile::verifyWriteImpl()
                 }
             }
         }
-        m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_writingVersion));//this constructor makes new file for writing
+        m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_writingVersion, m_writingTileRows, m_writingTileCols, m_writingQuantizeBits));//this constructor makes new file for writing
         if (m_readingImpl != NULL)
         {
             copyImplData(m_readingImpl, m_writingImpl, m_dims);
@@ -377,6 +521,11 @@ void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+const float* CiftiMemoryImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    return m_array.get(1, indexSelect);
+}
+
 void CiftiMemoryImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     float* ref = m_array.get(1, indexSelect);
@@ -402,15 +551,27 @@ void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
 
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
 {//opens existing file for reading
-    m_nifti.openRead(filename);//read-only, so we don't need write permission to read a cifti file
+    m_tileRows = 0;
+    m_tileCols = 0;
+    m_numTileCols = 0;
+    m_quantizeBits = 0;
+    m_quantizedRowBytes = 0;
+    m_nifti.openRead(filename, true);//read-only, so we don't need write permission to read a cifti file - memory map if possible, so the page cache is shared and getRowPointer works
     const NiftiHeader& myHeader = m_nifti.getHeader();
-    int numExts = (int)myHeader.m_extensions.size(), whichExt = -1;
+    int numExts = (int)myHeader.m_extensions.size(), whichExt = -1, whichTileExt = -1, whichQuantizeExt = -1;
     for (int i = 0; i < numExts; ++i)
     {
-        if (myHeader.m_extensions[i]->m_ecode == NIFTI_ECODE_CIFTI)
+        if (myHeader.m_extensions[i]->m_ecode == NIFTI_ECODE_CIFTI && whichExt == -1)
         {
             whichExt = i;
-            break;
+        }
+        if (myHeader.m_extensions[i]->m_ecode == NIFTI_ECODE_WORKBENCH_TILES && whichTileExt == -1)
+        {
+            whichTileExt = i;
+        }
+        if (myHeader.m_extensions[i]->m_ecode == NIFTI_ECODE_WORKBENCH_QUANTIZED_ROWS && whichQuantizeExt == -1)
+        {
+            whichQuantizeExt = i;
         }
     }
     if (whichExt == -1) throw DataFileException("no cifti extension found in file '" + filename + "'");
@@ -442,12 +603,129 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
             }
         }
     }
+    if (whichTileExt != -1)
+    {
+        if (m_xml.getNumberOfDimensions() != 2) throw DataFileException("tiled layout is only supported for 2D cifti, in file '" + filename + "'");
+        readTileExtension(*(myHeader.m_extensions[whichTileExt]), myHeader.isSwapped());
+    }
+    if (whichQuantizeExt != -1)
+    {
+        if (m_xml.getNumberOfDimensions() != 2) throw DataFileException("quantized rows are only supported for 2D cifti, in file '" + filename + "'");
+        if (whichTileExt != -1) throw DataFileException("file '" + filename + "' has both tiled layout and quantized rows, which is not supported");
+        readQuantizeExtension(*(myHeader.m_extensions[whichQuantizeExt]), myHeader.isSwapped());
+    } else {//readTileExtension already replaced the datatype with the tile element type
+        if (m_nifti.getHeader().getDataType() == NIFTI_TYPE_WORKBENCH_ENCODED) throw DataFileException("file '" + filename + "' has the workbench-encoded datatype, but no extension describing the encoding");
+    }
 }
 
-CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version)
+void CiftiOnDiskImpl::readQuantizeExtension(const NiftiExtension& extension, const bool& swapped)
+{
+    if ((int)extension.m_bytes.size() < QUANTIZE_EXTENSION_SIZE || memcmp(extension.m_bytes.data(), QUANTIZE_EXTENSION_MAGIC, 8) != 0)
+    {
+        throw DataFileException("unrecognized quantized rows extension in file '" + m_nifti.getFilename() + "'");
+    }
+    if (m_nifti.getHeader().getDataType() != NIFTI_TYPE_WORKBENCH_ENCODED)
+    {
+        throw DataFileException("invalid datatype for quantized rows in file '" + m_nifti.getFilename() + "'");
+    }
+    int64_t quantizeInfo[2];//row bytes, bits per code
+    memcpy(quantizeInfo, extension.m_bytes.data() + 8, sizeof(quantizeInfo));
+    if (swapped) ByteSwapping::swapArray(quantizeInfo, 2);
+    int64_t rowBytes = quantizeInfo[0];
+    if (quantizeInfo[1] != 16 && quantizeInfo[1] != 8) throw DataFileException("invalid quantization bits in file '" + m_nifti.getFilename() + "'");
+    int bits = (int)quantizeInfo[1];
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    if (rowBytes != QUANTIZE_ROW_HEADER_BYTES + rowLength * (bits / 8)) throw DataFileException("invalid quantized row size in file '" + m_nifti.getFilename() + "'");
+    m_quantizeBits = bits;
+    m_quantizedRowBytes = rowBytes;
+}
+
+void CiftiOnDiskImpl::readQuantizedRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const
+{
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    const char* rowBytes = NULL;
+    if (!m_nifti.getHeader().isSwapped())
+    {
+        rowBytes = m_nifti.getMappedBytes(index * m_quantizedRowBytes, m_quantizedRowBytes);//decode straight out of the mapping
+    }
+    if (rowBytes == NULL)
+    {
+        m_quantizedScratch.resize(m_quantizedRowBytes);
+        m_nifti.readBytes(m_quantizedScratch.data(), index * m_quantizedRowBytes, m_quantizedRowBytes, tolerateShortRead);//unwritten rows read as zeros, which decode to zeros
+        if (m_nifti.getHeader().isSwapped())
+        {
+            ByteSwapping::swapArray((float*)m_quantizedScratch.data(), 2);
+            if (m_quantizeBits == 16) ByteSwapping::swapArray((int16_t*)(m_quantizedScratch.data() + QUANTIZE_ROW_HEADER_BYTES), rowLength);
+        }
+        rowBytes = m_quantizedScratch.data();
+    }
+    float params[2];//offset, step
+    memcpy(params, rowBytes, sizeof(params));
+    if (m_quantizeBits == 16)
+    {
+        dequantizeRow((const int16_t*)(rowBytes + QUANTIZE_ROW_HEADER_BYTES), rowLength, params[0], params[1], dataOut);
+    } else {
+        dequantizeRow((const uint8_t*)(rowBytes + QUANTIZE_ROW_HEADER_BYTES), rowLength, params[0], params[1], dataOut);
+    }
+}
+
+void CiftiOnDiskImpl::writeQuantizedRow(const float* dataIn, const int64_t& index)
+{
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    m_quantizedScratch.resize(m_quantizedRowBytes);
+    float params[2];
+    if (m_quantizeBits == 16)
+    {
+        quantizeRow(dataIn, rowLength, params[0], params[1], (int16_t*)(m_quantizedScratch.data() + QUANTIZE_ROW_HEADER_BYTES));
+    } else {
+        quantizeRow(dataIn, rowLength, params[0], params[1], (uint8_t*)(m_quantizedScratch.data() + QUANTIZE_ROW_HEADER_BYTES));
+    }
+    memcpy(m_quantizedScratch.data(), params, sizeof(params));//we never write swapped cifti, see writeNew in the constructor
+    m_nifti.writeBytes(m_quantizedScratch.data(), index * m_quantizedRowBytes, m_quantizedRowBytes);
+}
+
+void CiftiOnDiskImpl::readTileExtension(const NiftiExtension& extension, const bool& swapped)
+{
+    if ((int)extension.m_bytes.size() < TILE_EXTENSION_SIZE || memcmp(extension.m_bytes.data(), TILE_EXTENSION_MAGIC, 8) != 0)
+    {
+        throw DataFileException("unrecognized tile extension in file '" + m_nifti.getFilename() + "'");
+    }
+    if (m_nifti.getHeader().getDataType() != NIFTI_TYPE_WORKBENCH_ENCODED)
+    {
+        throw DataFileException("invalid datatype for tiled layout in file '" + m_nifti.getFilename() + "'");
+    }
+    int64_t tileDims[2];
+    memcpy(tileDims, extension.m_bytes.data() + 8, sizeof(tileDims));
+    if (swapped) ByteSwapping::swapArray(tileDims, 2);
+    if (tileDims[0] < 1 || tileDims[1] < 1) throw DataFileException("invalid tile size in file '" + m_nifti.getFilename() + "'");
+    m_nifti.overrideDataType(NIFTI_TYPE_FLOAT32);//the tiles are plain floats
+    m_tileRows = tileDims[0];
+    m_tileCols = tileDims[1];
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    m_numTileCols = (rowLength + m_tileCols - 1) / m_tileCols;
+}
+
+CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const int64_t& tileRows, const int64_t& tileCols,
+                                 const int& quantizeBits)
 {//starts writing new file
+    CaretAssert((tileRows == 0) == (tileCols == 0));
+    CaretAssert(quantizeBits == 0 || quantizeBits == 8 || quantizeBits == 16);
+    m_tileRows = 0;//set after the file is created, so the tiled code paths aren't used on a failed construction
+    m_tileCols = 0;
+    m_numTileCols = 0;
+    m_quantizeBits = 0;
+    m_quantizedRowBytes = 0;
+    if (quantizeBits != 0 && xml.getNumberOfDimensions() != 2) throw DataFileException("quantized rows are only supported for 2D cifti");
+    if (quantizeBits != 0 && tileRows > 0) throw DataFileException("quantized rows can't be used with the tiled layout");
+    if (tileRows > 0 && filename.endsWith(".gz")) throw DataFileException("tiled layout can't be used with compressed files, as they can only be written sequentially");
+    if (tileRows > 0 && xml.getNumberOfDimensions() != 2) throw DataFileException("tiled layout is only supported for 2D cifti");
     NiftiHeader outHeader;
-    outHeader.setDataType(NIFTI_TYPE_FLOAT32);//actually redundant currently, default is float32
+    if (quantizeBits != 0 || tileRows > 0)
+    {
+        outHeader.setDataType(NIFTI_TYPE_WORKBENCH_ENCODED);//the extension describes the layout, and other readers must not read the data as a plain matrix
+    } else {
+        outHeader.setDataType(NIFTI_TYPE_FLOAT32);//actually redundant currently, default is float32
+    }
     char intentName[16];
     int32_t intentCode = xml.getIntentInfo(version, intentName);
     outHeader.setIntent(intentCode, intentName);
@@ -461,7 +739,29 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, c
         outExtension->m_bytes[i] = xmlBytes[i];
     }
     outHeader.m_extensions.push_back(outExtension);
+    if (tileRows > 0)
+    {
+        CaretPointer<NiftiExtension> tileExtension(new NiftiExtension());
+        tileExtension->m_ecode = NIFTI_ECODE_WORKBENCH_TILES;
+        tileExtension->m_bytes.resize(TILE_EXTENSION_SIZE);
+        int64_t tileDims[2] = { tileRows, tileCols };
+        memcpy(tileExtension->m_bytes.data(), TILE_EXTENSION_MAGIC, 8);
+        memcpy(tileExtension->m_bytes.data() + 8, tileDims, sizeof(tileDims));//we never write swapped cifti, see writeNew below
+        outHeader.m_extensions.push_back(tileExtension);
+    }
     vector<int64_t> matrixDims = xml.getDimensions();
+    int64_t quantizedRowBytes = 0;
+    if (quantizeBits != 0)
+    {
+        quantizedRowBytes = QUANTIZE_ROW_HEADER_BYTES + matrixDims[0] * (quantizeBits / 8);
+        CaretPointer<NiftiExtension> quantizeExtension(new NiftiExtension());
+        quantizeExtension->m_ecode = NIFTI_ECODE_WORKBENCH_QUANTIZED_ROWS;
+        quantizeExtension->m_bytes.resize(QUANTIZE_EXTENSION_SIZE);
+        memcpy(quantizeExtension->m_bytes.data(), QUANTIZE_EXTENSION_MAGIC, 8);
+        int64_t quantizeInfo[2] = { quantizedRowBytes, quantizeBits };
+        memcpy(quantizeExtension->m_bytes.data() + 8, quantizeInfo, sizeof(quantizeInfo));//we never write swapped cifti, see writeNew below
+        outHeader.m_extensions.push_back(quantizeExtension);
+    }
     vector<int64_t> niftiDims(4, 1);//the reserved space and time dims
     niftiDims.insert(niftiDims.end(), matrixDims.begin(), matrixDims.end());
     if (version.hasReversedFirstDims())
@@ -479,17 +779,95 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, c
         m_nifti.writeNew(filename, outHeader, 2, true);
     }
     m_xml = xml;
+    if (tileRows > 0)
+    {
+        m_nifti.overrideDataType(NIFTI_TYPE_FLOAT32);//the tiles are plain floats
+        m_tileRows = tileRows;
+        m_tileCols = tileCols;
+        m_numTileCols = (matrixDims[0] + m_tileCols - 1) / m_tileCols;
+        int64_t numTileRows = (matrixDims[1] + m_tileRows - 1) / m_tileRows;
+        float zero = 0.0f;//write the last padding element, so the file has its full length and reading whole edge tiles never comes up short
+        m_nifti.writeElements(&zero, getTileOffset(numTileRows - 1, m_numTileCols - 1) + m_tileRows * m_tileCols - 1, 1);
+    }
+    if (quantizeBits != 0)
+    {
+        m_quantizeBits = quantizeBits;
+        m_quantizedRowBytes = quantizedRowBytes;
+    }
 }
 
 void CiftiOnDiskImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool& tolerateShortRead) const
 {
+    if (m_quantizeBits != 0)
+    {
+        CaretAssert(indexSelect.size() == 1);
+        readQuantizedRow(dataOut, indexSelect[0], tolerateShortRead);
+        return;
+    }
+    if (m_tileRows > 0)
+    {//one contiguous piece from each tile in the tile row
+        CaretAssert(indexSelect.size() == 1);
+        int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+        int64_t tileRow = indexSelect[0] / m_tileRows, withinTile = indexSelect[0] % m_tileRows;
+        for (int64_t tileCol = 0, start = 0; start < rowLength; ++tileCol, start += m_tileCols)
+        {
+            m_nifti.readElements(dataOut + start, getTileOffset(tileRow, tileCol) + withinTile * m_tileCols, min(m_tileCols, rowLength - start), tolerateShortRead);
+        }
+        return;
+    }
     m_nifti.readData(dataOut, 5, indexSelect, tolerateShortRead);//5 means 4 reserved (space and time) plus the first cifti dimension
 }
 
+const float* CiftiOnDiskImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_tileRows > 0 || m_quantizeBits != 0) return NULL;//rows aren't contiguous floats
+    return m_nifti.getMappedFloatData(5, indexSelect);//NULL unless the on-disk format needs no conversion
+}
+
 void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    if (m_quantizeBits != 0)
+    {//read the offset and step of each row, and the one code from it
+        int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+        int64_t codeBytes = m_quantizeBits / 8;
+        char rowHeader[QUANTIZE_ROW_HEADER_BYTES], codeBytesIn[2];
+        for (int64_t i = 0; i < colLength; ++i)
+        {
+            m_nifti.readBytes(rowHeader, i * m_quantizedRowBytes, QUANTIZE_ROW_HEADER_BYTES);
+            m_nifti.readBytes(codeBytesIn, i * m_quantizedRowBytes + QUANTIZE_ROW_HEADER_BYTES + index * codeBytes, codeBytes);
+            float params[2];
+            memcpy(params, rowHeader, sizeof(params));
+            if (m_nifti.getHeader().isSwapped()) ByteSwapping::swapArray(params, 2);
+            if (m_quantizeBits == 16)
+            {
+                int16_t code;
+                memcpy(&code, codeBytesIn, sizeof(code));
+                if (m_nifti.getHeader().isSwapped()) ByteSwapping::swap(code);
+                dequantizeRow(&code, 1, params[0], params[1], dataOut + i);
+            } else {
+                dequantizeRow((const uint8_t*)codeBytesIn, 1, params[0], params[1], dataOut + i);
+            }
+        }
+        return;
+    }
+    if (m_tileRows > 0)
+    {//read each tile in the tile column in one piece, and pick out the column
+        int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+        int64_t tileCol = index / m_tileCols, withinTile = index % m_tileCols;
+        m_tileScratch.resize(m_tileRows * m_tileCols);
+        for (int64_t tileRow = 0, start = 0; start < colLength; ++tileRow, start += m_tileRows)
+        {
+            int64_t numRows = min(m_tileRows, colLength - start);//don't bother reading the padding rows of the last tile
+            m_nifti.readElements(m_tileScratch.data(), getTileOffset(tileRow, tileCol), numRows * m_tileCols);
+            for (int64_t i = 0; i < numRows; ++i)
+            {
+                dataOut[start + i] = m_tileScratch[i * m_tileCols + withinTile];
+            }
+        }
+        return;
+    }
     CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
@@ -503,6 +881,23 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
+    if (m_quantizeBits != 0)
+    {
+        CaretAssert(indexSelect.size() == 1);
+        writeQuantizedRow(dataIn, indexSelect[0]);
+        return;
+    }
+    if (m_tileRows > 0)
+    {
+        CaretAssert(indexSelect.size() == 1);
+        int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+        int64_t tileRow = indexSelect[0] / m_tileRows, withinTile = indexSelect[0] % m_tileRows;
+        for (int64_t tileCol = 0, start = 0; start < rowLength; ++tileCol, start += m_tileCols)
+        {
+            m_nifti.writeElements(dataIn + start, getTileOffset(tileRow, tileCol) + withinTile * m_tileCols, min(m_tileCols, rowLength - start));
+        }
+        return;
+    }
     m_nifti.writeData(dataIn, 5, indexSelect);
 }
 
@@ -510,6 +905,36 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    if (m_quantizeBits != 0)
+    {//RMW each row, because changing one value can change the row's offset and step
+        int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+        m_tileScratch.resize(m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+        for (int64_t i = 0; i < colLength; ++i)
+        {
+            readQuantizedRow(m_tileScratch.data(), i, true);
+            m_tileScratch[index] = dataIn[i];
+            writeQuantizedRow(m_tileScratch.data(), i);
+        }
+        return;
+    }
+    if (m_tileRows > 0)
+    {//RMW each tile in the tile column
+        int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+        int64_t tileCol = index / m_tileCols, withinTile = index % m_tileCols;
+        m_tileScratch.resize(m_tileRows * m_tileCols);
+        for (int64_t tileRow = 0, start = 0; start < colLength; ++tileRow, start += m_tileRows)
+        {
+            int64_t numRows = min(m_tileRows, colLength - start);
+            int64_t offset = getTileOffset(tileRow, tileCol);
+            m_nifti.readElements(m_tileScratch.data(), offset, numRows * m_tileCols);
+            for (int64_t i = 0; i < numRows; ++i)
+            {
+                m_tileScratch[i * m_tileCols + withinTile] = dataIn[start + i];
+            }
+            m_nifti.writeElements(m_tileScratch.data(), offset, numRows * m_tileCols);
+        }
+        return;
+    }
     CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
@@ -41,6 +41,7 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }//only implementations that can do it without copying need to override
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
@@ -52,12 +53,14 @@ namespace caret
             virtual void setColumn(const float* dataIn, const int64_t& index) = 0;
             virtual ~WriteImplInterface();
         };
-        CiftiFile() { }
+        CiftiFile();
         explicit CiftiFile(const QString &fileName);//calls openFile
         void openFile(const QString& fileName);//starts on-disk reading
         void openURL(const QString& url, const QString& user, const QString& pass);//open from XNAT
         void openURL(const QString& url);//same, without user/pass (or curently, reusing existing auth if the server matches
         void setWritingFile(const QString& fileName);//starts on-disk writing
+        void setWritingTileSize(const int64_t& rowsPerTile, const int64_t& columnsPerTile);//2D only: store the matrix as tiles so that getColumn doesn't read the whole file, 0, 0 for the standard layout
+        void setWritingQuantization(const int& bits);//2D only: store each row as 8 or 16 bit integers with a per-row offset and step, for smaller files and faster row reads, 0 for float32
         void writeFile(const QString& fileName, const CiftiVersion& writingVersion);//leaves current state as-is, rewrites if already writing to that filename and version mismatch
         void writeFile(const QString& fileName);//leaves current state as-is, does nothing if already writing to that filename
         void convertToInMemory();
@@ -66,6 +69,10 @@ namespace caret
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false) const;//tolerateShortRead is useful for on-disk writing when it is easiest to do RMW multiple times on a new file
         const std::vector<int64_t>& getDimensions() const { return m_dims; }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        //zero-copy access: returns NULL when the row can't be provided without conversion (compressed, not float32, byteswapped, scaled, or mapping failed), use getRow in that case
+        //pointer is invalidated by any open, set...(), write or conversion call on this CiftiFile
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        const float* getRowPointer(const int64_t& index) const;//for 2D only
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true, const CiftiVersion& writingVersion = CiftiVersion());
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true, const CiftiVersion& writingVersion = CiftiVersion());//set xml from old implementation
@@ -85,6 +92,8 @@ namespace caret
         QString m_writingFile;
         //CiftiXML m_xml;//uncomment when we drop CiftiInterface
         CiftiVersion m_writingVersion;
+        int64_t m_writingTileRows, m_writingTileCols;
+        int m_writingQuantizeBits;
         void verifyWriteImpl();
         static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims);
     };
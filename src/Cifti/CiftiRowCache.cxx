@@ -0,0 +1,232 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowCache.h"
+
+#include "CaretAssert.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+using namespace caret;
+
+namespace caret
+{
+    class CiftiRowCacheThread : public QThread
+    {
+        CiftiRowCache* m_cache;
+    public:
+        CiftiRowCacheThread(CiftiRowCache* cache) { m_cache = cache; }
+        void run() { m_cache->prefetchLoop(); }
+    };
+}
+
+CiftiRowCache::CiftiRowCache(const CiftiFile* file, const int64_t& memoryBudgetBytes)
+{
+    m_file = file;
+    const vector<int64_t>& dims = m_file->getDimensions();
+    if (dims.size() != 2) throw DataFileException("row cache only works on 2D cifti");
+    m_rowLength = dims[0];
+    m_numRows = dims[1];
+    m_prefetchingRow = -1;
+    m_foregroundReading = false;
+    m_abort = false;
+    m_prefetchFailed = false;
+    m_maxCachedRows = 0;
+    setMemoryBudget(memoryBudgetBytes);
+}
+
+CiftiRowCache::~CiftiRowCache()
+{
+    if (m_thread != NULL)
+    {
+        {
+            QMutexLocker locked(&m_mutex);
+            m_abort = true;
+            m_workAvailable.wakeAll();
+        }
+        m_thread->wait();//at most the time to read one row
+    }
+}
+
+bool CiftiRowCache::copyCachedRow(float* dataOut, const int64_t& index)
+{
+    map<int64_t, CachedRow>::iterator iter = m_rows.find(index);
+    if (iter == m_rows.end()) return false;
+    m_useOrder.splice(m_useOrder.begin(), m_useOrder, iter->second.m_usePosition);//iterators into the list stay valid
+    copy(iter->second.m_data.begin(), iter->second.m_data.end(), dataOut);
+    return true;
+}
+
+void CiftiRowCache::insertRow(const float* data, const int64_t& index)
+{
+    if (m_maxCachedRows < 1 || m_rows.find(index) != m_rows.end()) return;
+    evictRows(m_maxCachedRows - 1);
+    CachedRow& newRow = m_rows[index];
+    newRow.m_data.assign(data, data + m_rowLength);
+    m_useOrder.push_front(index);
+    newRow.m_usePosition = m_useOrder.begin();
+}
+
+void CiftiRowCache::evictRows(const int64_t& maxRows)
+{
+    while ((int64_t)m_rows.size() > max((int64_t)0, maxRows))
+    {
+        m_rows.erase(m_useOrder.back());
+        m_useOrder.pop_back();
+    }
+}
+
+void CiftiRowCache::getRow(float* dataOut, const int64_t& index)
+{
+    CaretAssert(index >= 0 && index < m_numRows);
+    {
+        QMutexLocker locked(&m_mutex);
+        while (index == m_prefetchingRow)//don't read it twice, it will be done soon
+        {
+            m_prefetchDone.wait(&m_mutex);
+        }
+        if (copyCachedRow(dataOut, index)) return;
+        m_foregroundReading = true;//keep the prefetcher from starting another row while we use the disk
+    }
+    try
+    {
+        m_file->getRow(dataOut, index);
+    } catch (...) {
+        QMutexLocker locked(&m_mutex);
+        m_foregroundReading = false;
+        m_workAvailable.wakeAll();
+        throw;
+    }
+    QMutexLocker locked(&m_mutex);
+    m_foregroundReading = false;
+    insertRow(dataOut, index);
+    m_workAvailable.wakeAll();
+}
+
+void CiftiRowCache::enablePrefetching(const QString& fileName)
+{
+    QMutexLocker locked(&m_mutex);
+    CaretAssert(m_thread == NULL);//can't change the file once the thread has opened it
+    m_prefetchFileName = fileName;
+}
+
+void CiftiRowCache::prefetchRows(const vector<int64_t>& indices)
+{
+    QMutexLocker locked(&m_mutex);
+    m_prefetchQueue.clear();
+    if (m_prefetchFileName.isEmpty() || m_prefetchFailed) return;
+    int64_t maxPrefetch = m_maxCachedRows / 2;//don't let prefetching push out everything that was actually used
+    for (size_t i = 0; i < indices.size() && (int64_t)m_prefetchQueue.size() < maxPrefetch; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= m_numRows) continue;
+        if (m_rows.find(indices[i]) != m_rows.end()) continue;
+        m_prefetchQueue.push_back(indices[i]);
+    }
+    if (m_prefetchQueue.empty()) return;
+    if (m_thread == NULL)
+    {
+        m_thread.grabNew(new CiftiRowCacheThread(this));
+        m_thread->start(QThread::LowPriority);
+    }
+    m_workAvailable.wakeAll();
+}
+
+void CiftiRowCache::prefetchLoop()
+{
+    QString fileName;
+    {
+        QMutexLocker locked(&m_mutex);
+        fileName = m_prefetchFileName;
+    }
+    CiftiFile prefetchFile;//separate reader, because file objects have a current position and aren't safe to share between threads
+    try
+    {
+        prefetchFile.openFile(fileName);
+        if (prefetchFile.getDimensions() != m_file->getDimensions()) throw DataFileException("file changed on disk");
+    } catch (exception&) {//CaretException derives from std::exception
+        QMutexLocker locked(&m_mutex);
+        m_prefetchFailed = true;//the cache still works, just without prefetching
+        m_prefetchQueue.clear();
+        return;
+    }
+    vector<float> buffer(m_rowLength);
+    while (true)
+    {
+        int64_t index = -1;
+        {
+            QMutexLocker locked(&m_mutex);
+            while (!m_abort && (m_prefetchQueue.empty() || m_foregroundReading))
+            {
+                m_workAvailable.wait(&m_mutex);
+            }
+            if (m_abort) return;
+            index = m_prefetchQueue.front();
+            m_prefetchQueue.pop_front();
+            if (m_rows.find(index) != m_rows.end()) continue;
+            m_prefetchingRow = index;
+        }
+        bool success = true;
+        try
+        {
+            prefetchFile.getRow(buffer.data(), index);
+        } catch (exception&) {
+            success = false;
+        }
+        QMutexLocker locked(&m_mutex);
+        if (success)
+        {
+            insertRow(buffer.data(), index);
+        } else {
+            m_prefetchQueue.clear();//a foreground read of the row will report the error
+        }
+        m_prefetchingRow = -1;
+        m_prefetchDone.wakeAll();
+    }
+}
+
+void CiftiRowCache::setMemoryBudget(const int64_t& memoryBudgetBytes)
+{
+    QMutexLocker locked(&m_mutex);
+    m_maxCachedRows = max((int64_t)0, memoryBudgetBytes) / max((int64_t)1, m_rowLength * (int64_t)sizeof(float));
+    evictRows(m_maxCachedRows);
+    while ((int64_t)m_prefetchQueue.size() > m_maxCachedRows / 2)
+    {
+        m_prefetchQueue.pop_back();
+    }
+}
+
+int64_t CiftiRowCache::getNumberOfCachedRows()
+{
+    QMutexLocker locked(&m_mutex);
+    return (int64_t)m_rows.size();
+}
+
+void CiftiRowCache::clear()
+{
+    QMutexLocker locked(&m_mutex);
+    m_prefetchQueue.clear();
+    evictRows(0);
+}
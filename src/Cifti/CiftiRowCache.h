@@ -0,0 +1,83 @@
+#ifndef __CIFTI_ROW_CACHE_H__
+#define __CIFTI_ROW_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretPointer.h"
+
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace caret
+{
+    class CiftiFile;
+    class CiftiRowCacheThread;
+    
+    //keeps recently used rows of a 2D CiftiFile within a memory budget, discarding the least recently used rows first,
+    //and can read rows that are likely to be wanted next on a background thread, from a separate reader of the same file
+    //the CiftiFile is only read from by getRow, so the caller must not be reading it from another thread at the same time
+    class CiftiRowCache
+    {
+        struct CachedRow
+        {
+            std::vector<float> m_data;
+            std::list<int64_t>::iterator m_usePosition;
+        };
+        const CiftiFile* m_file;
+        int64_t m_rowLength, m_numRows, m_maxCachedRows;
+        std::map<int64_t, CachedRow> m_rows;
+        std::list<int64_t> m_useOrder;//most recently used first
+        std::deque<int64_t> m_prefetchQueue;
+        QString m_prefetchFileName;
+        int64_t m_prefetchingRow;//-1 when the background thread isn't reading
+        bool m_foregroundReading, m_abort, m_prefetchFailed;
+        QMutex m_mutex;
+        QWaitCondition m_workAvailable, m_prefetchDone;
+        CaretPointer<CiftiRowCacheThread> m_thread;//started on the first prefetch request
+        
+        CiftiRowCache(const CiftiRowCache&);
+        CiftiRowCache& operator=(const CiftiRowCache&);
+        bool copyCachedRow(float* dataOut, const int64_t& index);//these require m_mutex to be locked
+        void insertRow(const float* data, const int64_t& index);
+        void evictRows(const int64_t& maxRows);
+        void prefetchLoop();
+        friend class CiftiRowCacheThread;
+    public:
+        CiftiRowCache(const CiftiFile* file, const int64_t& memoryBudgetBytes);
+        ~CiftiRowCache();
+        
+        void getRow(float* dataOut, const int64_t& index);//returns a cached row, or reads it and caches it, throws DataFileException on read errors
+        void enablePrefetching(const QString& fileName);//file name of the CiftiFile, which is opened separately for reading in the background
+        void prefetchRows(const std::vector<int64_t>& indices);//replaces any rows still waiting to be prefetched, reads them in the order given
+        void setMemoryBudget(const int64_t& memoryBudgetBytes);//0 disables caching
+        int64_t getNumberOfCachedRows();
+        void clear();
+    };
+    
+}
+
+#endif //__CIFTI_ROW_CACHE_H__
@@ -0,0 +1,187 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowReader.h"
+
+#include "CaretAssert.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+#include "MultiDimIterator.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    const int64_t MAX_READ_AHEAD_BYTES = ((int64_t)1) << 28;//don't let huge rows use more than 256MB of buffers
+}
+
+namespace caret
+{
+    class CiftiRowReaderThread : public QThread
+    {
+        CiftiRowReader* m_reader;
+    public:
+        CiftiRowReaderThread(CiftiRowReader* reader) { m_reader = reader; }
+        void run() { m_reader->readerLoop(); }
+    };
+}
+
+CiftiRowReader::CiftiRowReader(const CiftiFile* file, const vector<vector<int64_t> >& rowList, const int& readAhead)
+{
+    m_file = file;
+    m_rowList = rowList;
+    init(readAhead);
+}
+
+CiftiRowReader::CiftiRowReader(const CiftiFile* file, const vector<int64_t>& rowList, const int& readAhead)
+{
+    m_file = file;
+    if (m_file->getDimensions().size() != 2) throw DataFileException("row list of single indices only works on 2D cifti");
+    m_rowList.resize(rowList.size(), vector<int64_t>(1));
+    for (size_t i = 0; i < rowList.size(); ++i)
+    {
+        m_rowList[i][0] = rowList[i];
+    }
+    init(readAhead);
+}
+
+CiftiRowReader::CiftiRowReader(const CiftiFile* file, const int& readAhead)
+{
+    m_file = file;
+    const vector<int64_t>& dims = m_file->getDimensions();
+    if (dims.size() > 1)
+    {
+        for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+        {
+            m_rowList.push_back(*iter);
+        }
+    }
+    init(readAhead);
+}
+
+void CiftiRowReader::init(const int& readAhead)
+{
+    const vector<int64_t>& dims = m_file->getDimensions();
+    if (dims.size() < 2) throw DataFileException("cifti file must have at least 2 dimensions to read rows");
+    m_rowLength = dims[0];
+    m_numProduced = 0;
+    m_numConsumed = 0;
+    m_current = -1;
+    m_abort = false;
+    m_haveError = false;
+    int64_t numBuffers = min((int64_t)readAhead, max((int64_t)2, MAX_READ_AHEAD_BYTES / max((int64_t)1, m_rowLength * (int64_t)sizeof(float))));
+    numBuffers = min(numBuffers, (int64_t)m_rowList.size());
+    if (m_file->isInMemory() || numBuffers < 2)
+    {//nothing to overlap with, so don't bother with a thread
+        m_buffers.resize(1, vector<float>(m_rowLength));
+        return;
+    }
+    m_buffers.resize(numBuffers, vector<float>(m_rowLength));
+    m_thread.grabNew(new CiftiRowReaderThread(this));
+    m_thread->start();
+}
+
+CiftiRowReader::~CiftiRowReader()
+{
+    if (m_thread != NULL)
+    {
+        {
+            QMutexLocker locked(&m_mutex);
+            m_abort = true;
+            m_slotFree.wakeAll();
+        }
+        m_thread->wait();
+    }
+}
+
+void CiftiRowReader::readerLoop()
+{
+    int64_t numBuffers = (int64_t)m_buffers.size(), numRows = (int64_t)m_rowList.size();
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        {
+            QMutexLocker locked(&m_mutex);
+            while (i - m_numConsumed >= numBuffers && !m_abort)//slot is free once the row numBuffers before this one is done with
+            {
+                m_slotFree.wait(&m_mutex);
+            }
+            if (m_abort) return;
+        }
+        try
+        {
+            m_file->getRow(m_buffers[i % numBuffers].data(), m_rowList[i]);
+        } catch (CaretException& e) {
+            QMutexLocker locked(&m_mutex);
+            m_haveError = true;
+            m_errorMessage = e.whatString();
+            m_rowReady.wakeAll();
+            return;
+        } catch (exception& e) {
+            QMutexLocker locked(&m_mutex);
+            m_haveError = true;
+            m_errorMessage = e.what();
+            m_rowReady.wakeAll();
+            return;
+        }
+        QMutexLocker locked(&m_mutex);
+        m_numProduced = i + 1;
+        m_rowReady.wakeAll();
+    }
+}
+
+const float* CiftiRowReader::nextRow()
+{
+    int64_t next = m_current + 1;
+    if (next >= (int64_t)m_rowList.size()) throw DataFileException("tried to read past the end of the requested rows");
+    if (m_thread == NULL)
+    {
+        m_current = next;
+        m_numConsumed = next;
+        const float* ret = m_file->getRowPointer(m_rowList[next]);
+        if (ret != NULL) return ret;
+        m_file->getRow(m_buffers[0].data(), m_rowList[next]);
+        return m_buffers[0].data();
+    }
+    QMutexLocker locked(&m_mutex);
+    m_numConsumed = next;//release the previous row's buffer
+    m_slotFree.wakeAll();
+    while (m_numProduced <= next && !m_haveError)
+    {
+        m_rowReady.wait(&m_mutex);
+    }
+    if (m_numProduced <= next)//rows read before an error are still valid
+    {
+        throw DataFileException(m_errorMessage);
+    }
+    m_current = next;
+    return m_buffers[next % m_buffers.size()].data();
+}
+
+const vector<int64_t>& CiftiRowReader::getCurrentIndex() const
+{
+    CaretAssert(m_current >= 0);
+    return m_rowList[m_current];
+}
@@ -0,0 +1,75 @@
+#ifndef __CIFTI_ROW_READER_H__
+#define __CIFTI_ROW_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+namespace caret
+{
+    class CiftiFile;
+    class CiftiRowReaderThread;
+    
+    //reads a predetermined sequence of rows from a CiftiFile on a background thread, into a ring of buffers,
+    //so that file IO overlaps with whatever is done with the previous rows
+    //while one of these exists, nothing else may read from the CiftiFile it was given
+    class CiftiRowReader
+    {
+        const CiftiFile* m_file;
+        std::vector<std::vector<int64_t> > m_rowList;
+        std::vector<std::vector<float> > m_buffers;
+        int64_t m_rowLength, m_numProduced, m_numConsumed, m_current;
+        bool m_abort, m_haveError;
+        AString m_errorMessage;
+        QMutex m_mutex;
+        QWaitCondition m_rowReady, m_slotFree;
+        CaretPointer<CiftiRowReaderThread> m_thread;//NULL when reading synchronously
+        
+        CiftiRowReader(const CiftiRowReader&);
+        CiftiRowReader& operator=(const CiftiRowReader&);
+        void init(const int& readAhead);
+        void readerLoop();
+        friend class CiftiRowReaderThread;
+    public:
+        enum
+        {
+            DEFAULT_READ_AHEAD = 16
+        };
+        CiftiRowReader(const CiftiFile* file, const std::vector<std::vector<int64_t> >& rowList, const int& readAhead = DEFAULT_READ_AHEAD);
+        CiftiRowReader(const CiftiFile* file, const std::vector<int64_t>& rowList, const int& readAhead = DEFAULT_READ_AHEAD);//for 2D only
+        explicit CiftiRowReader(const CiftiFile* file, const int& readAhead = DEFAULT_READ_AHEAD);//all rows, in file order
+        ~CiftiRowReader();
+        
+        const float* nextRow();//blocks until the next row in the list is ready, pointer is valid until the next call, throws DataFileException on read errors
+        const std::vector<int64_t>& getCurrentIndex() const;//index of the row most recently returned by nextRow
+        int64_t getNumberOfRowsRemaining() const { return (int64_t)m_rowList.size() - m_numConsumed - (m_current >= 0 ? 1 : 0); }
+        const int64_t& getRowLength() const { return m_rowLength; }
+    };
+    
+}
+
+#endif //__CIFTI_ROW_READER_H__
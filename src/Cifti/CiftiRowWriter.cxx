@@ -0,0 +1,176 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowWriter.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    const int64_t MAX_WRITE_BEHIND_BYTES = ((int64_t)1) << 28;//don't let huge rows use more than 256MB of buffers
+}
+
+namespace caret
+{
+    class CiftiRowWriterThread : public QThread
+    {
+        CiftiRowWriter* m_writer;
+    public:
+        CiftiRowWriterThread(CiftiRowWriter* writer) { m_writer = writer; }
+        void run() { m_writer->writerLoop(); }
+    };
+}
+
+CiftiRowWriter::CiftiRowWriter(CiftiFile* file, const int& writeBehind)
+{
+    m_file = file;
+    const vector<int64_t>& dims = m_file->getDimensions();
+    if (dims.size() < 2) throw DataFileException("cifti file must have at least 2 dimensions to write rows");
+    m_rowLength = dims[0];
+    m_numQueued = 0;
+    m_numWritten = 0;
+    m_finishing = false;
+    m_haveError = false;
+    m_errorReported = false;
+    int64_t numBuffers = min((int64_t)writeBehind, max((int64_t)2, MAX_WRITE_BEHIND_BYTES / max((int64_t)1, m_rowLength * (int64_t)sizeof(float))));
+    if (m_file->isInMemory() || numBuffers < 2) return;//in-memory setRow is just a copy, don't bother with a thread
+    m_buffers.resize(numBuffers, vector<float>(m_rowLength));
+    m_indices.resize(numBuffers);
+    m_thread.grabNew(new CiftiRowWriterThread(this));
+    m_thread->start();
+}
+
+CiftiRowWriter::~CiftiRowWriter()
+{
+    stopThread();
+    if (m_haveError && !m_errorReported)
+    {
+        CaretLogWarning("error writing cifti rows was not reported: " + m_errorMessage);
+    }
+}
+
+void CiftiRowWriter::writerLoop()
+{
+    int64_t numBuffers = (int64_t)m_buffers.size();
+    while (true)
+    {
+        int64_t slot;
+        {
+            QMutexLocker locked(&m_mutex);
+            while (m_numWritten == m_numQueued && !m_finishing)
+            {
+                m_rowQueued.wait(&m_mutex);
+            }
+            if (m_numWritten == m_numQueued) return;//finishing, and nothing left
+            slot = m_numWritten % numBuffers;
+        }
+        try
+        {
+            m_file->setRow(m_buffers[slot].data(), m_indices[slot]);
+        } catch (CaretException& e) {
+            QMutexLocker locked(&m_mutex);
+            m_haveError = true;
+            m_errorMessage = e.whatString();
+            m_slotFree.wakeAll();
+            return;
+        } catch (exception& e) {
+            QMutexLocker locked(&m_mutex);
+            m_haveError = true;
+            m_errorMessage = e.what();
+            m_slotFree.wakeAll();
+            return;
+        }
+        QMutexLocker locked(&m_mutex);
+        ++m_numWritten;
+        m_slotFree.wakeAll();
+    }
+}
+
+void CiftiRowWriter::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
+{
+    if (m_thread == NULL)
+    {
+        throwIfError();
+        m_file->setRow(dataIn, indexSelect);
+        return;
+    }
+    int64_t numBuffers = (int64_t)m_buffers.size(), slot;
+    {
+        QMutexLocker locked(&m_mutex);
+        while (m_numQueued - m_numWritten >= numBuffers && !m_haveError)
+        {
+            m_slotFree.wait(&m_mutex);
+        }
+        slot = m_numQueued % numBuffers;
+    }
+    throwIfError();
+    memcpy(m_buffers[slot].data(), dataIn, m_rowLength * sizeof(float));//the writer thread doesn't touch this slot until it is queued
+    m_indices[slot] = indexSelect;
+    QMutexLocker locked(&m_mutex);
+    ++m_numQueued;
+    m_rowQueued.wakeAll();
+}
+
+void CiftiRowWriter::setRow(const float* dataIn, const int64_t& index)
+{
+    if (m_file->getDimensions().size() != 2) throw DataFileException("setRow with a single index only works on 2D cifti");
+    vector<int64_t> tempvec(1, index);
+    setRow(dataIn, tempvec);
+}
+
+void CiftiRowWriter::finish()
+{
+    stopThread();
+    throwIfError();
+}
+
+void CiftiRowWriter::stopThread()
+{
+    if (m_thread == NULL) return;
+    {
+        QMutexLocker locked(&m_mutex);
+        m_finishing = true;
+        m_rowQueued.wakeAll();
+    }
+    m_thread->wait();
+    m_thread.grabNew(NULL);
+}
+
+void CiftiRowWriter::throwIfError()
+{
+    QMutexLocker locked(&m_mutex);
+    if (m_haveError)
+    {
+        m_errorReported = true;//the thread has stopped, so keep throwing on later calls, but don't also warn in the destructor
+        throw DataFileException(m_errorMessage);
+    }
+}
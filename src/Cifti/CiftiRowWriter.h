@@ -0,0 +1,72 @@
+#ifndef __CIFTI_ROW_WRITER_H__
+#define __CIFTI_ROW_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+namespace caret
+{
+    class CiftiFile;
+    class CiftiRowWriterThread;
+    
+    //queues rows given to setRow and writes them to the CiftiFile on a background thread, so that computing the next row overlaps with writing
+    //while one of these exists, nothing else may use the CiftiFile it was given, call finish() before using it again (or before writeFile)
+    class CiftiRowWriter
+    {
+        CiftiFile* m_file;
+        std::vector<std::vector<float> > m_buffers;
+        std::vector<std::vector<int64_t> > m_indices;
+        int64_t m_rowLength, m_numQueued, m_numWritten;
+        bool m_finishing, m_haveError, m_errorReported;
+        AString m_errorMessage;
+        QMutex m_mutex;
+        QWaitCondition m_rowQueued, m_slotFree;
+        CaretPointer<CiftiRowWriterThread> m_thread;//NULL when writing synchronously
+        
+        CiftiRowWriter(const CiftiRowWriter&);
+        CiftiRowWriter& operator=(const CiftiRowWriter&);
+        void writerLoop();
+        void stopThread();
+        void throwIfError();
+        friend class CiftiRowWriterThread;
+    public:
+        enum
+        {
+            DEFAULT_WRITE_BEHIND = 16
+        };
+        explicit CiftiRowWriter(CiftiFile* file, const int& writeBehind = DEFAULT_WRITE_BEHIND);//set the cifti XML on the file before constructing this
+        ~CiftiRowWriter();//waits for queued rows, but can't report errors, so call finish() first
+        
+        void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);//copies the data, may block if the queue is full
+        void setRow(const float* dataIn, const int64_t& index);//for 2D only
+        void finish();//blocks until all queued rows are written, throws DataFileException if any write failed
+    };
+    
+}
+
+#endif //__CIFTI_ROW_WRITER_H__
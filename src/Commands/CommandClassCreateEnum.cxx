@@ -342,9 +342,15 @@ CommandClassCreateEnum::createImplementationFile(const AString& outputFileName,
     t += ("#undef " + ifdefNameStaticDeclaration + "\n");
     t += ("\n");
     t += ("#include \"CaretAssert.h\"\n");
+    t += ("#include \"CaretMutex.h\"\n");
     t += ("\n");
     t += ("using namespace caret;\n");
     t += ("\n");
+    t += ("namespace\n");
+    t += ("{\n");
+    t += ("    CaretMutex s_initializeMutex;\n");
+    t += ("}\n");
+    t += ("\n");
     t += ("    \n");
     t += ("/**\n");
     t += (" * \\class caret::" + enumClassName + " \n");
@@ -409,7 +415,10 @@ CommandClassCreateEnum::createImplementationFile(const AString& outputFileName,
     t += ("    if (initializedFlag) {\n");
     t += ("        return;\n");
     t += ("    }\n");
-    t += ("    initializedFlag = true;\n");
+    t += ("    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once\n");
+    t += ("    if (initializedFlag) {//double check\n");
+    t += ("        return;\n");
+    t += ("    }\n");
     t += ("\n");
     
     for (int32_t indx = 0; indx < numberOfEnumValues; indx++) {
@@ -425,6 +434,7 @@ CommandClassCreateEnum::createImplementationFile(const AString& outputFileName,
         t += ("                                    \"\"));\n");
         t += ("    \n");
     }
+    t += ("    initializedFlag = true;//only after the data is complete, the check above is done without the lock\n");
     t += ("}\n");
     t += ("\n");
     
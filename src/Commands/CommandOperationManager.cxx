@@ -123,6 +123,7 @@
 #include "OperationBorderExportColorTable.h"
 #include "OperationBorderFileExportToCaret5.h"
 #include "OperationBorderMerge.h"
+#include "OperationCiftiChangeLayout.h"
 #include "OperationCiftiChangeTimestep.h"
 #include "OperationCiftiConvert.h"
 #include "OperationCiftiConvertToScalar.h"
@@ -154,6 +155,7 @@
 #include "OperationMetricMath.h"
 #include "OperationMetricMerge.h"
 #include "OperationMetricPalette.h"
+#include "OperationMetricSmoothingPrecompute.h"
 #include "OperationMetricVertexSum.h"
 #include "OperationNiftiConvert.h"
 #include "OperationNiftiInformation.h"
@@ -180,6 +182,10 @@
 #include "OperationVolumeReorient.h"
 #include "OperationVolumeSetSpace.h"
 #include "OperationWbsparseMergeDense.h"
+#include "OperationWbsparseMultiplyCifti.h"
+#include "OperationWbsparseReduce.h"
+#include "OperationWbsparseThreshold.h"
+#include "OperationWbsparseTranspose.h"
 #include "OperationZipSceneFile.h"
 #include "OperationZipSpecFile.h"
 
@@ -337,6 +343,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderExportColorTable()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderFileExportToCaret5()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderMerge()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiChangeLayout()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiChangeTimestep()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiConvert()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiConvertToScalar()));
@@ -368,6 +375,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationMetricMath()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationMetricMerge()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationMetricPalette()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationMetricSmoothingPrecompute()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationMetricVertexSum()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationNiftiConvert()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationNiftiInformation()));
@@ -396,6 +404,10 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationVolumeReorient()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationVolumeSetSpace()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationWbsparseMergeDense()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationWbsparseMultiplyCifti()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationWbsparseReduce()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationWbsparseThreshold()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationWbsparseTranspose()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationZipSceneFile()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationZipSpecFile()));
     
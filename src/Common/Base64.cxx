@@ -191,6 +191,64 @@ inline static unsigned char Base64DecodeChar(unsigned char c)
   return Base64DecodeTable[c];
 }
 
+//----------------------------------------------------------------------------
+// Decode tables with the 6 bits of each character of a quad already shifted
+// into place, so a quad decodes with four lookups and one validity test.
+// Padding ('=') is marked invalid so that the end of the stream is left to
+// DecodeTriplet.
+namespace
+{
+  const uint32_t BASE64_FAST_INVALID = 0x01000000;
+  
+  struct Base64FastDecodeTables
+  {
+    uint32_t m_shifted[4][256];
+    Base64FastDecodeTables()
+    {
+      for (int c = 0; c < 256; ++c)
+        {
+        const uint32_t d = Base64DecodeTable[c];
+        for (int i = 0; i < 4; ++i)
+          {
+          if (d == 0xFF || c == '=')
+            {
+            m_shifted[i][c] = BASE64_FAST_INVALID;
+            } else {
+            m_shifted[i][c] = d << (6 * (3 - i));
+            }
+          }
+        }
+    }
+  };
+  
+  const Base64FastDecodeTables Base64FastTables;
+  
+  //decode whole quads until fewer than 4 characters or 3 output bytes remain,
+  //or a character that needs DecodeTriplet is found
+  inline void Base64DecodeQuads(const unsigned char*& ptr,
+                                const unsigned char* end,
+                                unsigned char*& optr,
+                                const unsigned char* oend)
+  {
+    while ((end - ptr) >= 4 && (oend - optr) >= 3)
+      {
+      const uint32_t quad = Base64FastTables.m_shifted[0][ptr[0]]
+                          | Base64FastTables.m_shifted[1][ptr[1]]
+                          | Base64FastTables.m_shifted[2][ptr[2]]
+                          | Base64FastTables.m_shifted[3][ptr[3]];
+      if (quad & BASE64_FAST_INVALID)
+        {
+        return;
+        }
+      optr[0] = (unsigned char)(quad >> 16);
+      optr[1] = (unsigned char)(quad >> 8);
+      optr[2] = (unsigned char)quad;
+      ptr += 4;
+      optr += 3;
+      }
+  }
+}
+
 //----------------------------------------------------------------------------
 int Base64::DecodeTriplet(unsigned char i0,
                                       unsigned char i1,
@@ -247,6 +305,7 @@ uint64_t Base64::decode(const unsigned char *input,
   if (max_input_length)
     {
     const unsigned char *end = input + max_input_length;
+    Base64DecodeQuads(ptr, end, optr, optr + max_input_length);//output is never longer than input
     while (ptr < end)
       {
       int len = 
@@ -263,6 +322,9 @@ uint64_t Base64::decode(const unsigned char *input,
   else 
     {
     unsigned char *oend = output + length;
+    //without an input length, the quad that completes the output must not be passed,
+    //the caller's input may end right after it
+    Base64DecodeQuads(ptr, ptr + ((length + 2) / 3) * 4, optr, oend);
     while ((oend - optr) >= 3)
       {
       int len = 
@@ -23,9 +23,15 @@
 #include "ByteOrderEnum.h"
 #undef __BYTE_ORDER_DECLARE__
 
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -92,7 +98,10 @@ ByteOrderEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ByteOrderEnum(ENDIAN_BIG,"ENDIAN_BIG"));
     enumData.push_back(ByteOrderEnum(ENDIAN_LITTLE,"ENDIAN_LITTLE"));
@@ -102,6 +111,7 @@ ByteOrderEnum::initialize()
     
     ByteOrderEnum::systemEndian = ByteOrderEnum::ENDIAN_BIG;
     if (*c == 0x01) systemEndian = ByteOrderEnum::ENDIAN_LITTLE;
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -26,9 +26,15 @@
 #endif
 
 #include "CaretBinaryFile.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 
 #include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #include "zlib.h"
 
 using namespace caret;
@@ -51,6 +57,37 @@ namespace caret
         void write(const void* dataIn, const int64_t& count);
         ~ZFileImpl();
     };
+    
+    //gzip-compatible file made of independently deflated members of at most 64KB, each marked with its compressed size (the BGZF layout),
+    //so that blocks can be compressed and decompressed in parallel, and seeking only needs to decompress the blocks that are read
+    //the index of block offsets is rebuilt from the member headers on open, so no extra file is needed
+    class BlockZFileImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        uchar* m_map;//compressed file, when mapping works
+        bool m_writing;
+        int64_t m_pos;//uncompressed position
+        std::vector<int64_t> m_blockCompStart, m_blockUncompStart;//one extra element at the end, for the end of the last block
+        std::vector<char> m_cache;//decompressed window of whole blocks, for reads that don't cover whole blocks
+        int64_t m_cacheStart;
+        std::vector<char> m_writeBuffer;//uncompressed data waiting to be compressed as a batch
+        int64_t m_flushedSize;
+        void buildIndex();
+        int64_t findBlock(const int64_t& position) const;
+        void decompressBlocks(const int64_t& firstBlock, const int64_t& endBlock, char* dataOut);
+        void fillCache(const int64_t& firstBlock);
+        void flushBlocks(const bool& all);
+    public:
+        BlockZFileImpl() { m_map = NULL; m_writing = false; m_pos = 0; m_cacheStart = 0; m_flushedSize = 0; }
+        static bool isBlockCompressed(const QString& filename);//checks the first member header for the block size field
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~BlockZFileImpl();
+    };
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
@@ -64,6 +101,25 @@ namespace caret
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
     };
+    
+    //read-only, maps the entire file so that readers can use the data in place, and so that the page cache is shared between processes
+    class MmapFileImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        uchar* m_map;
+        int64_t m_size, m_pos;
+    public:
+        MmapFileImpl() { m_map = NULL; m_size = 0; m_pos = 0; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);//throws if mapping fails, so the caller can fall back to QFileImpl
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        const char* getMappedData() const { return (const char*)m_map; }
+        int64_t getMappedSize() const { return m_size; }
+        ~MmapFileImpl();
+    };
 }
 
 CaretBinaryFile::ImplInterface::~ImplInterface()
@@ -106,17 +162,47 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        if ((opmode & WRITE) || BlockZFileImpl::isBlockCompressed(filename))//write everything in the block format, read other gzip files the old way
+        {
+            m_impl.grabNew(new BlockZFileImpl());
+        } else {
+            m_impl.grabNew(new ZFileImpl());
+        }
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
     } else {
+        if ((opmode & MEMORY_MAP) && !(opmode & WRITE))
+        {
+            try
+            {
+                m_impl.grabNew(new MmapFileImpl());
+                m_impl->open(filename, opmode);
+                m_curMode = opmode;
+                return;
+            } catch (DataFileException& e) {//32-bit address space, filesystem without mmap support, etc - not fatal, QFileImpl will report any real problems
+                CaretLogFine("memory mapping failed, falling back to normal reading: " + e.whatString());
+                m_impl.grabNew(NULL);
+            }
+        }
         m_impl.grabNew(new QFileImpl());
     }
-    m_impl->open(filename, opmode);
+    m_impl->open(filename, (OpenMode)(opmode & ~MEMORY_MAP));//the other implementations don't know about the mapping hint
     m_curMode = opmode;
 }
 
+const char* CaretBinaryFile::getMappedData() const
+{
+    if (m_impl == NULL) return NULL;
+    return m_impl->getMappedData();
+}
+
+int64_t CaretBinaryFile::getMappedSize() const
+{
+    if (m_impl == NULL) return 0;
+    return m_impl->getMappedSize();
+}
+
 void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
     if (!getOpenForRead()) throw DataFileException("file is not open for reading");
@@ -251,6 +337,382 @@ ZFileImpl::~ZFileImpl()
 {
     close();
 }
+
+namespace
+{
+    const int64_t BLOCK_HEADER_SIZE = 18, BLOCK_FOOTER_SIZE = 8;//gzip header with the 6 byte extra field, crc32 and isize
+    const int64_t BLOCK_MAX_SIZE = 65536;//size field is 16 bits
+    const int64_t BLOCK_DATA_SIZE = 0xff00;//uncompressed bytes per block, small enough that even incompressible data fits in a block
+    const int64_t CACHE_TARGET_SIZE = 1<<24;//16MB of blocks decompressed at a time for small reads, so sequential small reads still get parallelism
+    const uint8_t EMPTY_BLOCK[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 66, 67, 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };//end of file marker
+    
+    uint16_t readLE16(const uint8_t* data)
+    {
+        return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+    }
+    
+    uint32_t readLE32(const uint8_t* data)
+    {
+        return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+    
+    void writeLE16(uint8_t* data, const uint16_t& value)
+    {
+        data[0] = value & 0xff;
+        data[1] = value >> 8;
+    }
+    
+    void writeLE32(uint8_t* data, const uint32_t& value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data[i] = (value >> (8 * i)) & 0xff;
+        }
+    }
+    
+    //returns the total compressed size of the member, or -1 if this isn't a block member header
+    int64_t getBlockSize(const uint8_t* header)
+    {
+        if (header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0) return -1;
+        if (readLE16(header + 10) != 6 || header[12] != 66 || header[13] != 67 || readLE16(header + 14) != 2) return -1;
+        return (int64_t)readLE16(header + 16) + 1;
+    }
+    
+    //compresses up to BLOCK_DATA_SIZE bytes into a complete gzip member
+    void compressBlock(const char* dataIn, const int64_t& size, std::vector<char>& blockOut)
+    {
+        blockOut.resize(BLOCK_MAX_SIZE);
+        uint8_t* out = (uint8_t*)blockOut.data();
+        int64_t payloadSize = -1;
+        for (int level = Z_DEFAULT_COMPRESSION; payloadSize < 0; level = 0)//if it doesn't fit, store it instead
+        {
+            z_stream strm;
+            memset(&strm, 0, sizeof(z_stream));
+            if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) break;//negative window bits means raw deflate, we write the gzip wrapper ourselves
+            strm.next_in = (Bytef*)dataIn;
+            strm.avail_in = (uInt)size;
+            strm.next_out = out + BLOCK_HEADER_SIZE;
+            strm.avail_out = (uInt)(BLOCK_MAX_SIZE - BLOCK_HEADER_SIZE - BLOCK_FOOTER_SIZE);
+            int ret = deflate(&strm, Z_FINISH);
+            if (ret == Z_STREAM_END) payloadSize = strm.total_out;
+            deflateEnd(&strm);
+            if (level == 0) break;
+        }
+        if (payloadSize < 0) throw DataFileException("failed to compress block");
+        memcpy(out, EMPTY_BLOCK, BLOCK_HEADER_SIZE);
+        int64_t totalSize = BLOCK_HEADER_SIZE + payloadSize + BLOCK_FOOTER_SIZE;
+        writeLE16(out + 16, (uint16_t)(totalSize - 1));
+        writeLE32(out + BLOCK_HEADER_SIZE + payloadSize, (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataIn, (uInt)size));
+        writeLE32(out + BLOCK_HEADER_SIZE + payloadSize + 4, (uint32_t)size);
+        blockOut.resize(totalSize);
+    }
+    
+    //returns false on corrupt data
+    bool decompressBlock(const uint8_t* blockIn, const int64_t& blockSize, char* dataOut, const int64_t& expectedSize)
+    {
+        z_stream strm;
+        memset(&strm, 0, sizeof(z_stream));
+        if (inflateInit2(&strm, -15) != Z_OK) return false;
+        strm.next_in = (Bytef*)(blockIn + BLOCK_HEADER_SIZE);
+        strm.avail_in = (uInt)(blockSize - BLOCK_HEADER_SIZE - BLOCK_FOOTER_SIZE);
+        strm.next_out = (Bytef*)dataOut;
+        strm.avail_out = (uInt)expectedSize;
+        int ret = inflate(&strm, Z_FINISH);
+        bool ok = (ret == Z_STREAM_END && (int64_t)strm.total_out == expectedSize);
+        inflateEnd(&strm);
+        if (!ok) return false;
+        return (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataOut, (uInt)expectedSize) == readLE32(blockIn + blockSize - BLOCK_FOOTER_SIZE);
+    }
+}
+
+bool BlockZFileImpl::isBlockCompressed(const QString& filename)
+{
+    QFile myFile(filename);
+    if (!myFile.open(QIODevice::ReadOnly)) return false;//let the normal implementation report the error
+    uint8_t header[BLOCK_HEADER_SIZE];
+    if (myFile.read((char*)header, BLOCK_HEADER_SIZE) != BLOCK_HEADER_SIZE) return false;
+    return getBlockSize(header) > 0;
+}
+
+void BlockZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    m_pos = 0;
+    m_file.setFileName(filename);
+    switch (opmode)
+    {
+        case CaretBinaryFile::READ:
+            m_writing = false;
+            if (!m_file.open(QIODevice::ReadOnly)) throw DataFileException("error opening compressed file '" + filename + "'");
+            if (m_file.size() > 0)
+            {
+                m_map = m_file.map(0, m_file.size());//if this fails, we just read the compressed blocks as needed
+            }
+            buildIndex();
+            break;
+        case CaretBinaryFile::WRITE_TRUNCATE:
+            m_writing = true;
+            m_flushedSize = 0;
+            if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) throw DataFileException("error opening compressed file '" + filename + "'");
+            break;
+        default:
+            throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    }
+}
+
+void BlockZFileImpl::buildIndex()
+{
+    int64_t fileSize = m_file.size(), compPos = 0, uncompPos = 0;
+    m_blockCompStart.clear();
+    m_blockUncompStart.clear();
+    while (compPos < fileSize)
+    {
+        uint8_t header[BLOCK_HEADER_SIZE], footer[BLOCK_FOOTER_SIZE];
+        int64_t blockSize = -1;
+        if (compPos + BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE <= fileSize)
+        {
+            if (m_map != NULL)
+            {
+                memcpy(header, m_map + compPos, BLOCK_HEADER_SIZE);
+            } else {
+                if (!m_file.seek(compPos) || m_file.read((char*)header, BLOCK_HEADER_SIZE) != BLOCK_HEADER_SIZE) throw DataFileException("error reading compressed file '" + m_fileName + "'");
+            }
+            blockSize = getBlockSize(header);
+        }
+        if (blockSize < BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE || compPos + blockSize > fileSize)
+        {
+            throw DataFileException("compressed file '" + m_fileName + "' has a truncated or non-block member at offset " + AString::number(compPos));
+        }
+        if (m_map != NULL)
+        {
+            memcpy(footer, m_map + compPos + blockSize - BLOCK_FOOTER_SIZE, BLOCK_FOOTER_SIZE);
+        } else {
+            if (!m_file.seek(compPos + blockSize - BLOCK_FOOTER_SIZE) || m_file.read((char*)footer, BLOCK_FOOTER_SIZE) != BLOCK_FOOTER_SIZE) throw DataFileException("error reading compressed file '" + m_fileName + "'");
+        }
+        int64_t uncompSize = readLE32(footer + 4);
+        if (uncompSize > BLOCK_MAX_SIZE) throw DataFileException("compressed file '" + m_fileName + "' has a block that is too large");
+        if (uncompSize > 0)//skip empty blocks, including the end of file marker
+        {
+            m_blockCompStart.push_back(compPos);
+            m_blockUncompStart.push_back(uncompPos);
+        }
+        compPos += blockSize;
+        uncompPos += uncompSize;
+    }
+    m_blockCompStart.push_back(compPos);//sentinels
+    m_blockUncompStart.push_back(uncompPos);
+    m_cache.clear();
+    m_cacheStart = 0;
+}
+
+int64_t BlockZFileImpl::findBlock(const int64_t& position) const
+{//last block that starts at or before position
+    return (upper_bound(m_blockUncompStart.begin(), m_blockUncompStart.end() - 1, position) - m_blockUncompStart.begin()) - 1;
+}
+
+void BlockZFileImpl::decompressBlocks(const int64_t& firstBlock, const int64_t& endBlock, char* dataOut)
+{
+    if (endBlock <= firstBlock) return;
+    const uint8_t* compData;
+    std::vector<char> compBuffer;
+    int64_t compOffset = m_blockCompStart[firstBlock];
+    if (m_map != NULL)
+    {
+        compData = m_map + compOffset;
+    } else {//read the compressed blocks in one go, then decompress in parallel
+        int64_t compSize = m_blockCompStart[endBlock] - compOffset;
+        compBuffer.resize(compSize);
+        if (!m_file.seek(compOffset) || m_file.read(compBuffer.data(), compSize) != compSize) throw DataFileException("error reading compressed file '" + m_fileName + "'");
+        compData = (const uint8_t*)compBuffer.data();
+    }
+    bool ok = true;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int block = (int)firstBlock; block < (int)endBlock; ++block)
+    {
+        int64_t blockSize = getBlockSize(compData + m_blockCompStart[block] - compOffset);//don't trust the index if the file changed under us
+        if (blockSize < BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE || m_blockCompStart[block] + blockSize > m_blockCompStart[block + 1] ||
+            !decompressBlock(compData + m_blockCompStart[block] - compOffset, blockSize,
+                             dataOut + m_blockUncompStart[block] - m_blockUncompStart[firstBlock], m_blockUncompStart[block + 1] - m_blockUncompStart[block]))
+        {
+            ok = false;//can't throw inside parallel region
+        }
+    }
+    if (!ok) throw DataFileException("error decompressing file '" + m_fileName + "', file may be corrupt");
+}
+
+void BlockZFileImpl::fillCache(const int64_t& firstBlock)
+{
+    int64_t numBlocks = (int64_t)m_blockUncompStart.size() - 1;
+    int64_t endBlock = firstBlock + 1;
+    while (endBlock < numBlocks && m_blockUncompStart[endBlock] - m_blockUncompStart[firstBlock] < CACHE_TARGET_SIZE)
+    {
+        ++endBlock;
+    }
+    m_cache.resize(m_blockUncompStart[endBlock] - m_blockUncompStart[firstBlock]);
+    m_cacheStart = m_blockUncompStart[firstBlock];
+    try
+    {
+        decompressBlocks(firstBlock, endBlock, m_cache.data());
+    } catch (...) {
+        m_cache.clear();//don't leave a bad cache around
+        throw;
+    }
+}
+
+void BlockZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (!m_file.isOpen() || m_writing) throw DataFileException("read called on BlockZFileImpl not open for reading");//shouldn't happen
+    int64_t totalSize = m_blockUncompStart.back();
+    int64_t toRead = max((int64_t)0, min(count, totalSize - m_pos));
+    char* outPtr = (char*)dataOut;
+    int64_t totalRead = 0;
+    while (totalRead < toRead)
+    {
+        int64_t cacheEnd = m_cacheStart + (int64_t)m_cache.size();
+        if (m_pos >= m_cacheStart && m_pos < cacheEnd)
+        {
+            int64_t copySize = min(toRead - totalRead, cacheEnd - m_pos);
+            memcpy(outPtr + totalRead, m_cache.data() + (m_pos - m_cacheStart), copySize);
+            m_pos += copySize;
+            totalRead += copySize;
+            continue;
+        }
+        int64_t firstBlock = findBlock(m_pos);
+        if (m_blockUncompStart[firstBlock] == m_pos)
+        {//decompress whole blocks directly into the output, to avoid the extra copy on large reads
+            int64_t endBlock = findBlock(m_pos + (toRead - totalRead));
+            if (m_blockUncompStart[endBlock + 1] == m_pos + (toRead - totalRead)) ++endBlock;//request ends on a block boundary
+            if (endBlock > firstBlock)
+            {
+                int64_t copySize = m_blockUncompStart[endBlock] - m_pos;
+                decompressBlocks(firstBlock, endBlock, outPtr + totalRead);
+                m_pos += copySize;
+                totalRead += copySize;
+                continue;
+            }
+        }
+        fillCache(firstBlock);
+    }
+    if (numRead == NULL)
+    {
+        if (totalRead != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = totalRead;
+    }
+}
+
+void BlockZFileImpl::seek(const int64_t& position)
+{
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened BlockZFileImpl");//shouldn't happen
+    if (position < 0) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    if (m_writing)
+    {
+        int64_t curPos = pos();
+        if (position < curPos) throw DataFileException("can't seek backwards while writing compressed file '" + m_fileName + "'");
+        if (position > curPos)
+        {
+            std::vector<char> zeros(position - curPos, 0);//like gzseek, fill with zeros
+            write(zeros.data(), position - curPos);
+        }
+    } else {
+        m_pos = position;//like QFile, seeking past the end is allowed, reads there just come up short
+    }
+}
+
+int64_t BlockZFileImpl::pos()
+{
+    if (m_writing) return m_flushedSize + (int64_t)m_writeBuffer.size();
+    return m_pos;
+}
+
+void BlockZFileImpl::write(const void* dataIn, const int64_t& count)
+{
+    if (!m_file.isOpen() || !m_writing) throw DataFileException("write called on BlockZFileImpl not open for writing");//shouldn't happen
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    int64_t batchSize = BLOCK_DATA_SIZE * 16 * numThreads;//enough blocks to keep all threads busy
+    const char* inPtr = (const char*)dataIn;
+    int64_t totalWritten = 0;
+    while (totalWritten < count)
+    {
+        int64_t copySize = min(count - totalWritten, batchSize - (int64_t)m_writeBuffer.size());
+        m_writeBuffer.insert(m_writeBuffer.end(), inPtr + totalWritten, inPtr + totalWritten + copySize);
+        totalWritten += copySize;
+        if ((int64_t)m_writeBuffer.size() >= batchSize)
+        {
+            flushBlocks(false);
+        }
+    }
+}
+
+void BlockZFileImpl::flushBlocks(const bool& all)
+{//compress all full blocks in the buffer in parallel (and the partial one if all is true), then write them in order
+    int64_t bufSize = (int64_t)m_writeBuffer.size();
+    int64_t numBlocks = all ? (bufSize + BLOCK_DATA_SIZE - 1) / BLOCK_DATA_SIZE : bufSize / BLOCK_DATA_SIZE;
+    if (numBlocks == 0) return;
+    std::vector<std::vector<char> > compressed(numBlocks);
+    bool ok = true;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int block = 0; block < (int)numBlocks; ++block)
+    {
+        int64_t start = block * BLOCK_DATA_SIZE;
+        try
+        {
+            compressBlock(m_writeBuffer.data() + start, min(BLOCK_DATA_SIZE, bufSize - start), compressed[block]);
+        } catch (DataFileException&) {
+            ok = false;//can't throw out of the parallel region
+        }
+    }
+    if (!ok) throw DataFileException("failed to compress data for file '" + m_fileName + "'");
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {
+        if (m_file.write(compressed[block].data(), compressed[block].size()) != (int64_t)compressed[block].size())
+        {
+            throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+        }
+    }
+    int64_t used = min(bufSize, numBlocks * BLOCK_DATA_SIZE);
+    m_writeBuffer.erase(m_writeBuffer.begin(), m_writeBuffer.begin() + used);
+    m_flushedSize += used;
+}
+
+void BlockZFileImpl::close()
+{
+    if (m_map != NULL)
+    {
+        m_file.unmap(m_map);
+        m_map = NULL;
+    }
+    if (m_file.isOpen() && m_writing)
+    {
+        m_writing = false;//don't try this twice if it throws
+        flushBlocks(true);
+        if (m_file.write((const char*)EMPTY_BLOCK, sizeof(EMPTY_BLOCK)) != (int64_t)sizeof(EMPTY_BLOCK))
+        {
+            m_file.close();
+            throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+        }
+    }
+    m_file.close();
+    m_writeBuffer.clear();
+    m_cache.clear();
+    m_cacheStart = 0;
+    m_blockCompStart.clear();
+    m_blockUncompStart.clear();
+}
+
+BlockZFileImpl::~BlockZFileImpl()
+{
+    try
+    {
+        close();
+    } catch (DataFileException& e) {//destructors shouldn't throw
+        CaretLogWarning(e.whatString());
+    }
+}
 #endif //ZLIB_VERSION
 
 void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
@@ -311,3 +773,77 @@ void QFileImpl::write(const void* dataIn, const int64_t& count)
     if (writeret != count) throw DataFileException(msg);
     //if (writeret != count) throw DataFileException("failed to write to file '" + m_fileName + "'");
 }
+
+void MmapFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode & CaretBinaryFile::WRITE) throw DataFileException("memory mapped file only supports READ mode");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        throw DataFileException("failed to open file '" + m_fileName + "'");
+    }
+    m_size = m_file.size();
+    m_pos = 0;
+    if (m_size > 0)//mapping zero bytes is an error, but an empty file is not
+    {
+        m_map = m_file.map(0, m_size);
+        if (m_map == NULL)
+        {
+            m_file.close();
+            m_size = 0;
+            throw DataFileException("failed to memory map file '" + m_fileName + "'");
+        }
+    }
+}
+
+void MmapFileImpl::close()
+{
+    if (m_map != NULL)
+    {
+        m_file.unmap(m_map);
+        m_map = NULL;
+    }
+    m_file.close();
+    m_size = 0;
+    m_pos = 0;
+}
+
+void MmapFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    int64_t toRead = count;
+    if (m_pos + toRead > m_size) toRead = max((int64_t)0, m_size - m_pos);
+    if (toRead > 0)
+    {
+        memcpy(dataOut, m_map + m_pos, toRead);
+        m_pos += toRead;
+    }
+    if (numRead == NULL)
+    {
+        if (toRead != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+    } else {
+        *numRead = toRead;
+    }
+}
+
+void MmapFileImpl::seek(const int64_t& position)
+{
+    if (position < 0) throw DataFileException("seek failed in file '" + m_fileName + "'");
+    m_pos = position;//like QFile, seeking past the end is allowed, reads there just come up short
+}
+
+int64_t MmapFileImpl::pos()
+{
+    return m_pos;
+}
+
+void MmapFileImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on memory mapped file '" + m_fileName + "'");//CaretBinaryFile should prevent this
+}
+
+MmapFileImpl::~MmapFileImpl()
+{
+    close();
+}
@@ -41,7 +41,9 @@ namespace caret {
             READ_WRITE = 3,//for convenience
             TRUNCATE = 4,
             WRITE_TRUNCATE = 6,//ditto
-            READ_WRITE_TRUNCATE = 7//ditto
+            READ_WRITE_TRUNCATE = 7,//ditto
+            MEMORY_MAP = 8,//hint only: honored for read-only access to uncompressed files, silently falls back to normal reading if mapping fails
+            READ_MEMORY_MAP = 9//ditto
         };
         CaretBinaryFile() { }
         ///constructor that opens file
@@ -55,6 +57,8 @@ namespace caret {
         int64_t pos();
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
+        const char* getMappedData() const;//NULL if the file is not memory mapped, pointer is invalidated by close()
+        int64_t getMappedSize() const;
         class ImplInterface
         {
         protected:
@@ -67,6 +71,8 @@ namespace caret {
             virtual int64_t pos() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual const char* getMappedData() const { return NULL; }
+            virtual int64_t getMappedSize() const { return 0; }
             virtual ~ImplInterface();
         };
     private:
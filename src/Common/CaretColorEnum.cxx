@@ -25,9 +25,15 @@
 #undef __CARET_COLOR_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::CaretColorEnum 
@@ -85,7 +91,10 @@ CaretColorEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(CaretColorEnum(AQUA, 
                                       "AQUA", 
@@ -198,6 +207,7 @@ CaretColorEnum::initialize()
                                       1,
                                       1,
                                       0));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -22,8 +22,11 @@
 #include "CaretException.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
@@ -36,6 +39,7 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
         throw CaretException("error parsing expression '" + expression + "'");
     }
     CaretLogInfo("parsed '" + expression + "' as '" + toString() + "'");
+    compile();
 }
 
 double CaretMathExpression::evaluate(const vector<float>& variableValues) const
@@ -44,6 +48,393 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root.eval(variableValues);
 }
 
+void CaretMathExpression::evaluate(const vector<const float*>& inputs, float* output, const int64_t& count) const
+{
+    CaretAssert(inputs.size() >= m_varNames.size());
+    if (count <= 0) return;
+    int64_t numBlocks = (count - 1) / BLOCK_SIZE + 1;
+    int constStart = m_numRegisters - (int)m_constants.size();
+#pragma omp CARET_PAR if (numBlocks > 4)
+    {
+        vector<double> registers(m_numRegisters * BLOCK_SIZE);
+        for (int c = 0; c < (int)m_constants.size(); ++c)
+        {
+            double* myReg = registers.data() + (constStart + c) * BLOCK_SIZE;
+            for (int i = 0; i < BLOCK_SIZE; ++i)
+            {
+                myReg[i] = m_constants[c];
+            }
+        }
+#pragma omp CARET_FOR schedule(static)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            int64_t offset = block * BLOCK_SIZE;
+            executeBlock(inputs, offset, min((int64_t)BLOCK_SIZE, count - offset), registers.data(), output);
+        }
+    }
+}
+
+void CaretMathExpression::executeBlock(const vector<const float*>& inputs, const int64_t& offset, const int64_t& count, double* registers, float* output) const
+{
+    const int numVars = (int)m_varNames.size();
+    for (int v = 0; v < numVars; ++v)
+    {
+        double* myReg = registers + v * BLOCK_SIZE;
+        const float* myInput = inputs[v] + offset;
+        for (int64_t i = 0; i < count; ++i)
+        {
+            myReg[i] = myInput[i];
+        }
+    }
+    const int numInstructions = (int)m_program.size();
+    for (int n = 0; n < numInstructions; ++n)
+    {//every case must read all of its arguments for element i before writing element i, as the destination may also be an argument
+        const Instruction& myInstr = m_program[n];
+        double* dest = registers + myInstr.m_dest * BLOCK_SIZE;
+        const double* a = registers + myInstr.m_args[0] * BLOCK_SIZE;
+        const double* b = registers + myInstr.m_args[1] * BLOCK_SIZE;
+        const double* c = registers + myInstr.m_args[2] * BLOCK_SIZE;
+        switch (myInstr.m_op)
+        {
+            case Instruction::NEG:
+                for (int64_t i = 0; i < count; ++i) dest[i] = -a[i];
+                break;
+            case Instruction::ADD:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] + b[i];
+                break;
+            case Instruction::SUB:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] - b[i];
+                break;
+            case Instruction::MULT:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] * b[i];
+                break;
+            case Instruction::DIV:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] / b[i];
+                break;
+            case Instruction::GREATER:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > b[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::LESS:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] < b[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::GREATER_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(a[i]), abs(b[i])) / (1<<20);//same fudge factor as MathNode::eval
+                    dest[i] = (a[i] >= b[i] - adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::LESS_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(a[i]), abs(b[i])) / (1<<20);
+                    dest[i] = (a[i] <= b[i] + adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::POW:
+                for (int64_t i = 0; i < count; ++i) dest[i] = pow(a[i], b[i]);
+                break;
+            case Instruction::FUNC:
+                switch (myInstr.m_function)//must match MathNode::eval exactly
+                {
+                    case MathFunctionEnum::SIN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sin(a[i]);
+                        break;
+                    case MathFunctionEnum::COS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = cos(a[i]);
+                        break;
+                    case MathFunctionEnum::TAN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = tan(a[i]);
+                        break;
+                    case MathFunctionEnum::ASIN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = asin(a[i]);
+                        break;
+                    case MathFunctionEnum::ACOS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = acos(a[i]);
+                        break;
+                    case MathFunctionEnum::ATAN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = atan(a[i]);
+                        break;
+                    case MathFunctionEnum::SINH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sinh(a[i]);
+                        break;
+                    case MathFunctionEnum::COSH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = cosh(a[i]);
+                        break;
+                    case MathFunctionEnum::TANH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = tanh(a[i]);
+                        break;
+                    case MathFunctionEnum::ASINH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            if (arg > 0)
+                            {
+                                dest[i] = log(arg + sqrt(arg * arg + 1));
+                            } else {
+                                dest[i] = -log(-arg + sqrt(arg * arg + 1));
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::ACOSH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            dest[i] = log(arg + sqrt(arg * arg - 1));
+                        }
+                        break;
+                    case MathFunctionEnum::ATANH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            dest[i] = 0.5 * log((1 + arg) / (1 - arg));
+                        }
+                        break;
+                    case MathFunctionEnum::LN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = log(a[i]);
+                        break;
+                    case MathFunctionEnum::EXP:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = exp(a[i]);
+                        break;
+                    case MathFunctionEnum::LOG:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = log10(a[i]);
+                        break;
+                    case MathFunctionEnum::SQRT:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sqrt(a[i]);
+                        break;
+                    case MathFunctionEnum::ABS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = abs(a[i]);
+                        break;
+                    case MathFunctionEnum::FLOOR:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = floor(a[i]);
+                        break;
+                    case MathFunctionEnum::ROUND:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double temp = a[i];
+                            if (temp > 0.0)
+                            {
+                                dest[i] = floor(temp + 0.5);
+                            } else {
+                                dest[i] = ceil(temp - 0.5);
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::CEIL:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = ceil(a[i]);
+                        break;
+                    case MathFunctionEnum::ATAN2:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = atan2(a[i], b[i]);
+                        break;
+                    case MathFunctionEnum::MIN:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double first = a[i], other = b[i];
+                            dest[i] = (first > other ? other : first);
+                        }
+                        break;
+                    case MathFunctionEnum::MAX:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double first = a[i], other = b[i];
+                            dest[i] = (first < other ? other : first);
+                        }
+                        break;
+                    case MathFunctionEnum::MOD:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double first = a[i], second = b[i];
+                            if (second == 0.0)
+                            {
+                                dest[i] = 0.0;
+                            } else {
+                                dest[i] = first - second * floor(first / second);
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::CLAMP:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double temp = a[i], low = b[i], high = c[i];
+                            if (temp < low)
+                            {
+                                temp = low;
+                            }
+                            if (temp > high)
+                            {
+                                temp = high;
+                            }
+                            dest[i] = temp;
+                        }
+                        break;
+                    case MathFunctionEnum::INVALID:
+                        CaretAssertMessage(0, "compiled FUNC instruction with INVALID function");
+                        throw CaretException("compiling problem in CaretMathExpression");
+                }
+                break;
+        }
+    }
+    const double* result = registers + m_resultRegister * BLOCK_SIZE;
+    float* myOutput = output + offset;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        myOutput[i] = (float)result[i];
+    }
+}
+
+void CaretMathExpression::compile()
+{
+    m_program.clear();
+    m_constants.clear();
+    int firstTemp = (int)m_varNames.size();
+    m_numRegisters = firstTemp;//compileNode tracks the temporaries it uses in m_numRegisters, constants go after them
+    int result = compileNode(m_root, firstTemp);
+    int constStart = m_numRegisters;
+    m_numRegisters += (int)m_constants.size();
+    for (int n = 0; n < (int)m_program.size(); ++n)
+    {//constants were given negative placeholder registers, because the number of temporaries wasn't known yet
+        for (int j = 0; j < 3; ++j)
+        {
+            if (m_program[n].m_args[j] < 0) m_program[n].m_args[j] = constStart - m_program[n].m_args[j] - 1;
+        }
+    }
+    if (result < 0) result = constStart - result - 1;
+    m_resultRegister = result;
+}
+
+int CaretMathExpression::getConstantRegister(const double& value)
+{
+    for (int c = 0; c < (int)m_constants.size(); ++c)
+    {
+        if (memcmp(&(m_constants[c]), &value, sizeof(double)) == 0) return -c - 1;//compare bits, so 0 and -0 stay distinct
+    }
+    m_constants.push_back(value);
+    return -(int)m_constants.size();
+}
+
+int CaretMathExpression::compileNode(const MathNode& node, const int& destReg)
+{//destReg and above are free to use as temporaries, registers below it must not be written
+    if (destReg >= m_numRegisters) m_numRegisters = destReg + 1;
+    Instruction myInstr;
+    myInstr.m_function = MathFunctionEnum::INVALID;
+    myInstr.m_dest = destReg;
+    myInstr.m_args[0] = destReg; myInstr.m_args[1] = destReg; myInstr.m_args[2] = destReg;//unused arguments still need to point to a valid register
+    int ret = -1;
+    switch (node.m_type)
+    {
+        case MathNode::GREATERLESS:
+        {
+            int end = (int)node.m_arguments.size();
+            CaretAssert(end > 0);
+            ret = compileNode(node.m_arguments[0], destReg);
+            for (int i = 1; i < end; ++i)
+            {
+                if (node.m_inclusive[i])
+                {
+                    myInstr.m_op = (node.m_invert[i] ? Instruction::LESS_EQUAL : Instruction::GREATER_EQUAL);
+                } else {
+                    myInstr.m_op = (node.m_invert[i] ? Instruction::LESS : Instruction::GREATER);
+                }
+                myInstr.m_args[0] = ret;
+                myInstr.m_args[1] = compileNode(node.m_arguments[i], destReg + 1);
+                m_program.push_back(myInstr);
+                ret = destReg;
+            }
+            break;
+        }
+        case MathNode::ADDSUB:
+        {
+            int end = (int)node.m_arguments.size();
+            ret = getConstantRegister(0.0);//MathNode::eval starts from 0, which matters for the sign of zero
+            for (int i = 0; i < end; ++i)
+            {
+                myInstr.m_op = (node.m_invert[i] ? Instruction::SUB : Instruction::ADD);
+                myInstr.m_args[0] = ret;
+                myInstr.m_args[1] = compileNode(node.m_arguments[i], destReg + 1);
+                m_program.push_back(myInstr);
+                ret = destReg;
+            }
+            break;
+        }
+        case MathNode::MULTDIV:
+        {
+            int end = (int)node.m_arguments.size();
+            CaretAssert(end > 0);
+            int i = 0;
+            if (node.m_invert[0])
+            {
+                ret = getConstantRegister(1.0);
+            } else {//multiplying by 1 is exact, so start from the first argument
+                ret = compileNode(node.m_arguments[0], destReg);
+                i = 1;
+            }
+            for (; i < end; ++i)
+            {
+                myInstr.m_op = (node.m_invert[i] ? Instruction::DIV : Instruction::MULT);
+                myInstr.m_args[0] = ret;
+                myInstr.m_args[1] = compileNode(node.m_arguments[i], destReg + 1);
+                m_program.push_back(myInstr);
+                ret = destReg;
+            }
+            break;
+        }
+        case MathNode::POW:
+        {
+            int end = (int)node.m_arguments.size();
+            CaretAssert(end > 0);
+            ret = compileNode(node.m_arguments[0], destReg);
+            myInstr.m_op = Instruction::POW;
+            for (int i = 1; i < end; ++i)
+            {
+                myInstr.m_args[0] = ret;
+                myInstr.m_args[1] = compileNode(node.m_arguments[i], destReg + 1);
+                m_program.push_back(myInstr);
+                ret = destReg;
+            }
+            break;
+        }
+        case MathNode::FUNC:
+        {
+            int end = (int)node.m_arguments.size();
+            CaretAssert(end > 0 && end <= 3);
+            if (node.m_function == MathFunctionEnum::INVALID)
+            {
+                CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
+                throw CaretException("parsing problem in CaretMathExpression");
+            }
+            myInstr.m_op = Instruction::FUNC;
+            myInstr.m_function = node.m_function;
+            for (int i = 0; i < end; ++i)
+            {
+                myInstr.m_args[i] = compileNode(node.m_arguments[i], destReg + i);
+            }
+            m_program.push_back(myInstr);
+            ret = destReg;
+            break;
+        }
+        case MathNode::VAR:
+            CaretAssertVectorIndex(m_varNames, node.m_varIndex);
+            ret = node.m_varIndex;
+            break;
+        case MathNode::CONST:
+            ret = getConstantRegister(node.m_constVal);
+            break;
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "parsing left INVALID MathNode");
+            throw CaretException("parsing problem in CaretMathExpression");
+    }
+    if (node.m_negate)
+    {
+        myInstr.m_op = Instruction::NEG;
+        myInstr.m_function = MathFunctionEnum::INVALID;
+        myInstr.m_args[0] = ret;
+        myInstr.m_args[1] = destReg; myInstr.m_args[2] = destReg;
+        m_program.push_back(myInstr);
+        ret = destReg;
+    }
+    return ret;
+}
+
 CaretMathExpression::MathNode::MathNode()
 {
     m_type = INVALID;
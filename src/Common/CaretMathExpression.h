@@ -23,6 +23,8 @@
 
 #include "AString.h"
 #include "MathFunctionEnum.h"
+
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -65,14 +67,46 @@ class CaretMathExpression
     bool tryFunc(MathNode& node, const AString& input, const int& start, const int& end);
     bool tryVar(MathNode& node, const AString& input, const int& start, const int& end);
     bool tryConst(MathNode& node, const AString& input, const int& start, const int& end);
+    //compiled form for evaluating many elements at once: a flat list of elementwise operations on registers of BLOCK_SIZE doubles,
+    //registers are laid out as variables, then temporaries, then constants
+    struct Instruction
+    {
+        enum OpCode
+        {
+            NEG,
+            ADD,
+            SUB,
+            MULT,
+            DIV,
+            GREATER,
+            LESS,
+            GREATER_EQUAL,
+            LESS_EQUAL,
+            POW,
+            FUNC
+        };
+        OpCode m_op;
+        MathFunctionEnum::Enum m_function;
+        int m_dest, m_args[3];
+    };
+    enum { BLOCK_SIZE = 256 };
+    int compileNode(const MathNode& node, const int& destReg);//returns the register holding the result, which is only destReg if an instruction was needed
+    int getConstantRegister(const double& value);
+    void compile();
+    void executeBlock(const std::vector<const float*>& inputs, const int64_t& offset, const int64_t& count, double* registers, float* output) const;
     MathNode m_root;
     std::vector<AString> m_varNames;
+    std::vector<Instruction> m_program;
+    std::vector<double> m_constants;
+    int m_resultRegister, m_numRegisters;
     CaretMathExpression();
 public:
     static AString getExpressionHelpInfo();
     static bool getNamedConstant(const AString& name, double& valueOut);
     CaretMathExpression(const AString& expression);
     double evaluate(const std::vector<float>& variableValues) const;
+    //evaluates count elements at once, inputs[v][i] is the value of variable v (in getVarNames() order) for element i, gives the same results as the scalar version
+    void evaluate(const std::vector<const float*>& inputs, float* output, const int64_t& count) const;
     const std::vector<AString>& getVarNames() const { return m_varNames; }
     AString toString() const;//the expression, with a lot of parentheses added
 };
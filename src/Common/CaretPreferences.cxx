@@ -1230,6 +1230,32 @@ CaretPreferences::setToolBoxType(const int32_t toolBoxType)
     this->qSettings->sync();
 }
 
+/**
+ * @return Memory, in megabytes, used by each connectivity matrix file
+ * for keeping recently loaded and prefetched rows.
+ */
+int32_t
+CaretPreferences::getConnectivityRowCacheMegabytes() const
+{
+    return this->connectivityRowCacheMegabytes;
+}
+
+/**
+ * Set the memory, in megabytes, used by each connectivity matrix file
+ * for keeping recently loaded and prefetched rows.
+ *
+ * @param megabytes
+ *    New size of the row cache, zero disables the cache.
+ */
+void
+CaretPreferences::setConnectivityRowCacheMegabytes(const int32_t megabytes)
+{
+    this->connectivityRowCacheMegabytes = megabytes;
+    this->setInteger(CaretPreferences::NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES,
+                     this->connectivityRowCacheMegabytes);
+    this->qSettings->sync();
+}
+
 /**
  * @return Is the splash screen enabled?
  */
@@ -1457,6 +1483,9 @@ CaretPreferences::readPreferences()
     this->toolBoxType = this->getInteger(CaretPreferences::NAME_TOOLBOX_TYPE,
                                          0);
     
+    this->connectivityRowCacheMegabytes = this->getInteger(CaretPreferences::NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES,
+                                                           512);
+    
     this->splashScreenEnabled = this->getBoolean(CaretPreferences::NAME_SPLASH_SCREEN,
                                                  true);
     
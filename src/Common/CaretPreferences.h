@@ -142,6 +142,10 @@ namespace caret {
         
         void setToolBoxType(const int32_t toolBoxType);
         
+        int32_t getConnectivityRowCacheMegabytes() const;
+        
+        void setConnectivityRowCacheMegabytes(const int32_t megabytes);
+        
         void readTileTabsConfigurations(const bool performSync = true);
         
         std::vector<const TileTabsConfiguration*> getTileTabsConfigurationsSortedByName() const;
@@ -282,6 +286,8 @@ namespace caret {
         
         int32_t toolBoxType;
         
+        int32_t connectivityRowCacheMegabytes;
+        
         AString remoteFileUserName;
         AString remoteFilePassword;
         bool remoteFileLoginSaved;
@@ -317,6 +323,7 @@ namespace caret {
         static const AString NAME_TILE_TABS_CONFIGURATIONS;
         
         static const AString NAME_TOOLBOX_TYPE;
+        static const AString NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES;
     };
     
 #ifdef __CARET_PREFERENCES_DECLARE__
@@ -345,6 +352,7 @@ namespace caret {
     const AString CaretPreferences::NAME_PREVIOUS_OPEN_FILE_DIRECTORIES     = "previousOpenFileDirectories";
     const AString CaretPreferences::NAME_SPLASH_SCREEN = "splashScreen";
     const AString CaretPreferences::NAME_TOOLBOX_TYPE = "toolBoxType";
+    const AString CaretPreferences::NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES = "connectivityRowCacheMegabytes";
     const AString CaretPreferences::NAME_CUSTOM_VIEWS     = "customViews";
     const AString CaretPreferences::NAME_REMOTE_FILE_USER_NAME = "remoteFileUserName";
     const AString CaretPreferences::NAME_REMOTE_FILE_PASSWORD = "remoteFilePassword";
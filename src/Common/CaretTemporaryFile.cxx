@@ -231,6 +231,26 @@ CaretTemporaryFile::readFile(const AString& filename) throw (DataFileException)
     }
 }
 
+/**
+ * Create the temporary file on disk, empty, so that its name may be
+ * used by other classes that write and read it directly (as scratch
+ * space).  The file is still deleted when this instance goes out
+ * of scope.
+ *
+ * @throws DataFileException
+ *    If the temporary file could not be created.
+ */
+void
+CaretTemporaryFile::createEmptyFile() throw (DataFileException)
+{
+    if (m_temporaryFile->open()) {
+        m_temporaryFile->close();
+    }
+    else {
+        throw DataFileException("Unable to create temporary file");
+    }
+}
+
 /**
  * Write the contents of the temporary file to a local file with
  * the given name.
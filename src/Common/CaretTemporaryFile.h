@@ -47,6 +47,8 @@ namespace caret {
         virtual void readFile(const AString& filename) throw (DataFileException);
         
         virtual void writeFile(const AString& filename) throw (DataFileException);
+        
+        void createEmptyFile() throw (DataFileException);
 
         // ADD_NEW_METHODS_HERE
 
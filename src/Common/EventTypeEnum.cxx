@@ -23,9 +23,15 @@
 #undef __EVENT_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -59,7 +65,10 @@ EventTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(EventTypeEnum(EVENT_INVALID, 
                                      "EVENT_INVALID", 
@@ -244,6 +253,7 @@ EventTypeEnum::initialize()
     CaretAssertMessage((enumData.size() == static_cast<uint64_t>(EVENT_COUNT + 1)),
                        ("Number of EventTypeEnum::Enum values is incorrect.\n"
                         "Have enumerated type been added?"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __IMAGE_CAPTURE_METHOD_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ImageCaptureMethodEnum 
@@ -104,7 +110,10 @@ ImageCaptureMethodEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ImageCaptureMethodEnum(IMAGE_CAPTURE_WITH_RENDER_PIXMAP, 
                                     "IMAGE_CAPTURE_WITH_RENDER_PIXMAP", 
@@ -114,6 +123,7 @@ ImageCaptureMethodEnum::initialize()
                                     "IMAGE_CAPTURE_WITH_GRAB_FRAME_BUFFER", 
                                     "Grab Frame Buffer"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
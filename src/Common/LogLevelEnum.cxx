@@ -24,9 +24,15 @@
 #undef __LOG_LEVEL_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -68,7 +74,10 @@ LogLevelEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(LogLevelEnum(SEVERE, 
                                     800, 
@@ -115,6 +124,7 @@ LogLevelEnum::initialize()
                                     "OFF", 
                                     "Off"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __OPEN_G_L_DRAWING_METHOD_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::OpenGLDrawingMethodEnum 
@@ -106,7 +112,10 @@ OpenGLDrawingMethodEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(OpenGLDrawingMethodEnum(DRAW_WITH_VERTEX_BUFFERS_OFF, 
                                     "DRAW_WITH_VERTEX_BUFFERS_OFF", 
@@ -116,6 +125,7 @@ OpenGLDrawingMethodEnum::initialize()
                                     "DRAW_WITH_VERTEX_BUFFERS_ON", 
                                     "On"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -22,10 +22,16 @@
 #include "ReductionEnum.h"
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 vector<ReductionEnum> ReductionEnum::enumData;
 bool ReductionEnum::initializedFlag = false;
 
@@ -67,7 +73,10 @@ ReductionEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ReductionEnum(MAX, "MAX", "the maximum value"));
     enumData.push_back(ReductionEnum(MIN, "MIN", "the minimum value"));
@@ -81,6 +90,7 @@ ReductionEnum::initialize()
     enumData.push_back(ReductionEnum(MEDIAN, "MEDIAN", "the median of the data"));
     enumData.push_back(ReductionEnum(MODE, "MODE", "the mode of the data"));
     enumData.push_back(ReductionEnum(COUNT_NONZERO, "COUNT_NONZERO", "the number of nonzero elements in the data"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
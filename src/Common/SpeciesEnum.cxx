@@ -25,9 +25,15 @@
 #undef __SPECIES_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -69,7 +75,10 @@ SpeciesEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SpeciesEnum(TYPE_UNKNOWN, 
                                     0, 
@@ -136,6 +145,7 @@ SpeciesEnum::initialize()
                                     "TYPE_OTHER", 
                                     "Other not specified"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,10 +25,16 @@
 #undef __STEREOTAXIC_SPACE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretLogger.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -140,7 +146,10 @@ StereotaxicSpaceEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(StereotaxicSpaceEnum(SPACE_UNKNOWN, 
                                             "SPACE_UNKNOWN", 
@@ -370,6 +379,7 @@ StereotaxicSpaceEnum::initialize()
                                             48, 64, 48,
                                             3.0, 3.0, 3.0,
                                             -72.0, -106.5, -61.5));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -24,9 +24,15 @@
 #undef __STRUCTURE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -67,7 +73,10 @@ StructureEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(StructureEnum(CORTEX_LEFT,
                                      "CORTEX_LEFT",
@@ -212,6 +221,7 @@ StructureEnum::initialize()
     enumData.push_back(StructureEnum(THALAMUS_RIGHT, 
                                      "THALAMUS_RIGHT", 
                                      "ThalamusRight"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __YOKING_GROUP_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::YokingGroupEnum 
@@ -71,7 +77,10 @@ YokingGroupEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(YokingGroupEnum(YOKING_GROUP_OFF, 
                                     "YOKING_GROUP_OFF", 
@@ -109,6 +118,7 @@ YokingGroupEnum::initialize()
                                        "YOKING_GROUP_H",
                                        "Group H"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -31,6 +31,7 @@
 #include <iostream>
 
 #include "ApplicationInformation.h"
+#include "Brain.h"
 #include "BrainBrowserWindow.h"
 #include "BrainOpenGLWidget.h"
 #include "CaretAssert.h"
@@ -255,6 +256,12 @@ main(int argc, char* argv[])
         */
         SessionManager::createSessionManager();
         caretLoggerIsValid = true;
+        
+        /*
+        * Only a few maps of a metric or label file are shown at a
+        * time, so decode them when first shown.
+        */
+        Brain::setDeferGiftiDataArrayDecoding(true);
 
         /*
         * Parameters for the program.
@@ -41,33 +41,29 @@ const char magic[] = "\0\0\0\0cst\0";
 
 CaretSparseFile::CaretSparseFile()
 {
-    m_file = NULL;
+    m_mappedValues = NULL;
 }
 
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
-    m_file = NULL;
+    m_mappedValues = NULL;
     readFile(fileName);
 }
 
 void CaretSparseFile::readFile(const AString& filename)
 {
-    if (m_file != NULL)
-    {
-        fclose(m_file);
-        m_file = NULL;
-    }
+    m_mappedValues = NULL;
+    m_file.close();
     FileInformation fileInfo(filename);
     if (!fileInfo.exists()) throw DataFileException("file doesn't exist");
-    m_file = fopen(filename.toLocal8Bit().constData(), "rb");
-    if (m_file == NULL) throw DataFileException("error opening file");
+    m_file.open(filename, CaretBinaryFile::READ_MEMORY_MAP);//falls back to normal reading if mapping fails
     char buf[8];
-    if (fread(buf, 1, 8, m_file) != 8) throw DataFileException("error reading from file");
+    m_file.read(buf, 8);
     for (int i = 0; i < 8; ++i)
     {
         if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
     }
-    if (fread(m_dims, sizeof(int64_t), 2, m_file) != 2) throw DataFileException("error reading from file");
+    m_file.read(m_dims, 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
     {
         ByteSwapping::swapBytes(m_dims, 2);
@@ -75,7 +71,7 @@ void CaretSparseFile::readFile(const AString& filename)
     if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
     m_indexArray.resize(m_dims[1] + 1);
     vector<int64_t> lengthArray(m_dims[1]);
-    if (fread(lengthArray.data(), sizeof(int64_t), m_dims[1], m_file) != (size_t)m_dims[1]) throw DataFileException("error reading from file");
+    m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
     {
         ByteSwapping::swapBytes(lengthArray.data(), m_dims[1]);
@@ -91,46 +87,83 @@ void CaretSparseFile::readFile(const AString& filename)
     if (xml_offset >= fileInfo.size()) throw DataFileException("file is truncated");
     int64_t xml_length = fileInfo.size() - xml_offset;
     if (xml_length < 1) throw DataFileException("file is truncated");
-    if (MYSEEK(m_file, xml_offset, SEEK_SET) != 0) throw DataFileException("error seeking to XML");
-    const int64_t seekResult = MYTELL(m_file);
-    if (seekResult != xml_offset) {
-        const AString msg = ("Tried to seek to "
-                             + AString::number(xml_offset)
-                             + " but got an offset of "
-                             + AString::number(seekResult));
-        throw DataFileException(msg);
-    }
-    
+    m_file.seek(xml_offset);
     QByteArray myXMLBytes(xml_length, '\0');
-    if (fread(myXMLBytes.data(), 1, xml_length, m_file) != (size_t)xml_length) throw DataFileException("error reading from file");
+    m_file.read(myXMLBytes.data(), xml_length);
     m_xml.readXML(myXMLBytes);
     if (m_xml.getDimensionLength(CiftiXML::ALONG_ROW) != m_dims[0] || m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN) != m_dims[1])
     {
         throw DataFileException("cifti XML doesn't match dimensions of sparse file");
     }
+    if (m_file.getMappedData() != NULL && !ByteOrderEnum::isSystemBigEndian() && m_file.getMappedSize() >= xml_offset)
+    {//values start at a multiple of 8 bytes from the page-aligned mapping, so they can be used in place
+        m_mappedValues = (const int64_t*)(m_file.getMappedData() + m_valuesOffset);
+    }
 }
 
 CaretSparseFile::~CaretSparseFile()
 {
-    if (m_file != NULL) fclose(m_file);
 }
 
-void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
+void CaretSparseFile::writeFile(const AString& filename)
+{
+    if (m_indexArray.empty()) throw DataFileException("no sparse file has been read, can't write");
+    if (FileInformation(filename).getCanonicalFilePath() == FileInformation(m_file.getFilename()).getCanonicalFilePath())
+    {
+        throw DataFileException("can't write a sparse file over the file it is being read from");
+    }
+    CaretSparseFileWriter myWriter(filename, m_xml);
+    vector<int64_t> scratch, encoded;
+    for (int64_t i = 0; i < m_dims[1]; ++i)
+    {//the file representation is the same, so just copy the pairs
+        int64_t numPairs = (int64_t)(m_indexArray[i + 1] - m_indexArray[i]);
+        const int64_t* pairs = readPairs(i, scratch);
+        encoded.assign(pairs, pairs + numPairs * 2);
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(encoded.data(), encoded.size());
+        }
+        myWriter.writeEncodedRow(i, encoded);
+    }
+    myWriter.finish();
+}
+
+const int64_t* CaretSparseFile::getRowSparsePointer(const int64_t& index, int64_t& numNonzeroOut) const
+{
+    CaretAssert(index >= 0 && index < m_dims[1]);
+    numNonzeroOut = (int64_t)(m_indexArray[index + 1] - m_indexArray[index]);
+    if (m_mappedValues == NULL) return NULL;
+    return m_mappedValues + m_indexArray[index] * 2;
+}
+
+const int64_t* CaretSparseFile::readPairs(const int64_t& index, vector<int64_t>& scratch)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
+    if (m_mappedValues != NULL) return m_mappedValues + start * 2;
     int64_t numToRead = (end - start) * 2;
-    m_scratchArray.resize(numToRead);
-    if (MYSEEK(m_file, m_valuesOffset + start * sizeof(int64_t) * 2, SEEK_SET) != 0) throw DataFileException("failed to seek in file");
-    if (fread(m_scratchArray.data(), sizeof(int64_t), numToRead, m_file) != (size_t)numToRead) throw DataFileException("error reading from file");
+    scratch.resize(numToRead);
+    {
+        CaretMutexLocker locked(&m_readMutex);//file position is shared
+        m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
+        m_file.read(scratch.data(), numToRead * sizeof(int64_t));
+    }
     if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
+        ByteSwapping::swapBytes(scratch.data(), numToRead);
     }
+    return scratch.data();
+}
+
+void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
+{
+    vector<int64_t> scratch;
+    const int64_t* pairs = readPairs(index, scratch);
+    int64_t numToRead = (int64_t)(m_indexArray[index + 1] - m_indexArray[index]) * 2;
     int64_t curIndex = 0;
     for (int64_t i = 0; i < numToRead; i += 2)
     {
-        int64_t index = m_scratchArray[i];
+        int64_t index = pairs[i];
         if (index < curIndex || index >= m_dims[0]) throw DataFileException("impossible index value found in file");
         while (curIndex < index)
         {
@@ -138,7 +171,7 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
             ++curIndex;
         }
         ++curIndex;
-        rowOut[index] = m_scratchArray[i + 1];
+        rowOut[index] = pairs[i + 1];
     }
     while (curIndex < m_dims[0])
     {
@@ -149,51 +182,65 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 
 void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
 {
-    CaretAssert(index >= 0 && index < m_dims[1]);
-    int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
-    int64_t numToRead = (end - start) * 2, numNonzero = end - start;
-    m_scratchArray.resize(numToRead);
-    if (MYSEEK(m_file, m_valuesOffset + start * sizeof(int64_t) * 2, SEEK_SET) != 0) throw DataFileException("failed to seek in file");
-    if (fread(m_scratchArray.data(), sizeof(int64_t), numToRead, m_file) != (size_t)numToRead) throw DataFileException("error reading from file");
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
-    }
+    vector<int64_t> scratch;
+    const int64_t* pairs = readPairs(index, scratch);
+    int64_t numNonzero = (int64_t)(m_indexArray[index + 1] - m_indexArray[index]);
     indicesOut.resize(numNonzero);
     valuesOut.resize(numNonzero);
     int64_t lastIndex = -1;
     for (int64_t i = 0; i < numNonzero; ++i)
     {
-        indicesOut[i] = m_scratchArray[i * 2];
-        valuesOut[i] = m_scratchArray[i * 2 + 1];
+        indicesOut[i] = pairs[i * 2];
+        valuesOut[i] = pairs[i * 2 + 1];
         if (indicesOut[i] <= lastIndex || indicesOut[i] >= m_dims[0]) throw DataFileException("impossible index value found in file");
         lastIndex = indicesOut[i];
     }
 }
 
 void CaretSparseFile::getFibersRow(const int64_t& index, FiberFractions* rowOut)
-{
-    if (m_scratchRow.size() != (size_t)m_dims[0]) m_scratchRow.resize(m_dims[0]);
-    getRow(index, (int64_t*)m_scratchRow.data());
-    for (int64_t i = 0; i < m_dims[0]; ++i)
+{//decode only the stored pairs, rather than expanding to a full integer row first
+    vector<int64_t> scratch;
+    const int64_t* pairs = readPairs(index, scratch);
+    int64_t numNonzero = (int64_t)(m_indexArray[index + 1] - m_indexArray[index]);
+    int64_t curIndex = 0;
+    for (int64_t i = 0; i < numNonzero; ++i)
     {
-        if (m_scratchRow[i] == 0)
+        int64_t outIndex = pairs[i * 2];
+        if (outIndex < curIndex || outIndex >= m_dims[0]) throw DataFileException("impossible index value found in file");
+        while (curIndex < outIndex)
         {
-            rowOut[i].zero();
+            rowOut[curIndex].zero();
+            ++curIndex;
+        }
+        ++curIndex;
+        if (pairs[i * 2 + 1] == 0)
+        {
+            rowOut[outIndex].zero();
         } else {
-             decodeFibers(m_scratchRow[i], rowOut[i]);
+            decodeFibers((uint64_t)pairs[i * 2 + 1], rowOut[outIndex]);
         }
     }
+    while (curIndex < m_dims[0])
+    {
+        rowOut[curIndex].zero();
+        ++curIndex;
+    }
 }
 
 void CaretSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<FiberFractions>& valuesOut)
 {
-    getRowSparse(index, indicesOut, m_scratchSparseRow);
-    size_t numNonzero = m_scratchSparseRow.size();
+    vector<int64_t> scratch;
+    const int64_t* pairs = readPairs(index, scratch);
+    int64_t numNonzero = (int64_t)(m_indexArray[index + 1] - m_indexArray[index]);
+    indicesOut.resize(numNonzero);
     valuesOut.resize(numNonzero);
-    for (size_t i = 0; i < numNonzero; ++i)
+    int64_t lastIndex = -1;
+    for (int64_t i = 0; i < numNonzero; ++i)
     {
-        decodeFibers(((uint64_t*)m_scratchSparseRow.data())[i], valuesOut[i]);
+        indicesOut[i] = pairs[i * 2];
+        if (indicesOut[i] <= lastIndex || indicesOut[i] >= m_dims[0]) throw DataFileException("impossible index value found in file");
+        lastIndex = indicesOut[i];
+        decodeFibers((uint64_t)pairs[i * 2 + 1], valuesOut[i]);
     }
 }
 
@@ -275,36 +322,86 @@ void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
     if (m_nextRowIndex == m_dims[1]) finish();
 }
 
-void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+void CaretSparseFileWriter::encodeRowSparse(const int64_t& rowLength, const vector<int64_t>& indices, const vector<int64_t>& values, vector<int64_t>& encodedOut)
 {
-    CaretAssert(index < m_dims[1]);
-    CaretAssert(index >= m_nextRowIndex);
     CaretAssert(indices.size() == values.size());
-    while (m_nextRowIndex < index)
+    size_t numNonzero = indices.size();//assume no zeros
+    encodedOut.resize(numNonzero * 2);
+    int64_t lastIndex = -1;
+    for (size_t i = 0; i < numNonzero; ++i)
     {
-        m_lengthArray[m_nextRowIndex] = 0;
-        ++m_nextRowIndex;
+        if (indices[i] <= lastIndex || indices[i] >= rowLength) throw DataFileException("indices must be sorted when writing sparse rows");
+        lastIndex = indices[i];
+        encodedOut[i * 2] = indices[i];
+        encodedOut[i * 2 + 1] = values[i];
     }
-    m_scratchArray.clear();
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(encodedOut.data(), encodedOut.size());
+    }
+}
+
+void CaretSparseFileWriter::encodeFibersRowSparse(const int64_t& rowLength, const vector<int64_t>& indices, const vector<FiberFractions>& values, vector<int64_t>& encodedOut)
+{
+    CaretAssert(indices.size() == values.size());
     size_t numNonzero = indices.size();//assume no zeros
-    m_lengthArray[index] = numNonzero;
+    encodedOut.resize(numNonzero * 2);
     int64_t lastIndex = -1;
     for (size_t i = 0; i < numNonzero; ++i)
     {
-        if (indices[i] <= lastIndex || indices[i] >= m_dims[0]) throw DataFileException("indices must be sorted when writing sparse rows");
+        if (indices[i] <= lastIndex || indices[i] >= rowLength) throw DataFileException("indices must be sorted when writing sparse rows");
         lastIndex = indices[i];
-        m_scratchArray.push_back(indices[i]);
-        m_scratchArray.push_back(values[i]);
+        encodedOut[i * 2] = indices[i];
+        encodeFibers(values[i], ((uint64_t*)encodedOut.data())[i * 2 + 1]);
     }
     if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+        ByteSwapping::swapBytes(encodedOut.data(), encodedOut.size());
     }
-    if (fwrite(m_scratchArray.data(), sizeof(int64_t), m_scratchArray.size(), m_file) != m_scratchArray.size()) throw DataFileException("error writing to file");
+}
+
+void CaretSparseFileWriter::writeEncodedRow(const int64_t& index, const vector<int64_t>& encoded)
+{
+    CaretAssert(index < m_dims[1]);
+    CaretAssert(index >= m_nextRowIndex);
+    CaretAssert(encoded.size() % 2 == 0);
+    while (m_nextRowIndex < index)
+    {
+        m_lengthArray[m_nextRowIndex] = 0;
+        ++m_nextRowIndex;
+    }
+    m_lengthArray[index] = encoded.size() / 2;
+    if (fwrite(encoded.data(), sizeof(int64_t), encoded.size(), m_file) != encoded.size()) throw DataFileException("error writing to file");
     m_nextRowIndex = index + 1;
     if (m_nextRowIndex == m_dims[1]) finish();
 }
 
+namespace
+{
+    class SparseEncodeWriter : public CaretRowBlockProcessor<vector<int64_t> >
+    {
+        CaretSparseRowEncoder& m_encoder;
+        CaretSparseFileWriter& m_writer;
+    public:
+        SparseEncodeWriter(CaretSparseRowEncoder& encoder, CaretSparseFileWriter& writer) : m_encoder(encoder), m_writer(writer) { }
+        void computeRow(const int64_t& index, vector<int64_t>& rowOut) { m_encoder.encodeRow(index, rowOut); }
+        void writeRow(const int64_t& index, const vector<int64_t>& row) { m_writer.writeEncodedRow(index, row); }
+    };
+}
+
+void CaretSparseFileWriter::writeRowsParallel(CaretSparseRowEncoder& encoder)
+{
+    SparseEncodeWriter myProcessor(encoder, *this);
+    processRowBlocks(m_dims[1], 4096, myProcessor);
+    finish();
+}
+
+void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+{
+    encodeRowSparse(m_dims[0], indices, values, m_scratchArray);
+    writeEncodedRow(index, m_scratchArray);
+}
+
 void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFractions* row)
 {
     if (m_scratchRow.size() != (size_t)m_dims[0]) m_scratchRow.resize(m_dims[0]);
@@ -322,13 +419,8 @@ void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFrac
 
 void CaretSparseFileWriter::writeFibersRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<FiberFractions>& values)
 {
-    size_t numNonzero = values.size();//assume no zeros
-    m_scratchSparseRow.resize(numNonzero);
-    for (size_t i = 0; i < numNonzero; ++i)
-    {
-        encodeFibers(values[i], ((uint64_t*)m_scratchSparseRow.data())[i]);
-    }
-    writeRowSparse(index, indices, m_scratchSparseRow);
+    encodeFibersRowSparse(m_dims[0], indices, values, m_scratchArray);
+    writeEncodedRow(index, m_scratchArray);
 }
 
 void CaretSparseFileWriter::finish()
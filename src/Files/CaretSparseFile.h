@@ -21,15 +21,72 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cstdio>
 #include <vector>
 #include "stdint.h"
 #include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretException.h"
+#include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "DataFile.h"
 #include "CiftiXML.h"
 
 namespace caret {
     
+    ///per-row work for processRowBlocks, computeRow is called from multiple threads at once, writeRow is called from one thread, in row order
+    template <typename RowT>
+    class CaretRowBlockProcessor
+    {
+    public:
+        virtual void computeRow(const int64_t& index, RowT& rowOut) = 0;
+        virtual void writeRow(const int64_t& index, const RowT& row) = 0;
+        virtual ~CaretRowBlockProcessor() { }
+    };
+    
+    ///computes rows in parallel a block at a time, then writes the block in order, so output files are still written sequentially
+    ///if computeRow throws, the rest of the block finishes and then the first message is thrown as a CaretException
+    template <typename RowT>
+    void processRowBlocks(const int64_t& numRows, const int64_t& blockRows, CaretRowBlockProcessor<RowT>& processor)
+    {
+        std::vector<RowT> blockData(std::min(blockRows, numRows));
+        for (int64_t blockStart = 0; blockStart < numRows; blockStart += blockRows)
+        {
+            int64_t blockEnd = std::min(blockStart + blockRows, numRows);
+            bool ok = true;
+            AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = blockStart; i < blockEnd; ++i)
+            {
+                try
+                {
+                    processor.computeRow(i, blockData[i - blockStart]);
+                } catch (CaretException& e) {//can't throw out of a parallel region
+#pragma omp critical
+                    {
+                        if (ok) errorMessage = e.whatString();
+                        ok = false;
+                    }
+                }
+            }
+            if (!ok) throw CaretException(errorMessage);
+            for (int64_t i = blockStart; i < blockEnd; ++i)
+            {
+                processor.writeRow(i, blockData[i - blockStart]);
+            }
+        }
+    }
+    
+    ///per-row work for CaretSparseFileWriter::writeRowsParallel
+    class CaretSparseRowEncoder
+    {
+    public:
+        ///called from multiple threads at once, must fill encodedOut by using one of the CaretSparseFileWriter encode functions
+        virtual void encodeRow(const int64_t& index, std::vector<int64_t>& encodedOut) = 0;
+        virtual ~CaretSparseRowEncoder() { }
+    };
+    
     struct FiberFractions
     {
         uint32_t totalCount;  // total number of streamline that go through the voxel
@@ -38,29 +95,43 @@ namespace caret {
         void zero();
     };
     
+    ///all row reading functions are safe to call from multiple threads at once, they are lock-free when the file is memory mapped
     class CaretSparseFile /* : public DataFile */
     {
         static void decodeFibers(const uint64_t& coded, FiberFractions& decoded);//takes a uint because right shift on signed is implementation dependent
-        FILE* m_file;
+        CaretBinaryFile m_file;
+        const int64_t* m_mappedValues;//NULL unless the file is memory mapped and doesn't need byteswapping
+        CaretMutex m_readMutex;//protects the file position when not mapped
         int64_t m_dims[2], m_valuesOffset;
-        std::vector<uint64_t> m_indexArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        std::vector<uint64_t> m_indexArray;
         CaretSparseFile(const CaretSparseFile& rhs);
         CiftiXML m_xml;
+        const int64_t* readPairs(const int64_t& index, std::vector<int64_t>& scratch);//returns pointer to the interleaved index, value pairs of the row
     public:
         const int64_t* getDimensions() { return m_dims; }
+        
+        ///total streamline count of a value from a fiber trajectory file, without decoding the fractions
+        static int64_t getFiberTotalCount(const int64_t& coded) { return (int64_t)(((uint64_t)coded)>>32); }
 
         CaretSparseFile();
         
         virtual void readFile(const AString& filename);
         
-        virtual void writeFile(const AString&) { throw DataFileException("writeFile not implemented for CaretSparseFile"); }
+        ///copies every row of the open file to a new file
+        virtual void writeFile(const AString& filename);
         
         CaretSparseFile(const AString& fileName);
         
         ///get a reference to the XML data
         const CiftiXML& getCiftiXML() const { return m_xml; }
         
+        ///number of nonzero elements stored in a row, without reading it
+        int64_t getRowNumberOfNonzero(const int64_t& index) const { return (int64_t)(m_indexArray[index + 1] - m_indexArray[index]); }
+        
+        ///zero-copy access: returns the interleaved (index, value) pairs of the row as stored in the file, NULL if the file isn't memory mapped (or needs byteswapping), use getRowSparse in that case
+        ///pointer is invalidated by readFile or destruction, indices are not checked
+        const int64_t* getRowSparsePointer(const int64_t& index, int64_t& numNonzeroOut) const;
+        
         void getRow(const int64_t& index, int64_t* rowOut);
         
         void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut);
@@ -80,7 +151,7 @@ namespace caret {
         int64_t m_dims[2], m_valuesOffset, m_nextRowIndex;
         bool m_finished;
         std::vector<uint64_t> m_lengthArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        std::vector<int64_t> m_scratchArray;
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
     public:
@@ -88,6 +159,20 @@ namespace caret {
         
         ~CaretSparseFileWriter();
         
+        ///convert a sparse row to its on-disk representation without touching any file, safe to call from multiple threads at once
+        ///rowLength is the number of elements in a full row, for checking the indices
+        static void encodeRowSparse(const int64_t& rowLength, const std::vector<int64_t>& indices, const std::vector<int64_t>& values, std::vector<int64_t>& encodedOut);
+        
+        ///ditto, for fiber rows
+        static void encodeFibersRowSparse(const int64_t& rowLength, const std::vector<int64_t>& indices, const std::vector<FiberFractions>& values, std::vector<int64_t>& encodedOut);
+        
+        ///write a row produced by one of the encode functions, so that rows can be encoded in parallel and committed in order
+        ///you must write the rows in order, though you can skip empty rows
+        void writeEncodedRow(const int64_t& index, const std::vector<int64_t>& encoded);
+        
+        ///encode all rows in parallel with processRowBlocks and write them in order, then finish
+        void writeRowsParallel(CaretSparseRowEncoder& encoder);
+        
         ///you must write the rows in order, though you can skip empty rows
         void writeRow(const int64_t& index, const int64_t* row);
         
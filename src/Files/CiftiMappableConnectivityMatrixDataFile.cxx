@@ -25,6 +25,7 @@
 
 #include "CaretAssert.h"
 #include "CiftiFile.h"
+#include "CiftiRowCache.h"
 #include "CaretLogger.h"
 #include "ConnectivityDataLoaded.h"
 #include "EventManager.h"
@@ -49,6 +50,7 @@ CiftiMappableConnectivityMatrixDataFile::CiftiMappableConnectivityMatrixDataFile
 : CiftiMappableDataFile(dataFileType)
 {
     m_connectivityDataLoaded = new ConnectivityDataLoaded();
+    m_rowCacheMemoryBudget = 512 * 1024 * 1024;
     
     clearPrivate();
 
@@ -77,6 +79,11 @@ CiftiMappableConnectivityMatrixDataFile::~CiftiMappableConnectivityMatrixDataFil
 void
 CiftiMappableConnectivityMatrixDataFile::clear()
 {
+    /*
+     * The row cache reads from the CIFTI file so it must be
+     * removed before the parent class deletes the CIFTI file.
+     */
+    m_rowCache.grabNew(NULL);
     CiftiMappableDataFile::clear();
     clearPrivate();
 }
@@ -88,6 +95,7 @@ CiftiMappableConnectivityMatrixDataFile::clear()
 void
 CiftiMappableConnectivityMatrixDataFile::clearPrivate()
 {
+    m_rowCache.grabNew(NULL);
     m_loadedRowData.clear();
     m_rowLoadedTextForMapName = "";
     m_rowLoadedText = "";
@@ -311,6 +319,99 @@ CiftiMappableConnectivityMatrixDataFile::getRowIndexForVoxelIndexWhenLoading(con
     return rowIndex;
 }
 
+/**
+ * Read a row from the CIFTI file.  Rows of a file that is read from
+ * disk are kept in a cache, so that returning to a recently viewed
+ * or prefetched row does not read it from the disk again.
+ *
+ * @param dataOut
+ *    Output containing the row's data, must have a value for each column.
+ * @param rowIndex
+ *    Index of the row.
+ * @throw DataFileException
+ *    If an error occurs.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::readRowFromFile(float* dataOut,
+                                                         const int64_t rowIndex)
+{
+    CaretAssert(m_ciftiFile);
+    
+    if (m_ciftiFile->isInMemory()
+        || (m_ciftiFile->getDimensions().size() != 2)) {
+        m_ciftiFile->getRow(dataOut,
+                            rowIndex);
+        return;
+    }
+    
+    if (m_rowCache == NULL) {
+        m_rowCache.grabNew(new CiftiRowCache(m_ciftiFile,
+                                             m_rowCacheMemoryBudget));
+        if (DataFile::isFileOnNetwork(getFileName()) == false) {
+            m_rowCache->enablePrefetching(getFileName());
+        }
+    }
+    
+    m_rowCache->getRow(dataOut,
+                       rowIndex);
+}
+
+/**
+ * Read, in the background, the rows for surface nodes whose data is
+ * likely to be loaded soon, such as the neighbors of the node whose
+ * data was just loaded.  Nodes are read in the order given and any
+ * nodes from a previous call that have not been read are discarded.
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of the nodes.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::prefetchMapDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                        const StructureEnum::Enum structure,
+                                                                        const std::vector<int32_t>& nodeIndices)
+{
+    if ((m_ciftiFile == NULL)
+        || (m_rowCache == NULL)
+        || (m_dataLoadingEnabled == false)) {
+        return;
+    }
+    
+    std::vector<int64_t> rowIndices;
+    rowIndices.reserve(nodeIndices.size());
+    for (std::vector<int32_t>::const_iterator iter = nodeIndices.begin();
+         iter != nodeIndices.end();
+         iter++) {
+        const int64_t rowIndex = getRowIndexForNodeWhenLoading(structure,
+                                                               surfaceNumberOfNodes,
+                                                               *iter);
+        if (rowIndex >= 0) {
+            rowIndices.push_back(rowIndex);
+        }
+    }
+    
+    m_rowCache->prefetchRows(rowIndices);
+}
+
+/**
+ * Set the memory used for keeping rows that were read from the file.
+ *
+ * @param memoryBudgetBytes
+ *    Maximum size, in bytes, of the rows that are kept.  Zero
+ *    disables keeping rows.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::setRowCacheMemoryBudget(const int64_t memoryBudgetBytes)
+{
+    m_rowCacheMemoryBudget = memoryBudgetBytes;
+    if (m_rowCache != NULL) {
+        m_rowCache->setMemoryBudget(m_rowCacheMemoryBudget);
+    }
+}
+
 /**
  * Set the loaded row data to zeros.
  */
@@ -357,8 +458,8 @@ CiftiMappableConnectivityMatrixDataFile::loadDataForRowIndex(const int64_t rowIn
         CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
         m_loadedRowData.resize(dataCount);
         
-        m_ciftiFile->getRow(&m_loadedRowData[0],
-                                    rowIndex);
+        readRowFromFile(&m_loadedRowData[0],
+                        rowIndex);
         
         CaretLogFine("Read row " + AString::number(rowIndex));
         m_connectivityDataLoaded->setRowLoading(rowIndex);
@@ -439,8 +540,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForSurfaceNode(const int32_t
                                    + StructureEnum::toGuiName(structure));
                 CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
                 m_loadedRowData.resize(dataCount);
-                m_ciftiFile->getRow(&m_loadedRowData[0],
-                                         rowIndex);
+                readRowFromFile(&m_loadedRowData[0],
+                                rowIndex);
                 
                 CaretLogFine("Read row for node " + AString::number(nodeIndex));
                 
@@ -515,8 +616,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapData(const int32_t selectionInde
                                 );
             CaretAssert((selectionIndex >= 0) && (selectionIndex < m_ciftiFile->getNumberOfRows()));
             m_loadedRowData.resize(dataCount);
-            m_ciftiFile->getRow(&m_loadedRowData[0],
-                                        selectionIndex);
+            readRowFromFile(&m_loadedRowData[0],
+                            selectionIndex);
             
             CaretLogFine("Read row " + AString::number(selectionIndex+1));
             
@@ -630,7 +731,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForSurfaceNodes(const
             
             if (rowIndex >= 0) {
                 CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
-                m_ciftiFile->getRow(dataRow, rowIndex);
+                readRowFromFile(dataRow,
+                                rowIndex);
                 
                 for (int64_t j = 0; j < dataCount; j++) {
                     dataAverage[j] += dataRow[j];
@@ -744,7 +846,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForVoxelAtCoordinate(const i
         if (dataCount > 0) {
             m_loadedRowData.resize(dataCount);
             CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
-            m_ciftiFile->getRow(&m_loadedRowData[0], rowIndex);
+            readRowFromFile(&m_loadedRowData[0],
+                            rowIndex);
             
             m_rowLoadedTextForMapName = ("Row: "
                                         + AString::number(rowIndex)
@@ -872,8 +975,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForVoxelIndices(const
         const int64_t rowIndex = getRowIndexForVoxelIndexWhenLoading(voxelIJK.m_ijk);
         if (rowIndex >= 0) {
             CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
-            m_ciftiFile->getRow(&rowData[0],
-                                     rowIndex);
+            readRowFromFile(&rowData[0],
+                            rowIndex);
             
             for (int64_t j = 0; j < dataCount; j++) {
                 rowSum[j] += rowData[j];
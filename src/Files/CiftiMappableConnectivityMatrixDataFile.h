@@ -24,11 +24,13 @@
 #include <set>
 
 #include "BrainConstants.h"
+#include "CaretPointer.h"
 #include "CiftiMappableDataFile.h"
 #include "VoxelIJK.h"
 
 namespace caret {
 
+    class CiftiRowCache;
     class ConnectivityDataLoaded;
     class SceneClassAssistant;
     
@@ -64,6 +66,12 @@ namespace caret {
                                                        const std::vector<VoxelIJK>& voxelIndices) throw (DataFileException);
 
         void loadDataForRowIndex(const int64_t rowIndex) throw (DataFileException);
+        
+        void prefetchMapDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                            const StructureEnum::Enum structure,
+                                            const std::vector<int32_t>& nodeIndices);
+        
+        void setRowCacheMemoryBudget(const int64_t memoryBudgetBytes);
                 
         virtual void clear();
         
@@ -117,6 +125,9 @@ namespace caret {
         
         int64_t getRowIndexForVoxelIndexWhenLoading(const int64_t ijk[3]);
         
+        void readRowFromFile(float* dataOut,
+                             const int64_t rowIndex);
+        
         
         // ADD_NEW_MEMBERS_HERE
         
@@ -132,6 +143,10 @@ namespace caret {
         
         ConnectivityDataLoaded* m_connectivityDataLoaded;
         
+        CaretPointer<CiftiRowCache> m_rowCache;
+        
+        int64_t m_rowCacheMemoryBudget;
+        
         friend class CiftiBrainordinateScalarFile;
 
     };
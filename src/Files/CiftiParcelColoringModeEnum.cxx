@@ -25,9 +25,15 @@
 #undef __CIFTI_PARCEL_COLORING_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::CiftiParcelColoringModeEnum 
@@ -106,7 +112,10 @@ CiftiParcelColoringModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(CiftiParcelColoringModeEnum(CIFTI_PARCEL_COLORING_OFF, 
                                     "CIFTI_PARCEL_COLORING_OFF", 
@@ -120,6 +129,7 @@ CiftiParcelColoringModeEnum::initialize()
                                     "CIFTI_PARCEL_COLORING_OUTLINE", 
                                     "Outline"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -24,10 +24,16 @@
 #undef __DATA_FILE_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretLogger.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * \class caret::DataFileTypeEnum 
  * \brief An enumerated type for data files.
@@ -116,7 +122,10 @@ DataFileTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(DataFileTypeEnum(BORDER, 
                                         "BORDER", 
@@ -295,6 +304,7 @@ DataFileTypeEnum::initialize()
                                         true,
                                         "nii",
                                         "nii.gz"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __FIBER_ORIENTATION_COLORING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::FiberOrientationColoringTypeEnum 
@@ -72,7 +78,10 @@ FiberOrientationColoringTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(FiberOrientationColoringTypeEnum(FIBER_COLORING_FIBER_INDEX_AS_RGB,
                                     "FIBER_COLORING_FIBER_INDEX_AS_RGB", 
@@ -82,6 +91,7 @@ FiberOrientationColoringTypeEnum::initialize()
                                                         "FIBER_COLORING_XYZ_AS_RGB",
                                                         "XYZ as RGB"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
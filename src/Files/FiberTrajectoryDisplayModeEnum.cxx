@@ -25,9 +25,15 @@
 #undef __FIBER_TRAJECTORY_DISPLAY_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::FiberTrajectoryDisplayModeEnum 
@@ -70,7 +76,10 @@ FiberTrajectoryDisplayModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(FiberTrajectoryDisplayModeEnum(FIBER_TRAJECTORY_DISPLAY_ABSOLUTE, 
                                     "FIBER_TRAJECTORY_DISPLAY_ABSOLUTE", 
@@ -88,6 +97,7 @@ FiberTrajectoryDisplayModeEnum::initialize()
                                     "FIBER_TRAJECTORY_DISPLAY_PROPORTION", 
                                     "Proportion"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
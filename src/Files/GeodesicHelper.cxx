@@ -20,8 +20,10 @@
 
 #include "GeodesicHelper.h"
 #include "CaretAssert.h"
+#include "CaretException.h"
 #include "CaretHeap.h"
 #include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include <iostream>
@@ -35,31 +37,32 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn)
     CaretPointer<TopologyHelperBase> topoBase(new TopologyHelperBase(surfaceIn));
     TopologyHelper topoHelpIn(topoBase);//leave this building one privately, to not introduce even worse dependencies regarding SurfaceFile
     numNodes = surfaceIn->getNumberOfNodes();
-    //allocate
-    numNeighbors = new int32_t[numNodes];
-    nodeNeighbors = new int32_t*[numNodes];
-    distances = new float*[numNodes];
     //const float* coords = surfaceIn->getCoordinate(0);//hack previously needed for old code, before it used edgeInfo
     float d[3], g[3], ac[3], abhat[3], abmag, ad[3], efhat[3], efmag, ea[3], cdmag, eg[3], eh[3], ah[3], tempvec[3], tempf;
+    m_neighborStart.resize(numNodes + 1);
+    m_neighborStart[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {//count first so the flat arrays get allocated once
+        int32_t numNeigh = 0;
+        topoHelpIn.getNodeNeighbors(i, numNeigh);
+        m_neighborStart[i + 1] = m_neighborStart[i] + numNeigh;
+    }
+    m_nodeNeighbors.resize(m_neighborStart[numNodes]);
+    m_distances.resize(m_neighborStart[numNodes]);
     for (int32_t i = 0; i < numNodes; ++i)
     {//get neighbors
-        const int32_t* neighbors = topoHelpIn.getNodeNeighbors(i, numNeighbors[i]);
+        int32_t numNeigh = 0;
+        const int32_t* neighbors = topoHelpIn.getNodeNeighbors(i, numNeigh);
         const float* baseCoord = surfaceIn->getCoordinate(i);
-        nodeNeighbors[i] = new int32_t[numNeighbors[i]];
-        distances[i] = new float[numNeighbors[i]];
-        for (int32_t j = 0; j < numNeighbors[i]; ++j)
+        int64_t start = m_neighborStart[i];
+        for (int32_t j = 0; j < numNeigh; ++j)
         {
-            nodeNeighbors[i][j] = neighbors[j];
+            m_nodeNeighbors[start + j] = neighbors[j];
             const float* neighCoord = surfaceIn->getCoordinate(neighbors[j]);
             coordDiff(baseCoord, neighCoord, tempvec);
-            distances[i][j] = std::sqrt(tempvec[0] * tempvec[0] + tempvec[1] * tempvec[1] + tempvec[2] * tempvec[2]);//precompute for speed in other calls
+            m_distances[start + j] = std::sqrt(tempvec[0] * tempvec[0] + tempvec[1] * tempvec[1] + tempvec[2] * tempvec[2]);//precompute for speed in other calls
         }//so few floating point operations, this should turn out symmetric
     }
-    std::vector<int32_t> tempneigh2;
-    std::vector<float> tempdist2;
-    nodeNeighbors2 = new int32_t*[numNodes];
-    numNeighbors2 = new int32_t[numNodes];
-    distances2 = new float*[numNodes];
     //begin edge info based code
     vector<vector<int32_t> > nodeNeighbors2Vec;
     vector<vector<float> > distances2Vec;
@@ -130,15 +133,22 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn)
         nodeNeighbors2Vec[baseNode].push_back(farNode);
         distances2Vec[baseNode].push_back(tempf);
     }
+    m_neighborStart2.resize(numNodes + 1);
+    m_neighborStart2[0] = 0;
     for (int i = 0; i < numNodes; ++i)
-    {//copy it from vector into straight dynamic array, because now it won't change again, to use a bit less memory
-        numNeighbors2[i] = nodeNeighbors2Vec[i].size();
-        nodeNeighbors2[i] = new int32_t[numNeighbors2[i]];
-        distances2[i] = new float[numNeighbors2[i]];
-        for (int32_t j = 0; j < numNeighbors2[i]; ++j)
+    {
+        m_neighborStart2[i + 1] = m_neighborStart2[i] + nodeNeighbors2Vec[i].size();
+    }
+    m_nodeNeighbors2.resize(m_neighborStart2[numNodes]);
+    m_distances2.resize(m_neighborStart2[numNodes]);
+    for (int i = 0; i < numNodes; ++i)
+    {//copy it from vectors into flat arrays, because now it won't change again, to use a bit less memory and keep neighbor lookups contiguous
+        int64_t start = m_neighborStart2[i];
+        int32_t numNeigh = (int32_t)nodeNeighbors2Vec[i].size();
+        for (int32_t j = 0; j < numNeigh; ++j)
         {
-            nodeNeighbors2[i][j] = nodeNeighbors2Vec[i][j];
-            distances2[i][j] = distances2Vec[i][j];
+            m_nodeNeighbors2[start + j] = nodeNeighbors2Vec[i][j];
+            m_distances2[start + j] = distances2Vec[i][j];
         }
     }
 }
@@ -148,12 +158,12 @@ GeodesicHelper::GeodesicHelper(const CaretPointer<GeodesicHelperBase>& baseIn)
     m_myBase = baseIn;//copy the pointer so it doesn't get changed or deleted while we get its members
     //get references and info from base
     numNodes = m_myBase->numNodes;
-    distances = m_myBase->distances;
-    distances2 = m_myBase->distances2;
-    numNeighbors = m_myBase->numNeighbors;
-    numNeighbors2 = m_myBase->numNeighbors2;
-    nodeNeighbors = m_myBase->nodeNeighbors;
-    nodeNeighbors2 = m_myBase->nodeNeighbors2;
+    distances = m_myBase->m_distances.data();
+    distances2 = m_myBase->m_distances2.data();
+    neighborStart = m_myBase->m_neighborStart.data();
+    neighborStart2 = m_myBase->m_neighborStart2.data();
+    nodeNeighbors = m_myBase->m_nodeNeighbors.data();
+    nodeNeighbors2 = m_myBase->m_nodeNeighbors2.data();
     //allocate private scratch space
     m_heapIdent = CaretArray<int64_t>(numNodes);
     output = new float[numNodes];
@@ -192,10 +202,50 @@ void GeodesicHelper::getNodesToGeoDist(const int32_t node, const float maxdist,
     }
 }
 
+void GeodesicHelper::getNodesToGeoDist(const vector<int32_t>& roots, const float maxdist, vector<vector<int32_t> >& nodesOut, vector<vector<float> >& distsOut, const bool smoothflag)
+{
+    int64_t numRoots = (int64_t)roots.size();
+    nodesOut.resize(numRoots);
+    distsOut.resize(numRoots);
+    for (int64_t i = 0; i < numRoots; ++i)
+    {
+        CaretAssert(roots[i] < numNodes && roots[i] >= 0);
+        if (roots[i] >= numNodes || roots[i] < 0) throw CaretException("invalid root vertex given to GeodesicHelper");
+    }
+    CaretMutexLocker locked(&inUse);//protects the pool as well as our own scratch space
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    while ((int)m_threadPool.size() < numThreads - 1)
+    {//this object's scratch space is used by the first thread
+        m_threadPool.push_back(CaretPointer<GeodesicHelper>(new GeodesicHelper(m_myBase)));
+    }
+#pragma omp CARET_PAR num_threads(numThreads)
+    {
+        GeodesicHelper* myHelper = this;
+#ifdef CARET_OMP
+        int myThread = omp_get_thread_num();
+        if (myThread > 0) myHelper = m_threadPool[myThread - 1];
+#endif
+#pragma omp CARET_FOR schedule(dynamic, 16)
+        for (int64_t i = 0; i < numRoots; ++i)
+        {
+            nodesOut[i].clear();
+            distsOut[i].clear();
+            if (maxdist >= 0.0f)
+            {
+                myHelper->dijkstra(roots[i], maxdist, nodesOut[i], distsOut[i], smoothflag);
+            }
+        }
+    }
+}
+
 void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth)
 {
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0;
-    int32_t* neighbors;
+    const int32_t* neighbors;
+    const float* neighDists;
     float tempf;
     output[root] = 0.0f;
     marked[root] |= 4;
@@ -212,14 +262,15 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
             nodes.push_back(whichnode);
             dists.push_back(output[whichnode]);
             marked[whichnode] |= 1;//anything pulled from stack will already be marked as having a valid value (flag 4)
-            neighbors = nodeNeighbors[whichnode];
-            numNeigh = numNeighbors[whichnode];
+            neighbors = nodeNeighbors + neighborStart[whichnode];
+            neighDists = distances + neighborStart[whichnode];
+            numNeigh = (int32_t)(neighborStart[whichnode + 1] - neighborStart[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if marked
-                    tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                     if (tempf <= maxdist)
                     {//keep it off the heap if it is too far
                         if (!(marked[whichneigh] & 4))
@@ -238,14 +289,15 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
             }
             if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
             {
-                neighbors = nodeNeighbors2[whichnode];
-                numNeigh = numNeighbors2[whichnode];
+                neighbors = nodeNeighbors2 + neighborStart2[whichnode];
+                neighDists = distances2 + neighborStart2[whichnode];
+                numNeigh = (int32_t)(neighborStart2[whichnode + 1] - neighborStart2[whichnode]);
                 for (j = 0; j < numNeigh; ++j)
                 {
                     whichneigh = neighbors[j];
                     if (!(marked[whichneigh] & 1))
                     {//skip floating point math if marked
-                        tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                        tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                         if (tempf <= maxdist)
                         {//keep it off the heap if it is too far
                             if (!(marked[whichneigh] & 4))
@@ -274,7 +326,8 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
 void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
 {//straightforward dijkstra, no cutoffs, full surface
     int32_t i, j, whichnode, whichneigh, numNeigh;
-    int32_t* neighbors;
+    const int32_t* neighbors;
+    const float* neighDists;
     float tempf;
     output[root] = 0.0f;
     parent[root] = -1;//idiom for end of path
@@ -286,14 +339,15 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
         if (!(marked[whichnode] & 1))
         {
             marked[whichnode] |= 1;
-            neighbors = nodeNeighbors[whichnode];
-            numNeigh = numNeighbors[whichnode];
+            neighbors = nodeNeighbors + neighborStart[whichnode];
+            neighDists = distances + neighborStart[whichnode];
+            numNeigh = (int32_t)(neighborStart[whichnode + 1] - neighborStart[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if marked
-                    tempf = output[whichnode] + distances[whichnode][j];
+                    tempf = output[whichnode] + neighDists[j];
                     if (!(marked[whichneigh] & 4))
                     {
                         parent[whichneigh] = whichnode;
@@ -308,14 +362,15 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
             }
             if (smooth)
             {
-                neighbors = nodeNeighbors2[whichnode];
-                numNeigh = numNeighbors2[whichnode];
+                neighbors = nodeNeighbors2 + neighborStart2[whichnode];
+                neighDists = distances2 + neighborStart2[whichnode];
+                numNeigh = (int32_t)(neighborStart2[whichnode + 1] - neighborStart2[whichnode]);
                 for (j = 0; j < numNeigh; ++j)
                 {
                     whichneigh = neighbors[j];
                     if (!(marked[whichneigh] & 1))
                     {//skip floating point math if marked
-                        tempf = output[whichnode] + distances2[whichnode][j];
+                        tempf = output[whichnode] + neighDists[j];
                         if (!(marked[whichneigh] & 4))
                         {
                             parent[whichneigh] = whichnode;
@@ -429,7 +484,8 @@ float** GeodesicHelper::getGeoAllToAll(const bool smooth)
 void GeodesicHelper::alltoall(float** out, int32_t** parents, bool smooth)
 {//propagates info about shortest paths not containing root to other roots, hopefully making the problem tractable
     int32_t root, i, j, whichnode, whichneigh, numNeigh, remain, midpoint, midrevparent, endparent, prevdots = 0, dots;
-    int32_t* neighbors;
+    const int32_t* neighbors;
+    const float* neighDists;
     float tempf, tempf2;
     for (i = 0; i < numNodes; ++i)
     {
@@ -476,8 +532,9 @@ void GeodesicHelper::alltoall(float** out, int32_t** parents, bool smooth)
             {
                 if (!(marked[whichnode] & 2)) --remain;
                 marked[whichnode] |= 1;
-                neighbors = nodeNeighbors[whichnode];
-                numNeigh = numNeighbors[whichnode];
+                neighbors = nodeNeighbors + neighborStart[whichnode];
+                neighDists = distances + neighborStart[whichnode];
+                numNeigh = (int32_t)(neighborStart[whichnode + 1] - neighborStart[whichnode]);
                 for (j = 0; j < numNeigh; ++j)
                 {
                     whichneigh = neighbors[j];
@@ -491,7 +548,7 @@ void GeodesicHelper::alltoall(float** out, int32_t** parents, bool smooth)
                     } else {
                         if (!(marked[whichneigh] & 1))
                         {//skip floating point math if marked
-                            tempf = out[root][whichnode] + distances[whichnode][j];
+                            tempf = out[root][whichnode] + neighDists[j];
                             if (!(marked[whichneigh] & 4))
                             {
                                 out[root][whichneigh] = tempf;
@@ -508,8 +565,9 @@ void GeodesicHelper::alltoall(float** out, int32_t** parents, bool smooth)
                 }
                 if (smooth)
                 {
-                    neighbors = nodeNeighbors2[whichnode];
-                    numNeigh = numNeighbors2[whichnode];
+                    neighbors = nodeNeighbors2 + neighborStart2[whichnode];
+                    neighDists = distances2 + neighborStart2[whichnode];
+                    numNeigh = (int32_t)(neighborStart2[whichnode + 1] - neighborStart2[whichnode]);
                     for (j = 0; j < numNeigh; ++j)
                     {
                         whichneigh = neighbors[j];
@@ -523,7 +581,7 @@ void GeodesicHelper::alltoall(float** out, int32_t** parents, bool smooth)
                         } else {
                             if (!(marked[whichneigh] & 1))
                             {//skip floating point math if marked
-                                tempf = out[root][whichnode] + distances2[whichnode][j];
+                                tempf = out[root][whichnode] + neighDists[j];
                                 if (!(marked[whichneigh] & 4))
                                 {
                                     out[root][whichneigh] = tempf;
@@ -648,7 +706,8 @@ void GeodesicHelper::getGeoFromNode(const int32_t node, std::vector<float>& valu
 void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth)
 {
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0, remain = 0;
-    int32_t* neighbors;
+    const int32_t* neighbors;
+    const float* neighDists;
     float tempf;
     j = interested.size();
     for (i = 0; i < j; ++i)
@@ -680,14 +739,15 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
                 --remain;
             }
             marked[whichnode] |= 1;//anything pulled from stack will already be marked as having a valid value (flag 4), so already in changed list
-            neighbors = nodeNeighbors[whichnode];
-            numNeigh = numNeighbors[whichnode];
+            neighbors = nodeNeighbors + neighborStart[whichnode];
+            neighDists = distances + neighborStart[whichnode];
+            numNeigh = (int32_t)(neighborStart[whichnode + 1] - neighborStart[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if marked
-                    tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                     if (!(marked[whichneigh] & 4))
                     {
                         parent[whichneigh] = whichnode;
@@ -706,14 +766,15 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
             }
             if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
             {
-                neighbors = nodeNeighbors2[whichnode];
-                numNeigh = numNeighbors2[whichnode];
+                neighbors = nodeNeighbors2 + neighborStart2[whichnode];
+                neighDists = distances2 + neighborStart2[whichnode];
+                numNeigh = (int32_t)(neighborStart2[whichnode + 1] - neighborStart2[whichnode]);
                 for (j = 0; j < numNeigh; ++j)
                 {
                     whichneigh = neighbors[j];
                     if (!(marked[whichneigh] & 1))
                     {//skip floating point math if marked
-                        tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                        tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                         if (!(marked[whichneigh] & 4))
                         {
                             parent[whichneigh] = whichnode;
@@ -742,7 +803,8 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
 int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth)
 {
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0, ret = -1;
-    int32_t* neighbors;
+    const int32_t* neighbors;
+    const float* neighDists;
     float tempf;
     output[root] = 0.0f;
     changed[numChanged++] = root;
@@ -762,14 +824,15 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
                 break;
             }
             marked[whichnode] |= 1;//anything pulled from stack will already be marked as having a valid value (flag 4), so already in changed list
-            neighbors = nodeNeighbors[whichnode];
-            numNeigh = numNeighbors[whichnode];
+            neighbors = nodeNeighbors + neighborStart[whichnode];
+            neighDists = distances + neighborStart[whichnode];
+            numNeigh = (int32_t)(neighborStart[whichnode + 1] - neighborStart[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                     if (tempf <= maxdist)
                     {
                         if (!(marked[whichneigh] & 4))
@@ -791,14 +854,15 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
             }
             if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
             {
-                neighbors = nodeNeighbors2[whichnode];
-                numNeigh = numNeighbors2[whichnode];
+                neighbors = nodeNeighbors2 + neighborStart2[whichnode];
+                neighDists = distances2 + neighborStart2[whichnode];
+                numNeigh = (int32_t)(neighborStart2[whichnode + 1] - neighborStart2[whichnode]);
                 for (j = 0; j < numNeigh; ++j)
                 {
                     whichneigh = neighbors[j];
                     if (!(marked[whichneigh] & 1))
                     {//skip floating point math if frozen
-                        tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                        tempf = output[whichnode] + neighDists[j];//isn't precomputation wonderful
                         if (tempf <= maxdist)
                         {
                             if (!(marked[whichneigh] & 4))
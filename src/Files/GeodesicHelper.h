@@ -45,9 +45,10 @@ namespace caret {
         GeodesicHelperBase();//can't construct without arguments
         GeodesicHelperBase& operator=(const GeodesicHelperBase& right);//can't assign
         GeodesicHelperBase(const GeodesicHelperBase& right);//can't use copy constructor
-        float** distances, **distances2;//use primitives for speed, and they don't need to change size
-        int32_t** nodeNeighbors, **nodeNeighbors2;//copy neighbors at constructor, because I don't want to mess with inheritance, and I want speed of repeated calls
-        int32_t* numNeighbors, *numNeighbors2;
+        //neighbor lists are stored flat (CSR style), node i's neighbors are m_nodeNeighbors[m_neighborStart[i]] through m_nodeNeighbors[m_neighborStart[i + 1] - 1]
+        std::vector<int64_t> m_neighborStart, m_neighborStart2;
+        std::vector<int32_t> m_nodeNeighbors, m_nodeNeighbors2;
+        std::vector<float> m_distances, m_distances2;//same indexing as the neighbors
         int32_t numNodes;
         static void crossProd(const float in1[3], const float in2[3], float out[3]);//DO NOT PASS AN INPUT AS OUT
         static float dotProd(const float in1[3], const float in2[3]);
@@ -55,32 +56,17 @@ namespace caret {
         static void coordDiff(const float* coord1, const float* coord2, float out[3]);
     public:
         GeodesicHelperBase(const SurfaceFile* surfaceIn);
-        ~GeodesicHelperBase() {
-            if (numNeighbors) {
-                delete[] numNeighbors;
-                delete[] numNeighbors2;
-                for (int32_t i = 0; i < numNodes; ++i)
-                {
-                    delete[] nodeNeighbors[i];
-                    delete[] nodeNeighbors2[i];
-                    delete[] distances[i];
-                    delete[] distances2[i];
-                }
-                delete[] nodeNeighbors;
-                delete[] nodeNeighbors2;
-                delete[] distances;
-                delete[] distances2;
-            }
-        }
         friend class GeodesicHelper;//let it grab the private variables it needs
     };
 
     class GeodesicHelper
     {
         CaretMinHeap<int32_t, float> m_active;//save and reuse the allocated space
-        float* output, **distances, **distances2;//use primitives for speed, and they don't need to change size
-        int32_t** nodeNeighbors, **nodeNeighbors2;//copy neighbors at constructor, because I don't want to mess with inheritance, and I want speed of repeated calls
-        int32_t* numNeighbors, *numNeighbors2, *marked, *changed, *parent;
+        float* output;
+        const float* distances, *distances2;//flat arrays owned by the base, indexed by neighborStart
+        const int32_t* nodeNeighbors, *nodeNeighbors2;
+        const int64_t* neighborStart, *neighborStart2;
+        int32_t* marked, *changed, *parent;
         CaretArray<int64_t> m_heapIdent;
         int32_t numNodes;
         GeodesicHelper();//Don't allow construction without arguments
@@ -92,6 +78,7 @@ namespace caret {
         void dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth);//partial surface
         int32_t closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth);//just closest node
         CaretPointer<GeodesicHelperBase> m_myBase;//mostly just for automatic memory management
+        std::vector<CaretPointer<GeodesicHelper> > m_threadPool;//scratch space for the batched call, kept so that repeated calls don't reallocate
         CaretMutex inUse;//could add a function and a locker pointer to be able to lock to thread once, then call repeatedly without locking, if mutex overhead is actually a factor
     public:
         GeodesicHelper(const CaretPointer<GeodesicHelperBase>& baseIn);
@@ -106,6 +93,10 @@ namespace caret {
         /// Get distances from root node, up to a geodesic distance cutoff (stops computing when no more nodes are within that distance)
         void getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut, const bool smoothflag = true);
 
+        /// Get distances from many root nodes, up to a geodesic distance cutoff, using multiple threads - output vectors are in the same order as roots
+        void getNodesToGeoDist(const std::vector<int32_t>& roots, const float maxdist, std::vector<std::vector<int32_t> >& neighborsOut,
+                               std::vector<std::vector<float> >& distsOut, const bool smoothflag = true);
+
         /// Get distances from root node, up to a geodesic distance cutoff, and also return their parents (root node has -1 as parent)
         void getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut, std::vector<int32_t>& parentsOut, const bool smoothflag = true);
 
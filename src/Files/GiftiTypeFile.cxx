@@ -120,6 +120,21 @@ GiftiTypeFile::isModifiedExcludingPaletteColorMapping() const
     return false;
 }
 
+/**
+ * Set deferred decoding of compressed data arrays for the next read.
+ * Only the GUI should use this, it shows a few maps of a file at a
+ * time.  Errors in deferred arrays are then thrown as DataFileException
+ * by the data accessors instead of by readFile().
+ *
+ * @param deferDecoding
+ *    New status of deferred decoding.
+ */
+void
+GiftiTypeFile::setDeferDataArrayDecoding(const bool deferDecoding)
+{
+    this->giftiFile->setDeferDataArrayDecoding(deferDecoding);
+}
+
 /**
  * Is this file empty?
  *
@@ -70,6 +70,8 @@ namespace caret {
 
         virtual void readFile(const AString& filename) throw (DataFileException);
         
+        void setDeferDataArrayDecoding(const bool deferDecoding);
+        
         virtual void writeFile(const AString& filename) throw (DataFileException);
         
         virtual AString toString() const;
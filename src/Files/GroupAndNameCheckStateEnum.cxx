@@ -25,9 +25,15 @@
 #undef __GROUP_AND_NAME_CHECK_STATE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::GroupAndNameCheckStateEnum 
@@ -76,7 +82,10 @@ GroupAndNameCheckStateEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(GroupAndNameCheckStateEnum(UNCHECKED,
                                                   Qt::Unchecked,
@@ -92,6 +101,7 @@ GroupAndNameCheckStateEnum::initialize()
                                                   Qt::Checked,
                                                   "CHECKED",
                                                   "Checked"));    
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
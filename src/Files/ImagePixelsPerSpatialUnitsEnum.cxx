@@ -25,9 +25,15 @@
 #undef __IMAGE_PIXELS_PER_SPATIAL_UNITS_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ImagePixelsPerSpatialUnitsEnum 
@@ -104,7 +110,10 @@ ImagePixelsPerSpatialUnitsEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ImagePixelsPerSpatialUnitsEnum(PIXELS_PER_INCH,
                                                 "PIXELS_PER_INCH",
@@ -113,6 +122,7 @@ ImagePixelsPerSpatialUnitsEnum::initialize()
     enumData.push_back(ImagePixelsPerSpatialUnitsEnum(PIXEL_PER_CENTIMETER,
                                                 "PIXEL_PER_CENTIMETER",
                                                 "pixels/cm"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
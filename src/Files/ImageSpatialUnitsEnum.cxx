@@ -25,9 +25,15 @@
 #undef __IMAGE_SPATIAL_UNITS_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::ImageSpatialUnitsEnum 
@@ -106,7 +112,10 @@ ImageSpatialUnitsEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ImageSpatialUnitsEnum(INCHES,
                                              "INCHES",
@@ -119,6 +128,7 @@ ImageSpatialUnitsEnum::initialize()
     enumData.push_back(ImageSpatialUnitsEnum(MILLIMETERS,
                                              "MILLIMETERS",
                                              "mm"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __LABEL_DRAWING_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::LabelDrawingTypeEnum 
@@ -72,7 +78,10 @@ LabelDrawingTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(LabelDrawingTypeEnum(DRAW_FILLED, 
                                     "DRAW_FILLED", 
@@ -90,6 +99,7 @@ LabelDrawingTypeEnum::initialize()
                                             "DRAW_OUTLINE_LABEL_COLOR",
                                             "Outline Label Color"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 
@@ -22,6 +22,7 @@
 #include "CaretLogger.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "DataFileTypeEnum.h"
+#include "GiftiException.h"
 #include "GiftiFile.h"
 #include "GiftiLabel.h"
 #include "MathFunctions.h"
@@ -89,6 +90,7 @@ LabelFile::clear()
 {
     GiftiTypeFile::clear();
     this->columnDataPointers.clear();
+    this->anyColumnDecodingDeferred = false;
     m_classNameHierarchy->clear();
 }
 
@@ -152,13 +154,29 @@ LabelFile::validateDataArraysAfterReading() throw (DataFileException)
     
     const int32_t numberOfDataArrays = this->giftiFile->getNumberOfDataArrays();
     for (int32_t i = 0; i < numberOfDataArrays; i++) {
-        int32_t* tempPointer = this->giftiFile->getDataArray(i)->getDataPointerInt();
-        if (tempPointer == NULL) throw DataFileException("found non-integer data array in label file '" + getFileName() + "'");
-        this->columnDataPointers.push_back(tempPointer);
+        GiftiDataArray* gda = this->giftiFile->getDataArray(i);
+        if (gda->getDataType() != NiftiDataTypeEnum::NIFTI_TYPE_INT32) throw DataFileException("found non-integer data array in label file '" + getFileName() + "'");
+        if (gda->isDataDecodingDeferred()) {
+            this->anyColumnDecodingDeferred = true;
+            this->columnDataPointers.push_back(NULL);//set by getColumnDataPointer()
+        }
+        else {
+            this->columnDataPointers.push_back(gda->getDataPointerInt());
+        }
     }
     
     validateKeysAndLabels();
     
+    /*
+     * The hierarchy needs the keys in every map, so when decoding
+     * is deferred, wait until the hierarchy is first requested.
+     * New hierarchy items are selected by default.
+     */
+    if (this->anyColumnDecodingDeferred) {
+        m_forceUpdateOfGroupAndNameHierarchy = true;
+        return;
+    }
+    
     m_classNameHierarchy->update(this,
                                  true);
     m_forceUpdateOfGroupAndNameHierarchy = false;
@@ -295,6 +313,7 @@ LabelFile::initializeMembersLabelFile()
     }
     m_classNameHierarchy = new GroupAndNameHierarchyModel();
     m_forceUpdateOfGroupAndNameHierarchy = true;
+    this->anyColumnDecodingDeferred = false;
 }
 
 /**
@@ -349,11 +368,10 @@ int32_t
 LabelFile::getLabelKey(const int32_t nodeIndex,
                        const int32_t columnIndex) const
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), 
                        "Node Index out of range.");
     
-    return this->columnDataPointers[columnIndex][nodeIndex];
+    return getColumnDataPointer(columnIndex)[nodeIndex];
 }
 
 /**
@@ -371,10 +389,9 @@ LabelFile::setLabelKey(const int32_t nodeIndex,
                        const int32_t columnIndex,
                        const int32_t labelKey)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), "Node Index out of range.");
     
-    this->columnDataPointers[columnIndex][nodeIndex] = labelKey;
+    getColumnDataPointer(columnIndex)[nodeIndex] = labelKey;
     this->setModified();
     m_forceUpdateOfGroupAndNameHierarchy = true;
 }
@@ -414,9 +431,43 @@ LabelFile::getNodeIndicesWithLabelKey(const int32_t columnIndex,
  */
 const int32_t* 
 LabelFile::getLabelKeyPointerForColumn(const int32_t columnIndex) const
+{
+    return getColumnDataPointer(columnIndex);
+}
+
+/**
+ * Get the keys for a column, decoding them from the GIFTI data
+ * array if this is the first time the column is used.
+ *
+ * @param columnIndex
+ *     Index of the column.
+ * @return
+ *     Pointer to keys for the given column.
+ */
+int32_t*
+LabelFile::getColumnDataPointer(const int32_t columnIndex) const
 {
     CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    return this->columnDataPointers[columnIndex];    
+    if ( ! this->anyColumnDecodingDeferred) {
+        return this->columnDataPointers[columnIndex];
+    }
+    CaretMutexLocker locked(&this->columnDataMutex);
+    int32_t* columnData = this->columnDataPointers[columnIndex];
+    if (columnData == NULL) {
+        try {
+            columnData = this->giftiFile->getDataArray(columnIndex)->getDataPointerInt();
+        }
+        catch (const GiftiException& e) {
+            throw DataFileException("Error reading map "
+                                    + AString::number(columnIndex + 1)
+                                    + " of "
+                                    + this->getFileName()
+                                    + ": "
+                                    + e.whatString());
+        }
+        this->columnDataPointers[columnIndex] = columnData;
+    }
+    return columnData;
 }
 
 void LabelFile::setNumberOfNodesAndColumns(int32_t nodes, int32_t columns)
@@ -508,8 +559,7 @@ LabelFile::addMaps(const int32_t numberOfNodes,
 
 void LabelFile::setLabelKeysForColumn(const int32_t columnIndex, const int32_t* valuesIn)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    int32_t* myColumn = columnDataPointers[columnIndex];
+    int32_t* myColumn = getColumnDataPointer(columnIndex);
     int numNodes = (int)getNumberOfNodes();
     for (int i = 0; i < numNodes; ++i)
     {
@@ -25,6 +25,7 @@
 #include <vector>
 #include <stdint.h>
 
+#include "CaretMutex.h"
 #include "GiftiTypeFile.h"
 
 namespace caret {
@@ -101,8 +102,16 @@ namespace caret {
     private:
         void validateKeysAndLabels() const;
         
-        /** Points to actual data in each Gifti Data Array */
-        std::vector<int32_t*> columnDataPointers;
+        int32_t* getColumnDataPointer(const int32_t columnIndex) const;
+        
+        /** Points to actual data in each Gifti Data Array, NULL until used if decoding was deferred */
+        mutable std::vector<int32_t*> columnDataPointers;
+        
+        /** True if any column pointer is filled in on first use, only then is columnDataMutex needed */
+        bool anyColumnDecodingDeferred;
+        
+        /** Protects filling in columnDataPointers from multiple threads */
+        mutable CaretMutex columnDataMutex;
 
         /** Holds class and name hierarchy used for display selection */
         mutable GroupAndNameHierarchyModel* m_classNameHierarchy;
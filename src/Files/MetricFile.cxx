@@ -23,6 +23,7 @@
 #include "ChartDataCartesian.h"
 #include "ChartDataSource.h"
 #include "DataFileTypeEnum.h"
+#include "GiftiException.h"
 #include "GiftiFile.h"
 #include "MathFunctions.h"
 #include "MetricFile.h"
@@ -92,6 +93,7 @@ MetricFile::clear()
 {
     GiftiTypeFile::clear();
     this->columnDataPointers.clear();
+    this->anyColumnDecodingDeferred = false;
 }
 
 /**
@@ -111,52 +113,67 @@ MetricFile::validateDataArraysAfterReading() throw (DataFileException)
     bool isLabelData = false;
     
     const int32_t numberOfDataArrays = this->giftiFile->getNumberOfDataArrays();
-    for (int32_t i = 0; i < numberOfDataArrays; i++) {
-        GiftiDataArray* gda = this->giftiFile->getDataArray(i);
-        if (gda->getDataType() != NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
-            if (gda->getIntent() == NiftiIntentEnum::NIFTI_INTENT_LABEL) {
-                isLabelData = true;
-            }
-            gda->convertToDataType(NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32);
-        }
-        int numDims = gda->getNumberOfDimensions();
-        std::vector<int64_t> dims = gda->getDimensions();
-        if (numDims == 1 || (numDims == 2 && dims[1] == 1))
-        {
-            this->columnDataPointers.push_back(gda->getDataPointerFloat());
-        } else {
-            if (numDims != 2)
-            {
-                throw DataFileException("Invalid number of dimensions in metric file '" + getFileName() + "': " + AString::number(numDims));
-            }
-            if (numberOfDataArrays != 1)
-            {
-                throw DataFileException("Two dimensional data arrays are not allowed in metric files with multiple data arrays");
+    try {
+        for (int32_t i = 0; i < numberOfDataArrays; i++) {
+            GiftiDataArray* gda = this->giftiFile->getDataArray(i);
+            if (gda->getDataType() != NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
+                if (gda->getIntent() == NiftiIntentEnum::NIFTI_INTENT_LABEL) {
+                    isLabelData = true;
+                }
+                gda->convertToDataType(NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32);
             }
-            std::vector<int64_t> newdims = dims;
-            newdims[1] = 1;
-            GiftiFile* newFile = new GiftiFile();//convert to multiple 1-d arrays on the fly
-            *(newFile->getMetaData()) = *(giftiFile->getMetaData());
-            int32_t indices[2], newindices[2] = {0, 0};
-            for (indices[1] = 0; indices[1] < dims[1]; ++indices[1])
+            int numDims = gda->getNumberOfDimensions();
+            std::vector<int64_t> dims = gda->getDimensions();
+            if (numDims == 1 || (numDims == 2 && dims[1] == 1))
             {
-                GiftiDataArray* tempArray = new GiftiDataArray(NiftiIntentEnum::NIFTI_INTENT_NORMAL,
-                                                            NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32,
-                                                            newdims,
-                                                            GiftiEncodingEnum::GZIP_BASE64_BINARY);
-                for (indices[0] = 0; indices[0] < dims[0]; ++indices[0])
+                if (gda->isDataDecodingDeferred()) {
+                    this->anyColumnDecodingDeferred = true;
+                    this->columnDataPointers.push_back(NULL);//set by getColumnDataPointer()
+                }
+                else {
+                    this->columnDataPointers.push_back(gda->getDataPointerFloat());
+                }
+            } else {
+                if (numDims != 2)
+                {
+                    throw DataFileException("Invalid number of dimensions in metric file '" + getFileName() + "': " + AString::number(numDims));
+                }
+                if (numberOfDataArrays != 1)
+                {
+                    throw DataFileException("Two dimensional data arrays are not allowed in metric files with multiple data arrays");
+                }
+                std::vector<int64_t> newdims = dims;
+                newdims[1] = 1;
+                GiftiFile* newFile = new GiftiFile();//convert to multiple 1-d arrays on the fly
+                newFile->setDeferDataArrayDecoding(giftiFile->getDeferDataArrayDecoding());
+                *(newFile->getMetaData()) = *(giftiFile->getMetaData());
+                int32_t indices[2], newindices[2] = {0, 0};
+                for (indices[1] = 0; indices[1] < dims[1]; ++indices[1])
                 {
-                    newindices[0] = indices[0];
-                    tempArray->setDataFloat32(newindices, gda->getDataFloat32(indices));
+                    GiftiDataArray* tempArray = new GiftiDataArray(NiftiIntentEnum::NIFTI_INTENT_NORMAL,
+                                                                NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32,
+                                                                newdims,
+                                                                GiftiEncodingEnum::GZIP_BASE64_BINARY);
+                    for (indices[0] = 0; indices[0] < dims[0]; ++indices[0])
+                    {
+                        newindices[0] = indices[0];
+                        tempArray->setDataFloat32(newindices, gda->getDataFloat32(indices));
+                    }
+                    newFile->addDataArray(tempArray);
+                    newFile->setDataArrayName(indices[1], "#" + AString::number(indices[1] + 1));
+                    columnDataPointers.push_back(tempArray->getDataPointerFloat());
                 }
-                newFile->addDataArray(tempArray);
-                newFile->setDataArrayName(indices[1], "#" + AString::number(indices[1] + 1));
-                columnDataPointers.push_back(tempArray->getDataPointerFloat());
+                delete giftiFile;//delete old 2D file
+                giftiFile = newFile;//drop new 1D file in
             }
-            delete giftiFile;//delete old 2D file
-            giftiFile = newFile;//drop new 1D file in
         }
     }
+    catch (const GiftiException& e) {//only arrays that must be converted or split are decoded here when decoding is deferred
+        throw DataFileException("Error decoding "
+                                + this->getFileName()
+                                + ": "
+                                + e.whatString());
+    }
     
     if (isLabelData) {
         CaretLogWarning("Metric File: "
@@ -204,6 +221,7 @@ MetricFile::initializeMembersMetricFile()
     for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
         m_chartingEnabledForTab[i] = false;
     }
+    this->anyColumnDecodingDeferred = false;
 }
 
 /**
@@ -236,11 +254,10 @@ float
 MetricFile::getValue(const int32_t nodeIndex,
                      const int32_t columnIndex) const
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), 
                        "Node Index out of range.");
     
-    return this->columnDataPointers[columnIndex][nodeIndex];
+    return getColumnDataPointer(columnIndex)[nodeIndex];
 }
 
 /**
@@ -258,18 +275,51 @@ MetricFile::setValue(const int32_t nodeIndex,
                      const int32_t columnIndex,
                      const float value)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), "Node Index out of range.");
     
-    this->columnDataPointers[columnIndex][nodeIndex] = value;
+    getColumnDataPointer(columnIndex)[nodeIndex] = value;
     setModified();
 }
 
 const float* 
 MetricFile::getValuePointerForColumn(const int32_t columnIndex) const
+{
+    return getColumnDataPointer(columnIndex);
+}
+
+/**
+ * Get the data for a column, decoding it from the GIFTI data
+ * array if this is the first time the column is used.
+ *
+ * @param columnIndex
+ *     Column index.
+ * @return
+ *     Pointer to the column's data.
+ */
+float*
+MetricFile::getColumnDataPointer(const int32_t columnIndex) const
 {
     CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    return this->columnDataPointers[columnIndex];
+    if ( ! this->anyColumnDecodingDeferred) {
+        return this->columnDataPointers[columnIndex];
+    }
+    CaretMutexLocker locked(&this->columnDataMutex);
+    float* columnData = this->columnDataPointers[columnIndex];
+    if (columnData == NULL) {
+        try {
+            columnData = this->giftiFile->getDataArray(columnIndex)->getDataPointerFloat();
+        }
+        catch (const GiftiException& e) {
+            throw DataFileException("Error reading map "
+                                    + AString::number(columnIndex + 1)
+                                    + " of "
+                                    + this->getFileName()
+                                    + ": "
+                                    + e.whatString());
+        }
+        this->columnDataPointers[columnIndex] = columnData;
+    }
+    return columnData;
 }
 
 void MetricFile::setNumberOfNodesAndColumns(int32_t nodes, int32_t columns)
@@ -345,8 +395,7 @@ MetricFile::addMaps(const int32_t numberOfNodes,
 
 void MetricFile::setValuesForColumn(const int32_t columnIndex, const float* valuesIn)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    float* myColumn = columnDataPointers[columnIndex];
+    float* myColumn = getColumnDataPointer(columnIndex);
     int numNodes = (int)getNumberOfNodes();
     for (int i = 0; i < numNodes; ++i)
     {
@@ -357,8 +406,7 @@ void MetricFile::setValuesForColumn(const int32_t columnIndex, const float* valu
 
 void MetricFile::initializeColumn(const int32_t columnIndex, const float& value)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    float* myColumn = columnDataPointers[columnIndex];
+    float* myColumn = getColumnDataPointer(columnIndex);
     int numNodes = (int)getNumberOfNodes();
     for (int i = 0; i < numNodes; ++i)
     {
@@ -27,6 +27,7 @@
 
 #include "ChartableBrainordinateInterface.h"
 #include "BrainConstants.h"
+#include "CaretMutex.h"
 #include "GiftiTypeFile.h"
 
 namespace caret {
@@ -111,8 +112,16 @@ namespace caret {
                                               const SceneClass* sceneClass);
         
     private:
-        /** Points to actual data in each Gifti Data Array */
-        std::vector<float*> columnDataPointers;
+        float* getColumnDataPointer(const int32_t columnIndex) const;
+        
+        /** Points to actual data in each Gifti Data Array, NULL until used if decoding was deferred */
+        mutable std::vector<float*> columnDataPointers;
+        
+        /** True if any column pointer is filled in on first use, only then is columnDataMutex needed */
+        bool anyColumnDecodingDeferred;
+        
+        /** Protects filling in columnDataPointers from multiple threads */
+        mutable CaretMutex columnDataMutex;
 
         bool m_chartingEnabledForTab[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
     };
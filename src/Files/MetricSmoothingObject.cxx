@@ -27,26 +27,164 @@
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+#include "CaretLogger.h"
+#include "WeightsCacheFile.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace std;
 using namespace caret;
 
-MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
+namespace
+{//kernel cache file arrays: CSR node offsets as int64, then weight sums, neighbor vertices as int32, and weights
+    const char KERNEL_MAGIC[8] = { 'w', 'b', 's', 'm', 'o', 'o', 't', 'h' };
+    const int32_t KERNEL_VERSION = 1;
+}
+
+MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas,
+                                             const AString& cacheDirectory)
 {
     CaretAssert(mySurf != NULL);
     if (myRoi != NULL && mySurf->getNumberOfNodes() != myRoi->getNumberOfNodes())
     {
         throw CaretException("roi number of nodes doesn't match the surface");
     }
+    m_numNodes = mySurf->getNumberOfNodes();
+    if (cacheDirectory != "")
+    {
+        m_cacheKey = computeCacheKey(mySurf, kernel, myRoi, myMethod, nodeAreas);
+        m_cacheFileName = cacheDirectory + "/" + m_cacheKey + ".wbkernel";
+        if (readKernelFile(m_cacheFileName, m_cacheKey, m_numNodes))
+        {
+            return;
+        }
+    }
     precomputeWeights(mySurf, kernel, myRoi, myMethod, nodeAreas);
+    compactWeights();
+    if (cacheDirectory != "")
+    {
+        try
+        {
+            writeKernelFile(m_cacheFileName, m_cacheKey);
+        } catch (CaretException& e) {//failing to save the cache shouldn't stop the smoothing
+            CaretLogWarning("failed to save smoothing kernels to cache: " + e.whatString());
+        }
+    }
+}
+
+void MetricSmoothingObject::saveCacheFile() const
+{
+    if (m_cacheFileName == "") throw CaretException("no cache directory was given for the smoothing kernels");
+    if (QFile::exists(m_cacheFileName)) return;
+    writeKernelFile(m_cacheFileName, m_cacheKey);
+}
+
+void MetricSmoothingObject::compactWeights()
+{
+    int64_t numElems = 0;
+    m_nodeStartStorage.resize(m_numNodes + 1);
+    m_weightSumsStorage.resize(m_numNodes);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_nodeStartStorage[i] = numElems;
+        numElems += m_weightLists[i].m_nodes.size();
+        if (m_weightLists[i].m_nodes.empty())
+        {
+            m_weightSumsStorage[i] = 0.0f;//ROI methods don't set the sum of nodes they skip
+        } else {
+            m_weightSumsStorage[i] = m_weightLists[i].m_weightSum;
+        }
+    }
+    m_nodeStartStorage[m_numNodes] = numElems;
+    m_nodesStorage.resize(numElems);
+    m_weightsStorage.resize(numElems);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numWeights = (int32_t)m_weightLists[i].m_nodes.size();
+        int64_t start = m_nodeStartStorage[i];
+        for (int32_t j = 0; j < numWeights; ++j)
+        {
+            m_nodesStorage[start + j] = m_weightLists[i].m_nodes[j];
+            m_weightsStorage[start + j] = m_weightLists[i].m_weights[j];
+        }
+    }
+    vector<WeightList>().swap(m_weightLists);//release the memory
+    m_nodeStart = m_nodeStartStorage.data();
+    m_nodes = m_nodesStorage.data();
+    m_weights = m_weightsStorage.data();
+    m_weightSums = m_weightSumsStorage.data();
+}
+
+AString MetricSmoothingObject::computeCacheKey(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t methodNum = (int32_t)myMethod, numNodes = mySurf->getNumberOfNodes(), numTiles = mySurf->getNumberOfTriangles();
+    myHash.addData((const char*)&KERNEL_VERSION, sizeof(int32_t));//don't reuse files from a different weight computation
+    myHash.addData((const char*)&methodNum, sizeof(int32_t));
+    myHash.addData((const char*)&kernel, sizeof(float));
+    myHash.addData((const char*)&numNodes, sizeof(int32_t));
+    myHash.addData((const char*)mySurf->getCoordinateData(), numNodes * 3 * sizeof(float));
+    myHash.addData((const char*)&numTiles, sizeof(int32_t));
+    for (int32_t i = 0; i < numTiles; ++i)
+    {
+        myHash.addData((const char*)mySurf->getTriangle(i), 3 * sizeof(int32_t));
+    }
+    char flags[2] = { (char)(myRoi != NULL), (char)(nodeAreas != NULL) };
+    myHash.addData(flags, 2);
+    if (myRoi != NULL) myHash.addData((const char*)myRoi->getValuePointerForColumn(0), numNodes * sizeof(float));
+    if (nodeAreas != NULL) myHash.addData((const char*)nodeAreas, numNodes * sizeof(float));
+    return QString(myHash.result().toHex());
+}
+
+bool MetricSmoothingObject::readKernelFile(const AString& fileName, const AString& key, const int32_t& numNodes)
+{
+    try
+    {
+        WeightsCacheFile myFile;
+        if (!myFile.open(fileName, KERNEL_MAGIC, KERNEL_VERSION, key, numNodes)) return false;
+        int64_t numElems = myFile.getNumberOfElements();
+        m_nodeStart = myFile.nextArray(numNodes + 1, m_nodeStartStorage);
+        m_weightSums = myFile.nextArray(numNodes, m_weightSumsStorage);
+        m_nodes = myFile.nextArray(numElems, m_nodesStorage);
+        m_weights = myFile.nextArray(numElems, m_weightsStorage);
+        myFile.checkOffsets(m_nodeStart);
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if (m_nodes[i] < 0 || m_nodes[i] >= numNodes) throw CaretException("vertex index out of range");
+        }
+        m_mappedFile = myFile.getMappedFile();
+    } catch (CaretException& e) {//bad cache file, not fatal
+        CaretLogWarning("error reading smoothing kernel file '" + fileName + "', recomputing: " + e.whatString());
+        m_nodeStartStorage.clear();
+        m_weightSumsStorage.clear();
+        m_nodesStorage.clear();
+        m_weightsStorage.clear();
+        return false;
+    }
+    return true;
+}
+
+void MetricSmoothingObject::writeKernelFile(const AString& fileName, const AString& key) const
+{
+    int64_t numElems = m_nodeStart[m_numNodes];
+    vector<WeightsCacheFile::Array> arrays;
+    arrays.push_back(WeightsCacheFile::Array(m_nodeStart, (m_numNodes + 1) * sizeof(int64_t)));
+    arrays.push_back(WeightsCacheFile::Array(m_weightSums, m_numNodes * sizeof(float)));
+    arrays.push_back(WeightsCacheFile::Array(m_nodes, numElems * sizeof(int32_t)));
+    arrays.push_back(WeightsCacheFile::Array(m_weights, numElems * sizeof(float)));
+    WeightsCacheFile::writeFile(fileName, KERNEL_MAGIC, KERNEL_VERSION, key, m_numNodes, numElems, arrays);
 }
 
 void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +192,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != m_numNodes || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(m_numNodes, 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +213,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != m_numNodes))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,18 +251,18 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != m_numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(m_numNodes, numCols);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -154,17 +292,19 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            const int32_t* myNodes = m_nodes + m_nodeStart[i];
+            const float* myWeights = m_weights + m_nodeStart[i];
+            const float myWeightSum = m_weightSums[i];
+            int32_t numWeights = (int32_t)(m_nodeStart[i + 1] - m_nodeStart[i]);
+            if (myWeightSum != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
                 for (int32_t j = 0; j < numWeights; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[myNodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = myWeights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +323,18 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            const int32_t* myNodes = m_nodes + m_nodeStart[i];
+            const float* myWeights = m_weights + m_nodeStart[i];
+            const float myWeightSum = m_weightSums[i];
+            int32_t numWeights = (int32_t)(m_nodeStart[i + 1] - m_nodeStart[i]);
+            if (myWeightSum != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
                 for (int32_t j = 0; j < numWeights; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += myWeights[j] * myColumn[myNodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / myWeightSum;
             } else {
                 scratch[i] = 0.0f;
             }
@@ -218,18 +360,20 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            const int32_t* myNodes = m_nodes + m_nodeStart[i];
+            const float* myWeights = m_weights + m_nodeStart[i];
+            const float myWeightSum = m_weightSums[i];
+            int32_t numWeights = (int32_t)(m_nodeStart[i + 1] - m_nodeStart[i]);
+            if (roiColumn[i] > 0.0f && myWeightSum != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
                 for (int32_t j = 0; j < numWeights; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = myNodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = myWeights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +392,19 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            const int32_t* myNodes = m_nodes + m_nodeStart[i];
+            const float* myWeights = m_weights + m_nodeStart[i];
+            const float myWeightSum = m_weightSums[i];
+            int32_t numWeights = (int32_t)(m_nodeStart[i + 1] - m_nodeStart[i]);
+            if (roiColumn[i] > 0.0f && myWeightSum != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
                 for (int32_t j = 0; j < numWeights; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = myNodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = myWeights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -277,36 +423,51 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
 
+void MetricSmoothingObject::getAllGeoDists(const SurfaceFile* mySurf, const float& myGeoDist, vector<vector<int32_t> >& nodesOut, vector<vector<float> >& distsOut)
+{
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    vector<int32_t> roots(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        roots[i] = i;
+    }
+    mySurf->getGeodesicHelper()->getNodesToGeoDist(roots, myGeoDist, nodesOut, distsOut, true);//uses multiple threads internally
+}
+
 void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
     m_weightLists.resize(numNodes);
+    vector<vector<int32_t> > allNodes;
+    vector<vector<float> > allDistances;
+    getAllGeoDists(mySurf, myGeoDist, allNodes, allDistances);
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
-        CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
+        CaretPointer<GeodesicHelper> myGeoHelp;//only needed for the rare kernel that is too small, so don't make one unless needed
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
+            m_weightLists[i].m_nodes.swap(allNodes[i]);
+            vector<float>& distances = allDistances[i];
             if (distances.size() < 7)
             {
+                if (myGeoHelp == NULL) myGeoHelp = mySurf->getGeodesicHelper();
                 m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
                 m_weightLists[i].m_nodes.push_back(i);
                 myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
             }
             int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
             m_weightLists[i].m_weightSum = 0.0f;
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
+                distances[j] = weight;//convert in place, so we don't need a second copy of every kernel
                 m_weightLists[i].m_weightSum += weight;
             }
+            m_weightLists[i].m_weights.swap(distances);
         }
     }
 }
@@ -362,18 +523,23 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
     float gaussianDenom = -0.5f / myKernel / myKernel;
     vector<WeightList> tempList;//this is used to compute scattering kernels because it is easier to normalize scattering kernels correctly, and then convert to gathering kernels
     tempList.resize(numNodes);
+    vector<vector<int32_t> > allNodes;
+    vector<vector<float> > allDistances;
+    getAllGeoDists(mySurf, myGeoDist, allNodes, allDistances);
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
-        CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
+        CaretPointer<GeodesicHelper> myGeoHelp;//only needed for the rare kernel that is too small
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
+            tempList[i].m_nodes.swap(allNodes[i]);
+            vector<float> distances;
+            distances.swap(allDistances[i]);
             const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
             if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
             {
+                if (myGeoHelp == NULL) myGeoHelp = mySurf->getGeodesicHelper();
                 tempList[i].m_nodes = tempneighbors;
                 tempList[i].m_nodes.push_back(i);
                 myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
@@ -495,18 +661,23 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
     float gaussianDenom = -0.5f / myKernel / myKernel;
     vector<WeightList> tempList;//this is used to compute scattering kernels because it is easier to normalize scattering kernels correctly, and then convert to gathering kernels
     tempList.resize(numNodes);
+    vector<vector<int32_t> > allNodes;
+    vector<vector<float> > allDistances;
+    getAllGeoDists(mySurf, myGeoDist, allNodes, allDistances);
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
-        CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
+        CaretPointer<GeodesicHelper> myGeoHelp;//only needed for the rare kernel that is too small
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
+            tempList[i].m_nodes.swap(allNodes[i]);
+            vector<float> distances;
+            distances.swap(allDistances[i]);
             const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
             if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
             {
+                if (myGeoHelp == NULL) myGeoHelp = mySurf->getGeodesicHelper();
                 tempList[i].m_nodes = tempneighbors;
                 tempList[i].m_nodes.push_back(i);
                 myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
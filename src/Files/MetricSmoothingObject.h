@@ -30,6 +30,10 @@
 //NOTE: for a static ROI, it is (sometimes much) more efficient to use it in the constructor, and provide no ROI (NULL) to the functions, using both an ROI in constructor and in method
 //      will result in the effective ROI being the logical AND of the two (intersection).
 
+#include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretPointer.h"
+
 #include "stdint.h"
 #include "stddef.h"
 #include <vector>
@@ -48,10 +52,14 @@ namespace caret {
             GEO_GAUSS_EQUAL,
             GEO_GAUSS
         };
-        MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi = NULL, Method myMethod = GEO_GAUSS_AREA, const float* nodeAreas = NULL);
+        //if cacheDirectory is given, the weights are loaded from or saved to a file there, named by a hash of the surface, kernel, method, roi and areas
+        MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi = NULL, Method myMethod = GEO_GAUSS_AREA, const float* nodeAreas = NULL,
+                              const AString& cacheDirectory = "");
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///writes the kernel file to the cache directory given to the constructor if it isn't there yet, throws on failure
+        void saveCacheFile() const;
     private:
         struct WeightList
         {
@@ -59,10 +67,24 @@ namespace caret {
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        std::vector<WeightList> m_weightLists;//only used while computing the weights, compactWeights() moves them into the flat arrays
+        int32_t m_numNodes;
+        const int64_t* m_nodeStart;//the weights of node i are m_nodes/m_weights[m_nodeStart[i]] through [m_nodeStart[i + 1] - 1]
+        const int32_t* m_nodes;
+        const float* m_weights, *m_weightSums;
+        std::vector<int64_t> m_nodeStartStorage;//these are empty when the weights came from a mapped cache file
+        std::vector<int32_t> m_nodesStorage;
+        std::vector<float> m_weightsStorage, m_weightSumsStorage;
+        CaretPointer<CaretBinaryFile> m_mappedFile;
+        AString m_cacheKey, m_cacheFileName;//empty when no cache directory was given
+        void compactWeights();
+        static AString computeCacheKey(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas);
+        bool readKernelFile(const AString& fileName, const AString& key, const int32_t& numNodes);//returns false if the file is missing or doesn't match
+        void writeKernelFile(const AString& fileName, const AString& key) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
+        static void getAllGeoDists(const SurfaceFile* mySurf, const float& myGeoDist, std::vector<std::vector<int32_t> >& nodesOut, std::vector<std::vector<float> >& distsOut);//batched geodesic for every vertex
         void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel);
         void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
         void precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
@@ -70,6 +92,8 @@ namespace caret {
         void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel);
         void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
         MetricSmoothingObject();
+        MetricSmoothingObject(const MetricSmoothingObject&);//the flat array pointers can't be copied
+        MetricSmoothingObject& operator=(const MetricSmoothingObject&);
     };
     
 }
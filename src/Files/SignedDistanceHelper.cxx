@@ -46,10 +46,11 @@ DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
 #include "BoundingBox.h"
-#include "CaretHeap.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -58,116 +59,16 @@ using namespace caret;
 float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
 {
     CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
-    {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
-        {
-            if (curOct->m_leaf)
-            {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    while (numChanged)
-    {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
-    }
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestPoint(coord, bestInfo);
     return bestTriDist * computeSign(coord, bestInfo, myWinding);
 }
 
 void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
 {
     CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
-    {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
-        {
-            if (curOct->m_leaf)
-            {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    while (numChanged)
-    {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//clean up
-    }
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestPoint(coord, bestInfo);
     baryInfoOut.triangle = bestInfo.triangle;
     baryInfoOut.point = bestInfo.tempPoint;
     baryInfoOut.absDistance = bestTriDist;
@@ -703,6 +604,13 @@ float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t tria
     return result.length();
 }
 
+float SignedDistanceHelper::closestPoint(const float coord[3], ClosestPointInfo& myInfo)
+{
+    int32_t triangle = m_base->closestTriangle(coord);
+    CaretAssert(triangle != -1);
+    return unsignedDistToTri(coord, triangle, myInfo);//the BVH only finds the triangle, get the point details the same way as always
+}
+
 SignedDistanceHelper::SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase)
 {
     m_base = myBase;
@@ -734,6 +642,7 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
     }
     m_numTris = mySurf->getNumberOfTriangles();
     m_triangleList.resize(m_numTris * 3);
+    vector<float> triBounds(m_numTris * 6), centroids(m_numTris * 3);
     for (int32_t i = 0; i < m_numTris; ++i)
     {
         int32_t i3 = i * 3;
@@ -753,6 +662,22 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
             if (myCoordData[thisNode3 + 2] > maxCoord[2]) maxCoord[2] = myCoordData[thisNode3 + 2];
         }
         addTriangle(m_indexRoot, i, minCoord, maxCoord);//use bounding box for now as an easy test to capture any chance of the triangle intersecting the Oct
+        for (int j = 0; j < 3; ++j)
+        {
+            triBounds[i * 6 + j] = minCoord[j];
+            triBounds[i * 6 + j + 3] = maxCoord[j];
+            centroids[i * 3 + j] = (myCoordData[thisTri[0] * 3 + j] + myCoordData[thisTri[1] * 3 + j] + myCoordData[thisTri[2] * 3 + j]) / 3.0f;
+        }
+    }
+    if (m_numTris > 0)
+    {
+        vector<int32_t> triOrder(m_numTris);
+        for (int32_t i = 0; i < m_numTris; ++i)
+        {
+            triOrder[i] = i;
+        }
+        m_bvhNodes.reserve(2 * (m_numTris / BVH_LEAF_SIZE + 1));
+        buildBVH(triOrder, 0, m_numTris, centroids, triBounds);
     }
 }
 
@@ -843,6 +768,180 @@ void SignedDistanceHelperBase::addTriangle(Oct<TriVector>* thisOct, int32_t tria
     }
 }
 
+namespace
+{
+    struct CentroidLess
+    {
+        const float* m_centroids;
+        int m_axis;
+        CentroidLess(const float* centroids, const int& axis) : m_centroids(centroids), m_axis(axis) { }
+        bool operator()(const int32_t& left, const int32_t& right) const
+        {
+            return m_centroids[left * 3 + m_axis] < m_centroids[right * 3 + m_axis];
+        }
+    };
+}
+
+int32_t SignedDistanceHelperBase::buildBVH(vector<int32_t>& triOrder, const int32_t& start, const int32_t& end, const vector<float>& centroids, const vector<float>& triBounds)
+{
+    int32_t nodeIndex = (int32_t)m_bvhNodes.size();
+    m_bvhNodes.push_back(BVHNode());
+    float nodeMin[3], nodeMax[3], centMin[3], centMax[3];
+    for (int32_t i = start; i < end; ++i)
+    {
+        const float* bounds = triBounds.data() + triOrder[i] * 6;
+        const float* centroid = centroids.data() + triOrder[i] * 3;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (i == start || bounds[axis] < nodeMin[axis]) nodeMin[axis] = bounds[axis];
+            if (i == start || bounds[axis + 3] > nodeMax[axis]) nodeMax[axis] = bounds[axis + 3];
+            if (i == start || centroid[axis] < centMin[axis]) centMin[axis] = centroid[axis];
+            if (i == start || centroid[axis] > centMax[axis]) centMax[axis] = centroid[axis];
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_bvhNodes[nodeIndex].m_min[axis] = nodeMin[axis];
+        m_bvhNodes[nodeIndex].m_max[axis] = nodeMax[axis];
+    }
+    if (end - start <= BVH_LEAF_SIZE)
+    {
+        PackedTris packed;
+        for (int lane = 0; lane < BVH_LEAF_SIZE; ++lane)
+        {
+            Vector3D vert1, vert2, vert3;//padding lanes get a degenerate triangle at the origin, and are ignored
+            packed.m_tri[lane] = -1;
+            if (start + lane < end)
+            {
+                packed.m_tri[lane] = triOrder[start + lane];
+                const int32_t* triNodes = getTriangle(triOrder[start + lane]);
+                vert1 = getCoordinate(triNodes[0]);
+                vert2 = getCoordinate(triNodes[1]);
+                vert3 = getCoordinate(triNodes[2]);
+            }
+            Vector3D edge1 = vert2 - vert1, edge2 = vert3 - vert1, edge3 = vert3 - vert2;
+            Vector3D normal = edge1.cross(edge2);
+            float lengths[3] = { edge1.lengthsquared(), edge2.lengthsquared(), edge3.lengthsquared() };
+            float normalSqr = normal.lengthsquared();
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                packed.m_vert[axis][lane] = vert1[axis];
+                packed.m_edge1[axis][lane] = edge1[axis];
+                packed.m_edge2[axis][lane] = edge2[axis];
+                packed.m_edge3[axis][lane] = edge3[axis];
+                packed.m_normal[axis][lane] = normal[axis];
+                packed.m_invEdgeSqr[axis][lane] = (lengths[axis] > 0.0f ? 1.0f / lengths[axis] : 0.0f);
+            }
+            packed.m_invNormalSqr[lane] = (normalSqr > 0.0f ? 1.0f / normalSqr : 0.0f);
+        }
+        m_bvhNodes[nodeIndex].m_start = (int32_t)m_bvhLeafTris.size();
+        m_bvhNodes[nodeIndex].m_count = end - start;
+        m_bvhLeafTris.push_back(packed);
+        return nodeIndex;
+    }
+    int splitAxis = 0;//split at the median centroid along the longest axis, so the tree is balanced
+    if (centMax[1] - centMin[1] > centMax[splitAxis] - centMin[splitAxis]) splitAxis = 1;
+    if (centMax[2] - centMin[2] > centMax[splitAxis] - centMin[splitAxis]) splitAxis = 2;
+    int32_t mid = start + (end - start) / 2;
+    nth_element(triOrder.begin() + start, triOrder.begin() + mid, triOrder.begin() + end, CentroidLess(centroids.data(), splitAxis));
+    buildBVH(triOrder, start, mid, centroids, triBounds);//first child is always the next node
+    int32_t secondChild = buildBVH(triOrder, mid, end, centroids, triBounds);
+    m_bvhNodes[nodeIndex].m_start = secondChild;//don't hold a reference across the recursion, push_back may reallocate
+    m_bvhNodes[nodeIndex].m_count = 0;
+    return nodeIndex;
+}
+
+namespace
+{
+    inline float boxDistSqr(const float coord[3], const float minCoord[3], const float maxCoord[3])
+    {
+        float ret = 0.0f;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float diff = max(max(minCoord[axis] - coord[axis], coord[axis] - maxCoord[axis]), 0.0f);
+            ret += diff * diff;
+        }
+        return ret;
+    }
+}
+
+int32_t SignedDistanceHelperBase::closestTriangle(const float coord[3]) const
+{
+    if (m_bvhNodes.empty()) return -1;
+    const int STACK_SIZE = 64;//the tree is balanced, so this is far more than its depth
+    int32_t nodeStack[STACK_SIZE];
+    int stackSize = 0;
+    nodeStack[stackSize++] = 0;
+    float bestDistSqr = -1.0f;
+    int32_t bestTri = -1;
+    while (stackSize > 0)
+    {
+        int32_t curIndex = nodeStack[--stackSize];
+        const BVHNode& curNode = m_bvhNodes[curIndex];
+        if (bestTri != -1 && boxDistSqr(coord, curNode.m_min, curNode.m_max) >= bestDistSqr) continue;//a closer triangle was found since it was pushed
+        if (curNode.m_count > 0)
+        {
+            const PackedTris& packed = m_bvhLeafTris[curNode.m_start];
+            float distSqr[BVH_LEAF_SIZE];
+            for (int lane = 0; lane < BVH_LEAF_SIZE; ++lane)
+            {//closest point is in the face if the projection is inside all three edges, otherwise it is on the closest edge segment
+                float pa[3], pb[3], pc[3];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    pa[axis] = coord[axis] - packed.m_vert[axis][lane];
+                    pb[axis] = pa[axis] - packed.m_edge1[axis][lane];
+                    pc[axis] = pa[axis] - packed.m_edge2[axis][lane];
+                }
+                const float n[3] = { packed.m_normal[0][lane], packed.m_normal[1][lane], packed.m_normal[2][lane] };
+                const float e1[3] = { packed.m_edge1[0][lane], packed.m_edge1[1][lane], packed.m_edge1[2][lane] };
+                const float e2[3] = { packed.m_edge2[0][lane], packed.m_edge2[1][lane], packed.m_edge2[2][lane] };
+                const float e3[3] = { packed.m_edge3[0][lane], packed.m_edge3[1][lane], packed.m_edge3[2][lane] };
+                //(edge cross point) dot normal, for the edges 1->2, 2->3, 3->1
+                float side1 = (e1[1] * pa[2] - e1[2] * pa[1]) * n[0] + (e1[2] * pa[0] - e1[0] * pa[2]) * n[1] + (e1[0] * pa[1] - e1[1] * pa[0]) * n[2];
+                float side2 = (e3[1] * pb[2] - e3[2] * pb[1]) * n[0] + (e3[2] * pb[0] - e3[0] * pb[2]) * n[1] + (e3[0] * pb[1] - e3[1] * pb[0]) * n[2];
+                float side3 = (pc[1] * e2[2] - pc[2] * e2[1]) * n[0] + (pc[2] * e2[0] - pc[0] * e2[2]) * n[1] + (pc[0] * e2[1] - pc[1] * e2[0]) * n[2];
+                float planeDist = pa[0] * n[0] + pa[1] * n[1] + pa[2] * n[2];
+                float faceSqr = planeDist * planeDist * packed.m_invNormalSqr[lane];
+                float t1 = min(max((pa[0] * e1[0] + pa[1] * e1[1] + pa[2] * e1[2]) * packed.m_invEdgeSqr[0][lane], 0.0f), 1.0f);
+                float t2 = min(max((pa[0] * e2[0] + pa[1] * e2[1] + pa[2] * e2[2]) * packed.m_invEdgeSqr[1][lane], 0.0f), 1.0f);
+                float t3 = min(max((pb[0] * e3[0] + pb[1] * e3[1] + pb[2] * e3[2]) * packed.m_invEdgeSqr[2][lane], 0.0f), 1.0f);
+                float edgeSqr1 = 0.0f, edgeSqr2 = 0.0f, edgeSqr3 = 0.0f;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    float diff1 = pa[axis] - t1 * e1[axis], diff2 = pa[axis] - t2 * e2[axis], diff3 = pb[axis] - t3 * e3[axis];
+                    edgeSqr1 += diff1 * diff1;
+                    edgeSqr2 += diff2 * diff2;
+                    edgeSqr3 += diff3 * diff3;
+                }
+                bool inside = side1 >= 0.0f && side2 >= 0.0f && side3 >= 0.0f && packed.m_invNormalSqr[lane] > 0.0f;
+                distSqr[lane] = inside ? faceSqr : min(min(edgeSqr1, edgeSqr2), edgeSqr3);
+            }
+            for (int lane = 0; lane < curNode.m_count; ++lane)
+            {
+                if (bestTri == -1 || distSqr[lane] < bestDistSqr)
+                {
+                    bestDistSqr = distSqr[lane];
+                    bestTri = packed.m_tri[lane];
+                }
+            }
+        } else {
+            int32_t firstChild = curIndex + 1;
+            int32_t secondChild = curNode.m_start;
+            float firstDist = boxDistSqr(coord, m_bvhNodes[firstChild].m_min, m_bvhNodes[firstChild].m_max);
+            float secondDist = boxDistSqr(coord, m_bvhNodes[secondChild].m_min, m_bvhNodes[secondChild].m_max);
+            if (secondDist < firstDist)
+            {
+                swap(firstChild, secondChild);
+                swap(firstDist, secondDist);
+            }
+            CaretAssert(stackSize + 2 <= STACK_SIZE);
+            if (bestTri == -1 || secondDist < bestDistSqr) nodeStack[stackSize++] = secondChild;//push the farther one first, so the nearer one is searched first
+            if (bestTri == -1 || firstDist < bestDistSqr) nodeStack[stackSize++] = firstChild;
+        }
+    }
+    return bestTri;
+}
+
 const float* SignedDistanceHelperBase::getCoordinate(const int32_t nodeIndex) const
 {
     CaretAssert(nodeIndex >= 0 && nodeIndex < m_numNodes);
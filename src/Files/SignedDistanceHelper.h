@@ -50,13 +50,34 @@ namespace caret {
         };
         static const int NUM_TRIS_TO_TEST = 50;//test for whether to split leaf at this number
         static const int NUM_TRIS_TEST_INCR = 50;//and again at further multiples of this
-        CaretPointer<Oct<TriVector> > m_indexRoot;
+        static const int BVH_LEAF_SIZE = 4;//triangles per BVH leaf, and the width of the packed triangle arrays
+        struct BVHNode
+        {//leaves have m_count > 0 and use packed triangles m_start, inner nodes have m_count == 0, first child is the next node, second child is m_start
+            float m_min[3], m_max[3];
+            int32_t m_start, m_count;
+        };
+        struct PackedTris
+        {//the triangles of one leaf as structure of arrays, so the distance to all of them is one loop with no branches
+            float m_vert[3][BVH_LEAF_SIZE];//first vertex
+            float m_edge1[3][BVH_LEAF_SIZE];//second minus first
+            float m_edge2[3][BVH_LEAF_SIZE];//third minus first
+            float m_edge3[3][BVH_LEAF_SIZE];//third minus second
+            float m_normal[3][BVH_LEAF_SIZE];//edge1 cross edge2, not normalized
+            float m_invEdgeSqr[3][BVH_LEAF_SIZE];//reciprocal squared lengths of edge1, edge2, edge3, 0 when degenerate
+            float m_invNormalSqr[BVH_LEAF_SIZE];//0 when degenerate
+            int32_t m_tri[BVH_LEAF_SIZE];
+        };
+        CaretPointer<Oct<TriVector> > m_indexRoot;//used for ray and segment tests
+        std::vector<BVHNode> m_bvhNodes;//used for closest triangle
+        std::vector<PackedTris> m_bvhLeafTris;
         int32_t m_numTris, m_numNodes;
         std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
         std::vector<int32_t> m_triangleList;
         CaretPointer<TopologyHelper> m_topoHelp;
         SignedDistanceHelperBase();
         void addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3]);
+        int32_t buildBVH(std::vector<int32_t>& triOrder, const int32_t& start, const int32_t& end, const std::vector<float>& centroids, const std::vector<float>& triBounds);
+        int32_t closestTriangle(const float coord[3]) const;//-1 if no triangles
         const float* getCoordinate(const int32_t nodeIndex) const;//make these public? probably don't want them to be widely used, that is what SurfaceFile is for (but we don't want to store a SurfaceFile pointer)
         const int32_t* getTriangle(const int32_t tileIndex) const;
     public:
@@ -104,6 +125,7 @@ namespace caret {
             Vector3D tempPoint;
         };
         float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo);
+        float closestPoint(const float coord[3], ClosestPointInfo& myInfo);
         int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding);
         bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis);
     public:
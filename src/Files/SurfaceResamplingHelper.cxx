@@ -21,24 +21,60 @@
 #include "SurfaceResamplingHelper.h"
 
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "Vector3D.h"
+#include "WeightsCacheFile.h"
 
+#include <QCryptographicHash>
+#include <QDir>
+
+#include <cstring>
 #include <set>
 #include <map>
 
 using namespace std;
 using namespace caret;
 
+namespace
+{//weights cache file arrays: CSR row offsets as int64, then (vertex as int32, weight as float32) pairs
+    const char WEIGHTS_MAGIC[8] = { 'w', 'b', 'r', 'e', 's', 'm', 'p', 'l' };
+    const int32_t WEIGHTS_VERSION = 1;
+    
+    void addSurfaceToHash(QCryptographicHash& myHash, const SurfaceFile* mySurf)
+    {
+        int numNodes = mySurf->getNumberOfNodes(), numTiles = mySurf->getNumberOfTriangles();
+        myHash.addData((const char*)&numNodes, sizeof(int));
+        myHash.addData((const char*)mySurf->getCoordinateData(), numNodes * 3 * sizeof(float));
+        myHash.addData((const char*)&numTiles, sizeof(int));
+        for (int i = 0; i < numTiles; ++i)
+        {
+            myHash.addData((const char*)mySurf->getTriangle(i), 3 * sizeof(int32_t));
+        }
+    }
+}
+
 SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
-                                                 const float* currentAreas, const float* newAreas, const float* currentRoi)
+                                                 const float* currentAreas, const float* newAreas, const float* currentRoi, const AString& cacheDirectory)
 {
     if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    m_numCurrentNodes = currentSphere->getNumberOfNodes();
+    AString cacheKey, cacheFileName;
+    if (cacheDirectory != "")
+    {
+        cacheKey = computeCacheKey(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi);
+        cacheFileName = cacheDirectory + "/" + cacheKey + ".wbweights";
+        if (readWeightsFile(cacheFileName, cacheKey, m_numCurrentNodes, newSphere->getNumberOfNodes()))
+        {
+            return;
+        }
+    }
     SurfaceFile currentSphereMod, newSphereMod;
     changeRadius(100.0f, currentSphere, &currentSphereMod);
     changeRadius(100.0f, newSphere, &newSphereMod);
@@ -53,6 +89,77 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
             computeWeightsBarycentric(&currentSphereMod, &newSphereMod, currentRoi);
             break;
     }
+    if (cacheDirectory != "")
+    {
+        try
+        {
+            writeWeightsFile(cacheFileName, cacheKey);
+        } catch (CaretException& e) {//failing to save the cache shouldn't stop the resampling
+            CaretLogWarning("failed to save resampling weights to cache: " + e.whatString());
+        }
+    }
+}
+
+AString SurfaceResamplingHelper::computeCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                                 const float* currentAreas, const float* newAreas, const float* currentRoi)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    QByteArray methodName = SurfaceResamplingMethodEnum::toName(myMethod).toUtf8();
+    myHash.addData(methodName);
+    myHash.addData((const char*)&WEIGHTS_VERSION, sizeof(int32_t));//don't reuse files from a different weight computation
+    addSurfaceToHash(myHash, currentSphere);
+    addSurfaceToHash(myHash, newSphere);
+    int numCurNodes = currentSphere->getNumberOfNodes(), numNewNodes = newSphere->getNumberOfNodes();
+    char flags[3] = { (char)(currentAreas != NULL), (char)(newAreas != NULL), (char)(currentRoi != NULL) };
+    myHash.addData(flags, 3);
+    if (currentAreas != NULL) myHash.addData((const char*)currentAreas, numCurNodes * sizeof(float));
+    if (newAreas != NULL) myHash.addData((const char*)newAreas, numNewNodes * sizeof(float));
+    if (currentRoi != NULL) myHash.addData((const char*)currentRoi, numCurNodes * sizeof(float));
+    return QString(myHash.result().toHex());
+}
+
+bool SurfaceResamplingHelper::readWeightsFile(const AString& fileName, const AString& key, const int& numCurrentNodes, const int& numNewNodes)
+{
+    try
+    {
+        WeightsCacheFile myFile;
+        if (!myFile.open(fileName, WEIGHTS_MAGIC, WEIGHTS_VERSION, key, numNewNodes)) return false;
+        int64_t numElems = myFile.getNumberOfElements();
+        vector<int64_t> offsetStorage;
+        const int64_t* offsets = myFile.nextArray(numNewNodes + 1, offsetStorage);
+        myFile.checkOffsets(offsets);
+        const WeightElem* elems = myFile.nextArray(numElems, m_storagechunk);//offsets are 8 bytes each, so this is aligned
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if (elems[i].node < 0 || elems[i].node >= numCurrentNodes) throw CaretException("vertex index out of range");
+        }
+        m_weights = CaretArray<const WeightElem*>(numNewNodes + 1);
+        for (int64_t i = 0; i <= numNewNodes; ++i)
+        {
+            m_weights[i] = elems + offsets[i];
+        }
+        m_mappedFile = myFile.getMappedFile();
+    } catch (CaretException& e) {//bad cache file, not fatal
+        CaretLogWarning("error reading resampling weights file '" + fileName + "', recomputing: " + e.whatString());
+        m_weights = CaretArray<const WeightElem*>();
+        m_storagechunk = CaretArray<WeightElem>();
+        return false;
+    }
+    return true;
+}
+
+void SurfaceResamplingHelper::writeWeightsFile(const AString& fileName, const AString& key) const
+{
+    int64_t numNodes = (int64_t)m_weights.size() - 1, numElems = m_weights[numNodes] - m_weights[0];
+    vector<int64_t> offsets(numNodes + 1);
+    for (int64_t i = 0; i <= numNodes; ++i)
+    {
+        offsets[i] = m_weights[i] - m_weights[0];
+    }
+    vector<WeightsCacheFile::Array> arrays;
+    arrays.push_back(WeightsCacheFile::Array(offsets.data(), (numNodes + 1) * sizeof(int64_t)));
+    arrays.push_back(WeightsCacheFile::Array(m_weights[0], numElems * sizeof(WeightElem)));
+    WeightsCacheFile::writeFile(fileName, WEIGHTS_MAGIC, WEIGHTS_VERSION, key, numNodes, numElems, arrays);
 }
 
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
@@ -61,7 +168,7 @@ void SurfaceResamplingHelper::resampleNormal(const float* input, float* output,
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1], *elem = m_weights[i];
+        const WeightElem* end = m_weights[i + 1], *elem = m_weights[i];
         if (elem != end)
         {
             double accum = 0.0;
@@ -76,6 +183,68 @@ void SurfaceResamplingHelper::resampleNormal(const float* input, float* output,
     }
 }
 
+void SurfaceResamplingHelper::resampleNormal(const float* const* inputs, float* const* outputs, const int& numMaps, const float& invalidVal) const
+{
+    const int MAP_BLOCK = 16;//interleave this many maps, so the inner loop is contiguous and each weight is used MAP_BLOCK times per load
+    int numNodes = (int)m_weights.size() - 1;
+    if (numNodes < 1 || numMaps < 1) return;
+    vector<float> interleavedIn((int64_t)m_numCurrentNodes * MAP_BLOCK, 0.0f), interleavedOut((int64_t)numNodes * MAP_BLOCK);
+    for (int mapStart = 0; mapStart < numMaps; mapStart += MAP_BLOCK)
+    {
+        int blockMaps = min(MAP_BLOCK, numMaps - mapStart);
+#pragma omp CARET_PARFOR schedule(static)
+        for (int node = 0; node < m_numCurrentNodes; ++node)
+        {
+            float* dest = interleavedIn.data() + (int64_t)node * MAP_BLOCK;
+            for (int m = 0; m < blockMaps; ++m)
+            {
+                dest[m] = inputs[mapStart + m][node];
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+        for (int i = 0; i < numNodes; ++i)
+        {
+            float* dest = interleavedOut.data() + (int64_t)i * MAP_BLOCK;
+            const WeightElem* end = m_weights[i + 1], *elem = m_weights[i];
+            if (elem != end)
+            {
+                double accum[MAP_BLOCK];
+                for (int m = 0; m < MAP_BLOCK; ++m)
+                {
+                    accum[m] = 0.0;
+                }
+                for (; elem != end; ++elem)
+                {
+                    const float* source = interleavedIn.data() + (int64_t)elem->node * MAP_BLOCK;
+                    const float weight = elem->weight;
+                    for (int m = 0; m < MAP_BLOCK; ++m)//fixed trip count so it vectorizes, lanes past blockMaps are ignored
+                    {
+                        accum[m] += source[m] * weight;//same rounding as the single map version
+                    }
+                }
+                for (int m = 0; m < MAP_BLOCK; ++m)
+                {
+                    dest[m] = accum[m];
+                }
+            } else {
+                for (int m = 0; m < MAP_BLOCK; ++m)
+                {
+                    dest[m] = invalidVal;
+                }
+            }
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int i = 0; i < numNodes; ++i)
+        {
+            const float* source = interleavedOut.data() + (int64_t)i * MAP_BLOCK;
+            for (int m = 0; m < blockMaps; ++m)
+            {
+                outputs[mapStart + m][i] = source[m];
+            }
+        }
+    }
+}
+
 void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output) const
 {
     int numNodes = (int)m_weights.size() - 1;
@@ -83,8 +252,8 @@ void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output)
     for (int i = 0; i < numNodes; ++i)
     {
         double tempvec[3] = { 0.0, 0.0, 0.0 };
-        WeightElem* end = m_weights[i + 1];
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        const WeightElem* end = m_weights[i + 1];
+        for (const WeightElem* elem = m_weights[i]; elem != end; ++elem)
         {
             const float* coord = input + elem->node * 3;
             tempvec[0] += coord[0] * elem->weight;//don't need to divide afterwards, because the weights already sum to 1
@@ -107,8 +276,8 @@ void SurfaceResamplingHelper::resamplePopular(const int32_t* input, int32_t* out
         map<int32_t, float> accum;
         float maxweight = -1.0f;
         int32_t bestlabel = invalidVal;
-        WeightElem* end = m_weights[i + 1];
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        const WeightElem* end = m_weights[i + 1];
+        for (const WeightElem* elem = m_weights[i]; elem != end; ++elem)
         {
             int32_t label = input[elem->node];
             map<int, float>::iterator iter = accum.find(label);
@@ -139,10 +308,10 @@ void SurfaceResamplingHelper::resampleLargest(const float* input, float* output,
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1];
+        const WeightElem* end = m_weights[i + 1];
         float largest = -1.0f;
         int largestNode = -1;
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        for (const WeightElem* elem = m_weights[i]; elem != end; ++elem)
         {
             if (elem->weight > largest)
             {
@@ -165,10 +334,10 @@ void SurfaceResamplingHelper::resampleLargest(const int32_t* input, int32_t* out
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1];
+        const WeightElem* end = m_weights[i + 1];
         float largest = -1.0f;
         int largestNode = -1;
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        for (const WeightElem* elem = m_weights[i]; elem != end; ++elem)
         {
             if (elem->weight > largest)
             {
@@ -532,7 +701,7 @@ void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& wei
 {
     int compactsize = 0;
     int numNodes = (int)weights.size();
-    m_weights = CaretArray<WeightElem*>(numNodes + 1);//include a "one-after" pointer
+    m_weights = CaretArray<const WeightElem*>(numNodes + 1);//include a "one-after" pointer
     for (int i = 0; i < numNodes; ++i)
     {
         compactsize += (int)weights[i].size();
@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include "AString.h"
+#include "CaretBinaryFile.h"
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
@@ -41,19 +43,28 @@ namespace caret {
             WeightElem(const int& nodeIn, const float& weightIn) : node(nodeIn), weight(weightIn) { }
         };
         CaretArray<WeightElem> m_storagechunk;
-        CaretArray<WeightElem*> m_weights;
+        CaretArray<const WeightElem*> m_weights;
+        CaretPointer<CaretBinaryFile> m_mappedFile;//when the weights were loaded from a mapped cache file, m_weights points into it
+        int m_numCurrentNodes;
         static bool checkSphere(const SurfaceFile* surface);
         static void changeRadius(const float& radius, const SurfaceFile* input, SurfaceFile* output);
         void computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas, const float* currentRoi);
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
         static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
+        static AString computeCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                       const float* currentAreas, const float* newAreas, const float* currentRoi);
+        bool readWeightsFile(const AString& fileName, const AString& key, const int& numCurrentNodes, const int& numNewNodes);//returns false if the file is missing or doesn't match
+        void writeWeightsFile(const AString& fileName, const AString& key) const;
     public:
-        SurfaceResamplingHelper() { }
+        SurfaceResamplingHelper() { m_numCurrentNodes = 0; }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
-                                const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL);
+                                const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL,
+                                const AString& cacheDirectory = "");//if cacheDirectory is given, weights are loaded from or saved to a file there, named by a hash of the inputs
         ///resample real-valued data by means of weights
         void resampleNormal(const float* input, float* output, const float& invalidVal = 0.0f) const;
+        ///resample many maps at once, reads the weights once per block of maps instead of once per map
+        void resampleNormal(const float* const* inputs, float* const* outputs, const int& numMaps, const float& invalidVal = 0.0f) const;
         ///resample 3D coordinate data by means of weights
         void resample3DCoord(const float* input, float* output) const;
         ///resample label-like data according to which value gets the largest weight sum
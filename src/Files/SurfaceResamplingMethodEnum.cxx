@@ -23,9 +23,15 @@
 #include "SurfaceResamplingMethodEnum.h"
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 std::vector<SurfaceResamplingMethodEnum> SurfaceResamplingMethodEnum::enumData;
 bool SurfaceResamplingMethodEnum::initializedFlag = false;
 
@@ -77,7 +83,10 @@ SurfaceResamplingMethodEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SurfaceResamplingMethodEnum(ADAP_BARY_AREA, 
                                     0, 
@@ -89,6 +98,7 @@ SurfaceResamplingMethodEnum::initialize()
                                     "BARYCENTRIC", 
                                     "barycentric"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
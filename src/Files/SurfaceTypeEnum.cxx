@@ -23,8 +23,15 @@
 #include "SurfaceTypeEnum.h"
 #undef __SURFACE_TYPE_ENUM_DECLARE__
 
+#include "CaretMutex.h"
+
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -61,7 +68,10 @@ SurfaceTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SurfaceTypeEnum(UNKNOWN, 
                                        "UNKNOWN", 
@@ -103,6 +113,7 @@ SurfaceTypeEnum::initialize()
                                        "HULL", 
                                        "Hull",
                                        "Hull"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -403,7 +414,10 @@ SecondarySurfaceTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SecondarySurfaceTypeEnum(INVALID, 
                                        "INVALID", 
@@ -421,6 +435,7 @@ SecondarySurfaceTypeEnum::initialize()
                                        "PIAL", 
                                        "Pial",
                                        "Pial"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -26,6 +26,7 @@
 
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretTemporaryFile.h"
 #include "ChartDataCartesian.h"
 #include "ChartDataSource.h"
@@ -50,6 +51,11 @@ using namespace std;
 const float VolumeFile::INVALID_INTERP_VALUE = 0.0f;//we may want NaN or something more obvious
 bool VolumeFile::s_voxelColoringEnabled = true;
 
+namespace
+{
+    const int64_t ALL_SPLINES_MAX_BYTES = ((int64_t)1) << 30;//validateAllSplines does nothing for volumes larger than this, per-frame splines are computed and freed as they are used instead
+}
+
 /**
  * Static method that sets the status of voxel coloring.  Coloring may take
  * time and is almost never needed during command line operations (wb_command).
@@ -425,6 +431,157 @@ float VolumeFile::interpolateValue(const float coordIn1, const float coordIn2, c
     return INVALID_INTERP_VALUE;
 }
 
+void VolumeFile::prepareInterpolation(const float* coordsIn, const int64_t& numCoords, InterpType interp, InterpolationStencils& stencilsOut) const
+{
+    stencilsOut.m_interp = interp;
+    stencilsOut.m_numCoords = numCoords;
+    stencilsOut.m_valid.resize(numCoords);
+    stencilsOut.m_baseIndex.clear();
+    stencilsOut.m_weights.clear();
+    stencilsOut.m_splineWeights.clear();
+    switch (interp)
+    {
+        case CUBIC:
+            stencilsOut.m_splineWeights.resize(numCoords);
+            break;
+        case TRILINEAR:
+            stencilsOut.m_weights.resize(numCoords * 3);
+            stencilsOut.m_baseIndex.resize(numCoords);
+            break;
+        case ENCLOSING_VOXEL:
+            stencilsOut.m_baseIndex.resize(numCoords);
+            break;
+    }
+    const int64_t frameDims[3] = { m_dimensions[0], m_dimensions[1], m_dimensions[2] };
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+    for (int64_t i = 0; i < numCoords; ++i)
+    {
+        const float* coord = coordsIn + i * 3;
+        switch (interp)
+        {
+            case CUBIC:
+            {
+                float indexSpace[3];
+                spaceToIndex(coord, indexSpace);
+                int64_t ind1low = floor(indexSpace[0]);
+                int64_t ind2low = floor(indexSpace[1]);
+                int64_t ind3low = floor(indexSpace[2]);
+                bool valid = indexValid(ind1low, ind2low, ind3low) && indexValid(ind1low + 1, ind2low + 1, ind3low + 1);
+                stencilsOut.m_valid[i] = valid;
+                if (valid)
+                {
+                    VolumeSpline::computeSampleWeights(indexSpace[0], indexSpace[1], indexSpace[2], frameDims, stencilsOut.m_splineWeights[i]);
+                } else {
+                    stencilsOut.m_splineWeights[i].m_valid = false;
+                }
+                break;
+            }
+            case TRILINEAR:
+            {
+                float index1, index2, index3;
+                spaceToIndex(coord, index1, index2, index3);
+                int64_t ind1low = floor(index1);
+                int64_t ind2low = floor(index2);
+                int64_t ind3low = floor(index3);
+                bool valid = indexValid(ind1low, ind2low, ind3low) && indexValid(ind1low + 1, ind2low + 1, ind3low + 1);
+                stencilsOut.m_valid[i] = valid;
+                if (valid)
+                {
+                    stencilsOut.m_baseIndex[i] = ind1low + frameDims[0] * (ind2low + frameDims[1] * ind3low);
+                    stencilsOut.m_weights[i * 3] = index1 - ind1low;
+                    stencilsOut.m_weights[i * 3 + 1] = index2 - ind2low;
+                    stencilsOut.m_weights[i * 3 + 2] = index3 - ind3low;
+                }
+                break;
+            }
+            case ENCLOSING_VOXEL:
+            {
+                int64_t index1, index2, index3;
+                enclosingVoxel(coord, index1, index2, index3);
+                bool valid = indexValid(index1, index2, index3);
+                stencilsOut.m_valid[i] = valid;
+                if (valid)
+                {
+                    stencilsOut.m_baseIndex[i] = index1 + frameDims[0] * (index2 + frameDims[1] * index3);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void VolumeFile::interpolateFrame(const InterpolationStencils& stencils, float* valuesOut, const int64_t brickIndex, const int64_t component) const
+{
+    CaretAssert(brickIndex >= 0 && brickIndex < m_dimensions[3]);
+    CaretAssert(component >= 0 && component < m_dimensions[4]);
+    const int64_t numCoords = stencils.m_numCoords;
+    const float* frame = getFrame(brickIndex, component);
+    const int64_t jstep = m_dimensions[0], kstep = m_dimensions[0] * m_dimensions[1];
+    switch (stencils.m_interp)
+    {
+        case CUBIC:
+        {
+            validateSpline(brickIndex, component);//deconvolve in parallel before we start our own parallel loop
+            const VolumeSpline& spline = m_frameSplines[component * m_dimensions[3] + brickIndex];
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+            for (int64_t i = 0; i < numCoords; ++i)
+            {
+                if (stencils.m_valid[i])
+                {
+                    valuesOut[i] = spline.sample(stencils.m_splineWeights[i]);
+                } else {
+                    valuesOut[i] = INVALID_INTERP_VALUE;
+                }
+            }
+            break;
+        }
+        case TRILINEAR:
+        {
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+            for (int64_t i = 0; i < numCoords; ++i)
+            {
+                if (!stencils.m_valid[i])
+                {
+                    valuesOut[i] = INVALID_INTERP_VALUE;
+                    continue;
+                }
+                const float* base = frame + stencils.m_baseIndex[i];
+                const float* weights = stencils.m_weights.data() + i * 3;
+                float xhighWeight = weights[0];
+                float xlowWeight = 1.0f - xhighWeight;
+                float xinterp[2][2];//same arithmetic as interpolateValue, so results are identical
+                xinterp[0][0] = xlowWeight * base[0] + xhighWeight * base[1];
+                xinterp[1][0] = xlowWeight * base[jstep] + xhighWeight * base[jstep + 1];
+                xinterp[0][1] = xlowWeight * base[kstep] + xhighWeight * base[kstep + 1];
+                xinterp[1][1] = xlowWeight * base[kstep + jstep] + xhighWeight * base[kstep + jstep + 1];
+                float yhighWeight = weights[1];
+                float ylowWeight = 1.0f - yhighWeight;
+                float yinterp[2];
+                yinterp[0] = ylowWeight * xinterp[0][0] + yhighWeight * xinterp[1][0];
+                yinterp[1] = ylowWeight * xinterp[0][1] + yhighWeight * xinterp[1][1];
+                float zhighWeight = weights[2];
+                float zlowWeight = 1.0f - zhighWeight;
+                valuesOut[i] = zlowWeight * yinterp[0] + zhighWeight * yinterp[1];
+            }
+            break;
+        }
+        case ENCLOSING_VOXEL:
+        {
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+            for (int64_t i = 0; i < numCoords; ++i)
+            {
+                if (stencils.m_valid[i])
+                {
+                    valuesOut[i] = frame[stencils.m_baseIndex[i]];
+                } else {
+                    valuesOut[i] = INVALID_INTERP_VALUE;
+                }
+            }
+            break;
+        }
+    }
+}
+
 void VolumeFile::validateSpline(const int64_t brickIndex, const int64_t component) const
 {
     CaretAssert(brickIndex >= 0 && brickIndex < m_dimensions[3]);//function is public, so check inputs
@@ -435,7 +592,7 @@ void VolumeFile::validateSpline(const int64_t brickIndex, const int64_t componen
         CaretMutexLocker locked(&m_splineMutex);//prevent concurrent modify access to spline state
         if (!m_splinesValid)//double check
         {
-            m_frameSplineValid = vector<bool>(numFrames, false);
+            m_frameSplineValid = vector<char>(numFrames, 0);
             m_frameSplines = vector<VolumeSpline>(numFrames);//release the old spline memory
             m_splinesValid = true;//the only purpose of this flag is for setModified to be fast, don't worry about it becoming false again before the below happens
         }
@@ -452,7 +609,56 @@ void VolumeFile::validateSpline(const int64_t brickIndex, const int64_t componen
             {
                 CaretLogWarning("ignored non-numeric input value when calculating cubic splines in volume '" + getFileName() + "', frame #" + AString::number(brickIndex + 1));
             }
-            m_frameSplineValid[whichFrame] = true;
+            m_frameSplineValid[whichFrame] = 1;
+        }
+    }
+}
+
+void VolumeFile::validateAllSplines() const
+{
+    int64_t numFrames = m_dimensions[3] * m_dimensions[4];
+    if (numFrames * m_dimensions[0] * m_dimensions[1] * m_dimensions[2] * (int64_t)sizeof(float) > ALL_SPLINES_MAX_BYTES) return;
+    vector<int64_t> toCompute;
+    {
+        CaretMutexLocker locked(&m_splineMutex);//prevent concurrent modify access to spline state
+        if (!m_splinesValid)
+        {
+            m_frameSplineValid = vector<char>(numFrames, 0);
+            m_frameSplines = vector<VolumeSpline>(numFrames);//release the old spline memory
+            m_splinesValid = true;
+        }
+        for (int64_t frame = 0; frame < numFrames; ++frame)
+        {
+            if (!m_frameSplineValid[frame]) toCompute.push_back(frame);
+        }
+    }
+    int64_t numToCompute = (int64_t)toCompute.size();
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    if (numToCompute < numThreads)
+    {//too few frames to keep every thread busy, let each frame use all threads
+        for (int64_t i = 0; i < numToCompute; ++i)
+        {
+            validateSpline(toCompute[i] % m_dimensions[3], toCompute[i] / m_dimensions[3]);
+        }
+        return;
+    }
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numToCompute; ++i)
+    {//one frame per thread, the spline constructor doesn't nest its parallel loops
+        int64_t brickIndex = toCompute[i] % m_dimensions[3], component = toCompute[i] / m_dimensions[3];
+        VolumeSpline newSpline(getFrame(brickIndex, component), m_dimensions);
+        CaretMutexLocker locked(&m_splineMutex);
+        if (!m_frameSplineValid[toCompute[i]])//validateSpline may have gotten it first
+        {
+            m_frameSplines[toCompute[i]] = newSpline;
+            if (newSpline.ignoredNonNumeric())
+            {
+                CaretLogWarning("ignored non-numeric input value when calculating cubic splines in volume '" + getFileName() + "', frame #" + AString::number(brickIndex + 1));
+            }
+            m_frameSplineValid[toCompute[i]] = 1;
         }
     }
 }
@@ -467,7 +673,7 @@ void VolumeFile::freeSpline(const int64_t brickIndex, const int64_t component) c
         CaretMutexLocker locked(&m_splineMutex);//prevent concurrent modify access to spline state
         if (!m_splinesValid)//double check
         {
-            m_frameSplineValid = vector<bool>(numFrames, false);
+            m_frameSplineValid = vector<char>(numFrames, 0);
             m_frameSplines = vector<VolumeSpline>(numFrames);//release the old spline memory
             m_splinesValid = true;//the only purpose of this flag is for setModified to be fast
         }
@@ -481,7 +687,7 @@ void VolumeFile::freeSpline(const int64_t brickIndex, const int64_t component) c
         if (m_frameSplineValid[whichFrame])//double check
         {
             m_frameSplines[whichFrame] = VolumeSpline();
-            m_frameSplineValid[whichFrame] = false;
+            m_frameSplineValid[whichFrame] = 0;
         }
     }
 }
@@ -592,7 +798,7 @@ void VolumeFile::updateCaretExtension()
 void VolumeFile::validateMembers()
 {
     m_dataRangeValid = false;
-    m_frameSplineValid = vector<bool>(m_dimensions[3] * m_dimensions[4], false);
+    m_frameSplineValid = vector<char>(m_dimensions[3] * m_dimensions[4], 0);
     m_frameSplines = vector<VolumeSpline>(m_dimensions[3] * m_dimensions[4]);//release any previous spline memory
     m_splinesValid = true;//this now indicates only if they need to all be recalculated - the frame vectors will always have the correct length
     int numMaps = getNumberOfMaps();
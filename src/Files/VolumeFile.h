@@ -34,13 +34,13 @@
 #include "DescriptiveStatistics.h"
 #include "PaletteFile.h"
 #include "VolumeFileVoxelColorizer.h"
+#include "VolumeSpline.h"
 #include "VoxelIJK.h"
 
 namespace caret {
     
     class GroupAndNameHierarchyModel;
     class VolumeFileVoxelColorizer;
-    class VolumeSpline;
     
     class VolumeFile : public VolumeBase, public CaretMappableDataFile, public ChartableBrainordinateInterface
     {
@@ -79,7 +79,7 @@ namespace caret {
         
         mutable bool m_splinesValid;
         
-        mutable std::vector<bool> m_frameSplineValid;
+        mutable std::vector<char> m_frameSplineValid;//not vector<bool>, so that setting one frame doesn't touch its neighbors
         
         mutable std::vector<VolumeSpline> m_frameSplines;
         
@@ -115,6 +115,17 @@ namespace caret {
         
         const static float INVALID_INTERP_VALUE;
         
+        ///voxel indices and weights for a set of coordinates, from prepareInterpolation, for use with interpolateFrame on any frame of the same volume space
+        struct InterpolationStencils
+        {
+            InterpType m_interp;
+            int64_t m_numCoords;
+            std::vector<char> m_valid;//false where interpolateValue would give INVALID_INTERP_VALUE
+            std::vector<int64_t> m_baseIndex;//ENCLOSING_VOXEL and TRILINEAR: index within the frame of the (low) voxel
+            std::vector<float> m_weights;//TRILINEAR: 3 high-side weights per coordinate
+            std::vector<VolumeSpline::SampleWeights> m_splineWeights;//CUBIC
+        };
+        
         /** Enables coloring.  Coloring is almost always not needed for command line operations */
         static bool s_voxelColoringEnabled;
         
@@ -141,10 +152,19 @@ namespace caret {
         void validateSpline(const int64_t brickIndex = 0, const int64_t component = 0) const;
 
         void freeSpline(const int64_t brickIndex = 0, const int64_t component = 0) const;
+        
+        ///compute the splines of all frames now, in parallel across frames when there are enough of them, does nothing if they would take too much memory (as much as the data)
+        void validateAllSplines() const;
 
         float interpolateValue(const float* coordIn, InterpType interp = TRILINEAR, bool* validOut = NULL, const int64_t brickIndex = 0, const int64_t component = 0) const;
 
         float interpolateValue(const float coordIn1, const float coordIn2, const float coordIn3, InterpType interp = TRILINEAR, bool* validOut = NULL, const int64_t brickIndex = 0, const int64_t component = 0) const;
+        
+        ///compute indices and weights for interpolating many coordinates (xyz triples) once, to be applied to as many frames as needed
+        void prepareInterpolation(const float* coordsIn, const int64_t& numCoords, InterpType interp, InterpolationStencils& stencilsOut) const;
+        
+        ///same results as interpolateValue on each coordinate given to prepareInterpolation, parallel over coordinates, for CUBIC the spline is validated but not freed
+        void interpolateFrame(const InterpolationStencils& stencils, float* valuesOut, const int64_t brickIndex = 0, const int64_t component = 0) const;
 
         ///returns true if volume space matches in spatial dimensions and sform
         bool matchesVolumeSpace(const VolumeFile* right) const;
@@ -44,190 +44,136 @@ VolumeSpline::VolumeSpline(const float* frame, const int64_t framedims[3])
     m_dims[0] = framedims[0];
     m_dims[1] = framedims[1];
     m_dims[2] = framedims[2];
-    m_deconv = CaretArray<float>(m_dims[0] * m_dims[1] * m_dims[2]);
-    CaretArray<float> scratchArray(m_dims[0] * max(m_dims[1], m_dims[2])), deconvScratch(max(m_dims[0], max(m_dims[1], m_dims[2])));//allocate as much as we will need, even if we don't use it all yet
+    const int64_t zstep = m_dims[0] * m_dims[1], numRows = m_dims[1] * m_dims[2];
+    m_deconv = CaretArray<float>(zstep * m_dims[2]);
+    CaretArray<float> deconvScratch(max(m_dims[0], max(m_dims[1], m_dims[2])));
     predeconvolve(deconvScratch, m_dims[0]);
-    for (int k = 0; k < m_dims[2]; ++k)
+    float* deconvData = m_deconv.getArray();
+#pragma omp CARET_PAR
     {
-        int64_t index = m_dims[0] * m_dims[1] * k;
-        int64_t index2 = 0;
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            for (int i = 0; i < m_dims[0]; ++i)
+        bool ignored = false;
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int64_t row = 0; row < numRows; ++row)
+        {//i-rows are contiguous, filter them in place as we copy them in
+            const float* inRow = frame + row * m_dims[0];
+            float* outRow = deconvData + row * m_dims[0];
+            for (int64_t i = 0; i < m_dims[0]; ++i)
             {
-                float tempf = frame[index];
+                float tempf = inRow[i];
                 if (MathFunctions::isNumeric(tempf))
                 {
-                    scratchArray[index2] = tempf;
+                    outRow[i] = tempf;
                 } else {
-                    scratchArray[index2] = 0.0f;
-                    m_ignoredNonNumeric = true;
+                    outRow[i] = 0.0f;
+                    ignored = true;
                 }
-                ++index;
-                ++index2;
             }
+            deconvolve(outRow, deconvScratch, m_dims[0]);
         }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int j = 0; j < m_dims[1]; ++j)
+        if (ignored)
         {
-            int64_t privIndex = j * m_dims[0];
-            deconvolve(scratchArray.getArray() + privIndex, deconvScratch, m_dims[0]);
-        }
-        index = m_dims[0] * m_dims[1] * k;
-        index2 = 0;
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                m_deconv[index] = scratchArray[index2];
-                ++index;
-                ++index2;
-            }
+#pragma omp critical
+            m_ignoredNonNumeric = true;
         }
     }
     predeconvolve(deconvScratch, m_dims[1]);
-    for (int k = 0; k < m_dims[2]; ++k)
-    {
-        int64_t indexbase = k * m_dims[1] * m_dims[0];
-        int64_t index = indexbase;
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            int64_t index2 = j;
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                scratchArray[index2] = m_deconv[index];//read linearly from frame while writing transposed should be slightly faster, because cache can stay dirty?
-                index2 += m_dims[1];
-                ++index;
-            }
-        }
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t privindex = i * m_dims[1];
-            deconvolve(scratchArray.getArray() + privindex, deconvScratch, m_dims[1]);
-        }
-        index = 0;
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t index2 = i + indexbase;
-            for (int j = 0; j < m_dims[1]; ++j)
-            {
-                m_deconv[index2] = scratchArray[index];//even though scratch should be cached now, if writing to frame collides, reading linearly should give better behavior
-                ++index;
-                index2 += m_dims[0];
-            }
-        }
+    for (int64_t k = 0; k < m_dims[2]; ++k)
+    {//filter all j-lines of a slice together, so the inner loop runs along contiguous i
+        deconvolveLines(deconvData + k * zstep, deconvScratch, m_dims[1], m_dims[0], m_dims[0]);
     }
     predeconvolve(deconvScratch, m_dims[2]);
-    for (int j = 0; j < m_dims[1]; ++j)//finally, use a similar strategy to do linear reads instead of widely interleaved reads for k-rows
-    {
-        int64_t indexbase = j * m_dims[0];
-        int64_t increment = m_dims[1] * m_dims[0];
-        for (int k = 0; k < m_dims[2]; ++k)
-        {
-            int64_t index = indexbase + k * increment;
-            int64_t index2 = k;
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                scratchArray[index2] = m_deconv[index];
-                index2 += m_dims[2];
-                ++index;
-            }
-        }
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t privindex = i * m_dims[2];
-            deconvolve(scratchArray.getArray() + privindex, deconvScratch, m_dims[2]);
-        }
-        for (int i = 0; i < m_dims[0]; ++i)
+    for (int64_t j = 0; j < m_dims[1]; ++j)
+    {//same for k-lines, one i-row from each slice
+        deconvolveLines(deconvData + j * m_dims[0], deconvScratch, m_dims[2], zstep, m_dims[0]);
+    }
+}
+
+void VolumeSpline::computeSampleWeights(const float& ifloat, const float& jfloat, const float& kfloat, const int64_t framedims[3], SampleWeights& weightsOut)
+{
+    if (framedims[0] < 1 || ifloat < 0.0f || jfloat < 0.0f || kfloat < 0.0f || ifloat > framedims[0] - 1 || jfloat > framedims[1] - 1 || kfloat > framedims[2] - 1)
+    {
+        weightsOut.m_valid = false;
+        return;
+    }
+    const float coord[3] = { ifloat, jfloat, kfloat };
+    int64_t low[3];
+    weightsOut.m_edge = false;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float ipart;
+        float fpart = modf(coord[axis], &ipart);
+        low[axis] = (int64_t)ipart;
+        weightsOut.m_lowEdge[axis] = (low[axis] < 1);
+        weightsOut.m_highEdge[axis] = (low[axis] >= framedims[axis] - 2);
+        weightsOut.m_edge = weightsOut.m_edge || weightsOut.m_lowEdge[axis] || weightsOut.m_highEdge[axis];
+        CubicSpline spline = CubicSpline::bspline(fpart, weightsOut.m_lowEdge[axis], weightsOut.m_highEdge[axis]);
+        const float* splineWeights = spline.getWeights();
+        for (int tap = 0; tap < 4; ++tap)
         {
-            int64_t index = indexbase + i;
-            int64_t index2 = i * m_dims[2];
-            for (int k = 0; k < m_dims[2]; ++k)
-            {
-                m_deconv[index] = scratchArray[index2];
-                index += increment;
-                ++index2;
-            }
+            weightsOut.m_weights[axis][tap] = splineWeights[tap];
         }
     }
+    weightsOut.m_baseIndex = low[0] - 1 + framedims[0] * (low[1] - 1 + framedims[1] * (low[2] - 1));
+    weightsOut.m_valid = true;
 }
 
-float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float& kfloat)
+float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float& kfloat) const
 {
-    if (m_dims[0] < 1 || ifloat < 0.0f || jfloat < 0.0f || kfloat < 0.0f || ifloat > m_dims[0] - 1 || jfloat > m_dims[1] - 1 || kfloat > m_dims[2] - 1) return 0.0f;//yeesh
+    SampleWeights weights;
+    computeSampleWeights(ifloat, jfloat, kfloat, m_dims, weights);
+    return sample(weights);
+}
+
+float VolumeSpline::sample(const SampleWeights& weights) const
+{
+    if (!weights.m_valid || m_dims[0] < 1) return 0.0f;//yeesh
     const int64_t zstep = m_dims[0] * m_dims[1];
-    float iparti, ipartj, ipartk;
-    float fparti = modf(ifloat, &iparti);
-    float fpartj = modf(jfloat, &ipartj);
-    float fpartk = modf(kfloat, &ipartk);
-    int64_t lowi = (int64_t)iparti;
-    int64_t lowj = (int64_t)ipartj;
-    int64_t lowk = (int64_t)ipartk;
-    bool lowedgei = (lowi < 1);
-    bool lowedgej = (lowj < 1);
-    bool lowedgek = (lowk < 1);
-    bool highedgei = (lowi >= m_dims[0] - 2);
-    bool highedgej = (lowj >= m_dims[1] - 2);
-    bool highedgek = (lowk >= m_dims[2] - 2);
-    CubicSpline ispline = CubicSpline::bspline(fparti, lowedgei, highedgei);
-    CubicSpline jspline = CubicSpline::bspline(fpartj, lowedgej, highedgej);
-    CubicSpline kspline = CubicSpline::bspline(fpartk, lowedgek, highedgek);
+    const float* iweights = weights.m_weights[0], *jweights = weights.m_weights[1], *kweights = weights.m_weights[2];
     float jtemp[4], ktemp[4];//the weights of the splines are zero for off-the edge values, but zero the data anyway
-    jtemp[0] = 0.0f;
-    jtemp[3] = 0.0f;
-    ktemp[0] = 0.0f;
-    ktemp[3] = 0.0f;
-    if (lowedgei || lowedgej || lowedgek || highedgei || highedgej || highedgek)
-    {//there is an edge nearby, use the generic version with more conditionals
-        int jstart = lowedgej ? 1 : 0;
-        int kstart = lowedgek ? 1 : 0;
-        int jend = highedgej ? 3 : 4;
-        int kend = highedgek ? 3 : 4;
+    if (weights.m_edge)
+    {//there is an edge nearby, skip the samples that are off the edge
+        jtemp[0] = 0.0f;
+        jtemp[3] = 0.0f;
+        ktemp[0] = 0.0f;
+        ktemp[3] = 0.0f;
+        int istart = weights.m_lowEdge[0] ? 1 : 0;
+        int jstart = weights.m_lowEdge[1] ? 1 : 0;
+        int kstart = weights.m_lowEdge[2] ? 1 : 0;
+        int iend = weights.m_highEdge[0] ? 3 : 4;
+        int jend = weights.m_highEdge[1] ? 3 : 4;
+        int kend = weights.m_highEdge[2] ? 3 : 4;
         for (int k = kstart; k < kend; ++k)
         {
-            int64_t indexk = (k + lowk - 1) * zstep;
             for (int j = jstart; j < jend; ++j)
             {
-                int64_t indexj = indexk + (j + lowj - 1) * m_dims[0] + lowi - 1;
-                if (lowedgei)//have to do these tests for the simple reason that otherwise we might access off the end of the array in two of the 8 corners
+                int64_t indexj = weights.m_baseIndex + k * zstep + j * m_dims[0];//base index may be off the low edge, but the samples we use are not
+                float accum = m_deconv[indexj + istart] * iweights[istart];
+                for (int i = istart + 1; i < iend; ++i)
                 {
-                    if (highedgei)
-                    {
-                        jtemp[j] = ispline.evalBothEdge(m_deconv[indexj + 1], m_deconv[indexj + 2]);
-                    } else {
-                        jtemp[j] = ispline.evalLowEdge(m_deconv[indexj + 1], m_deconv[indexj + 2], m_deconv[indexj + 3]);
-                    }
-                } else {
-                    if (highedgei)
-                    {
-                        jtemp[j] = ispline.evalHighEdge(m_deconv[indexj], m_deconv[indexj + 1], m_deconv[indexj + 2]);
-                    } else {
-                        jtemp[j] = ispline.evaluate(m_deconv[indexj], m_deconv[indexj + 1], m_deconv[indexj + 2], m_deconv[indexj + 3]);
-                    }
+                    accum += m_deconv[indexj + i] * iweights[i];
                 }
+                jtemp[j] = accum;
             }
-            ktemp[k] = jspline.evaluate(jtemp[0], jtemp[1], jtemp[2], jtemp[3]);
+            ktemp[k] = jtemp[0] * jweights[0] + jtemp[1] * jweights[1] + jtemp[2] * jweights[2] + jtemp[3] * jweights[3];
         }
-        return kspline.evaluate(ktemp[0], ktemp[1], ktemp[2], ktemp[3]);
     } else {//we are clear of all edges, we can use fewer conditionals
-        int64_t indexbase = lowi - 1 + m_dims[0] * (lowj - 1 + m_dims[1] * (lowk - 1));
-        const float* basePtr = m_deconv.getArray() + indexbase;
+        const float* basePtr = m_deconv.getArray() + weights.m_baseIndex;
         int64_t indexk = 0;
         for (int k = 0; k < 4; ++k)
         {
             int64_t indexj = indexk;
             for (int j = 0; j < 4; ++j)
             {
-                jtemp[j] = ispline.evaluate(basePtr[indexj], basePtr[indexj + 1], basePtr[indexj + 2], basePtr[indexj + 3]);
+                jtemp[j] = basePtr[indexj] * iweights[0] + basePtr[indexj + 1] * iweights[1] + basePtr[indexj + 2] * iweights[2] + basePtr[indexj + 3] * iweights[3];
                 indexj += m_dims[0];
             }
-            ktemp[k] = jspline.evaluate(jtemp[0], jtemp[1], jtemp[2], jtemp[3]);
+            ktemp[k] = jtemp[0] * jweights[0] + jtemp[1] * jweights[1] + jtemp[2] * jweights[2] + jtemp[3] * jweights[3];
             indexk += zstep;
         }
-        return kspline.evaluate(ktemp[0], ktemp[1], ktemp[2], ktemp[3]);
     }
+    return ktemp[0] * kweights[0] + ktemp[1] * kweights[1] + ktemp[2] * kweights[2] + ktemp[3] * kweights[3];
 }
 
 void VolumeSpline::deconvolve(float* data, const float* backsubs, const int64_t& length)
@@ -246,6 +192,36 @@ void VolumeSpline::deconvolve(float* data, const float* backsubs, const int64_t&
     }
 }
 
+void VolumeSpline::deconvolveLines(float* data, const float* backsubs, const int64_t& length, const int64_t& stride, const int64_t& numLines)
+{//same arithmetic as deconvolve, on numLines adjacent lines whose elements are stride apart
+    if (length < 1) return;
+    const float A = 1.0f / 6.0f, B = 2.0f / 3.0f;
+    for (int64_t line = 0; line < numLines; ++line)
+    {
+        data[line] /= B;
+    }
+    for (int64_t i = 1; i < length; ++i)
+    {
+        float* current = data + i * stride;
+        const float* previous = current - stride;
+        const float divisor = B - A * backsubs[i - 1];
+        for (int64_t line = 0; line < numLines; ++line)
+        {
+            current[line] = (current[line] - A * previous[line]) / divisor;
+        }
+    }
+    for (int64_t i = length - 2; i >= 0; --i)
+    {
+        float* current = data + i * stride;
+        const float* next = current + stride;
+        const float backsub = backsubs[i];
+        for (int64_t line = 0; line < numLines; ++line)
+        {
+            current[line] -= backsub * next[line];
+        }
+    }
+}
+
 void VolumeSpline::predeconvolve(float* backsubs, const int64_t& length)
 {
     if (length < 1) return;
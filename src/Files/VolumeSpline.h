@@ -32,12 +32,24 @@ namespace caret {
         int64_t m_dims[3];
         CaretArray<float> m_deconv;//don't do lazy deconvolution, it doesn't save much time, and takes more memory and slightly longer if you have to do the whole volume anyway
         void deconvolve(float* data, const float* backsubs, const int64_t& length);//use CaretArray so that it doesn't reallocate like a vector on copy, and the data is static once computed
+        static void deconvolveLines(float* data, const float* backsubs, const int64_t& length, const int64_t& stride, const int64_t& numLines);//several lines at once, so the inner loop is over adjacent memory
         void predeconvolve(float* backsubs, const int64_t& length);//since the back substitution on the same size array uses the same coefficients, precompute them
     public:
+        ///everything sample() needs that depends only on the location, so it can be computed once and reused across frames of the same dimensions
+        struct SampleWeights
+        {
+            float m_weights[3][4];//spline weights for i, j, k
+            int64_t m_baseIndex;//linear index of the first sample in each dimension, may be out of range at the low edges
+            bool m_lowEdge[3], m_highEdge[3];
+            bool m_edge;//any of the above
+            bool m_valid;//false when outside the volume, sample() returns 0
+        };
         VolumeSpline();
         VolumeSpline(const float* frame, const int64_t framedims[3]);
-        float sample(const float& i, const float& j, const float& k);
-        float sample(const float ijk[3]) { return sample(ijk[0], ijk[1], ijk[2]); }
+        static void computeSampleWeights(const float& i, const float& j, const float& k, const int64_t framedims[3], SampleWeights& weightsOut);
+        float sample(const SampleWeights& weights) const;
+        float sample(const float& i, const float& j, const float& k) const;
+        float sample(const float ijk[3]) const { return sample(ijk[0], ijk[1], ijk[2]); }
         bool ignoredNonNumeric() const { return m_ignoredNonNumeric; }
     };
     
@@ -0,0 +1,131 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "WeightsCacheFile.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace caret;
+
+const int64_t WeightsCacheFile::KEY_LENGTH;
+const int64_t WeightsCacheFile::HEADER_SIZE;
+
+namespace
+{
+    const int32_t BYTE_ORDER_CHECK = 0x01020304;//reads differently on the other endianness, so such a file just doesn't match
+}
+
+void WeightsCacheFile::writeFile(const AString& fileName, const char magic[8], const int32_t& version, const AString& key,
+                                 const int64_t& numRows, const int64_t& numElems, const vector<Array>& arrays)
+{
+    char header[HEADER_SIZE];
+    memset(header, 0, HEADER_SIZE);
+    memcpy(header, magic, 8);
+    memcpy(header + 8, &version, sizeof(int32_t));
+    memcpy(header + 12, &BYTE_ORDER_CHECK, sizeof(int32_t));
+    QByteArray keyBytes = key.toLatin1();
+    CaretAssert(keyBytes.size() == KEY_LENGTH);
+    memcpy(header + 16, keyBytes.constData(), min((int64_t)keyBytes.size(), KEY_LENGTH));
+    memcpy(header + 16 + KEY_LENGTH, &numRows, sizeof(int64_t));
+    memcpy(header + 24 + KEY_LENGTH, &numElems, sizeof(int64_t));
+    QTemporaryFile myFile(fileName + ".XXXXXX");//write to a temporary name and rename, so concurrent jobs never see a partial file
+    if (!myFile.open()) throw CaretException("failed to create temporary file next to '" + fileName + "'");
+    bool ok = (myFile.write(header, HEADER_SIZE) == HEADER_SIZE);
+    for (size_t i = 0; ok && i < arrays.size(); ++i)
+    {
+        ok = (myFile.write((const char*)arrays[i].m_data, arrays[i].m_numBytes) == arrays[i].m_numBytes);
+    }
+    if (!ok) throw CaretException("failed to write weights cache file '" + myFile.fileName() + "'");
+    myFile.close();
+    if (QFile::exists(fileName)) return;//another process beat us to it, temporary file gets removed automatically
+    AString tempName = myFile.fileName();
+    myFile.setAutoRemove(false);//otherwise it would remove the file under its new name
+    if (!myFile.rename(fileName))
+    {
+        QFile::remove(tempName);
+        throw CaretException("failed to rename temporary file to '" + fileName + "'");
+    }
+}
+
+bool WeightsCacheFile::open(const AString& fileName, const char magic[8], const int32_t& version, const AString& key, const int64_t& numRows)
+{
+    m_file = CaretPointer<CaretBinaryFile>();
+    m_mapped = false;
+    if (!QFile::exists(fileName)) return false;
+    CaretPointer<CaretBinaryFile> myFile(new CaretBinaryFile(fileName, CaretBinaryFile::READ_MEMORY_MAP));
+    char header[HEADER_SIZE];
+    myFile->read(header, HEADER_SIZE);
+    int32_t fileVersion, byteOrder;
+    int64_t fileRows, fileElems;
+    memcpy(&fileVersion, header + 8, sizeof(int32_t));
+    memcpy(&byteOrder, header + 12, sizeof(int32_t));
+    memcpy(&fileRows, header + 16 + KEY_LENGTH, sizeof(int64_t));
+    memcpy(&fileElems, header + 24 + KEY_LENGTH, sizeof(int64_t));
+    if (memcmp(header, magic, 8) != 0 || fileVersion != version || byteOrder != BYTE_ORDER_CHECK ||
+        QByteArray(header + 16, KEY_LENGTH) != key.toLatin1() || fileRows != numRows || fileElems < 0)
+    {
+        CaretLogInfo("weights cache file '" + fileName + "' doesn't match, recomputing");
+        return false;
+    }
+    m_file = myFile;
+    m_mapped = (m_file->getMappedData() != NULL);
+    m_numRows = fileRows;
+    m_numElems = fileElems;
+    m_position = HEADER_SIZE;
+    return true;
+}
+
+CaretPointer<CaretBinaryFile> WeightsCacheFile::getMappedFile() const
+{
+    if (m_mapped) return m_file;
+    return CaretPointer<CaretBinaryFile>();
+}
+
+void WeightsCacheFile::checkOffsets(const int64_t* offsets) const
+{
+    if (offsets[0] != 0 || offsets[m_numRows] != m_numElems) throw CaretException("bad offsets");
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        if (offsets[i + 1] < offsets[i]) throw CaretException("bad offsets");
+    }
+}
+
+const char* WeightsCacheFile::nextMapped(const int64_t& numBytes)
+{
+    CaretAssert(m_mapped);
+    if (m_file->getMappedSize() < m_position + numBytes) throw CaretException("file is truncated");
+    const char* ret = m_file->getMappedData() + m_position;
+    m_position += numBytes;
+    return ret;
+}
+
+void WeightsCacheFile::nextRead(void* dataOut, const int64_t& numBytes)
+{
+    m_file->read(dataOut, numBytes);
+    m_position += numBytes;
+}
@@ -0,0 +1,87 @@
+#ifndef __WEIGHTS_CACHE_FILE_H__
+#define __WEIGHTS_CACHE_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretException.h"
+#include "CaretPointer.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    ///file for caching precomputed sparse weights: a header (magic, version, byte order check, key, number of rows, number of elements), then the arrays, all in native byte order
+    class WeightsCacheFile
+    {
+        CaretPointer<CaretBinaryFile> m_file;
+        int64_t m_numRows, m_numElems, m_position;
+        bool m_mapped;
+        const char* nextMapped(const int64_t& numBytes);
+        void nextRead(void* dataOut, const int64_t& numBytes);
+    public:
+        struct Array
+        {
+            const void* m_data;
+            int64_t m_numBytes;
+            Array(const void* data, const int64_t& numBytes) : m_data(data), m_numBytes(numBytes) { }
+        };
+        static const int64_t KEY_LENGTH = 40;//sha1 as hex
+        static const int64_t HEADER_SIZE = 8 + 4 + 4 + KEY_LENGTH + 8 + 8;//multiple of 8, so the first array is aligned
+
+        ///writes to a temporary name and renames, so concurrent jobs never see a partial file, throws on failure
+        static void writeFile(const AString& fileName, const char magic[8], const int32_t& version, const AString& key,
+                              const int64_t& numRows, const int64_t& numElems, const std::vector<Array>& arrays);
+
+        WeightsCacheFile() { m_numRows = 0; m_numElems = 0; m_position = 0; m_mapped = false; }
+        ///returns false if the file is missing or the header doesn't match, throws if the file is unreadable
+        bool open(const AString& fileName, const char magic[8], const int32_t& version, const AString& key, const int64_t& numRows);
+        int64_t getNumberOfElements() const { return m_numElems; }
+        bool isMapped() const { return m_mapped; }
+        ///the caller keeps this to keep pointers into the mapping valid, NULL when not mapped
+        CaretPointer<CaretBinaryFile> getMappedFile() const;
+        ///throws unless offsets start at 0, never decrease, and end at the number of elements
+        void checkOffsets(const int64_t* offsets) const;
+
+        ///next array in the file, points into the mapping if there is one, otherwise is read into storage
+        template <typename T>
+        const T* nextArray(const int64_t& count, std::vector<T>& storage)
+        {
+            if (isMapped()) return (const T*)nextMapped(count * sizeof(T));//callers order the arrays so that each one is aligned for its type
+            storage.resize(count);
+            nextRead(storage.data(), count * sizeof(T));
+            return storage.data();
+        }
+        template <typename T>
+        const T* nextArray(const int64_t& count, CaretArray<T>& storage)
+        {
+            if (isMapped()) return (const T*)nextMapped(count * sizeof(T));
+            storage = CaretArray<T>(count);
+            nextRead(storage.getArray(), count * sizeof(T));
+            return storage.getArray();
+        }
+    };
+
+}
+
+#endif //__WEIGHTS_CACHE_FILE_H__
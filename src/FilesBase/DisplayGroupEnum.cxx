@@ -25,9 +25,15 @@
 #undef __DISPLAY_GROUP_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::DisplayGroupEnum 
@@ -74,7 +80,10 @@ DisplayGroupEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(DisplayGroupEnum(DISPLAY_GROUP_TAB, 
                                         "DISPLAY_GROUP_TAB", 
@@ -101,6 +110,7 @@ DisplayGroupEnum::initialize()
         CaretAssertMessage(0, "NUMBER_OF_GROUPS constant is incorrect.  New ENUMs added?");
     }
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
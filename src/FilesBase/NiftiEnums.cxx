@@ -22,9 +22,15 @@
 #include "NiftiEnums.h"
 #undef __NIFTI_ENUMS_DECLARE__
 
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 ///Nifti Data Type Enum
 NiftiDataTypeEnum::NiftiDataTypeEnum()
 {
@@ -49,7 +55,10 @@ NiftiDataTypeEnum::createDataTypes()
     if (dataTypesCreatedFlag) {
         return;
     }
-    dataTypesCreatedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (dataTypesCreatedFlag) {//double check
+        return;
+    }
 
     dataTypes.push_back(NiftiDataTypeEnum(NIFTI_TYPE_INVALID,
                                           "NIFTI_DATA_TYPE_NONE",
@@ -99,6 +108,7 @@ NiftiDataTypeEnum::createDataTypes()
     dataTypes.push_back(NiftiDataTypeEnum(NIFTI_TYPE_COMPLEX256,
                                           "NIFTI_TYPE_COMPLEX256",
                                           2048));
+    dataTypesCreatedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -257,7 +267,10 @@ NiftiIntentEnum::initializeIntents()
     if (intentsCreatedFlag) {
         return;
     }
-    intentsCreatedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (intentsCreatedFlag) {//double check
+        return;
+    }
 
     //intents.push_back(
     //   NiftiIntentEnum());
@@ -326,6 +339,7 @@ NiftiIntentEnum::initializeIntents()
     intents.push_back(NiftiIntentEnum(NIFTI_INTENT_CONNECTIVITY_PARCELLATED,"NIFTI_INTENT_CONNECTIVITY_PARCELLATED", 3003,"Connectivity - Parcellated","","",""));
     intents.push_back(NiftiIntentEnum(NIFTI_INTENT_CONNECTIVITY_PARCELLATED_TIME,"NIFTI_INTENT_CONNECTIVITY_PARCELLATED_TIME", 3004,"Connectivity - Parcellated Time Series","","",""));
     intents.push_back(NiftiIntentEnum(NIFTI_INTENT_CONNECTIVITY_TRAJECTORY,"NIFTI_INTENT_CONNECTIVITY_TRAJECTORY", 3005,"Connectivity - Trajectory","","",""));
+    intentsCreatedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -520,7 +534,10 @@ NiftiSpacingUnitsEnum::initializeSpacingUnits()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     spacingUnits.push_back(NiftiSpacingUnitsEnum(NIFTI_UNITS_UNKNOWN,
                                                  0,
@@ -534,6 +551,7 @@ NiftiSpacingUnitsEnum::initializeSpacingUnits()
     spacingUnits.push_back(NiftiSpacingUnitsEnum(NIFTI_UNITS_MICRON,
                                                  3,
                                                  "NIFTI_UNITS_MICRON"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -696,7 +714,10 @@ NiftiTimeUnitsEnum::initializeTimeUnits()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(NiftiTimeUnitsEnum(NIFTI_UNITS_UNKNOWN, 0,"NIFTI_UNITS_UNKNOWN"));
     enumData.push_back(NiftiTimeUnitsEnum(NIFTI_UNITS_SEC, 8,"NIFTI_UNITS_SEC"));
@@ -704,6 +725,7 @@ NiftiTimeUnitsEnum::initializeTimeUnits()
     enumData.push_back(NiftiTimeUnitsEnum(NIFTI_UNITS_USEC, 24,"NIFTI_UNITS_USEC"));
     enumData.push_back(NiftiTimeUnitsEnum(NIFTI_UNITS_HZ, 32,"NIFTI_UNITS_HZ"));
     enumData.push_back(NiftiTimeUnitsEnum(NIFTI_UNITS_PPM, 40,"NIFTI_UNITS_PPM"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -861,13 +883,17 @@ NiftiTransformEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(NiftiTransformEnum(NIFTI_XFORM_UNKNOWN, 0,"NIFTI_XFORM_UNKNOWN"));
     enumData.push_back(NiftiTransformEnum(NIFTI_XFORM_SCANNER_ANAT, 1,"NIFTI_XFORM_SCANNER_ANAT"));
     enumData.push_back(NiftiTransformEnum(NIFTI_XFORM_ALIGNED_ANAT, 2,"NIFTI_XFORM_ALIGNED_ANAT"));
     enumData.push_back(NiftiTransformEnum(NIFTI_XFORM_TALAIRACH, 3,"NIFTI_XFORM_TALAIRACH"));
     enumData.push_back(NiftiTransformEnum(NIFTI_XFORM_MNI_152, 4,"NIFTI_XFORM_MNI_152"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -1025,10 +1051,14 @@ NiftiVersionEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(NiftiVersionEnum(NIFTI_VERSION_1, 348, "NIFTI_VERSION_1"));
     enumData.push_back(NiftiVersionEnum(NIFTI_VERSION_2, 540, "NIFTI_VERSION_2"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __VOLUME_SLICE_VIEW_AXIS_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class VolumeSliceViewPlaneEnum 
@@ -76,7 +82,10 @@ VolumeSliceViewPlaneEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(VolumeSliceViewPlaneEnum(ALL, 
                                                "ALL", 
@@ -97,6 +106,7 @@ VolumeSliceViewPlaneEnum::initialize()
                                                "PARASAGITTAL", 
                                                "Parasagittal",
                                                "P"));    
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -49,6 +49,10 @@ const int32_t NIFTI_INTENT_CONNECTIVITY_PARCELLATED_PARCELLATED_SERIES=3011;
 const int32_t NIFTI_INTENT_CONNECTIVITY_PARCELLATED_PARCELLATED_SCALAR=3012;
 
 const int32_t NIFTI_ECODE_CIFTI=32;
+const int32_t NIFTI_ECODE_WORKBENCH_TILES=1032;//not registered, workbench-specific: tile geometry of a tiled cifti matrix, data is NOT row-major when present
+const int32_t NIFTI_ECODE_WORKBENCH_QUANTIZED_ROWS=1033;//not registered, workbench-specific: each row of a 2D cifti matrix is stored as 8 or 16 bit integers with its own offset and step, data is NOT plain integers when present
+
+const int32_t NIFTI_TYPE_WORKBENCH_ENCODED=32767;//not registered, workbench-specific: the data section is encoded as described by one of the workbench extensions above, so that other readers refuse the file rather than misreading it
 
 #define NIFTI2_VERSION(h) \
     (h).sizeof_hdr == 348 ? 1 : (\
@@ -19,6 +19,7 @@
 /*LICENSE_END*/
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <limits>
@@ -28,8 +29,10 @@
 #include "ByteOrderEnum.h"
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretLogger.h"
 #include "DataCompressZLib.h"
+#include "DataFileException.h"
 
 //#include "FileUtilities.h"
 #include "FastStatistics.h"
@@ -163,14 +166,22 @@ GiftiDataArray::copyHelperGiftiDataArray(const GiftiDataArray& nda)
     }
    intent = nda.intent;
    encoding = nda.encoding;
-   arraySubscriptingOrder = nda.arraySubscriptingOrder;
    dataType = nda.dataType;
    //dataLocation = nda.dataLocation;
    dataTypeSize = nda.dataTypeSize;
-   endian = nda.endian;
    dimensions = nda.dimensions;
-   allocateData();
-   data = nda.data;
+   {
+      CaretMutexLocker locked(&nda.m_deferredMutex);//another thread may be decoding nda
+      arraySubscriptingOrder = nda.arraySubscriptingOrder;
+      endian = nda.endian;
+      data = nda.data;//may be empty if decoding is deferred, so don't allocate from the dimensions
+      m_deferredText = nda.m_deferredText;
+      m_deferredDataType = nda.m_deferredDataType;
+      m_deferredExternalFileName = nda.m_deferredExternalFileName;
+      m_deferredExternalFileOffset = nda.m_deferredExternalFileOffset;
+      m_dataDeferred = nda.m_dataDeferred;
+   }
+   updateDataPointers();
    metaData = nda.metaData;
    nonWrittenMetaData = nda.nonWrittenMetaData;
    externalFileName = nda.externalFileName;
@@ -248,6 +259,7 @@ GiftiDataArray::getDataTypeAppropriateForIntent(const NiftiIntentEnum::Enum inte
 void 
 GiftiDataArray::addRows(const int32_t numRowsToAdd)
 {
+   ensureDataDecoded();
    dimensions[0] += numRowsToAdd;
    allocateData();
 }
@@ -261,6 +273,7 @@ GiftiDataArray::deleteRows(const std::vector<int32_t>& rowsToDeleteIn)
    if (rowsToDeleteIn.empty()) {
       return;
    }
+   ensureDataDecoded();
    
    //
    // Sort rows in reverse order
@@ -300,6 +313,7 @@ GiftiDataArray::deleteRows(const std::vector<int32_t>& rowsToDeleteIn)
 void 
 GiftiDataArray::setDimensions(const std::vector<int64_t> dimensionsIn)
 {
+   ensureDataDecoded();
    dimensions = dimensionsIn;
    if (dimensions.size() == 1) {
       dimensions.push_back(1);
@@ -407,6 +421,11 @@ GiftiDataArray::clear()
    dataTypeSize = sizeof(float);
    metaData.clear();
    nonWrittenMetaData.clear();
+   m_dataDeferred = false;
+   std::string().swap(m_deferredText);
+   m_deferredDataType = NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32;
+   m_deferredExternalFileName = "";
+   m_deferredExternalFileOffset = 0;
    dimensions.clear();
    setDimensions(dimensions);
    externalFileName = "";
@@ -558,6 +577,7 @@ GiftiDataArray::remapIntValues(const std::vector<int32_t>& remappingTable)
  */
 void 
 GiftiDataArray::transferLabelIndices(const std::map<int32_t,int32_t>& indexConverter) {
+    ensureDataDecoded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_INT32) {
         int64_t num = this->getTotalNumberOfElements();
         for (int i = 0; i < num; i++) {
@@ -577,9 +597,15 @@ GiftiDataArray::transferLabelIndices(const std::map<int32_t,int32_t>& indexConve
 /**
  * read a GIFTI data array from text.
  * Data array should already be initialized and allocated.
+ *
+ * When deferDecoding is true and the data is GZIP_BASE64_BINARY
+ * encoded, only the encoded text is kept and the data is decoded
+ * the first time it is accessed.  The encoded text is compressed
+ * so it is usually much smaller than the decoded data.  Data in an
+ * external binary file is likewise not read until it is accessed.
  */
 void 
-GiftiDataArray::readFromText(const AString text,
+GiftiDataArray::readFromText(std::string& text,
                              const GiftiEndianEnum::Enum dataEndianForReading,
                              const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
                              const NiftiDataTypeEnum::Enum dataTypeForReading,
@@ -587,17 +613,49 @@ GiftiDataArray::readFromText(const AString text,
                              const GiftiEncodingEnum::Enum encodingForReading,
                              const AString& externalFileNameForReading,
                              const int64_t externalFileOffsetForReading,
-                             const bool isReadOnlyMetaData) throw (GiftiException)
+                             const bool isReadOnlyMetaData,
+                             const bool deferDecoding) throw (GiftiException)
 {
    const NiftiDataTypeEnum::Enum requiredDataType = dataType;
+   m_dataDeferred = false;
+   m_deferredText.clear();
+   m_deferredExternalFileName = "";
+   m_deferredExternalFileOffset = 0;
    dataType = dataTypeForReading;
    encoding = encodingForReading;
    endian   = dataEndianForReading;
    arraySubscriptingOrder = arraySubscriptingOrderForReading;
-   setDimensions(dimensionsForReading);
    if (dimensionsForReading.size() == 0) {
       throw GiftiException("Data array has no dimensions.");
    }
+   const bool deferThisArray = (deferDecoding
+                                && (isReadOnlyMetaData == false)
+                                && ((encoding == GiftiEncodingEnum::GZIP_BASE64_BINARY)
+                                    || (encoding == GiftiEncodingEnum::EXTERNAL_FILE_BINARY)));
+   if (deferThisArray) {
+      //
+      // Keep the encoded text and set up the array as it will be after
+      // decoding, but without allocating the data
+      //
+      dimensions = dimensionsForReading;
+      if (dimensions.size() == 1) {
+         dimensions.push_back(1);
+      }
+      m_deferredText.swap(text);
+      m_deferredDataType = dataType;
+      m_deferredExternalFileName = externalFileNameForReading;
+      m_deferredExternalFileOffset = externalFileOffsetForReading;
+      if ((requiredDataType != dataType)
+          && (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET)) {
+         dataType = requiredDataType;
+      }
+      std::vector<uint8_t>().swap(data);
+      updateDataPointers();
+      m_dataDeferred = true;
+      setModified();
+      return;
+   }
+   setDimensions(dimensionsForReading);
    //setExternalFileInformation(externalFileNameForReading,
    //                           externalFileOffsetForReading);//TSC: don't set the external filename on the array, because that is what it uses when writing the array
                               
@@ -605,216 +663,325 @@ GiftiDataArray::readFromText(const AString text,
    // If NOT metadata only
    //
    if (isReadOnlyMetaData == false) {
-      //
-      // Total number of elements in Data Array
-      //
-      const int64_t numElements = getTotalNumberOfElements();
-      
-      switch (encoding) {
-          case GiftiEncodingEnum::ASCII:
-            {
-                std::istringstream stream(text.toStdString());
-                
-               switch (dataType) {
-                  case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
-                     {
-                        float* ptr = dataPointerFloat;
-                        for (int64_t i = 0; i < numElements; i++) {
-                           stream >> *ptr;
-                           ptr++;
-                        }
+      decodeDataText(text,
+                     requiredDataType,
+                     externalFileNameForReading,
+                     externalFileOffsetForReading);
+   } // If NOT metadata only
+   
+   setModified();
+}
+
+/**
+ * Decode the text of the data array into the data, which must already be
+ * allocated with the data type and dimensions of the text.  Converts to
+ * the required data type and to row major order if needed.
+ */
+void
+GiftiDataArray::decodeDataText(const std::string& text,
+                               const NiftiDataTypeEnum::Enum requiredDataType,
+                               const AString& externalFileNameForReading,
+                               const int64_t externalFileOffsetForReading) throw (GiftiException)
+{
+   //
+   // Total number of elements in Data Array
+   //
+   const int64_t numElements = getTotalNumberOfElements();
+   
+   switch (encoding) {
+       case GiftiEncodingEnum::ASCII:
+         {
+             std::istringstream stream(text);
+             
+            switch (dataType) {
+               case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
+                  {
+                     float* ptr = dataPointerFloat;
+                     for (int64_t i = 0; i < numElements; i++) {
+                        stream >> *ptr;
+                        ptr++;
                      }
-                     break;
-                   case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
-                     {
-                        int32_t* ptr = dataPointerInt;
-                        for (int64_t i = 0; i < numElements; i++) {
-                           stream >> *ptr;
-                           ptr++;
-                        }
+                  }
+                  break;
+                case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
+                  {
+                     int32_t* ptr = dataPointerInt;
+                     for (int64_t i = 0; i < numElements; i++) {
+                        stream >> *ptr;
+                        ptr++;
                      }
-                     break;
-                   case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
-                     {
-                        uint8_t* ptr = dataPointerUByte;
-                         int32_t c;
-                        for (int64_t i = 0; i < numElements; i++) {
-                           stream >> c;
-                           *ptr = static_cast<uint8_t>(c);
-                           ptr++;
-                        }
+                  }
+                  break;
+                case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
+                  {
+                     uint8_t* ptr = dataPointerUByte;
+                      int32_t c;
+                     for (int64_t i = 0; i < numElements; i++) {
+                        stream >> c;
+                        *ptr = static_cast<uint8_t>(c);
+                        ptr++;
                      }
-                     break;
-                   default:
-                       throw GiftiException("DataType " + NiftiDataTypeEnum::toName(dataType) + " not supported in GIFTI");
-               }
-            }
-            break;
-          case GiftiEncodingEnum::BASE64_BINARY:
-            {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               const uint64_t numDecoded =
-                     Base64::decode((const unsigned char*)(text.toStdString().c_str()),
-                                                data.size(),
-                                                &data[0]);
-               if (numDecoded != data.size()) {
-                  std::ostringstream str;
-                  str << "Decoding of Base64 Binary data failed.\n"
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                      << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Is byte swapping needed ?
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
+                  }
+                  break;
+                default:
+                    throw GiftiException("DataType " + NiftiDataTypeEnum::toName(dataType) + " not supported in GIFTI");
             }
-            break;
-          case GiftiEncodingEnum::GZIP_BASE64_BINARY:
-            {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               unsigned char* dataBuffer = new unsigned char[data.size()];
-               //const char* textChars = text.toAscii().constData();
-               const uint64_t numDecoded =
-                     Base64::decode((unsigned char*)text.toStdString().c_str(),
-                                                data.size(),
-                                                dataBuffer);
-               if (numDecoded == 0) {
-                   std::ostringstream str;
-                   str << "Decoding of GZip Base64 Binary data failed."
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
+         }
+         break;
+       case GiftiEncodingEnum::BASE64_BINARY:
+         {
+            //
+            // Decode the Base64 data using VTK's algorithm
+            //
+            const uint64_t numDecoded =
+                  Base64::decode((const unsigned char*)(text.c_str()),
+                                             data.size(),
+                                             &data[0]);
+            if (numDecoded != data.size()) {
+               std::ostringstream str;
+               str << "Decoding of Base64 Binary data failed.\n"
+                << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
                    << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                   throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               
-               //
-               // Uncompress the data using VTK's algorithm
-               // 
-                DataCompressZLib compressor;
-                const uint64_t uncompressedDataLength = 
-                                   compressor.uncompressData(dataBuffer,
-                                                          numDecoded,
-                                                          (unsigned char*)&data[0],
-                                                          data.size());
-               if (uncompressedDataLength != data.size()) {
-                  std::ostringstream str;
-                  str << "Decompression of Binary data failed.\n"
-                   << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Free memory
-               //
-               delete[] dataBuffer;
-               
-               //
-               // Is byte swapping needed ? 
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
+               throw GiftiException(AString::fromStdString(str.str()));
             }
-            break;
-          case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
-            {
-               if (externalFileNameForReading.length() <= 0) {
-                  throw GiftiException("External file name is empty.");
-               }
-               
-                std::ifstream extBinFile(externalFileNameForReading.toStdString().c_str(),
-                                         std::ifstream::in);
-                if (extBinFile.good() == false) {
-                        throw GiftiException("Error opening \""
-                                            + externalFileNameForReading
-                                            + "\"");
-                }
-                else {
-                  //
-                  // Move to the offset of the data
-                  //
-                  extBinFile.seekg(externalFileOffsetForReading, std::ios::beg);
-                  if (extBinFile.good() == false) {
-                        throw GiftiException("Error seeking to \""
-                                             + AString::number(externalFileOffsetForReading)
-                                             + "\" in \""
-                                             + externalFileNameForReading
-                                             + "\"");
-                  }
-                    
-                  //
-                  // Set the number of bytes that must be read
-                  //
-                    std::streamsize numberOfBytesToRead = 0;
-                  char* pointerToForReadingData = NULL;
-                  switch (dataType) {
-                     case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
-                        numberOfBytesToRead = numElements * sizeof(float);
-                        pointerToForReadingData = (char*)dataPointerFloat;
-                        break;
-                     case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
-                        numberOfBytesToRead = numElements * sizeof(int32_t);
-                        pointerToForReadingData = (char*)dataPointerInt;
-                        break;
-                     case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
-                        numberOfBytesToRead = numElements * sizeof(uint8_t);
-                        pointerToForReadingData = (char*)dataPointerUByte;
-                        break;
-                      default:
-                          throw GiftiException("DataType " + NiftiDataTypeEnum::toName(dataType) + " not supported in GIFTI");
-                  }
-               
-                  //
-                  // Read the data
-                  //
-                  extBinFile.read((char*)pointerToForReadingData,
-                                    numberOfBytesToRead);
-                  if(extBinFile.good() == false) {
+            
+            //
+            // Is byte swapping needed ?
+            //
+            if (endian != getSystemEndian()) {
+               byteSwapData(getSystemEndian());
+            }
+         }
+         break;
+       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+         {
+            //
+            // Decode all of the Base64 text, the compressed data
+            // may be larger than the uncompressed data
+            //
+            std::vector<unsigned char> dataBuffer((text.size() / 4) * 3 + 3);
+            const uint64_t numDecoded = (text.empty() ? 0 :
+                  Base64::decode((const unsigned char*)text.c_str(),
+                                             dataBuffer.size(),
+                                             &dataBuffer[0],
+                                             text.size()));
+            if (numDecoded == 0) {
+                std::ostringstream str;
+                str << "Decoding of GZip Base64 Binary data failed."
+                << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
+                << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
+                throw GiftiException(AString::fromStdString(str.str()));
+            }
+            
+            
+            //
+            // Uncompress the data using VTK's algorithm
+            // 
+             DataCompressZLib compressor;
+             const uint64_t uncompressedDataLength = 
+                                compressor.uncompressData(&dataBuffer[0],
+                                                       numDecoded,
+                                                       (unsigned char*)&data[0],
+                                                       data.size());
+            if (uncompressedDataLength != data.size()) {
+               std::ostringstream str;
+               str << "Decompression of Binary data failed.\n"
+                << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
+                << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
+               throw GiftiException(AString::fromStdString(str.str()));
+            }
+            
+            //
+            // Is byte swapping needed ? 
+            //
+            if (endian != getSystemEndian()) {
+               byteSwapData(getSystemEndian());
+            }
+         }
+         break;
+       case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+         {
+            if (externalFileNameForReading.length() <= 0) {
+               throw GiftiException("External file name is empty.");
+            }
+            
+            //
+            // Set the number of bytes that must be read
+            //
+            int64_t numberOfBytesToRead = 0;
+            char* pointerToForReadingData = NULL;
+            switch (dataType) {
+               case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
+                  numberOfBytesToRead = numElements * sizeof(float);
+                  pointerToForReadingData = (char*)dataPointerFloat;
+                  break;
+               case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
+                  numberOfBytesToRead = numElements * sizeof(int32_t);
+                  pointerToForReadingData = (char*)dataPointerInt;
+                  break;
+               case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
+                  numberOfBytesToRead = numElements * sizeof(uint8_t);
+                  pointerToForReadingData = (char*)dataPointerUByte;
+                  break;
+                default:
+                    throw GiftiException("DataType " + NiftiDataTypeEnum::toName(dataType) + " not supported in GIFTI");
+            }
+            if (externalFileOffsetForReading < 0) {
+               throw GiftiException("Invalid offset "
+                                    + AString::number(externalFileOffsetForReading)
+                                    + " for \""
+                                    + externalFileNameForReading
+                                    + "\"");
+            }
+            
+            //
+            // Copy the data out of a memory map of the file when possible
+            // (the file is only mapped while the array is read), otherwise
+            // seek and read
+            //
+            try {
+               CaretBinaryFile extBinFile(externalFileNameForReading,
+                                          CaretBinaryFile::READ_MEMORY_MAP);
+               const char* mappedData = (const char*)extBinFile.getMappedData();
+               if (mappedData != NULL) {
+                  if (externalFileOffsetForReading + numberOfBytesToRead > extBinFile.getMappedSize()) {
                      throw GiftiException("Tried to read "
-                                         + AString::number((int64_t)numberOfBytesToRead)
-                                         + " from "
-                                         + externalFileOffsetForReading
-                                         + " but failed");
-                  }
-                  
-                  //
-                  // Is byte swapping needed ?
-                  //
-                  if (endian != getSystemEndian()) {
-                     byteSwapData(getSystemEndian());
+                                          + AString::number(numberOfBytesToRead)
+                                          + " bytes from offset "
+                                          + AString::number(externalFileOffsetForReading)
+                                          + " in \""
+                                          + externalFileNameForReading
+                                          + "\" but the file is only "
+                                          + AString::number(extBinFile.getMappedSize())
+                                          + " bytes");
                   }
+                  memcpy(pointerToForReadingData,
+                         mappedData + externalFileOffsetForReading,
+                         numberOfBytesToRead);
+               }
+               else {
+                  extBinFile.seek(externalFileOffsetForReading);
+                  extBinFile.read(pointerToForReadingData,
+                                  numberOfBytesToRead);
                }
             }
-            break;
-      }
-   
-      //
-      // Check if data type needs to be converted
-      //
-      if (requiredDataType != dataType) {
-          if (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET) {
-            convertToDataType(requiredDataType);
+            catch (const DataFileException& e) {
+               throw GiftiException("Error reading external data file \""
+                                    + externalFileNameForReading
+                                    + "\": "
+                                    + e.whatString());
+            }
+            
+            //
+            // Is byte swapping needed ?
+            //
+            if (endian != getSystemEndian()) {
+               byteSwapData(getSystemEndian());
+            }
          }
+         break;
+   }
+
+   //
+   // Check if data type needs to be converted
+   //
+   if (requiredDataType != dataType) {
+       if (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET) {
+         convertToDataType(requiredDataType);
       }
-      
-       //
-       // Are array indices in opposite order
-       //
-       if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
-           convertArrayIndexingOrder();
-       }
-   } // If NOT metadata only
+   }
    
-   setModified();
+    //
+    // Are array indices in opposite order
+    //
+    if (arraySubscriptingOrder == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
+        convertArrayIndexingOrder();
+    }
+}
+
+/**
+ * @return True if the data is still encoded, waiting to be decoded
+ *    the first time it is accessed.
+ */
+bool
+GiftiDataArray::isDataDecodingDeferred() const
+{
+    CaretMutexLocker locked(&m_deferredMutex);
+    return m_dataDeferred;
+}
+
+/**
+ * Decode the data now if it was kept encoded when the array was read
+ * with decoding deferred.  Safe to call from multiple threads.
+ *
+ * @throws GiftiException
+ *    If the data could not be decoded.
+ */
+void
+GiftiDataArray::finishDeferredDecoding() throw (GiftiException)
+{
+    ensureDataDecoded();
+}
+
+/**
+ * Decode the data, if it was kept encoded when the array was read
+ * with decoding deferred, before it is used.  Safe to call from
+ * multiple threads.
+ *
+ * @throws GiftiException
+ *    If the data could not be decoded.  The array stays deferred,
+ *    so every later access also fails instead of seeing invalid data.
+ */
+void
+GiftiDataArray::ensureDataDecoded() const throw (GiftiException)
+{
+    CaretMutexLocker locked(&m_deferredMutex);
+    if (m_dataDeferred) {
+        decodeDeferredData();
+    }
+}
+
+/**
+ * Decode the data that was kept encoded when the array was read
+ * with decoding deferred.  The caller must hold m_deferredMutex.
+ *
+ * @throws GiftiException
+ *    If the data could not be decoded, the array is left unchanged.
+ */
+void
+GiftiDataArray::decodeDeferredData() const throw (GiftiException)
+{
+    GiftiDataArray* me = const_cast<GiftiDataArray*>(this);
+    
+    /*
+     * Decode into a temporary array so that this array stays
+     * deferred if decoding fails
+     */
+    GiftiDataArray decoded(intent);
+    decoded.dataType = m_deferredDataType;
+    decoded.encoding = encoding;
+    decoded.endian = endian;
+    decoded.arraySubscriptingOrder = arraySubscriptingOrder;
+    decoded.dimensions = dimensions;
+    decoded.allocateData();
+    try {
+        decoded.decodeDataText(m_deferredText,
+                               dataType,
+                               m_deferredExternalFileName,
+                               m_deferredExternalFileOffset);
+    }
+    catch (const GiftiException& e) {
+        throw GiftiException("Error decoding GIFTI data array: " + e.whatString());
+    }
+    me->data.swap(decoded.data);
+    me->dataTypeSize = decoded.dataTypeSize;
+    me->endian = decoded.endian;
+    me->arraySubscriptingOrder = decoded.arraySubscriptingOrder;//decoding converts to row major
+    me->updateDataPointers();
+    std::string().swap(me->m_deferredText);
+    me->m_deferredExternalFileName = "";
+    me->m_deferredExternalFileOffset = 0;
+    me->m_dataDeferred = false;
 }
 
 /**
@@ -1008,13 +1175,18 @@ GiftiDataArray::convertArrayIndexingOrder() throw (GiftiException)
  *    Stream for external binary file.
  * @param encodingForWriting
  *    GIFTI encoding used when writing the data.
+ * @param preEncodedData
+ *    If not NULL, the output of encodeBinaryData() for encodingForWriting,
+ *    used instead of encoding the data here.
  */
 void 
 GiftiDataArray::writeAsXML(std::ostream& stream, 
                            std::ostream* externalBinaryOutputStream,
-                           GiftiEncodingEnum::Enum encodingForWriting) 
+                           GiftiEncodingEnum::Enum encodingForWriting,
+                           const std::string* preEncodedData) 
                                                 throw (GiftiException)
 {
+    ensureDataDecoded();
     this->encoding = encodingForWriting;
     
     //
@@ -1049,10 +1221,18 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
     }
     
    //
-   // External file not supported
+   // The external file name and offset are only meaningful for external
+   // binary data (the name was set by the writer that owns the data file)
    //
-   //const AString externalFileName = "";
-   //const AString externalFileOffset = "0";
+   AString externalFileNameForWriting;
+   int64_t externalFileOffsetForWriting = 0;
+   if (this->encoding == GiftiEncodingEnum::EXTERNAL_FILE_BINARY) {
+      if (externalBinaryOutputStream == NULL) {
+         throw GiftiException("No output stream for external binary data.");
+      }
+      externalFileNameForWriting = externalFileName;
+      externalFileOffsetForWriting = externalFileOffset;
+   }
    
    //
    // Write the opening tag
@@ -1068,8 +1248,8 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
     }
     dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_ENCODING, GiftiEncodingEnum::toGiftiName(this->encoding));
     dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_ENDIAN, GiftiEndianEnum::toGiftiName(this->endian));
-    dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_EXTERNAL_FILE_NAME, externalFileName);
-    dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_EXTERNAL_FILE_OFFSET, externalFileOffset);
+    dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_EXTERNAL_FILE_NAME, externalFileNameForWriting);
+    dataAtt.addAttribute(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_EXTERNAL_FILE_OFFSET, externalFileOffsetForWriting);
 
     
     
@@ -1169,78 +1349,31 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
          }
          break;
        case GiftiEncodingEnum::BASE64_BINARY:
+       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
          {
-            //
-            // Encode the data with VTK's Base64 algorithm
-            //
-            const uint64_t bufferLength = static_cast<uint64_t>(data.size() * 1.5);
-            char* buffer = new char[bufferLength];
-            const uint64_t compressedLength =
-               Base64::encode(&data[0],
-                                          data.size(),
-                                          (unsigned char*)buffer);
-            if (compressedLength >= bufferLength) {
-               throw GiftiException(
-                     "Base64 encoding buffer length ("
-                     + AString::number(bufferLength)
-                     + ") is too small but needs to be "
-                                    + AString::number(compressedLength));
+            std::string encodedData;
+            if (preEncodedData == NULL) {
+               encodeBinaryData(encoding,
+                                encodedData);
+               preEncodedData = &encodedData;
             }
-            buffer[compressedLength] = '\0';
             
             //
             // Write the data  MUST BE NO space around data
             //
-            xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, buffer);
-            
-            //
-            // Free memory
-            //
-            delete[] buffer;
+            xmlWriter.writeElementNoSpaceAscii(GiftiXmlElements::TAG_DATA, *preEncodedData);
          }
          break;
-       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+       case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
          {
             //
-            // Compress the data with VTK's ZLIB algorithm
-            //
-             DataCompressZLib compressor;
-             unsigned long compressedDataBufferLength = 
-                              compressor.getMaximumCompressionSpace(data.size());
-            unsigned char* compressedDataBuffer = new unsigned char[compressedDataBufferLength];
-            unsigned long compressedDataLength =
-                          compressor.compressData(&data[0], 
-                                               data.size(),
-                                               compressedDataBuffer,
-                                               compressedDataBufferLength);
-            
-            //
-            // Encode the data with VTK's Base64 algorithm
-            //
-            char* buffer = new char[static_cast<int64_t>(compressedDataLength * 1.5)];
-            const uint64_t compressedLength =
-               Base64::encode(compressedDataBuffer,
-                                          compressedDataLength,
-                                          (unsigned char*)buffer);
-            buffer[compressedLength] = '\0';
-            
-             //
-             // Write the data  MUST BE NO space around data
-             //
-             xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, buffer);
-             
-            
-            //
-            // Free memory
+            // Raw data in the endian of this system, which is written in
+            // the Endian attribute
             //
-            delete[] buffer;
-            delete[] compressedDataBuffer;
-         }
-         break;
-       case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
-         {
             const int64_t dataLength = data.size();
-            externalBinaryOutputStream->write((const char*)&data[0], dataLength);
+            if (dataLength > 0) {
+               externalBinaryOutputStream->write((const char*)&data[0], dataLength);
+            }
             if (externalBinaryOutputStream->bad()) {
                throw GiftiException("Output stream for external file reports its status as bad.");
             }
@@ -1259,12 +1392,73 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
    xmlWriter.writeEndElement();
 }                      
 
+/**
+ * Encode the data as base64 text, compressing it with zlib first for
+ * GZIP_BASE64_BINARY.  Does not modify the data array, so different
+ * arrays may be encoded in parallel before they are written.
+ *
+ * @param encodingForWriting
+ *    BASE64_BINARY or GZIP_BASE64_BINARY.
+ * @param encodedDataOut
+ *    Output containing the encoded text.
+ */
+void
+GiftiDataArray::encodeBinaryData(const GiftiEncodingEnum::Enum encodingForWriting,
+                                 std::string& encodedDataOut) const throw (GiftiException)
+{
+    ensureDataDecoded();
+    encodedDataOut.clear();
+    if (data.empty()) {
+        return;
+    }
+    
+    const unsigned char* bytesToEncode = &data[0];
+    uint64_t numberOfBytesToEncode = data.size();
+    std::vector<unsigned char> compressedData;
+    switch (encodingForWriting) {
+        case GiftiEncodingEnum::BASE64_BINARY:
+            break;
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+        {
+            //
+            // Compress the data with VTK's ZLIB algorithm
+            //
+            DataCompressZLib compressor;
+            compressedData.resize(compressor.getMaximumCompressionSpace(data.size()));
+            numberOfBytesToEncode = compressor.compressData(&data[0],
+                                                            data.size(),
+                                                            &compressedData[0],
+                                                            compressedData.size());
+            if (numberOfBytesToEncode == 0) {
+                throw GiftiException("Compression of data array failed.");
+            }
+            bytesToEncode = &compressedData[0];
+        }
+            break;
+        default:
+            throw GiftiException("Encoding "
+                                 + GiftiEncodingEnum::toName(encodingForWriting)
+                                 + " is not base64 binary");
+    }
+    
+    //
+    // Encode the data with VTK's Base64 algorithm, 4 characters for each 3 bytes
+    //
+    encodedDataOut.resize(((numberOfBytesToEncode + 2) / 3) * 4);
+    const uint64_t encodedLength = Base64::encode(bytesToEncode,
+                                                  numberOfBytesToEncode,
+                                                  (unsigned char*)&encodedDataOut[0]);
+    CaretAssert(encodedLength == encodedDataOut.size());
+    encodedDataOut.resize(encodedLength);
+}
+
 /**
  * convert to data type.
  */
 void 
 GiftiDataArray::convertToDataType(const NiftiDataTypeEnum::Enum newDataType) throw (GiftiException)
 {
+   ensureDataDecoded();
    if (newDataType != dataType) {      
       //
       // make a copy of myself
@@ -1433,6 +1627,7 @@ GiftiDataArray::isModified() const
 void 
 GiftiDataArray::getMinMaxValues(int& minValue, int& maxValue) const
 {
+   ensureDataDecoded();
    if (minMaxIntValuesValid == false) {
       minValueInt = std::numeric_limits<int32_t>::max();
       minValueInt = std::numeric_limits<int32_t>::min();
@@ -1460,6 +1655,7 @@ void
 GiftiDataArray::getMinMaxValuesFloat(float& minValue,
                           float& maxValue) const
 {
+    ensureDataDecoded();
     if (minMaxFloatValuesValid == false) {
         minValueFloat =  std::numeric_limits<float>::max();
         maxValueFloat = -std::numeric_limits<float>::max();
@@ -1482,6 +1678,13 @@ GiftiDataArray::getMinMaxValuesFloat(float& minValue,
 void 
 GiftiDataArray::zeroize()
 {
+   if (m_dataDeferred) {
+      m_dataDeferred = false;
+      std::string().swap(m_deferredText);
+      m_deferredExternalFileName = "";
+      m_deferredExternalFileOffset = 0;
+      allocateData();
+   }
    if (data.empty() == false) {
       std::fill(data.begin(), data.end(), 0);
    }
@@ -1523,6 +1726,7 @@ GiftiDataArray::getDataOffset(const int32_t indices[]) const
 float 
 GiftiDataArray::getDataFloat32(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerFloat[offset];
 }
@@ -1533,6 +1737,7 @@ GiftiDataArray::getDataFloat32(const int32_t indices[]) const
 const float* 
 GiftiDataArray::getDataFloat32Pointer(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerFloat[offset];
 }
@@ -1543,6 +1748,7 @@ GiftiDataArray::getDataFloat32Pointer(const int32_t indices[]) const
 int32_t 
 GiftiDataArray::getDataInt32(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerInt[offset];
 }
@@ -1553,6 +1759,7 @@ GiftiDataArray::getDataInt32(const int32_t indices[]) const
 const int32_t* 
 GiftiDataArray::getDataInt32Pointer(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerInt[offset];
 }
@@ -1563,6 +1770,7 @@ GiftiDataArray::getDataInt32Pointer(const int32_t indices[]) const
 uint8_t 
 GiftiDataArray::getDataUInt8(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerUByte[offset];
 }
@@ -1573,6 +1781,7 @@ GiftiDataArray::getDataUInt8(const int32_t indices[]) const
 const uint8_t*
 GiftiDataArray::getDataUInt8Pointer(const int32_t indices[]) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerUByte[offset];
 }
@@ -1583,6 +1792,7 @@ GiftiDataArray::getDataUInt8Pointer(const int32_t indices[]) const
 void 
 GiftiDataArray::setDataFloat32(const int32_t indices[], const float dataValue) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    dataPointerFloat[offset] = dataValue;
 }
@@ -1593,6 +1803,7 @@ GiftiDataArray::setDataFloat32(const int32_t indices[], const float dataValue) c
 void 
 GiftiDataArray::setDataInt32(const int32_t indices[], const int32_t dataValue) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    dataPointerInt[offset] = dataValue;
 }
@@ -1603,6 +1814,7 @@ GiftiDataArray::setDataInt32(const int32_t indices[], const int32_t dataValue) c
 void 
 GiftiDataArray::setDataUInt8(const int32_t indices[], const uint8_t dataValue) const
 {
+   ensureDataDecoded();
    const int64_t offset = getDataOffset(indices);
    dataPointerUByte[offset] = dataValue;
 }      
@@ -1702,6 +1914,7 @@ GiftiDataArray::getPaletteColorMapping() const
 const DescriptiveStatistics* 
 GiftiDataArray::getDescriptiveStatistics() const
 {
+    ensureDataDecoded();
     if (this->descriptiveStatistics == NULL) {
         this->descriptiveStatistics = new DescriptiveStatistics();
         this->descriptiveStatistics->update(this->dataPointerFloat, 
@@ -1712,6 +1925,7 @@ GiftiDataArray::getDescriptiveStatistics() const
 
 const FastStatistics* GiftiDataArray::getFastStatistics() const
 {
+    ensureDataDecoded();
     if (m_fastStatistics == NULL)
     {
         m_fastStatistics.grabNew(new FastStatistics());
@@ -1722,6 +1936,7 @@ const FastStatistics* GiftiDataArray::getFastStatistics() const
 
 const Histogram* GiftiDataArray::getHistogram() const
 {
+    ensureDataDecoded();
     if (m_histogram == NULL)
     {
         m_histogram.grabNew(new Histogram(100));
@@ -1753,6 +1968,7 @@ GiftiDataArray::getDescriptiveStatistics(const float mostPositiveValueInclusive,
                                                       const float mostNegativeValueInclusive,
                                                       const bool includeZeroValues) const
 {
+    ensureDataDecoded();
     if (this->descriptiveStatisticsLimitedValues == NULL) {
         this->descriptiveStatisticsLimitedValues = new DescriptiveStatistics();
     }
@@ -1772,6 +1988,7 @@ const Histogram* GiftiDataArray::getHistogram(const float mostPositiveValueInclu
                                               const float mostNegativeValueInclusive,
                                               const bool includeZeroValues) const
 {
+    ensureDataDecoded();
     if (m_histogramLimitedValues == NULL)
     {
         m_histogramLimitedValues.grabNew(new Histogram(100));
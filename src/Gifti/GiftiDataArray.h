@@ -24,11 +24,13 @@
 
 #include <map>
 #include <ostream>
+#include <string>
 #include <AString.h>
 #include <vector>
 
 #include <stdint.h>
 
+#include "CaretMutex.h"
 #include "CaretObject.h"
 #include "CaretPointer.h"
 #include "DescriptiveStatistics.h"
@@ -95,7 +97,7 @@ namespace caret {
         std::vector<int64_t> getDimensions() const { return dimensions; }
         
         /// current size of the data (in bytes)
-        int64_t getDataSizeInBytes() const { return data.size(); }
+        int64_t getDataSizeInBytes() const { ensureDataDecoded(); return data.size(); }
         
         /// get a dimension
         int32_t getDimension(const int32_t dimIndex) const { return dimensions[dimIndex]; }
@@ -112,8 +114,8 @@ namespace caret {
         // get data offset 
         //int64_t getDataOffset(const int64_t nodeNum, const int64_t componentNum) const;//TSC: implementation was wrong, commenting out for now
         
-        // read a data array from text
-        void readFromText(const AString text,
+        // read a data array from text, text may be taken by the array
+        void readFromText(std::string& text,
                           const GiftiEndianEnum::Enum dataEndianForReading,
                           const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
                           const NiftiDataTypeEnum::Enum dataTypeForReading,
@@ -121,12 +123,24 @@ namespace caret {
                           const GiftiEncodingEnum::Enum encodingForReading,
                           const AString& externalFileNameForReading,
                           const int64_t externalFileOffsetForReading,
-                          const bool isReadOnlyMetaData) throw (GiftiException);
+                          const bool isReadOnlyMetaData,
+                          const bool deferDecoding = false) throw (GiftiException);
+        
+        // is the data still encoded, waiting to be decoded on first access
+        bool isDataDecodingDeferred() const;
+        
+        // decode the data now if decoding was deferred
+        void finishDeferredDecoding() throw (GiftiException);
+        
+        // encode the data as base64 text, compressing it first for GZIP_BASE64_BINARY
+        void encodeBinaryData(const GiftiEncodingEnum::Enum encodingForWriting,
+                              std::string& encodedDataOut) const throw (GiftiException);
         
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
-                        GiftiEncodingEnum::Enum encodingForWriting) throw (GiftiException);
+                        GiftiEncodingEnum::Enum encodingForWriting,
+                        const std::string* preEncodedData = NULL) throw (GiftiException);
         
         /// get endian
         GiftiEndianEnum::Enum getEndian() const { return endian; }
@@ -208,22 +222,22 @@ namespace caret {
         void setArraySubscriptingOrder(const GiftiArrayIndexingOrderEnum::Enum aso) { arraySubscriptingOrder = aso; }
         
         /// get pointer for floating point data (valid only if data type is FLOAT)
-        float* getDataPointerFloat() { return dataPointerFloat; }
+        float* getDataPointerFloat() { ensureDataDecoded(); return dataPointerFloat; }
         
         /// get pointer for floating point data (const method) (valid only if data type is FLOAT)
-        const float* getDataPointerFloat() const { return dataPointerFloat; }
+        const float* getDataPointerFloat() const { ensureDataDecoded(); return dataPointerFloat; }
         
         /// get pointer for integer data (valid only if data type is INT)
-        int32_t* getDataPointerInt() { return dataPointerInt; }
+        int32_t* getDataPointerInt() { ensureDataDecoded(); return dataPointerInt; }
         
         /// get pointer for integer data (const method) (valid only if data type is INT)
-        const int32_t* getDataPointerInt() const { return dataPointerInt; }
+        const int32_t* getDataPointerInt() const { ensureDataDecoded(); return dataPointerInt; }
         
         /// get pointer for unsigned byte data (valid only if data type is UBYTE)
-        uint8_t* getDataPointerUByte() { return dataPointerUByte; }
+        uint8_t* getDataPointerUByte() { ensureDataDecoded(); return dataPointerUByte; }
         
         /// get pointer for unsigned byte data (const method) (valid only if data type is UBYTE)
-        const uint8_t* getDataPointerUByte() const { return dataPointerUByte; }
+        const uint8_t* getDataPointerUByte() const { ensureDataDecoded(); return dataPointerUByte; }
         
         // set all elements of array to zero
         void zeroize();
@@ -323,6 +337,18 @@ namespace caret {
         /// convert array indexing order of data
         void convertArrayIndexingOrder() throw (GiftiException);
         
+        // decode the array's text into the (already allocated) data
+        void decodeDataText(const std::string& text,
+                            const NiftiDataTypeEnum::Enum requiredDataType,
+                            const AString& externalFileNameForReading,
+                            const int64_t externalFileOffsetForReading) throw (GiftiException);
+        
+        // decode deferred data before it is used
+        void ensureDataDecoded() const throw (GiftiException);
+        
+        // decode the text that was kept when reading was deferred, caller must hold m_deferredMutex
+        void decodeDeferredData() const throw (GiftiException);
+        
         /// the data
         std::vector<uint8_t> data;
         
@@ -417,6 +443,24 @@ namespace caret {
         mutable CaretPointer<Histogram> m_histogramLimitedValues;
         
         bool modifiedFlag; // DO NOT COPY
+        
+        /// encoded text of the data when decoding is deferred, empty once decoded
+        std::string m_deferredText;
+        
+        /// data type of the encoded text when decoding is deferred
+        NiftiDataTypeEnum::Enum m_deferredDataType;
+        
+        /// external file holding the data when decoding of an external file array is deferred
+        AString m_deferredExternalFileName;
+        
+        /// offset of the data in the external file when decoding is deferred
+        int64_t m_deferredExternalFileOffset;
+        
+        /// data has not been decoded yet
+        bool m_dataDeferred;
+        
+        /// serializes decoding of deferred data
+        mutable CaretMutex m_deferredMutex;
         // ***** BE SURE TO UPDATE copyHelper() if elements are added ******
         
         /// allow NodeDataFile access to protected elements
@@ -24,6 +24,7 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 
 #include "FileInformation.h"
 #include "GiftiEncodingEnum.h"
@@ -56,6 +57,7 @@ GiftiFile::GiftiFile(const AString& descriptiveName,
     this->defaultExtension = defaultExtension;
    numberOfNodesForSparseNodeIndexFile = 0;
     this->encodingForWriting = GiftiFile::defaultEncodingForWriting;
+    m_deferDataArrayDecoding = false;
 }
 
 /**
@@ -71,6 +73,7 @@ GiftiFile::GiftiFile()
     numberOfNodesForSparseNodeIndexFile = 0;
     this->defaultExtension = ".gii";
     this->encodingForWriting = GiftiFile::defaultEncodingForWriting;
+    m_deferDataArrayDecoding = false;
 }
 
 /**
@@ -118,6 +121,7 @@ GiftiFile::copyHelperGiftiFile(const GiftiFile& nndf)
       addDataArray(new GiftiDataArray(*nndf.dataArrays[i]));
    }
     this->encodingForWriting = nndf.encodingForWriting;
+    m_deferDataArrayDecoding = nndf.m_deferDataArrayDecoding;
 }
       
 /**
@@ -870,6 +874,36 @@ GiftiFile::readFile(const AString& filename) throw (DataFileException)
         throw DataFileException(AString::fromStdString(str.str()));
     }
     
+    /*
+     * Compressed data arrays are only decoded by the parser when
+     * they are first used.  Unless decoding is to stay deferred,
+     * decode them now in parallel, since inflating is most of
+     * the time spent reading.
+     */
+    if ( ! m_deferDataArrayDecoding) {
+        const int32_t numArraysToDecode = getNumberOfDataArrays();
+        std::vector<AString> decodingErrors(numArraysToDecode);
+#pragma omp CARET_PARFOR schedule(dynamic) if (numArraysToDecode > 1)
+        for (int32_t i = 0; i < numArraysToDecode; i++) {
+            try {
+                dataArrays[i]->finishDeferredDecoding();
+            }
+            catch (const GiftiException& e) {
+                decodingErrors[i] = e.whatString();
+            }
+        }
+        for (int32_t i = 0; i < numArraysToDecode; i++) {
+            if ( ! decodingErrors[i].isEmpty()) {
+                clear();
+                this->setFileName("");
+                throw DataFileException("Error while reading "
+                                        + filename
+                                        + ": "
+                                        + decodingErrors[i]);
+            }
+        }
+    }
+    
     /*
      * If any maps are missing names, give them default names.
      */
@@ -902,6 +936,57 @@ GiftiFile::writeFile(const AString& filename) throw (DataFileException)
             //}
         }
         
+        int numberOfDataArrays = this->getNumberOfDataArrays();
+        
+        //
+        // Compressing and encoding is most of the time spent writing,
+        // so do it for all data arrays in parallel, then write in order
+        //
+        std::vector<std::string> encodedData;
+        const bool preEncodeData = ((numberOfDataArrays > 1)
+                                    && ((this->encodingForWriting == GiftiEncodingEnum::BASE64_BINARY)
+                                        || (this->encodingForWriting == GiftiEncodingEnum::GZIP_BASE64_BINARY)));
+        if (preEncodeData) {
+            encodedData.resize(numberOfDataArrays);
+            std::vector<AString> encodingErrors(numberOfDataArrays);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numberOfDataArrays; i++) {
+                try {
+                    this->getDataArray(i)->encodeBinaryData(this->encodingForWriting,
+                                                            encodedData[i]);
+                }
+                catch (const GiftiException& e) {
+                    encodingErrors[i] = e.whatString();
+                }
+            }
+            for (int i = 0; i < numberOfDataArrays; i++) {
+                if ( ! encodingErrors[i].isEmpty()) {
+                    throw GiftiException(encodingErrors[i]);
+                }
+            }
+        }
+        else {
+            //
+            // Arrays not yet decoded may be reading from the external data
+            // file that the writer replaces, so decode them all first
+            //
+            std::vector<AString> decodingErrors(numberOfDataArrays);
+#pragma omp CARET_PARFOR schedule(dynamic) if (numberOfDataArrays > 1)
+            for (int i = 0; i < numberOfDataArrays; i++) {
+                try {
+                    this->getDataArray(i)->finishDeferredDecoding();
+                }
+                catch (const GiftiException& e) {
+                    decodingErrors[i] = e.whatString();
+                }
+            }
+            for (int i = 0; i < numberOfDataArrays; i++) {
+                if ( ! decodingErrors[i].isEmpty()) {
+                    throw GiftiException(decodingErrors[i]);
+                }
+            }
+        }
+        
         //
         // Create a GIFTI Data Array File Writer
         //
@@ -911,7 +996,6 @@ GiftiFile::writeFile(const AString& filename) throw (DataFileException)
         //
         // Start writing the file
         //
-        int numberOfDataArrays = this->getNumberOfDataArrays();
         giftiFileWriter.start(numberOfDataArrays,
                               &this->metaData,
                               &this->labelTable);
@@ -920,7 +1004,14 @@ GiftiFile::writeFile(const AString& filename) throw (DataFileException)
         // Write the data arrays
         //
         for (int i = 0; i < numberOfDataArrays; i++) {
-            giftiFileWriter.writeDataArray(this->getDataArray(i));
+            if (preEncodeData) {
+                giftiFileWriter.writeDataArray(this->getDataArray(i),
+                                               &encodedData[i]);
+                std::string().swap(encodedData[i]);//release as we go
+            }
+            else {
+                giftiFileWriter.writeDataArray(this->getDataArray(i));
+            }
         }
         
         //
@@ -1235,6 +1326,21 @@ GiftiFile::setEncodingForWriting(const GiftiEncodingEnum::Enum encoding)
     this->encodingForWriting = encoding;
 }
 
+/**
+ * Set deferred decoding of data arrays when reading.  When true,
+ * GZIP_BASE64_BINARY data arrays keep their encoded text and are
+ * decoded the first time their data is accessed, so reading a file
+ * with many arrays is fast when only some of them are used.
+ *
+ * @param deferDecoding
+ *    New status.
+ */
+void
+GiftiFile::setDeferDataArrayDecoding(const bool deferDecoding)
+{
+    m_deferDataArrayDecoding = deferDecoding;
+}
+
 
     
 /**
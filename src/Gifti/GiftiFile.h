@@ -186,6 +186,11 @@ class GiftiFile : public DataFile {
     
     bool getReadMetaDataOnlyFlag() const { return false; }
     
+    /** @return True if gzip base64 data arrays are decoded on first access instead of while reading. */
+    bool getDeferDataArrayDecoding() const { return m_deferDataArrayDecoding; }
+    
+    void setDeferDataArrayDecoding(const bool deferDecoding);
+    
     /** @return The encoding used to write the file. */
     GiftiEncodingEnum::Enum getEncodingForWriting() const { return this->encodingForWriting; }
     
@@ -239,6 +244,9 @@ class GiftiFile : public DataFile {
       /// number of nodes in sparse node index files (NIFTI_INTENT_NODE_INDEX array)
       int32_t numberOfNodesForSparseNodeIndexFile;
       
+    /** Decode data arrays on first access instead of while reading */
+    bool m_deferDataArrayDecoding;
+    
     /** The default encoding for writing a GIFTI file. */
     static GiftiEncodingEnum::Enum defaultEncodingForWriting;
     
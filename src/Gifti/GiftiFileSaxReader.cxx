@@ -138,6 +138,7 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
          }
          else if (qName == GiftiXmlElements::TAG_DATA) {
             this->state = STATE_DATA_ARRAY_DATA;
+            this->dataArrayText.clear();
          }
          else if (qName == GiftiXmlElements::TAG_COORDINATE_TRANSFORMATION_MATRIX) {
             this->state = STATE_DATA_ARRAY_MATRIX;
@@ -401,7 +402,7 @@ GiftiFileSaxReader::createDataArray(const XmlAttributes& attributes) throw (XmlS
         const AString offsetString = attributes.getValue(GiftiXmlElements::ATTRIBUTE_DATA_ARRAY_EXTERNAL_FILE_OFFSET);
         //if (offsetString.isEmpty() == false) {
             bool validOffsetFlag = false;
-            this->externalFileOffsetForReadingData = offsetString.toLong(&validOffsetFlag);
+            this->externalFileOffsetForReadingData = offsetString.toLongLong(&validOffsetFlag);
             if (validOffsetFlag == false) {
                 XmlSaxParserException e("File Offset is not an integer ("
                                             + offsetString
@@ -522,7 +523,11 @@ GiftiFileSaxReader::processArrayData() throw (XmlSaxParserException)
    //}
    
    try {
-      dataArray->readFromText(elementText, 
+      //
+      // compressed arrays are not decoded here, GiftiFile decodes
+      // them in parallel after parsing, or on first access
+      //
+      dataArray->readFromText(this->dataArrayText, 
                            this->endianForReadingArrayData,
                            arraySubscriptingOrderForReadingArrayData,
                            dataTypeForReadingArrayData,
@@ -530,7 +535,9 @@ GiftiFileSaxReader::processArrayData() throw (XmlSaxParserException)
                            encodingForReadingArrayData,
                            externalFileNameForReadingData,
                            externalFileOffsetForReadingData,
-                              this->giftiFile->getReadMetaDataOnlyFlag());
+                              this->giftiFile->getReadMetaDataOnlyFlag(),
+                              true);
+      std::string().swap(this->dataArrayText);
    }
    catch (const GiftiException& e) {
        throw XmlSaxParserException(e.whatString());
@@ -549,6 +556,9 @@ GiftiFileSaxReader::characters(const char* ch) throw (XmlSaxParserException)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if (this->state == STATE_DATA_ARRAY_DATA) {
+        this->dataArrayText += ch;//array data is ASCII, keep it out of the UTF-16 AString
+    }
     else {
         elementText += ch;
     }
@@ -23,6 +23,7 @@
 /*LICENSE_END*/
 
 #include <stack>
+#include <string>
 #include <AString.h>
 #include <stdint.h>
 
@@ -120,6 +121,9 @@ namespace caret {
         /// element text
         AString elementText;
         
+        /// text of the data array's Data element
+        std::string dataArrayText;
+        
         /// GIFTI data array being read
         GiftiDataArray* dataArray;
         
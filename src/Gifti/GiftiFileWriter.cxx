@@ -175,10 +175,13 @@ GiftiFileWriter::start(const int numberOfDataArrays,
  * Write a GIFTI Data Array.
  *
  * @param gda - The data array.
+ * @param preEncodedData - If not NULL, the array's data already encoded
+ *    with GiftiDataArray::encodeBinaryData() for this file's encoding.
  * @throws GiftiException - If an error occurs.
  */
 void 
-GiftiFileWriter::writeDataArray(GiftiDataArray* gda) throw (GiftiException)
+GiftiFileWriter::writeDataArray(GiftiDataArray* gda,
+                                const std::string* preEncodedData) throw (GiftiException)
 {
     this->verifyOpened();
     
@@ -221,7 +224,8 @@ GiftiFileWriter::writeDataArray(GiftiDataArray* gda) throw (GiftiException)
         //
         gda->writeAsXML(*this->xmlFileOutputStream, 
                         this->externalFileOutputStream,
-                        this->encoding);
+                        this->encoding,
+                        preEncodedData);
         
         //
         // Increment counter of data arrays written
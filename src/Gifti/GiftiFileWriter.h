@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <fstream>
+#include <string>
 
 #include "CaretObject.h"
 #include "GiftiFile.h"
@@ -45,7 +46,8 @@ namespace caret {
         void start(const int numberOfDataArrays,
                    GiftiMetaData* metadata,
                    GiftiLabelTable* labelTable) throw (GiftiException);
-        void writeDataArray(GiftiDataArray* gda) throw (GiftiException);
+        void writeDataArray(GiftiDataArray* gda,
+                            const std::string* preEncodedData = NULL) throw (GiftiException);
         
         void finish() throw (GiftiException);
         
@@ -25,9 +25,15 @@
 #undef __CURSOR_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::CursorEnum 
@@ -74,7 +80,10 @@ CursorEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(CursorEnum(CURSOR_DEFAULT, 
                                     "CURSOR_DEFAULT", 
@@ -104,6 +113,7 @@ CursorEnum::initialize()
                                   "CURSOR_WHATS_THIS",
                                   "What's this Cursor"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -23,9 +23,15 @@
 #include "ViewModeEnum.h"
 #undef __VIEW_MODE_DECLARE__
 
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 /**
  * Constructor.
  *
@@ -61,7 +67,10 @@ ViewModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(ViewModeEnum(VIEW_MODE_INVALID, 
                                     0, 
@@ -82,6 +91,7 @@ ViewModeEnum::initialize()
                                     3, 
                                     "VIEW_MODE_WHOLE_BRAIN", 
                                     "Whole Brain"));
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -621,6 +621,9 @@ int NiftiHeader::typeToNumBits(const int64_t& type)
         case NIFTI_TYPE_COMPLEX256:
             return 256;
             break;
+        case NIFTI_TYPE_WORKBENCH_ENCODED:
+            return 8;//the encoding is given by a workbench extension, so bitpix has no real meaning
+            break;
         default:
             throw DataFileException("incorrect datatype code");
     }
@@ -22,12 +22,19 @@
 
 #include "DataFileException.h"
 
+#include <cstring>
+
 using namespace std;
 using namespace caret;
 
-void NiftiIO::openRead(const QString& filename)
+void NiftiIO::openRead(const QString& filename, const bool& memoryMap)
 {
-    m_file.open(filename);
+    if (memoryMap)
+    {
+        m_file.open(filename, CaretBinaryFile::READ_MEMORY_MAP);
+    } else {
+        m_file.open(filename);
+    }
     m_header.read(m_file);
     if (m_header.getDataType() == DT_BINARY)
     {
@@ -59,6 +66,73 @@ void NiftiIO::close()
     m_dims.clear();
 }
 
+int64_t NiftiIO::getElementOffset(const int& fullDims, const vector<int64_t>& indexSelect, int64_t& numElemsOut) const
+{
+    CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
+    CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+    numElemsOut = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
+    int curDim;
+    for (curDim = 0; curDim < fullDims; ++curDim)
+    {
+        numElemsOut *= m_dims[curDim];
+    }
+    int64_t numDimSkip = numElemsOut, numSkip = 0;
+    for (; curDim < (int)m_dims.size(); ++curDim)
+    {
+        CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
+        numSkip += indexSelect[curDim - fullDims] * numDimSkip;
+        numDimSkip *= m_dims[curDim];
+    }
+    return numSkip;
+}
+
+const float* NiftiIO::getMappedFloatData(const int& fullDims, const vector<int64_t>& indexSelect) const
+{
+    const char* mapped = m_file.getMappedData();
+    if (mapped == NULL) return NULL;
+    if (m_header.getDataType() != NIFTI_TYPE_FLOAT32 || m_header.isSwapped()) return NULL;
+    double mult, offset;
+    if (m_header.getDataScaling(mult, offset)) return NULL;
+    int64_t numElems = 0;
+    int64_t start = getElementOffset(fullDims, indexSelect, numElems) * sizeof(float) + m_header.getDataOffset();
+    if (start % sizeof(float) != 0) return NULL;//vox_offset is required to be a multiple of 16, but don't hand out a misaligned pointer if someone wrote a bad file
+    if (start + numElems * (int64_t)sizeof(float) > m_file.getMappedSize()) return NULL;//truncated file, let the normal read path report the error
+    return (const float*)(mapped + start);
+}
+
+void NiftiIO::readBytes(char* dataOut, const int64_t& byteOffset, const int64_t& numBytes, const bool& tolerateShortRead)
+{
+    const char* mapped = getMappedBytes(byteOffset, numBytes);
+    if (mapped != NULL)
+    {
+        memcpy(dataOut, mapped, numBytes);
+        return;
+    }
+    m_file.seek(byteOffset + m_header.getDataOffset());
+    int64_t numRead = 0;
+    m_file.read(dataOut, numBytes, &numRead);
+    if ((numRead != numBytes && !tolerateShortRead) || numRead < 0)
+    {
+        throw DataFileException("error while reading from file '" + m_file.getFilename() + "'");
+    }
+    if (numRead < numBytes) memset(dataOut + numRead, 0, numBytes - numRead);//what wasn't written yet reads as zeros
+}
+
+void NiftiIO::writeBytes(const char* dataIn, const int64_t& byteOffset, const int64_t& numBytes)
+{
+    m_file.seek(byteOffset + m_header.getDataOffset());
+    m_file.write(dataIn, numBytes);
+}
+
+const char* NiftiIO::getMappedBytes(const int64_t& byteOffset, const int64_t& numBytes) const
+{
+    const char* mapped = m_file.getMappedData();
+    if (mapped == NULL) return NULL;
+    int64_t start = byteOffset + m_header.getDataOffset();
+    if (start + numBytes > m_file.getMappedSize()) return NULL;
+    return mapped + start;
+}
+
 int NiftiIO::getNumComponents() const
 {
     switch (m_header.getDataType())
@@ -84,6 +158,8 @@ int NiftiIO::getNumComponents() const
         case NIFTI_TYPE_FLOAT128:
             return 1;
             break;
+        case NIFTI_TYPE_WORKBENCH_ENCODED:
+            throw DataFileException("file '" + m_file.getFilename() + "' uses a workbench-specific data encoding, it can only be read as cifti");
         default:
             CaretAssert(0);
             throw DataFileException("internal error, report what you did to the developers");
@@ -119,6 +195,8 @@ int NiftiIO::numBytesPerElem()
         case NIFTI_TYPE_COMPLEX256:
             return 16;
             break;
+        case NIFTI_TYPE_WORKBENCH_ENCODED:
+            throw DataFileException("file '" + m_file.getFilename() + "' uses a workbench-specific data encoding, it can only be read as cifti");
         default:
             CaretAssert(0);
             throw DataFileException("internal error, report what you did to the developers");
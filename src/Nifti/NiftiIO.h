@@ -47,11 +47,13 @@ namespace caret
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
+        int64_t getElementOffset(const int& fullDims, const std::vector<int64_t>& indexSelect, int64_t& numElemsOut) const;
     public:
-        void openRead(const QString& filename);
+        void openRead(const QString& filename, const bool& memoryMap = false);//memory mapping is only attempted for uncompressed files, falls back to normal reading
         void writeNew(const QString& filename, const NiftiHeader& header, const int& version = 1, const bool& withRead = false, const bool& swapEndian = false);
         QString getFilename() const { return m_file.getFilename(); }
         void overrideDimensions(const std::vector<int64_t>& newDims) { m_dims = newDims; }//HACK: deal with reading/writing CIFTI-1's broken headers
+        void overrideDataType(const int16_t& newType) { m_header.setDataType(newType); }//HACK: workbench-encoded cifti has NIFTI_TYPE_WORKBENCH_ENCODED in the header, and its element type in an extension
         void close();
         const NiftiHeader& getHeader() const { return m_header; }
         const std::vector<int64_t>& getDimensions() const { return m_dims; }
@@ -62,72 +64,87 @@ namespace caret
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //raw access by offset into the data section, for layouts that aren't plain row-major, like tiled cifti
+        //NOTE: offset and count are in scalar values, so each component of a multi-component type counts separately
+        template<typename T>
+        void readElements(T* dataOut, const int64_t& numSkip, const int64_t& numElems, const bool& tolerateShortRead = false);
+        template<typename T>
+        void writeElements(const T* dataIn, const int64_t& numSkip, const int64_t& numElems);
+        //raw access by byte offset into the data section, with no type conversion, scaling, or byteswapping, for workbench-specific encodings like quantized cifti rows
+        void readBytes(char* dataOut, const int64_t& byteOffset, const int64_t& numBytes, const bool& tolerateShortRead = false);
+        void writeBytes(const char* dataIn, const int64_t& byteOffset, const int64_t& numBytes);
+        const char* getMappedBytes(const int64_t& byteOffset, const int64_t& numBytes) const;//NULL if not mapped, or the range is past the end of the file
+        bool isMemoryMapped() const { return m_file.getMappedData() != NULL; }
+        //returns pointer directly into the mapped file when the on-disk data needs no conversion (FLOAT32, native byte order, no scaling), otherwise NULL
+        const float* getMappedFloatData(const int& fullDims, const std::vector<int64_t>& indexSelect) const;
     };
     
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
-        }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
-        {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
-        }
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
-        int64_t numRead = 0;
-        m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
-        if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
-        {
-            throw DataFileException("error while reading from file '" + m_file.getFilename() + "'");
+        int64_t numElems = 0;
+        int64_t numSkip = getElementOffset(fullDims, indexSelect, numElems);
+        readElements(dataOut, numSkip, numElems, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readElements(T* dataOut, const int64_t& numSkip, const int64_t& numElems, const bool& tolerateShortRead)
+    {
+        int64_t readBytes = numElems * numBytesPerElem(), readStart = numSkip * numBytesPerElem() + m_header.getDataOffset();
+        char* readPointer = NULL;
+        const char* mapped = m_file.getMappedData();
+        if (mapped != NULL && !m_header.isSwapped() && readStart + readBytes <= m_file.getMappedSize())
+        {//convert straight out of the mapping - swapping has to modify the data, so that case still goes through m_scratch
+            readPointer = const_cast<char*>(mapped + readStart);//convertRead only writes to its input when swapping
+        } else {
+            m_scratch.resize(readBytes);
+            m_file.seek(readStart);
+            int64_t numRead = 0;
+            m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
+            if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
+            {
+                throw DataFileException("error while reading from file '" + m_file.getFilename() + "'");
+            }
+            readPointer = m_scratch.data();
         }
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertRead(dataOut, (uint8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint8_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertRead(dataOut, (int8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int8_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertRead(dataOut, (uint16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint16_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertRead(dataOut, (int16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int16_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertRead(dataOut, (uint32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint32_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertRead(dataOut, (int32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int32_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertRead(dataOut, (uint64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint64_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertRead(dataOut, (int64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int64_t*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertRead(dataOut, (float*)m_scratch.data(), numElems);
+                convertRead(dataOut, (float*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertRead(dataOut, (double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (double*)readPointer, numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertRead(dataOut, (long double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (long double*)readPointer, numElems);
                 break;
             default:
                 CaretAssert(0);
@@ -139,21 +156,14 @@ namespace caret
     template<typename T>
     void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
-        }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
-        {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
-        }
+        int64_t numElems = 0;
+        int64_t numSkip = getElementOffset(fullDims, indexSelect, numElems);
+        writeElements(dataIn, numSkip, numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::writeElements(const T* dataIn, const int64_t& numSkip, const int64_t& numElems)
+    {
         m_scratch.resize(numElems * numBytesPerElem());
         m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
         switch (m_header.getDataType())
@@ -0,0 +1,120 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationCiftiChangeLayout.h"
+#include "OperationException.h"
+
+#include "CiftiFile.h"
+#include "MultiDimIterator.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+AString OperationCiftiChangeLayout::getCommandSwitch()
+{
+    return "-cifti-change-layout";
+}
+
+AString OperationCiftiChangeLayout::getShortDescription()
+{
+    return "CHANGE THE ON-DISK LAYOUT OF A CIFTI MATRIX";
+}
+
+OperationParameters* OperationCiftiChangeLayout::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addCiftiParameter(1, "cifti-in", "the input cifti file");
+    
+    ret->addCiftiOutputParameter(2, "cifti-out", "the output cifti file");
+    
+    OptionalParameter* tileOpt = ret->createOptionalParameter(3, "-tile-size", "set the tile dimensions (default 128 by 128)");
+    tileOpt->addIntegerParameter(1, "rows", "number of rows in each tile");
+    tileOpt->addIntegerParameter(2, "columns", "number of columns in each tile");
+    
+    ret->createOptionalParameter(4, "-standard", "write the normal untiled layout instead");
+    
+    OptionalParameter* quantizeOpt = ret->createOptionalParameter(5, "-quantize", "store each row as integers with its own offset and step, instead of tiles");
+    quantizeOpt->addIntegerParameter(1, "bits", "bits per value, 8 or 16");
+    
+    ret->setHelpText(
+        AString("Rewrites a 2D cifti file with its matrix stored in rectangular tiles, so that reading a column only needs to read the tiles ") +
+        "that contain it, rather than the entire file.  " +
+        "The tile geometry is recorded in a workbench-specific nifti extension, and the data section is no longer in the standard order, " +
+        "so tiled files can only be read by workbench.  Use -standard to convert a tiled file back to the normal layout.\n\n" +
+        "Tiled file format: the nifti datatype is set to the unregistered code 32767, so that other nifti and cifti readers refuse the file " +
+        "instead of misreading it.  A nifti extension with code 1032 holds the magic string 'wbtiles1', then the rows and columns per tile as 64 bit integers.  " +
+        "The data section is 32 bit floats, with the tiles in row-major order, and each tile stored row-major and padded to the full tile size.\n\n" +
+        "The -quantize option instead stores each row in its original order as 16 or 8 bit integers, with the offset and step of the row " +
+        "stored just before it, making the file 2 or 4 times smaller, and reading a row from disk correspondingly faster.  " +
+        "Each row is quantized over its own range, so the error of any value is at most half of the row's range divided by 65534 or 254.  " +
+        "NaN is preserved, infinite values become NaN.  Like tiled files, quantized files can only be read by workbench, use -standard to convert back to float.\n\n" +
+        "Quantized file format: the nifti datatype is set to the unregistered code 32767, so that other nifti and cifti readers refuse the file " +
+        "instead of misreading it.  A nifti extension with code 1033 holds the magic string 'wbquant1', then the bytes in each stored row and the bits per value, " +
+        "as 64 bit integers.  Each stored row is a 32 bit float offset and a 32 bit float step, followed by one signed 16 bit or unsigned 8 bit code per value, " +
+        "and the value is offset + step * code, except that the lowest 16 bit code or the highest 8 bit code means NaN."
+    );
+    return ret;
+}
+
+void OperationCiftiChangeLayout::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CiftiFile* ciftiIn = myParams->getCifti(1);
+    CiftiFile* ciftiOut = myParams->getOutputCifti(2);
+    int64_t tileRows = 128, tileCols = 128;
+    OptionalParameter* tileOpt = myParams->getOptionalParameter(3);
+    if (tileOpt->m_present)
+    {
+        tileRows = tileOpt->getInteger(1);
+        tileCols = tileOpt->getInteger(2);
+        if (tileRows < 1 || tileCols < 1) throw OperationException("tile dimensions must be positive");
+    }
+    if (myParams->getOptionalParameter(4)->m_present)
+    {
+        if (tileOpt->m_present) throw OperationException("-tile-size and -standard are mutually exclusive");
+        tileRows = 0;
+        tileCols = 0;
+    }
+    int quantizeBits = 0;
+    OptionalParameter* quantizeOpt = myParams->getOptionalParameter(5);
+    if (quantizeOpt->m_present)
+    {
+        if (tileOpt->m_present || myParams->getOptionalParameter(4)->m_present) throw OperationException("-quantize can't be used with -tile-size or -standard");
+        quantizeBits = (int)quantizeOpt->getInteger(1);
+        if (quantizeBits != 8 && quantizeBits != 16) throw OperationException("quantization must be 8 or 16 bits");
+        tileRows = 0;
+        tileCols = 0;
+    }
+    const vector<int64_t>& dims = ciftiIn->getDimensions();
+    if (dims.size() != 2 && tileRows != 0) throw OperationException("tiled layout is only supported for 2D cifti files");
+    if (dims.size() != 2 && quantizeBits != 0) throw OperationException("quantized rows are only supported for 2D cifti files");
+    ciftiOut->setWritingTileSize(tileRows, tileCols);
+    ciftiOut->setWritingQuantization(quantizeBits);
+    ciftiOut->setCiftiXML(ciftiIn->getCiftiXML());
+    vector<int64_t> extraDims(dims.begin() + 1, dims.end());
+    vector<float> scratchRow(dims[0]);
+    for (MultiDimIterator<int64_t> iter(extraDims); !iter.atEnd(); ++iter)
+    {
+        ciftiIn->getRow(scratchRow.data(), *iter);
+        ciftiOut->setRow(scratchRow.data(), *iter);
+    }
+}
@@ -24,13 +24,48 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
+#include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiRowReader.h"
+#include "CiftiRowWriter.h"
 #include "CiftiXML.h"
 #include "MultiDimIterator.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int MAX_BATCH_ROWS = 1024;//output rows evaluated together
+    const int64_t MAX_BATCH_BYTES = ((int64_t)1) << 28;//limit batch storage plus the read-ahead and write-behind buffers to about 256MB
+    
+    //updates loadedRow to the row of the variable that is needed for this output row, returns whether it changed
+    bool getNeededRow(const vector<int64_t>& selectInfo, const vector<int64_t>& outIndex, vector<int64_t>& loadedRow)
+    {
+        bool needToLoad = false;
+        for (int dim = 0; dim < (int)loadedRow.size(); ++dim)
+        {
+            int64_t indexNeeded = -1;
+            if (selectInfo[dim + 1] == -1)
+            {
+                CaretAssert(dim < (int)outIndex.size());//"match to output index" can't work past output dimensionality
+                indexNeeded = outIndex[dim];//NOTE: iter also doesn't include the first dim
+            } else {
+                indexNeeded = selectInfo[dim + 1];
+            }
+            if (indexNeeded != loadedRow[dim])
+            {
+                needToLoad = true;
+                loadedRow[dim] = indexNeeded;
+            }
+        }
+        return needToLoad;
+    }
+}
+
 AString OperationCiftiMath::getCommandSwitch()
 {
     return "-cifti-math";
@@ -230,57 +265,112 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
+    const int64_t rowLength = outDims[0];
+    vector<int64_t> varRowLength(numVars);
+    int64_t bytesPerRow = rowLength * sizeof(float);//output row
+    for (int v = 0; v < numVars; ++v)
+    {
+        varRowLength[v] = varCiftiFiles[v]->getDimensions()[0];
+        bytesPerRow += varRowLength[v] * sizeof(float);
+    }
+    //each row of a batch exists twice: in the batch storage, and in a reader's read-ahead or the writer's write-behind buffers, which are also batchRows deep
+    int64_t batchRows = max((int64_t)1, min((int64_t)MAX_BATCH_ROWS, MAX_BATCH_BYTES / (2 * bytesPerRow)));
+    vector<vector<int64_t> > outRowList;
+    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    {
+        outRowList.push_back(*iter);
+    }
+    const int64_t numOutRows = (int64_t)outRowList.size();
     vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
+    vector<vector<vector<int64_t> > > rowsToLoad(numVars);//figure out the order rows will be needed in, so they can be read ahead
     for (int v = 0; v < numVars; ++v)
     {
-        inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
         loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
     }
-    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    for (int64_t r = 0; r < numOutRows; ++r)
     {
-        for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+        for (int v = 0; v < numVars; ++v)
         {
-            bool needToLoad = false;
-            for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
+            if (getNeededRow(selectInfo[v], outRowList[r], loadedRow[v]))
             {
-                int64_t indexNeeded = -1;
-                if (selectInfo[v][dim + 1] == -1)
-                {
-                    CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
-                    indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
-                } else {
-                    indexNeeded = selectInfo[v][dim + 1];
-                }
-                if (indexNeeded != loadedRow[v][dim])
-                {
-                    needToLoad = true;
-                    loadedRow[v][dim] = indexNeeded;
-                }
-            }
-            if (needToLoad)
-            {
-                varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                rowsToLoad[v].push_back(loadedRow[v]);
             }
         }
-        for (int j = 0; j < outDims[0]; ++j)
+    }
+    vector<CaretPointer<CiftiRowReader> > varReaders(numVars);
+    for (int v = 0; v < numVars; ++v)
+    {//read ahead a full batch, so the next batch is read while this one is evaluated
+        varReaders[v].grabNew(new CiftiRowReader(varCiftiFiles[v], rowsToLoad[v], (int)batchRows));
+        loadedRow[v].assign(loadedRow[v].size(), -1);
+    }
+    CiftiRowWriter myWriter(myCiftiOut, (int)batchRows);
+    //slot 0 of each variable's batch storage holds the row carried over from the previous batch, for when consecutive output rows use the same input row
+    vector<vector<float> > batchInput(numVars);
+    vector<vector<int64_t> > rowSlot(numVars, vector<int64_t>(batchRows));
+    vector<int64_t> lastSlot(numVars, -1);
+    for (int v = 0; v < numVars; ++v)
+    {
+        batchInput[v].resize((batchRows + 1) * varRowLength[v]);
+    }
+    vector<float> batchOutput(batchRows * rowLength);
+    for (int64_t batchStart = 0; batchStart < numOutRows; batchStart += batchRows)
+    {
+        int64_t thisBatch = min(batchRows, numOutRows - batchStart);
+        for (int v = 0; v < numVars; ++v)//read everything this batch needs first
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            if (lastSlot[v] > 0)
+            {
+                copy(batchInput[v].begin() + lastSlot[v] * varRowLength[v], batchInput[v].begin() + (lastSlot[v] + 1) * varRowLength[v], batchInput[v].begin());
+                lastSlot[v] = 0;
+            }
+            for (int64_t r = 0; r < thisBatch; ++r)
             {
-                if (selectInfo[v][0] == -1)
+                if (getNeededRow(selectInfo[v], outRowList[batchStart + r], loadedRow[v]))
                 {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
+                    ++lastSlot[v];
+                    const float* inputRow = varReaders[v]->nextRow();
+                    copy(inputRow, inputRow + varRowLength[v], batchInput[v].begin() + lastSlot[v] * varRowLength[v]);
                 }
+                CaretAssert(lastSlot[v] >= 0);
+                rowSlot[v][r] = lastSlot[v];
             }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
+        }
+#pragma omp CARET_PAR
+        {
+            vector<const float*> exprInputs(numVars, (const float*)NULL);
+            vector<vector<float> > selectRows(numVars);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t r = 0; r < thisBatch; ++r)
             {
-                scratchRow[j] = nanfixval;
+                for (int v = 0; v < numVars; ++v)//now we check for select along row
+                {
+                    const float* inputRow = batchInput[v].data() + rowSlot[v][r] * varRowLength[v];
+                    if (selectInfo[v][0] == -1)
+                    {
+                        exprInputs[v] = inputRow;
+                    } else {
+                        selectRows[v].assign(rowLength, inputRow[selectInfo[v][0]]);//the expression takes arrays, so repeat the selected value
+                        exprInputs[v] = selectRows[v].data();
+                    }
+                }
+                float* outRow = batchOutput.data() + r * rowLength;
+                myExpr.evaluate(exprInputs, outRow, rowLength);
+                if (nanfix)
+                {
+                    for (int64_t j = 0; j < rowLength; ++j)
+                    {
+                        if (outRow[j] != outRow[j])
+                        {
+                            outRow[j] = nanfixval;
+                        }
+                    }
+                }
             }
         }
-        myCiftiOut->setRow(scratchRow.data(), *iter);
+        for (int64_t r = 0; r < thisBatch; ++r)//the writer copies, and writes in order on its own thread
+        {
+            myWriter.setRow(batchOutput.data() + r * rowLength, outRowList[batchStart + r]);
+        }
     }
+    myWriter.finish();
 }
@@ -22,12 +22,14 @@
 #include "OperationException.h"
 
 #include "CaretHeap.h"
+#include "CaretMutex.h"
 #include "CaretSparseFile.h"
 #include "CiftiFile.h"
 #include "OxfordSparseThreeFile.h"
 #include "MetricFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <vector>
@@ -37,6 +39,51 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    class ReorderEncoder : public CaretSparseRowEncoder
+    {
+        OxfordSparseThreeFile& m_inFile;
+        const vector<int64_t>& m_rowReorder;
+        int64_t m_outRowLength;
+        CaretMutex m_readMutex;
+    public:
+        ReorderEncoder(OxfordSparseThreeFile& inFile, const vector<int64_t>& rowReorder, const int64_t& outRowLength) :
+            m_inFile(inFile), m_rowReorder(rowReorder), m_outRowLength(outRowLength) { }
+        void encodeRow(const int64_t& index, vector<int64_t>& encodedOut)
+        {
+            vector<int64_t> indicesIn, indicesOut;//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
+            vector<FiberFractions> fibersIn, fibersOut;//can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
+            CaretMinHeap<FiberFractions, int64_t> myHeap;//use our heap to do heapsort, rather than coding a struct for stl sort
+            {
+                CaretMutexLocker locked(&m_readMutex);//OxfordSparseThreeFile uses a single file handle, and a locker is released if the read throws
+                m_inFile.getFibersRowSparse(index, indicesIn, fibersIn);
+            }
+            size_t numNonzero = indicesIn.size();
+            myHeap.reserve(numNonzero);
+            for (size_t j = 0; j < numNonzero; ++j)
+            {
+                int64_t newIndex = m_rowReorder[indicesIn[j]];//reorder
+                if (newIndex != -1)
+                {
+                    myHeap.push(fibersIn[j], newIndex);//heapify
+                }
+            }
+            indicesOut.resize(myHeap.size());
+            fibersOut.resize(myHeap.size());
+            int64_t curIndex = 0;
+            while (!myHeap.isEmpty())
+            {
+                int64_t newIndex;
+                fibersOut[curIndex] = myHeap.pop(&newIndex);
+                indicesOut[curIndex] = newIndex;
+                ++curIndex;
+            }
+            CaretSparseFileWriter::encodeFibersRowSparse(m_outRowLength, indicesOut, fibersOut, encodedOut);
+        }
+    };
+}
+
 AString OperationConvertMatrix4ToWorkbenchSparse::getCommandSwitch()
 {
     return "-convert-matrix4-to-workbench-sparse";
@@ -181,33 +228,6 @@ void OperationConvertMatrix4ToWorkbenchSparse::useParameters(OperationParameters
         }
     }
     CaretSparseFileWriter mywriter(outFileName, myXML);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
-    vector<int64_t> indicesIn, indicesOut;//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
-    vector<FiberFractions> fibersIn, fibersOut;//can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
-    CaretMinHeap<FiberFractions, int64_t> myHeap;//use our heap to do heapsort, rather than coding a struct for stl sort
-    for (int64_t i = 0; i < sparseDims[1]; ++i)
-    {
-        inFile.getFibersRowSparse(i, indicesIn, fibersIn);
-        size_t numNonzero = indicesIn.size();
-        myHeap.reserve(numNonzero);
-        for (size_t j = 0; j < numNonzero; ++j)
-        {
-            int64_t newIndex = rowReorder[indicesIn[j]];//reorder
-            if (newIndex != -1)
-            {
-                myHeap.push(fibersIn[j], newIndex);//heapify
-            }
-        }
-        indicesOut.resize(myHeap.size());
-        fibersOut.resize(myHeap.size());
-        int64_t curIndex = 0;
-        while (!myHeap.isEmpty())
-        {
-            int64_t newIndex;
-            fibersOut[curIndex] = myHeap.pop(&newIndex);
-            indicesOut[curIndex] = newIndex;
-            ++curIndex;
-        }
-        mywriter.writeFibersRowSparse(i, indicesOut, fibersOut);
-    }
-    mywriter.finish();
+    ReorderEncoder myEncoder(inFile, rowReorder, myXML.getDimensionLength(CiftiXML::ALONG_ROW));
+    mywriter.writeRowsParallel(myEncoder);
 }
@@ -0,0 +1,132 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationMetricSmoothingPrecompute.h"
+#include "OperationException.h"
+
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+
+#include <QDir>
+
+using namespace caret;
+using namespace std;
+
+AString OperationMetricSmoothingPrecompute::getCommandSwitch()
+{
+    return "-metric-smoothing-precompute";
+}
+
+AString OperationMetricSmoothingPrecompute::getShortDescription()
+{
+    return "BUILD SMOOTHING KERNELS FOR LATER USE";
+}
+
+OperationParameters* OperationMetricSmoothingPrecompute::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addSurfaceParameter(1, "surface", "the surface that will be smoothed on");
+    
+    ret->addDoubleParameter(2, "smoothing-kernel", "the sigma for the gaussian kernel function, in mm");
+    
+    ret->addStringParameter(3, "cache-directory", "the directory to save the kernel file in");
+    
+    OptionalParameter* roiOption = ret->createOptionalParameter(4, "-roi", "build the kernels for smoothing within a region of interest");
+    roiOption->addMetricParameter(1, "roi-metric", "the roi that will be used, as a metric");
+    
+    OptionalParameter* corrAreaOpt = ret->createOptionalParameter(5, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
+    corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
+    
+    OptionalParameter* methodSelect = ret->createOptionalParameter(6, "-method", "select smoothing method, default GEO_GAUSS_AREA");
+    methodSelect->addStringParameter(1, "method", "the name of the smoothing method");
+    
+    ret->setHelpText(
+        AString("Computes the smoothing kernels that -metric-smoothing would use with the same surface, kernel, roi, corrected areas and method, ") +
+        "and saves them in the cache directory, so that -metric-smoothing or -cifti-smoothing with -kernel-cache pointing to that directory " +
+        "can load them instead of recomputing them.  " +
+        "If a matching kernel file already exists, it is left as is.\n\n" +
+        "The roi must match exactly, including non-binary values, for the kernels to be found, only the first column is used.  " +
+        "To prepare for -cifti-smoothing, use the structure's roi output by -cifti-separate on the cifti file that will be smoothed.  " +
+        "See -metric-smoothing for the valid values of <method>."
+    );
+    return ret;
+}
+
+void OperationMetricSmoothingPrecompute::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    SurfaceFile* mySurf = myParams->getSurface(1);
+    float myKernel = (float)myParams->getDouble(2);
+    AString cacheDir = myParams->getString(3);
+    if (myKernel <= 0.0f)
+    {
+        throw OperationException("invalid kernel size");
+    }
+    if (!QDir(cacheDir).exists())
+    {
+        throw OperationException("cache directory '" + cacheDir + "' does not exist");
+    }
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    MetricFile* myRoi = NULL;
+    OptionalParameter* roiOption = myParams->getOptionalParameter(4);
+    if (roiOption->m_present)
+    {
+        myRoi = roiOption->getMetric(1);
+        if (myRoi->getNumberOfNodes() != numNodes)
+        {
+            throw OperationException("roi metric does not match surface in number of vertices");
+        }
+    }
+    const float* areaData = NULL;
+    OptionalParameter* corrAreaOpt = myParams->getOptionalParameter(5);
+    if (corrAreaOpt->m_present)
+    {
+        MetricFile* corrAreaMetric = corrAreaOpt->getMetric(1);
+        if (corrAreaMetric->getNumberOfNodes() != numNodes)
+        {
+            throw OperationException("corrected vertex areas metric does not match surface in number of vertices");
+        }
+        areaData = corrAreaMetric->getValuePointerForColumn(0);
+    }
+    MetricSmoothingObject::Method myMethod = MetricSmoothingObject::GEO_GAUSS_AREA;
+    OptionalParameter* methodSelect = myParams->getOptionalParameter(6);
+    if (methodSelect->m_present)
+    {
+        AString methodName = methodSelect->getString(1);
+        if (methodName == "GEO_GAUSS_AREA")
+        {
+            myMethod = MetricSmoothingObject::GEO_GAUSS_AREA;
+        } else if (methodName == "GEO_GAUSS_EQUAL") {
+            myMethod = MetricSmoothingObject::GEO_GAUSS_EQUAL;
+        } else if (methodName == "GEO_GAUSS") {
+            myMethod = MetricSmoothingObject::GEO_GAUSS;
+        } else {
+            throw OperationException("unknown smoothing method name");
+        }
+    }
+    MetricSmoothingObject mySmooth(mySurf, myKernel, myRoi, myMethod, areaData, cacheDir);
+    try
+    {
+        mySmooth.saveCacheFile();
+    } catch (CaretException& e) {
+        throw OperationException("failed to save smoothing kernel file: " + e.whatString());
+    }
+}
@@ -161,15 +161,16 @@ void OperationSurfaceGeodesicROIs::useParameters(OperationParameters* myParams,
                                             ", " + AString::number(myCoord[2], 'f', 1) + ")");
         }
     }
+    vector<vector<int32_t> > allNodes;
+    vector<vector<float> > allDists;
+    mySurf->getGeodesicHelper()->getNodesToGeoDist(nodelist, limit, allNodes, allDists);//all seeds at once, in parallel
     switch (overlapType)
     {
         case 1://ALLOW
             for (int i = 0; i < (int)nodelist.size(); ++i)
             {
-                CaretPointer<GeodesicHelper> myhelp = mySurf->getGeodesicHelper();
-                vector<int32_t> roinodes;
-                vector<float> dists;
-                myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                const vector<int32_t>& roinodes = allNodes[i];
+                vector<float>& dists = allDists[i];
                 if (sigma > 0.0f)
                 {
                     double accum = 0.0;
@@ -199,10 +200,8 @@ void OperationSurfaceGeodesicROIs::useParameters(OperationParameters* myParams,
             vector<float> bestDists(numNodes, -1.0f);
             for (int i = 0; i < (int)nodelist.size(); ++i)
             {
-                CaretPointer<GeodesicHelper> myhelp = mySurf->getGeodesicHelper();
-                vector<int32_t> roinodes;
-                vector<float> dists;
-                myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                const vector<int32_t>& roinodes = allNodes[i];
+                const vector<float>& dists = allDists[i];
                 for (int j = 0; j < (int)roinodes.size(); ++j)
                 {
                     ++useCounts[roinodes[j]];
@@ -26,6 +26,69 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{//CaretSparseFile reads are safe from multiple threads
+    class RowMergeEncoder : public CaretSparseRowEncoder
+    {
+        vector<CaretPointer<CaretSparseFile> >& m_wbsparseList;
+        const vector<int>& m_sourceWbsparse;
+        const vector<int64_t>& m_modelStart, &m_modelEnd;
+        int64_t m_outRowLength;
+    public:
+        RowMergeEncoder(vector<CaretPointer<CaretSparseFile> >& wbsparseList, const vector<int>& sourceWbsparse,
+                        const vector<int64_t>& modelStart, const vector<int64_t>& modelEnd, const int64_t& outRowLength) :
+            m_wbsparseList(wbsparseList), m_sourceWbsparse(sourceWbsparse), m_modelStart(modelStart), m_modelEnd(modelEnd), m_outRowLength(outRowLength) { }
+        void encodeRow(const int64_t& index, vector<int64_t>& encodedOut)
+        {
+            vector<int64_t> outIndices, outValues, inIndices, inValues;
+            int64_t curOffset = 0;
+            int loaded = -1;
+            int numOutModels = (int)m_sourceWbsparse.size();
+            for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
+            {
+                int64_t startIndex = m_modelStart[j], endIndex = m_modelEnd[j];
+                if (endIndex > startIndex)
+                {
+                    if (loaded != m_sourceWbsparse[j])
+                    {
+                        m_wbsparseList[m_sourceWbsparse[j]]->getRowSparse(index, inIndices, inValues);
+                        loaded = m_sourceWbsparse[j];
+                    }
+                    int64_t numSparse = (int64_t)inIndices.size();
+                    for (int64_t k = 0; k < numSparse; ++k)
+                    {
+                        if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
+                        {
+                            outIndices.push_back(inIndices[k] + curOffset);
+                            outValues.push_back(inValues[k]);
+                        }
+                    }
+                    curOffset += endIndex - startIndex;
+                }
+            }
+            CaretSparseFileWriter::encodeRowSparse(m_outRowLength, outIndices, outValues, encodedOut);
+        }
+    };
+    
+    class ColumnMergeEncoder : public CaretSparseRowEncoder
+    {
+        vector<CaretPointer<CaretSparseFile> >& m_wbsparseList;
+        const vector<int>& m_rowSourceFile;
+        const vector<int64_t>& m_rowSourceIndex;
+        int64_t m_outRowLength;
+    public:
+        ColumnMergeEncoder(vector<CaretPointer<CaretSparseFile> >& wbsparseList, const vector<int>& rowSourceFile,
+                           const vector<int64_t>& rowSourceIndex, const int64_t& outRowLength) :
+            m_wbsparseList(wbsparseList), m_rowSourceFile(rowSourceFile), m_rowSourceIndex(rowSourceIndex), m_outRowLength(outRowLength) { }
+        void encodeRow(const int64_t& index, vector<int64_t>& encodedOut)
+        {
+            vector<int64_t> inIndices, inValues;
+            m_wbsparseList[m_rowSourceFile[index]]->getRowSparse(m_rowSourceIndex[index], inIndices, inValues);
+            CaretSparseFileWriter::encodeRowSparse(m_outRowLength, inIndices, inValues, encodedOut);
+        }
+    };
+}
+
 AString OperationWbsparseMergeDense::getCommandSwitch()
 {
     return "-wbsparse-merge-dense";
@@ -151,84 +214,52 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     outXML.setMap(myDir, newDenseMap);
     int numOutModels = (int)sourceWbsparse.size();
     CaretAssert(numOutModels == (int)newDenseMap.getModelInfo().size());
-    int64_t outColSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
     CaretSparseFileWriter myWriter(outputName, outXML);
     vector<CiftiBrainModelsMap::ModelInfo> outModelInfo = newDenseMap.getModelInfo();
+    int64_t outRowLength = outXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    vector<int> rowSourceFile;//for each output row, which input and which row of it - rows are read and encoded in parallel, then written in order
+    vector<int64_t> rowSourceIndex;
+    vector<int64_t> modelStart(numOutModels, 0), modelEnd(numOutModels, 0);
     switch (myDir)
     {
         case CiftiXML::ALONG_ROW:
         {
-            for (int64_t i = 0; i < outColSize; ++i)
+            for (int j = 0; j < numOutModels; ++j)//look up the ranges once, rather than for every row
             {
-                int64_t curOffset = 0;
-                vector<int64_t> outIndices, outValues, inIndices, inValues;
-                int loaded = -1;
-                for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
+                const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
+                const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
+                const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
+                switch (myInfo.m_type)
                 {
-                    const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
-                    const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
-                    const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
-                    int64_t startIndex = -1, endIndex = -1;
-                    switch (myInfo.m_type)
+                    case CiftiBrainModelsMap::SURFACE:
                     {
-                        case CiftiBrainModelsMap::SURFACE:
+                        vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
+                            modelStart[j] = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            modelEnd[j] = modelStart[j] + tempMap.size();
                         }
-                        case CiftiBrainModelsMap::VOXELS:
-                        {
-                            vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
-                        }
-                        default:
-                            CaretAssert(false);
-                            break;
+                        break;
                     }
-                    if (endIndex > startIndex)
+                    case CiftiBrainModelsMap::VOXELS:
                     {
-                        if (loaded != sourceWbsparse[j])
+                        vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(i, inIndices, inValues);
-                            loaded = sourceWbsparse[j];
+                            modelStart[j] = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            modelEnd[j] = modelStart[j] + tempMap.size();
                         }
-                        int64_t numSparse = (int64_t)inIndices.size();
-                        for (int64_t k = 0; k < numSparse; ++k)
-                        {
-                            if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
-                            {
-                                outIndices.push_back(inIndices[k] + curOffset);
-                                outValues.push_back(inValues[k]);
-                            }
-                        }
-                        curOffset += endIndex - startIndex;
+                        break;
                     }
+                    default:
+                        CaretAssert(false);
+                        break;
                 }
-                myWriter.writeRowSparse(i, outIndices, outValues);
-                outIndices.clear();//reset for next row
-                outValues.clear();
             }
             break;
         }
         case CiftiXML::ALONG_COLUMN:
         {
-            vector<int64_t> inIndices, inValues;
             for (int j = 0; j < numOutModels; ++j)
             {
                 const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
@@ -244,8 +275,9 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                         for (int64_t k = 0; k < mapSize; ++k)
                         {
                             CaretAssert(tempMap[k].m_surfaceNode == outMap[k].m_surfaceNode);
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(tempMap[k].m_ciftiIndex, inIndices, inValues);
-                            myWriter.writeRowSparse(outMap[k].m_ciftiIndex, inIndices, inValues);
+                            CaretAssert(outMap[k].m_ciftiIndex == (int64_t)rowSourceIndex.size());
+                            rowSourceFile.push_back(sourceWbsparse[j]);
+                            rowSourceIndex.push_back(tempMap[k].m_ciftiIndex);
                         }
                         break;
                     }
@@ -259,8 +291,9 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                             CaretAssert(tempMap[k].m_ijk[0] == outMap[k].m_ijk[0]);
                             CaretAssert(tempMap[k].m_ijk[1] == outMap[k].m_ijk[1]);
                             CaretAssert(tempMap[k].m_ijk[2] == outMap[k].m_ijk[2]);
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(tempMap[k].m_ciftiIndex, inIndices, inValues);
-                            myWriter.writeRowSparse(outMap[k].m_ciftiIndex, inIndices, inValues);
+                            CaretAssert(outMap[k].m_ciftiIndex == (int64_t)rowSourceIndex.size());
+                            rowSourceFile.push_back(sourceWbsparse[j]);
+                            rowSourceIndex.push_back(tempMap[k].m_ciftiIndex);
                         }
                         break;
                     }
@@ -269,11 +302,19 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                         break;
                 }
             }
+            CaretAssert((int64_t)rowSourceIndex.size() == outXML.getDimensionLength(CiftiXML::ALONG_COLUMN));
             break;
         }
         default:
             CaretAssert(false);
             break;
     }
-    myWriter.finish();
+    if (myDir == CiftiXML::ALONG_ROW)
+    {
+        RowMergeEncoder myEncoder(wbsparseList, sourceWbsparse, modelStart, modelEnd, outRowLength);
+        myWriter.writeRowsParallel(myEncoder);
+    } else {
+        ColumnMergeEncoder myEncoder(wbsparseList, rowSourceFile, rowSourceIndex, outRowLength);
+        myWriter.writeRowsParallel(myEncoder);
+    }
 }
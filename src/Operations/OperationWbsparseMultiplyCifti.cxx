@@ -0,0 +1,143 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationWbsparseMultiplyCifti.h"
+#include "OperationException.h"
+
+#include "CaretSparseFile.h"
+#include "CiftiFile.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    class MultiplyProcessor : public CaretRowBlockProcessor<vector<float> >
+    {
+        CaretSparseFile& m_sparseIn;
+        const vector<float>& m_denseData;
+        int64_t m_denseCols;
+        bool m_fibers, m_normalize;
+        CiftiFile* m_ciftiOut;
+    public:
+        MultiplyProcessor(CaretSparseFile& sparseIn, const vector<float>& denseData, const int64_t& denseCols, const bool& fibers, const bool& normalize, CiftiFile* ciftiOut) :
+            m_sparseIn(sparseIn), m_denseData(denseData), m_denseCols(denseCols), m_fibers(fibers), m_normalize(normalize), m_ciftiOut(ciftiOut) { }
+        void computeRow(const int64_t& index, vector<float>& rowOut)
+        {
+            vector<int64_t> indices, values;
+            vector<double> accum(m_denseCols, 0.0);
+            m_sparseIn.getRowSparse(index, indices, values);
+            double rowSum = 0.0;
+            int64_t numNonzero = (int64_t)indices.size();
+            for (int64_t j = 0; j < numNonzero; ++j)
+            {
+                double weight = (m_fibers ? CaretSparseFile::getFiberTotalCount(values[j]) : values[j]);
+                rowSum += weight;
+                const float* denseRow = m_denseData.data() + indices[j] * m_denseCols;
+                for (int64_t k = 0; k < m_denseCols; ++k)
+                {
+                    accum[k] += weight * denseRow[k];
+                }
+            }
+            double scale = 1.0;
+            if (m_normalize)
+            {
+                scale = (rowSum != 0.0 ? 1.0 / rowSum : 0.0);
+            }
+            rowOut.resize(m_denseCols);
+            for (int64_t k = 0; k < m_denseCols; ++k)
+            {
+                rowOut[k] = accum[k] * scale;
+            }
+        }
+        void writeRow(const int64_t& index, const vector<float>& row)
+        {
+            m_ciftiOut->setRow(row.data(), index);
+        }
+    };
+}
+
+AString OperationWbsparseMultiplyCifti::getCommandSwitch()
+{
+    return "-wbsparse-multiply-cifti";
+}
+
+AString OperationWbsparseMultiplyCifti::getShortDescription()
+{
+    return "MULTIPLY A WBSPARSE MATRIX BY A CIFTI FILE";
+}
+
+OperationParameters* OperationWbsparseMultiplyCifti::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addStringParameter(1, "wbsparse-in", "the sparse matrix");
+    
+    ret->addCiftiParameter(2, "cifti-in", "the dense cifti file to multiply by");
+    
+    ret->addCiftiOutputParameter(3, "cifti-out", "the output cifti file");
+    
+    ret->createOptionalParameter(4, "-fibers", "the input is a fiber trajectory file, use the total streamline count as the value");
+    
+    ret->createOptionalParameter(5, "-normalize-rows", "divide each row of the sparse matrix by its sum before multiplying");
+    
+    ret->setHelpText(
+        AString("Computes the matrix product of the wbsparse file and the cifti file, using only the stored nonzero values of the wbsparse file.  ") +
+        "The mapping along the columns of the cifti file (down a column) must match the mapping along the rows of the wbsparse file.  " +
+        "The output has the wbsparse file's column mapping down its columns, and the cifti file's row mapping along its rows.  " +
+        "The cifti file is loaded into memory, the wbsparse file is not.\n\n" +
+        "With -normalize-rows, each row of the sparse matrix is scaled to sum to 1, so the output is a weighted average of the cifti rows, " +
+        "for instance the mean of the cifti data over the streamlines from each seed.  Rows that sum to zero produce zeros."
+    );
+    return ret;
+}
+
+void OperationWbsparseMultiplyCifti::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CaretSparseFile sparseIn(myParams->getString(1));
+    const CiftiFile* ciftiIn = myParams->getCifti(2);
+    CiftiFile* ciftiOut = myParams->getOutputCifti(3);
+    bool fibers = myParams->getOptionalParameter(4)->m_present;
+    bool normalize = myParams->getOptionalParameter(5)->m_present;
+    const CiftiXML& sparseXML = sparseIn.getCiftiXML(), &denseXML = ciftiIn->getCiftiXML();
+    if (denseXML.getNumberOfDimensions() != 2) throw OperationException("cifti file must have 2 dimensions");
+    if (*(sparseXML.getMap(CiftiXML::ALONG_ROW)) != *(denseXML.getMap(CiftiXML::ALONG_COLUMN)))
+    {
+        throw OperationException("cifti column mapping does not match wbsparse row mapping");
+    }
+    const int64_t* dims = sparseIn.getDimensions();
+    const int64_t numSparseRows = dims[1];
+    const int64_t denseRows = denseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), denseCols = denseXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    CaretAssert(denseRows == dims[0]);
+    CiftiXML outXML;
+    outXML.setNumberOfDimensions(2);
+    outXML.setMap(CiftiXML::ALONG_COLUMN, *(sparseXML.getMap(CiftiXML::ALONG_COLUMN)));
+    outXML.setMap(CiftiXML::ALONG_ROW, *(denseXML.getMap(CiftiXML::ALONG_ROW)));
+    ciftiOut->setCiftiXML(outXML);
+    vector<float> denseData(denseRows * denseCols);
+    for (int64_t i = 0; i < denseRows; ++i)
+    {
+        ciftiIn->getRow(denseData.data() + i * denseCols, i);
+    }
+    MultiplyProcessor myProcessor(sparseIn, denseData, denseCols, fibers, normalize, ciftiOut);
+    processRowBlocks(numSparseRows, 1024, myProcessor);//output rows are computed in parallel a block at a time, then written in order
+}
@@ -0,0 +1,277 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationWbsparseReduce.h"
+#include "OperationException.h"
+
+#include "CaretOMP.h"
+#include "CaretSparseFile.h"
+#include "CiftiFile.h"
+#include "ReductionEnum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+AString OperationWbsparseReduce::getCommandSwitch()
+{
+    return "-wbsparse-reduce";
+}
+
+AString OperationWbsparseReduce::getShortDescription()
+{
+    return "PERFORM REDUCTION ON A WBSPARSE FILE WITHOUT EXPANDING IT";
+}
+
+OperationParameters* OperationWbsparseReduce::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addStringParameter(1, "wbsparse-in", "the wbsparse file to reduce");
+    
+    ret->addStringParameter(2, "direction", "which dimension to reduce along, ROW or COLUMN");
+    
+    ret->addStringParameter(3, "operation", "the reduction operator to use");
+    
+    ret->addCiftiOutputParameter(4, "cifti-out", "the output cifti file");
+    
+    ret->createOptionalParameter(5, "-fibers", "the input is a fiber trajectory file, use the total streamline count as the value");
+    
+    ret->setHelpText(
+        AString("Performs the specified reduction on the data along each row (ROW) or each column (COLUMN) of the wbsparse file, using only the stored nonzero values, ") +
+        "so the matrix is never expanded in memory.  Zeros that are not stored are still counted by all operators.  " +
+        "The output is a single-column cifti file.  The supported reduction operators are:\n\n" +
+        "MAX: the maximum value\nMIN: the minimum value\nSUM: the sum of the values\nMEAN: the mean of the values\n" +
+        "STDEV: the standard deviation (N denominator)\nSAMPSTDEV: the sample standard deviation (N-1 denominator)\nVARIANCE: the variance of the values\n" +
+        "COUNT_NONZERO: the number of nonzero values"
+    );
+    return ret;
+}
+
+namespace
+{
+    //sparse-aware statistics: the numNonzero stored values plus (length - numNonzero) implicit zeros
+    float finishReduction(const ReductionEnum::Enum& myReduce, const int64_t& length, const int64_t& numNonzero, const double& sum, const double& residSqr, const double& maxVal, const double& minVal)
+    {
+        switch (myReduce)
+        {
+            case ReductionEnum::MAX:
+                if (numNonzero < length) return max(maxVal, 0.0);
+                return maxVal;
+            case ReductionEnum::MIN:
+                if (numNonzero < length) return min(minVal, 0.0);
+                return minVal;
+            case ReductionEnum::SUM:
+                return sum;
+            case ReductionEnum::MEAN:
+                return sum / length;
+            case ReductionEnum::STDEV:
+                return sqrt(residSqr / length);
+            case ReductionEnum::SAMPSTDEV:
+                return sqrt(residSqr / (length - 1));
+            case ReductionEnum::VARIANCE:
+                return residSqr / length;
+            case ReductionEnum::COUNT_NONZERO:
+                return numNonzero;
+            default:
+                CaretAssert(false);
+                return 0.0f;
+        }
+    }
+    
+    bool needsResiduals(const ReductionEnum::Enum& myReduce)
+    {
+        return myReduce == ReductionEnum::STDEV || myReduce == ReductionEnum::SAMPSTDEV || myReduce == ReductionEnum::VARIANCE;
+    }
+}
+
+void OperationWbsparseReduce::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CaretSparseFile sparseIn(myParams->getString(1));
+    AString directionName = myParams->getString(2);
+    int myDir;
+    if (directionName == "ROW")
+    {
+        myDir = CiftiXML::ALONG_ROW;
+    } else if (directionName == "COLUMN") {
+        myDir = CiftiXML::ALONG_COLUMN;
+    } else {
+        throw OperationException("incorrect string for direction, use ROW or COLUMN");
+    }
+    AString opString = myParams->getString(3);
+    bool ok = false;
+    ReductionEnum::Enum myReduce = ReductionEnum::fromName(opString, &ok);
+    if (!ok) throw OperationException("unrecognized operation string '" + opString + "'");
+    switch (myReduce)
+    {
+        case ReductionEnum::MAX:
+        case ReductionEnum::MIN:
+        case ReductionEnum::SUM:
+        case ReductionEnum::MEAN:
+        case ReductionEnum::STDEV:
+        case ReductionEnum::SAMPSTDEV:
+        case ReductionEnum::VARIANCE:
+        case ReductionEnum::COUNT_NONZERO:
+            break;
+        default:
+            throw OperationException("operation '" + opString + "' is not supported on wbsparse files");
+    }
+    CiftiFile* ciftiOut = myParams->getOutputCifti(4);
+    bool fibers = myParams->getOptionalParameter(5)->m_present;
+    const int64_t* dims = sparseIn.getDimensions();
+    const int64_t rowLength = dims[0], numRows = dims[1];
+    int64_t reduceLength = (myDir == CiftiXML::ALONG_ROW ? rowLength : numRows);
+    if (myReduce == ReductionEnum::SAMPSTDEV && reduceLength < 2) throw OperationException("SAMPSTDEV reduction would require dividing by zero");
+    const CiftiXML& inXML = sparseIn.getCiftiXML();
+    CiftiXML outXML;
+    outXML.setNumberOfDimensions(2);
+    outXML.setMap(CiftiXML::ALONG_COLUMN, *(inXML.getMap(1 - myDir)));//the dimension we don't reduce along is what remains
+    CiftiScalarsMap outRowMap;
+    outRowMap.setLength(1);
+    outRowMap.setMapName(0, ReductionEnum::toName(myReduce));
+    outXML.setMap(CiftiXML::ALONG_ROW, outRowMap);
+    ciftiOut->setCiftiXML(outXML);
+    vector<float> outCol(myDir == CiftiXML::ALONG_ROW ? numRows : rowLength);
+    bool readOK = true;
+    AString errorMessage;
+    if (myDir == CiftiXML::ALONG_ROW)
+    {//rows are independent, CaretSparseFile reads are safe from multiple threads
+#pragma omp CARET_PAR
+        {
+            vector<int64_t> indices, values;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < numRows; ++i)
+            {
+                try
+                {
+                    sparseIn.getRowSparse(i, indices, values);
+                } catch (CaretException& e) {//can't throw out of a parallel region
+#pragma omp critical
+                    {
+                        readOK = false;
+                        errorMessage = e.whatString();
+                    }
+                    continue;
+                }
+                int64_t numNonzero = (int64_t)values.size();
+                double sum = 0.0, maxVal = 0.0, minVal = 0.0, residSqr = 0.0;
+                for (int64_t j = 0; j < numNonzero; ++j)
+                {
+                    double value = (fibers ? CaretSparseFile::getFiberTotalCount(values[j]) : values[j]);
+                    sum += value;
+                    if (j == 0 || value > maxVal) maxVal = value;
+                    if (j == 0 || value < minVal) minVal = value;
+                }
+                if (needsResiduals(myReduce))
+                {
+                    double mean = sum / rowLength;
+                    for (int64_t j = 0; j < numNonzero; ++j)
+                    {
+                        double value = (fibers ? CaretSparseFile::getFiberTotalCount(values[j]) : values[j]);
+                        residSqr += (value - mean) * (value - mean);
+                    }
+                    residSqr += (rowLength - numNonzero) * mean * mean;
+                }
+                outCol[i] = finishReduction(myReduce, rowLength, numNonzero, sum, residSqr, maxVal, minVal);
+            }
+        }
+    } else {//columns are scattered across rows, so each thread accumulates its own column statistics, then they are combined
+        vector<double> sum(rowLength, 0.0), maxVal(rowLength, 0.0), minVal(rowLength, 0.0), residSqr(rowLength, 0.0);
+        vector<int64_t> numNonzero(rowLength, 0);
+        for (int pass = 0; pass < (needsResiduals(myReduce) ? 2 : 1); ++pass)
+        {
+#pragma omp CARET_PAR
+            {
+                vector<int64_t> indices, values, myNonzero;
+                vector<double> mySum, myMax, myMin, myResid;
+                if (pass == 0)
+                {
+                    myNonzero.resize(rowLength, 0);
+                    mySum.resize(rowLength, 0.0);
+                    myMax.resize(rowLength, 0.0);
+                    myMin.resize(rowLength, 0.0);
+                } else {
+                    myResid.resize(rowLength, 0.0);
+                }
+#pragma omp CARET_FOR schedule(dynamic, 64)
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    try
+                    {
+                        sparseIn.getRowSparse(i, indices, values);
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        {
+                            readOK = false;
+                            errorMessage = e.whatString();
+                        }
+                        continue;
+                    }
+                    int64_t rowNonzero = (int64_t)values.size();
+                    for (int64_t j = 0; j < rowNonzero; ++j)
+                    {
+                        int64_t col = indices[j];
+                        double value = (fibers ? CaretSparseFile::getFiberTotalCount(values[j]) : values[j]);
+                        if (pass == 0)
+                        {
+                            if (myNonzero[col] == 0 || value > myMax[col]) myMax[col] = value;
+                            if (myNonzero[col] == 0 || value < myMin[col]) myMin[col] = value;
+                            mySum[col] += value;
+                            ++myNonzero[col];
+                        } else {
+                            double diff = value - sum[col] / numRows;
+                            myResid[col] += diff * diff;
+                        }
+                    }
+                }
+#pragma omp critical
+                {
+                    for (int64_t col = 0; col < rowLength; ++col)
+                    {
+                        if (pass == 0)
+                        {
+                            if (myNonzero[col] != 0)
+                            {
+                                if (numNonzero[col] == 0 || myMax[col] > maxVal[col]) maxVal[col] = myMax[col];
+                                if (numNonzero[col] == 0 || myMin[col] < minVal[col]) minVal[col] = myMin[col];
+                                numNonzero[col] += myNonzero[col];
+                                sum[col] += mySum[col];//values are integers, so the order of summation doesn't change the result
+                            }
+                        } else {
+                            residSqr[col] += myResid[col];
+                        }
+                    }
+                }
+            }
+            if (!readOK) throw OperationException(errorMessage);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+        for (int64_t col = 0; col < rowLength; ++col)
+        {
+            double mean = sum[col] / numRows;
+            outCol[col] = finishReduction(myReduce, numRows, numNonzero[col], sum[col], residSqr[col] + (numRows - numNonzero[col]) * mean * mean, maxVal[col], minVal[col]);
+        }
+    }
+    if (!readOK) throw OperationException(errorMessage);
+    ciftiOut->setColumn(outCol.data(), 0);
+}
@@ -0,0 +1,126 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationWbsparseThreshold.h"
+#include "OperationException.h"
+
+#include "CaretSparseFile.h"
+#include "FileInformation.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    class ThresholdEncoder : public CaretSparseRowEncoder
+    {
+        CaretSparseFile& m_sparseIn;
+        int64_t m_rowLength, m_minimum;
+        double m_rowFraction;
+        bool m_fibers;
+    public:
+        ThresholdEncoder(CaretSparseFile& sparseIn, const int64_t& minimum, const double& rowFraction, const bool& fibers) :
+            m_sparseIn(sparseIn), m_rowLength(sparseIn.getDimensions()[0]), m_minimum(minimum), m_rowFraction(rowFraction), m_fibers(fibers) { }
+        //CaretSparseFile reads are safe from multiple threads
+        void encodeRow(const int64_t& index, vector<int64_t>& encodedOut)
+        {
+            vector<int64_t> indicesIn, valuesIn, indicesOut, valuesOut;
+            m_sparseIn.getRowSparse(index, indicesIn, valuesIn);
+            int64_t numNonzero = (int64_t)valuesIn.size();
+            int64_t rowMax = 0;
+            if (m_rowFraction > 0.0)
+            {
+                for (int64_t j = 0; j < numNonzero; ++j)
+                {
+                    int64_t value = (m_fibers ? CaretSparseFile::getFiberTotalCount(valuesIn[j]) : valuesIn[j]);
+                    if (j == 0 || value > rowMax) rowMax = value;
+                }
+            }
+            double rowMinimum = m_rowFraction * rowMax;
+            for (int64_t j = 0; j < numNonzero; ++j)
+            {
+                int64_t value = (m_fibers ? CaretSparseFile::getFiberTotalCount(valuesIn[j]) : valuesIn[j]);
+                if (value >= m_minimum && value >= rowMinimum)
+                {
+                    indicesOut.push_back(indicesIn[j]);
+                    valuesOut.push_back(valuesIn[j]);
+                }
+            }
+            CaretSparseFileWriter::encodeRowSparse(m_rowLength, indicesOut, valuesOut, encodedOut);
+        }
+    };
+}
+
+AString OperationWbsparseThreshold::getCommandSwitch()
+{
+    return "-wbsparse-threshold";
+}
+
+AString OperationWbsparseThreshold::getShortDescription()
+{
+    return "REMOVE SMALL VALUES FROM A WBSPARSE FILE";
+}
+
+OperationParameters* OperationWbsparseThreshold::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addStringParameter(1, "wbsparse-in", "the wbsparse file to threshold");
+    
+    ret->addIntegerParameter(2, "minimum", "the smallest value to keep");
+    
+    ret->addStringParameter(3, "wbsparse-out", "output - the output wbsparse file");//HACK: fake the output format since we don't have a wbsparse parameter type (or file type, really)
+    
+    ret->createOptionalParameter(4, "-fibers", "the input is a fiber trajectory file, compare the total streamline count to the threshold");
+    
+    OptionalParameter* rowFracOpt = ret->createOptionalParameter(5, "-row-fraction", "also remove values that are small compared to their row");
+    rowFracOpt->addDoubleParameter(1, "fraction", "fraction of the row's maximum value that a value must reach to be kept");
+    
+    ret->setHelpText(
+        AString("Removes every stored value that is less than the minimum, so that later operations have less data to process.  ") +
+        "With -fibers, entries are compared by their total streamline count, and kept entries are copied unchanged.  " +
+        "Rows are processed in parallel and directly on the sparse representation."
+    );
+    return ret;
+}
+
+void OperationWbsparseThreshold::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CaretSparseFile sparseIn(myParams->getString(1));
+    int64_t minimum = myParams->getInteger(2);
+    AString outputName = myParams->getString(3);
+    if (FileInformation(myParams->getString(1)).getCanonicalFilePath() == FileInformation(outputName).getCanonicalFilePath())
+    {//the writer would truncate the file that the input is mapped from
+        throw OperationException("can't write a sparse file over the file it is being read from");
+    }
+    bool fibers = myParams->getOptionalParameter(4)->m_present;
+    OptionalParameter* rowFracOpt = myParams->getOptionalParameter(5);
+    double rowFraction = 0.0;
+    if (rowFracOpt->m_present)
+    {
+        rowFraction = rowFracOpt->getDouble(1);
+        if (rowFraction < 0.0 || rowFraction > 1.0) throw OperationException("row fraction must be between 0 and 1");
+    }
+    CaretSparseFileWriter myWriter(outputName, sparseIn.getCiftiXML());
+    ThresholdEncoder myEncoder(sparseIn, minimum, rowFraction, fibers);
+    myWriter.writeRowsParallel(myEncoder);
+}
@@ -0,0 +1,235 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationWbsparseTranspose.h"
+#include "OperationException.h"
+
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretOMP.h"
+#include "CaretSparseFile.h"
+#include "FileInformation.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+AString OperationWbsparseTranspose::getCommandSwitch()
+{
+    return "-wbsparse-transpose";
+}
+
+AString OperationWbsparseTranspose::getShortDescription()
+{
+    return "TRANSPOSE A WBSPARSE FILE";
+}
+
+OperationParameters* OperationWbsparseTranspose::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addStringParameter(1, "wbsparse-in", "the input wbsparse file");
+    
+    ret->addStringParameter(2, "wbsparse-out", "output - the output wbsparse file");//HACK: fake the output format since we don't have a wbsparse parameter type (or file type, really)
+    
+    OptionalParameter* memLimitOpt = ret->createOptionalParameter(3, "-mem-limit", "restrict memory usage");
+    memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
+    
+    ret->setHelpText(
+        AString("The output is a wbsparse file where every row in the input is a column in the output.  ") +
+        "Values are copied unchanged, so fiber trajectory files can also be transposed.  " +
+        "Only the nonzero values are moved, and if a memory limit is given, the output is built in groups of rows that fit within it, " +
+        "reading the input once per group."
+    );
+    return ret;
+}
+
+void OperationWbsparseTranspose::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CaretSparseFile sparseIn(myParams->getString(1));
+    AString outputName = myParams->getString(2);
+    if (FileInformation(myParams->getString(1)).getCanonicalFilePath() == FileInformation(outputName).getCanonicalFilePath())
+    {//the writer would truncate the file that the input is mapped from
+        throw OperationException("can't write a sparse file over the file it is being read from");
+    }
+    OptionalParameter* memLimitOpt = myParams->getOptionalParameter(3);
+    float memLimitGB = -1.0f;
+    if (memLimitOpt->m_present)
+    {
+        memLimitGB = (float)memLimitOpt->getDouble(1);
+        if (memLimitGB < 0.0f)
+        {
+            throw OperationException("memory limit cannot be negative");
+        }
+    }
+    const int64_t* dims = sparseIn.getDimensions();
+    const int64_t inRowLength = dims[0], inNumRows = dims[1];
+    const CiftiXML& inXML = sparseIn.getCiftiXML();
+    CiftiXML outXML;
+    outXML.setNumberOfDimensions(2);
+    outXML.setMap(CiftiXML::ALONG_ROW, *(inXML.getMap(CiftiXML::ALONG_COLUMN)));
+    outXML.setMap(CiftiXML::ALONG_COLUMN, *(inXML.getMap(CiftiXML::ALONG_ROW)));
+    vector<int64_t> colCount(inRowLength, 0);//first pass: count the values in each input column, which is the length of each output row
+    bool ok = true;
+    AString errorMessage;
+#pragma omp CARET_PAR
+    {
+        vector<int64_t> indices, values;
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int64_t i = 0; i < inNumRows; ++i)
+        {
+            try
+            {
+                sparseIn.getRowSparse(i, indices, values);
+            } catch (CaretException& e) {//can't throw out of a parallel region
+#pragma omp critical
+                {
+                    ok = false;
+                    errorMessage = e.whatString();
+                }
+                continue;
+            }
+            int64_t numNonzero = (int64_t)indices.size();
+            for (int64_t j = 0; j < numNonzero; ++j)
+            {
+#pragma omp atomic
+                ++colCount[indices[j]];
+            }
+        }
+    }
+    if (!ok) throw OperationException(errorMessage);
+    int64_t maxBlockValues = -1;
+    if (memLimitGB >= 0.0f)
+    {
+        maxBlockValues = (int64_t)(memLimitGB * 1024 * 1024 * 1024 / (2 * sizeof(int64_t)));
+    }
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    CaretSparseFileWriter myWriter(outputName, outXML);
+    vector<int64_t> blockPairs, blockOffsets, encoded;
+    int64_t blockStart = 0;
+    while (blockStart < inRowLength)
+    {
+        int64_t blockEnd = blockStart, blockValues = 0;
+        do
+        {//always take at least one output row
+            blockValues += colCount[blockEnd];
+            ++blockEnd;
+        } while (blockEnd < inRowLength && (maxBlockValues < 0 || blockValues + colCount[blockEnd] <= maxBlockValues));
+        blockOffsets.resize(blockEnd - blockStart + 1);
+        blockOffsets[0] = 0;
+        for (int64_t c = blockStart; c < blockEnd; ++c)
+        {
+            blockOffsets[c - blockStart + 1] = blockOffsets[c - blockStart] + colCount[c];
+        }
+        blockPairs.resize(blockValues * 2);
+        //split the output rows of the block into ranges with similar numbers of values, each range is filled by one thread scanning every input row in order,
+        //so the output rows come out sorted without any locking
+        int64_t numRanges = 1;
+        int64_t testNonzero;
+        if (sparseIn.getRowSparsePointer(0, testNonzero) != NULL)
+        {//scanning the input more than once only makes sense when rows can be used in place
+            numRanges = min((int64_t)numThreads * 4, blockEnd - blockStart);
+        }
+        vector<int64_t> rangeBounds(numRanges + 1);
+        rangeBounds[0] = blockStart;
+        rangeBounds[numRanges] = blockEnd;
+        for (int64_t r = 1; r < numRanges; ++r)
+        {
+            rangeBounds[r] = blockStart + (lower_bound(blockOffsets.begin(), blockOffsets.end() - 1, blockValues * r / numRanges) - blockOffsets.begin());
+        }
+#pragma omp CARET_PAR
+        {
+            vector<int64_t> indices, values, cursor;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t r = 0; r < numRanges; ++r)
+            {
+                int64_t rangeStart = rangeBounds[r], rangeEnd = rangeBounds[r + 1];
+                if (rangeEnd <= rangeStart) continue;
+                cursor.assign(rangeEnd - rangeStart, 0);
+                for (int64_t i = 0; i < inNumRows; ++i)
+                {
+                    int64_t numNonzero;
+                    const int64_t* pairs = sparseIn.getRowSparsePointer(i, numNonzero);
+                    if (pairs == NULL)
+                    {
+                        try
+                        {
+                            sparseIn.getRowSparse(i, indices, values);
+                        } catch (CaretException& e) {
+#pragma omp critical
+                            {
+                                ok = false;
+                                errorMessage = e.whatString();
+                            }
+                            break;
+                        }
+                    }
+                    int64_t lo = 0, hi = numNonzero;//binary search for the first stored index in the range, indices in a row are sorted
+                    while (lo < hi)
+                    {
+                        int64_t mid = (lo + hi) / 2;
+                        int64_t midIndex = (pairs == NULL ? indices[mid] : pairs[mid * 2]);
+                        if (midIndex < rangeStart)
+                        {
+                            lo = mid + 1;
+                        } else {
+                            hi = mid;
+                        }
+                    }
+                    for (int64_t j = lo; j < numNonzero; ++j)
+                    {
+                        int64_t col = (pairs == NULL ? indices[j] : pairs[j * 2]);
+                        if (col >= rangeEnd) break;
+                        if (col < 0 || (j > 0 && col <= (pairs == NULL ? indices[j - 1] : pairs[j * 2 - 2])))
+                        {//pointer access doesn't check indices, and we can't let a bad file write outside the buffer
+#pragma omp critical
+                            {
+                                ok = false;
+                                errorMessage = "impossible index value found in file";
+                            }
+                            break;
+                        }
+                        int64_t outPos = blockOffsets[col - blockStart] + cursor[col - rangeStart];
+                        ++cursor[col - rangeStart];
+                        blockPairs[outPos * 2] = i;
+                        blockPairs[outPos * 2 + 1] = (pairs == NULL ? values[j] : pairs[j * 2 + 1]);
+                    }
+                }
+            }
+        }
+        if (!ok) throw OperationException(errorMessage);
+        for (int64_t c = blockStart; c < blockEnd; ++c)
+        {
+            encoded.assign(blockPairs.begin() + blockOffsets[c - blockStart] * 2, blockPairs.begin() + blockOffsets[c - blockStart + 1] * 2);
+            if (ByteOrderEnum::isSystemBigEndian())
+            {
+                ByteSwapping::swapBytes(encoded.data(), encoded.size());
+            }
+            myWriter.writeEncodedRow(c, encoded);
+        }
+        blockStart = blockEnd;
+    }
+    myWriter.finish();
+}
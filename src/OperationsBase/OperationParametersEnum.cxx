@@ -23,9 +23,15 @@
 #include "OperationParametersEnum.h"
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
 std::vector<OperationParametersEnum> OperationParametersEnum::enumData;
 bool OperationParametersEnum::initializedFlag = false;
     
@@ -76,7 +82,10 @@ OperationParametersEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(OperationParametersEnum(SURFACE, 
                                     0, 
@@ -133,6 +142,7 @@ OperationParametersEnum::initialize()
                                     "Boolean", 
                                     "Boolean"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __PALETTE_THRESHOLD_RANGE_MODE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::PaletteThresholdRangeModeEnum 
@@ -72,7 +78,10 @@ PaletteThresholdRangeModeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(PaletteThresholdRangeModeEnum(PALETTE_THRESHOLD_RANGE_MODE_FILE, 
                                     "PALETTE_THRESHOLD_RANGE_MODE_FILE", 
@@ -86,6 +95,7 @@ PaletteThresholdRangeModeEnum::initialize()
                                     "PALETTE_THRESHOLD_RANGE_MODE_UNLIMITED", 
                                     "Unlimited"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -25,9 +25,15 @@
 #undef __SCENE_OBJECT_DATA_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::SceneObjectDataTypeEnum 
@@ -77,7 +83,10 @@ SceneObjectDataTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SceneObjectDataTypeEnum(SCENE_INVALID, 
                                                "SCENE_INVALID", 
@@ -119,6 +128,7 @@ SceneObjectDataTypeEnum::initialize()
                                                "string",
                                                "string"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
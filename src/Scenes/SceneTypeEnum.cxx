@@ -25,9 +25,15 @@
 #undef __SCENE_TYPE_ENUM_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_initializeMutex;
+}
+
     
 /**
  * \class caret::SceneTypeEnum 
@@ -73,7 +79,10 @@ SceneTypeEnum::initialize()
     if (initializedFlag) {
         return;
     }
-    initializedFlag = true;
+    CaretMutexLocker locked(&s_initializeMutex);//an enum may be used for the first time by several threads at once
+    if (initializedFlag) {//double check
+        return;
+    }
 
     enumData.push_back(SceneTypeEnum(SCENE_TYPE_FULL, 
                                     "SCENE_TYPE_FULL", 
@@ -83,6 +92,7 @@ SceneTypeEnum::initialize()
                                     "SCENE_TYPE_GENERIC", 
                                     "Generic Scene"));
     
+    initializedFlag = true;//only after the data is complete, the check above is done without the lock
 }
 
 /**
@@ -20,6 +20,12 @@
 
 #include "CiftiFileTest.h"
 #include "CiftiFile.h"
+#include "CiftiRowCache.h"
+#include "NiftiIO.h"
+
+#include <algorithm>
+#include <cmath>
+
 using namespace caret;
 CiftiFileTest::CiftiFileTest(const AString &identifier) : TestInterface(identifier)
 {
@@ -35,6 +41,12 @@ void CiftiFileTest::execute()
     if(this->failed()) return;
     testCiftiReadWriteOnDisk();
     if(this->failed()) return;
+    testCiftiReadWriteTiled();
+    if(this->failed()) return;
+    testCiftiRowCache();
+    if(this->failed()) return;
+    testCiftiReadWriteQuantized();
+    if(this->failed()) return;
 }
 
 void CiftiFileTest::testObjectCreateDestroy()
@@ -199,3 +211,169 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
     delete [] testRow;
 }
 
+
+void CiftiFileTest::testCiftiReadWriteTiled()
+{
+    std::cout << "Testing tiled Cifti reader/writer." << std::endl;
+
+    CiftiFile reader(this->m_default_path + "/cifti/DenseTimeSeries.dtseries.nii");
+
+    AString outFile = this->m_default_path + "/cifti/testOutTiled.dtseries.nii";
+    if(QFile::exists(outFile)) QFile::remove(outFile);
+    CiftiFile writer;
+    writer.setWritingFile(outFile);
+    writer.setWritingTileSize(37, 13);//deliberately not dividing the dimensions, to exercise the padded edge tiles
+    writer.setCiftiXML(reader.getCiftiXML());
+
+    std::vector <int64_t> dim = reader.getDimensions();
+    if (dim.size() != 2) setFailed("input file must have 2 dimensions");
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+    std::vector<float> row(rowSize), testRow(rowSize), column(columnSize), testColumn(columnSize);
+
+    for(int64_t i = 0;i<columnSize;i++)
+    {
+        reader.getRow(row.data(),i);
+        writer.setRow(row.data(),i);
+    }
+
+    writer.writeFile(outFile);
+
+    NiftiIO headerCheck;
+    headerCheck.openRead(outFile);
+    if(headerCheck.getHeader().getDataType() != NIFTI_TYPE_WORKBENCH_ENCODED)
+    {
+        this->setFailed("Tiled Cifti file does not have the workbench-encoded datatype, so other readers would misread it.");
+        return;
+    }
+    headerCheck.close();
+
+    CiftiFile test(outFile);
+    for(int64_t i = 0;i<columnSize;i++)
+    {
+        reader.getRow(row.data(),i);
+        test.getRow(testRow.data(),i);
+        if(memcmp((void *)row.data(),(void *)testRow.data(),rowSize*sizeof(float)))
+        {
+            this->setFailed("Input and tiled output Cifti file rows are not the same.");
+            return;
+        }
+    }
+    for(int64_t i = 0;i<rowSize;i++)
+    {
+        reader.getColumn(column.data(),i);
+        test.getColumn(testColumn.data(),i);
+        if(memcmp((void *)column.data(),(void *)testColumn.data(),columnSize*sizeof(float)))
+        {
+            this->setFailed("Input and tiled output Cifti file columns are not the same.");
+            return;
+        }
+    }
+    std::cout << "Reading and writing of tiled Cifti was successful for all rows and columns." << std::endl;
+}
+
+void CiftiFileTest::testCiftiRowCache()
+{
+    std::cout << "Testing Cifti row cache." << std::endl;
+
+    AString inFile = this->m_default_path + "/cifti/DenseTimeSeries.dtseries.nii";
+    CiftiFile reader(inFile), cached(inFile);
+    std::vector <int64_t> dim = reader.getDimensions();
+    if (dim.size() != 2) setFailed("input file must have 2 dimensions");
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+    const int64_t maxRows = 4;
+    CiftiRowCache cache(&cached, maxRows * rowSize * sizeof(float));
+    cache.enablePrefetching(inFile);
+    std::vector<float> row(rowSize), testRow(rowSize);
+    std::vector<int64_t> prefetch;
+    for(int64_t pass = 0;pass<2;pass++)
+    {
+        for(int64_t i = 0;i<columnSize;i++)
+        {
+            prefetch.clear();
+            prefetch.push_back((i + 1) % columnSize);
+            prefetch.push_back((i + 2) % columnSize);
+            cache.prefetchRows(prefetch);
+            reader.getRow(row.data(),i);
+            cache.getRow(testRow.data(),i);
+            if(memcmp((void *)row.data(),(void *)testRow.data(),rowSize*sizeof(float)))
+            {
+                this->setFailed("Cached Cifti row is not the same as the file row.");
+                return;
+            }
+            if(cache.getNumberOfCachedRows() > maxRows)
+            {
+                this->setFailed("Cifti row cache exceeded its memory budget.");
+                return;
+            }
+        }
+    }
+    std::cout << "Cifti row cache returned the correct data for all rows." << std::endl;
+}
+
+void CiftiFileTest::testCiftiReadWriteQuantized()
+{
+    std::cout << "Testing quantized Cifti reader/writer." << std::endl;
+
+    CiftiFile reader(this->m_default_path + "/cifti/DenseTimeSeries.dtseries.nii");
+
+    AString outFile = this->m_default_path + "/cifti/testOutQuantized.dtseries.nii";
+    if(QFile::exists(outFile)) QFile::remove(outFile);
+    CiftiFile writer;
+    writer.setWritingFile(outFile);
+    writer.setWritingQuantization(16);
+    writer.setCiftiXML(reader.getCiftiXML());
+
+    std::vector <int64_t> dim = reader.getDimensions();
+    if (dim.size() != 2) setFailed("input file must have 2 dimensions");
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+    std::vector<float> row(rowSize), testRow(rowSize), column(columnSize), testColumn(columnSize);
+
+    for(int64_t i = 0;i<columnSize;i++)
+    {
+        reader.getRow(row.data(),i);
+        writer.setRow(row.data(),i);
+    }
+
+    writer.writeFile(outFile);
+
+    NiftiIO headerCheck;
+    headerCheck.openRead(outFile);
+    if(headerCheck.getHeader().getDataType() != NIFTI_TYPE_WORKBENCH_ENCODED)
+    {
+        this->setFailed("Quantized Cifti file does not have the workbench-encoded datatype, so other readers would misread it.");
+        return;
+    }
+    headerCheck.close();
+
+    CiftiFile test(outFile);
+    for(int64_t i = 0;i<columnSize;i++)
+    {
+        reader.getRow(row.data(),i);
+        test.getRow(testRow.data(),i);
+        float minVal = *std::min_element(row.begin(), row.end()), maxVal = *std::max_element(row.begin(), row.end());
+        float tolerance = (maxVal - minVal) / 65534.0f + 1e-6f * std::max(std::fabs(minVal), std::fabs(maxVal));
+        for(int64_t j = 0;j<rowSize;j++)
+        {
+            if(std::fabs(row[j] - testRow[j]) > tolerance)
+            {
+                this->setFailed("Quantized output Cifti file row differs from the input by more than the quantization step.");
+                return;
+            }
+        }
+    }
+    reader.getColumn(column.data(),rowSize / 2);
+    test.getColumn(testColumn.data(),rowSize / 2);
+    for(int64_t i = 0;i<columnSize;i++)
+    {
+        test.getRow(testRow.data(),i);
+        if(testColumn[i] != testRow[rowSize / 2])
+        {
+            this->setFailed("Quantized Cifti file column does not match its rows.");
+            return;
+        }
+    }
+    std::cout << "Reading and writing of quantized Cifti was successful for all rows." << std::endl;
+}
@@ -32,6 +32,9 @@ public:
     void testCiftiRead();
     void testCiftiReadWriteInMemory();
     void testCiftiReadWriteOnDisk();
+    void testCiftiReadWriteTiled();
+    void testCiftiRowCache();
+    void testCiftiReadWriteQuantized();
 };
 
 } // namespace caret
@@ -0,0 +1,220 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GiftiFileTest.h"
+
+#include "DataFileException.h"
+#include "GiftiDataArray.h"
+#include "GiftiException.h"
+#include "GiftiFile.h"
+#include "GiftiXmlElements.h"
+
+#include <QDir>
+#include <QFile>
+
+using namespace caret;
+using namespace std;
+
+namespace {
+    const int32_t NUMBER_OF_ARRAYS = 2;
+    const int32_t NUMBER_OF_ROWS = 7;
+    const int32_t NUMBER_OF_COLUMNS = 3;
+    
+    float columnMajorTestValue(const int32_t arrayIndex, const int32_t row, const int32_t column)
+    {
+        return arrayIndex * 1000.0f + row * 10.0f + column;
+    }
+}
+
+GiftiFileTest::GiftiFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void GiftiFileTest::execute()
+{
+    testColumnMajorRoundTrip(false);//parser defers compressed arrays, readFile decodes them in parallel
+    if (failed()) return;
+    testColumnMajorRoundTrip(true);
+    if (failed()) return;
+    testDecodingErrorOnRead();
+    if (failed()) return;
+    testDeferredDecodingError();
+}
+
+void GiftiFileTest::testColumnMajorRoundTrip(const bool deferDecoding)
+{
+    const AString firstFileName = QDir::tempPath() + "/giftiFileTestColumnMajor1.func.gii";
+    const AString secondFileName = QDir::tempPath() + "/giftiFileTestColumnMajor2.func.gii";
+    vector<int64_t> dims;
+    dims.push_back(NUMBER_OF_ROWS);
+    dims.push_back(NUMBER_OF_COLUMNS);
+    {
+        GiftiFile writer;
+        for (int32_t a = 0; a < NUMBER_OF_ARRAYS; ++a)
+        {
+            GiftiDataArray* gda = new GiftiDataArray(NiftiIntentEnum::NIFTI_INTENT_NONE,
+                                                     NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32,
+                                                     dims,
+                                                     GiftiEncodingEnum::GZIP_BASE64_BINARY);
+            gda->setArraySubscriptingOrder(GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER);
+            int32_t indices[2];
+            for (indices[0] = 0; indices[0] < NUMBER_OF_ROWS; ++indices[0])
+            {
+                for (indices[1] = 0; indices[1] < NUMBER_OF_COLUMNS; ++indices[1])
+                {
+                    gda->setDataFloat32(indices, columnMajorTestValue(a, indices[0], indices[1]));
+                }
+            }
+            writer.addDataArray(gda);
+        }
+        writer.setEncodingForWriting(GiftiEncodingEnum::GZIP_BASE64_BINARY);
+        writer.writeFile(firstFileName);
+    }
+    {
+        GiftiFile reader;
+        reader.setDeferDataArrayDecoding(deferDecoding);
+        reader.readFile(firstFileName);
+        if (reader.getDataArray(0)->isDataDecodingDeferred() != deferDecoding)
+        {
+            setFailed(AString("array decoding was ") + (deferDecoding ? "not " : "") + "deferred as requested");
+        }
+        checkColumnMajorValues(reader, "after reading");
+        reader.setEncodingForWriting(GiftiEncodingEnum::GZIP_BASE64_BINARY);
+        reader.writeFile(secondFileName);//arrays are row major once decoded, must be written that way
+    }
+    if (!failed())
+    {
+        GiftiFile rereader;
+        rereader.setDeferDataArrayDecoding(deferDecoding);
+        rereader.readFile(secondFileName);
+        checkColumnMajorValues(rereader, "after writing and reading again");
+    }
+    QFile::remove(firstFileName);
+    QFile::remove(secondFileName);
+}
+
+void GiftiFileTest::checkColumnMajorValues(const GiftiFile& giftiFile, const AString& description)
+{
+    if (giftiFile.getNumberOfDataArrays() != NUMBER_OF_ARRAYS)
+    {
+        setFailed(description + ": file has " + AString::number(giftiFile.getNumberOfDataArrays()) + " arrays, should be " + AString::number(NUMBER_OF_ARRAYS));
+        return;
+    }
+    for (int32_t a = 0; a < NUMBER_OF_ARRAYS; ++a)
+    {
+        const GiftiDataArray* gda = giftiFile.getDataArray(a);
+        if (gda->getNumberOfDimensions() != 2 || gda->getDimension(0) != NUMBER_OF_ROWS || gda->getDimension(1) != NUMBER_OF_COLUMNS)
+        {
+            setFailed(description + ": array " + AString::number(a) + " has wrong dimensions");
+            return;
+        }
+        int32_t indices[2];
+        for (indices[0] = 0; indices[0] < NUMBER_OF_ROWS; ++indices[0])
+        {
+            for (indices[1] = 0; indices[1] < NUMBER_OF_COLUMNS; ++indices[1])
+            {
+                const float expected = columnMajorTestValue(a, indices[0], indices[1]);
+                const float value = gda->getDataFloat32(indices);
+                if (value != expected)
+                {
+                    setFailed(description + ": array " + AString::number(a) + " value at (" + AString::number(indices[0]) + ", " + AString::number(indices[1]) +
+                              ") should be " + AString::number(expected) + ", got " + AString::number(value));
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void GiftiFileTest::testDecodingErrorOnRead()
+{
+    const AString fileName = QDir::tempPath() + "/giftiFileTestCorrupt.func.gii";
+    vector<int64_t> dims(1, 100);
+    {
+        GiftiFile writer;
+        writer.addDataArray(new GiftiDataArray(NiftiIntentEnum::NIFTI_INTENT_NONE,
+                                               NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32,
+                                               dims,
+                                               GiftiEncodingEnum::GZIP_BASE64_BINARY));
+        writer.setEncodingForWriting(GiftiEncodingEnum::GZIP_BASE64_BINARY);
+        writer.writeFile(fileName);
+    }
+    QByteArray contents;
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            setFailed("unable to open " + fileName);
+            return;
+        }
+        contents = file.readAll();
+    }
+    const QByteArray dataTag = ("<" + GiftiXmlElements::TAG_DATA + ">").toAscii();
+    const int dataStart = contents.indexOf(dataTag);
+    if (dataStart < 0)
+    {
+        setFailed("no data element in " + fileName);
+        return;
+    }
+    contents.replace(dataStart + dataTag.size(), 4, "AAAA");//still base64, but no longer a zlib stream
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            setFailed("unable to write " + fileName);
+            return;
+        }
+        file.write(contents);
+    }
+    try
+    {
+        GiftiFile reader;
+        reader.readFile(fileName);
+        setFailed("reading a file with corrupt compressed data did not throw");
+    } catch (DataFileException&) {
+    }
+    QFile::remove(fileName);
+}
+
+void GiftiFileTest::testDeferredDecodingError()
+{
+    GiftiDataArray gda(NiftiIntentEnum::NIFTI_INTENT_NONE);
+    std::string text("QUJDRA==");//valid base64, but not gzip data
+    vector<int64_t> dims(1, 5);
+    gda.readFromText(text,
+                     GiftiEndianEnum::ENDIAN_LITTLE,
+                     GiftiArrayIndexingOrderEnum::ROW_MAJOR_ORDER,
+                     NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32,
+                     dims,
+                     GiftiEncodingEnum::GZIP_BASE64_BINARY,
+                     "",
+                     0,
+                     false,
+                     true);
+    for (int i = 0; i < 2; ++i)//must fail on every access, not only the first
+    {
+        try
+        {
+            gda.getDataPointerFloat();
+            setFailed("invalid deferred data was decoded without an error");
+            return;
+        } catch (GiftiException&) {
+        }
+    }
+}
@@ -55,4 +55,31 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    CaretMathExpression arrayExpr("max(a, -b) / (b - 1) + (a >= b) - mod(a, 0.75) ^ 2 + atan2(-a, b)");//compiled array evaluation must match the scalar version
+    const vector<AString>& arrayNames = arrayExpr.getVarNames();
+    if (arrayNames.size() != 2) setFailed("incorrect number of variables found");
+    const int NUM_ELEMS = 1000;//more than one block
+    vector<vector<float> > arrayInputs(2, vector<float>(NUM_ELEMS));
+    for (int i = 0; i < NUM_ELEMS; ++i)
+    {
+        arrayInputs[0][i] = (i % 37) * 0.25f - 4.0f;
+        arrayInputs[1][i] = (i % 11) * 0.5f - 2.0f;
+    }
+    vector<const float*> inputPointers(2);
+    inputPointers[0] = arrayInputs[0].data();
+    inputPointers[1] = arrayInputs[1].data();
+    vector<float> arrayOutput(NUM_ELEMS);
+    arrayExpr.evaluate(inputPointers, arrayOutput.data(), NUM_ELEMS);
+    for (int i = 0; i < NUM_ELEMS; ++i)
+    {
+        vars[0] = arrayInputs[0][i];
+        vars[1] = arrayInputs[1][i];
+        float scalarResult = (float)arrayExpr.evaluate(vars);
+        if (scalarResult != arrayOutput[i] && (scalarResult == scalarResult || arrayOutput[i] == arrayOutput[i]))
+        {
+            setFailed("array evaluation differs from scalar evaluation at element " + AString::number(i) + ", expected " +
+                      AString::number(scalarResult) + ", got " + AString::number(arrayOutput[i]));
+            break;
+        }
+    }
 }
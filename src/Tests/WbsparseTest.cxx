@@ -0,0 +1,284 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "WbsparseTest.h"
+
+#include "CaretPointer.h"
+#include "CaretSparseFile.h"
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+#include "OperationParameters.h"
+#include "OperationWbsparseMultiplyCifti.h"
+#include "OperationWbsparseReduce.h"
+#include "OperationWbsparseThreshold.h"
+#include "OperationWbsparseTranspose.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace {
+    const int64_t NUMBER_OF_ROWS = 6;
+    const int64_t ROW_LENGTH = 5;
+    const int64_t DENSE_VALUES[NUMBER_OF_ROWS][ROW_LENGTH] = {//includes an empty row and a full row, the operations only see the nonzeros
+        { 0, 3, 0, 0, 7 },
+        { 1, 0, 0, 2, 0 },
+        { 0, 0, 0, 0, 0 },
+        { 4, 4, 1, 9, 1 },
+        { 0, 0, 5, 0, 0 },
+        { 2, 0, 6, 0, 8 }
+    };
+    
+    void setStringParameter(OperationParameters* myParams, const int32_t key, const AString& value)
+    {
+        ((StringParameter*)myParams->getInputParameter(key, OperationParametersEnum::STRING))->m_parameter = value;
+    }
+    
+    //reduction of the dense values, zeros included
+    double denseReduction(const vector<double>& values, const AString& operation)
+    {
+        double sum = 0.0, maxVal = values[0], minVal = values[0];
+        int64_t count = 0;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            sum += values[i];
+            maxVal = max(maxVal, values[i]);
+            minVal = min(minVal, values[i]);
+            if (values[i] != 0.0) ++count;
+        }
+        double mean = sum / values.size(), residSqr = 0.0;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            residSqr += (values[i] - mean) * (values[i] - mean);
+        }
+        if (operation == "SUM") return sum;
+        if (operation == "MEAN") return mean;
+        if (operation == "MAX") return maxVal;
+        if (operation == "MIN") return minVal;
+        if (operation == "STDEV") return sqrt(residSqr / values.size());
+        if (operation == "COUNT_NONZERO") return count;
+        return 0.0;
+    }
+}
+
+WbsparseTest::WbsparseTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void WbsparseTest::execute()
+{
+    const AString inputName = QDir::tempPath() + "/wbsparseTestInput.wbsparse";
+    try
+    {
+        writeInputFile(inputName);
+        const char* operations[] = { "SUM", "MEAN", "MAX", "MIN", "STDEV", "COUNT_NONZERO" };
+        for (int i = 0; i < 6 && !failed(); ++i)
+        {
+            testReduce(inputName, true, operations[i]);
+            if (!failed()) testReduce(inputName, false, operations[i]);
+        }
+        if (!failed()) testTranspose(inputName);
+        if (!failed()) testThreshold(inputName);
+        if (!failed()) testMultiplyCifti(inputName, false);
+        if (!failed()) testMultiplyCifti(inputName, true);
+    } catch (CaretException& e) {
+        setFailed("exception in wbsparse test: " + e.whatString());
+    }
+    QFile::remove(inputName);
+}
+
+void WbsparseTest::writeInputFile(const AString& fileName)
+{
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    CiftiScalarsMap rowMap, columnMap;
+    rowMap.setLength(ROW_LENGTH);
+    columnMap.setLength(NUMBER_OF_ROWS);
+    myXML.setMap(CiftiXML::ALONG_ROW, rowMap);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, columnMap);
+    CaretSparseFileWriter myWriter(fileName, myXML);
+    for (int64_t i = 0; i < NUMBER_OF_ROWS; ++i)
+    {
+        myWriter.writeRow(i, DENSE_VALUES[i]);
+    }
+    myWriter.finish();
+}
+
+void WbsparseTest::testReduce(const AString& inputName, const bool alongRow, const AString& operation)
+{
+    CaretPointer<OperationParameters> myParams(OperationWbsparseReduce::getParameters());
+    setStringParameter(myParams, 1, inputName);
+    setStringParameter(myParams, 2, (alongRow ? "ROW" : "COLUMN"));
+    setStringParameter(myParams, 3, operation);
+    ((CiftiParameter*)myParams->getOutputParameter(4, OperationParametersEnum::CIFTI))->m_parameter.grabNew(new CiftiFile());
+    OperationWbsparseReduce::useParameters(myParams, NULL);
+    const CiftiFile* ciftiOut = myParams->getOutputCifti(4);
+    int64_t outLength = (alongRow ? NUMBER_OF_ROWS : ROW_LENGTH), reduceLength = (alongRow ? ROW_LENGTH : NUMBER_OF_ROWS);
+    if (ciftiOut->getCiftiXML().getDimensionLength(CiftiXML::ALONG_COLUMN) != outLength)
+    {
+        setFailed("wbsparse reduce " + operation + " output has the wrong length");
+        return;
+    }
+    vector<float> outCol(outLength);
+    ciftiOut->getColumn(outCol.data(), 0);
+    vector<double> values(reduceLength);
+    for (int64_t i = 0; i < outLength; ++i)
+    {
+        for (int64_t j = 0; j < reduceLength; ++j)
+        {
+            values[j] = (alongRow ? DENSE_VALUES[i][j] : DENSE_VALUES[j][i]);
+        }
+        double expected = denseReduction(values, operation);
+        if (abs(outCol[i] - expected) > 1e-5 * max(1.0, abs(expected)))
+        {
+            setFailed("wbsparse reduce " + operation + " along " + (alongRow ? "ROW" : "COLUMN") + " index " + AString::number(i) +
+                      ": expected " + AString::number(expected) + ", got " + AString::number(outCol[i]));
+            return;
+        }
+    }
+}
+
+void WbsparseTest::testTranspose(const AString& inputName)
+{
+    const AString outputName = QDir::tempPath() + "/wbsparseTestTranspose.wbsparse";
+    CaretPointer<OperationParameters> myParams(OperationWbsparseTranspose::getParameters());
+    setStringParameter(myParams, 1, inputName);
+    setStringParameter(myParams, 2, outputName);
+    OperationWbsparseTranspose::useParameters(myParams, NULL);
+    {
+        CaretSparseFile transposed(outputName);
+        const int64_t* dims = transposed.getDimensions();
+        if (dims[0] != NUMBER_OF_ROWS || dims[1] != ROW_LENGTH)
+        {
+            setFailed("wbsparse transpose output has the wrong dimensions");
+        } else {
+            vector<int64_t> row(NUMBER_OF_ROWS);
+            for (int64_t i = 0; i < ROW_LENGTH && !failed(); ++i)
+            {
+                transposed.getRow(i, row.data());
+                for (int64_t j = 0; j < NUMBER_OF_ROWS; ++j)
+                {
+                    if (row[j] != DENSE_VALUES[j][i])
+                    {
+                        setFailed("wbsparse transpose mismatch at row " + AString::number(i) + ", column " + AString::number(j));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    QFile::remove(outputName);
+}
+
+void WbsparseTest::testThreshold(const AString& inputName)
+{
+    const AString outputName = QDir::tempPath() + "/wbsparseTestThreshold.wbsparse";
+    const int64_t minimum = 3;
+    CaretPointer<OperationParameters> myParams(OperationWbsparseThreshold::getParameters());
+    setStringParameter(myParams, 1, inputName);
+    ((IntegerParameter*)myParams->getInputParameter(2, OperationParametersEnum::INT))->m_parameter = minimum;
+    setStringParameter(myParams, 3, outputName);
+    OperationWbsparseThreshold::useParameters(myParams, NULL);
+    {
+        CaretSparseFile thresholded(outputName);
+        vector<int64_t> row(ROW_LENGTH);
+        for (int64_t i = 0; i < NUMBER_OF_ROWS && !failed(); ++i)
+        {
+            thresholded.getRow(i, row.data());
+            for (int64_t j = 0; j < ROW_LENGTH; ++j)
+            {
+                int64_t expected = (DENSE_VALUES[i][j] >= minimum ? DENSE_VALUES[i][j] : 0);
+                if (row[j] != expected)
+                {
+                    setFailed("wbsparse threshold mismatch at row " + AString::number(i) + ", column " + AString::number(j));
+                    break;
+                }
+            }
+        }
+    }
+    QFile::remove(outputName);
+}
+
+void WbsparseTest::testMultiplyCifti(const AString& inputName, const bool normalize)
+{
+    const int64_t denseCols = 2;
+    CiftiXML denseXML;
+    denseXML.setNumberOfDimensions(2);
+    CiftiScalarsMap rowMap, columnMap;
+    rowMap.setLength(denseCols);
+    columnMap.setLength(ROW_LENGTH);//must match the sparse file's row mapping
+    denseXML.setMap(CiftiXML::ALONG_ROW, rowMap);
+    denseXML.setMap(CiftiXML::ALONG_COLUMN, columnMap);
+    CaretPointer<OperationParameters> myParams(OperationWbsparseMultiplyCifti::getParameters());
+    setStringParameter(myParams, 1, inputName);
+    CaretPointer<CiftiFile>& ciftiIn = ((CiftiParameter*)myParams->getInputParameter(2, OperationParametersEnum::CIFTI))->m_parameter;
+    ciftiIn.grabNew(new CiftiFile());
+    ciftiIn->setCiftiXML(denseXML);
+    vector<float> denseRow(denseCols);
+    for (int64_t j = 0; j < ROW_LENGTH; ++j)
+    {
+        for (int64_t k = 0; k < denseCols; ++k)
+        {
+            denseRow[k] = j + 1 + 10 * k;
+        }
+        ciftiIn->setRow(denseRow.data(), j);
+    }
+    ((CiftiParameter*)myParams->getOutputParameter(3, OperationParametersEnum::CIFTI))->m_parameter.grabNew(new CiftiFile());
+    myParams->getOptionalParameter(5)->m_present = normalize;
+    OperationWbsparseMultiplyCifti::useParameters(myParams, NULL);
+    const CiftiFile* ciftiOut = myParams->getOutputCifti(3);
+    const AString testName = AString("wbsparse multiply cifti") + (normalize ? " with -normalize-rows" : "");
+    if (ciftiOut->getCiftiXML().getDimensionLength(CiftiXML::ALONG_COLUMN) != NUMBER_OF_ROWS ||
+        ciftiOut->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW) != denseCols)
+    {
+        setFailed(testName + " output has the wrong dimensions");
+        return;
+    }
+    vector<float> outRow(denseCols);
+    for (int64_t i = 0; i < NUMBER_OF_ROWS; ++i)
+    {
+        ciftiOut->getRow(outRow.data(), i);
+        double rowSum = 0.0;
+        for (int64_t j = 0; j < ROW_LENGTH; ++j)
+        {
+            rowSum += DENSE_VALUES[i][j];
+        }
+        for (int64_t k = 0; k < denseCols; ++k)
+        {
+            double expected = 0.0;
+            for (int64_t j = 0; j < ROW_LENGTH; ++j)
+            {
+                expected += DENSE_VALUES[i][j] * (j + 1 + 10 * k);
+            }
+            if (normalize) expected = (rowSum != 0.0 ? expected / rowSum : 0.0);//the empty row stays zero
+            if (abs(outRow[k] - expected) > 1e-5 * max(1.0, abs(expected)))
+            {
+                setFailed(testName + " row " + AString::number(i) + ", column " + AString::number(k) +
+                          ": expected " + AString::number(expected) + ", got " + AString::number(outRow[k]));
+                return;
+            }
+        }
+    }
+}
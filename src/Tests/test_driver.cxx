@@ -31,6 +31,7 @@
 
 //tests
 #include "CiftiFileTest.h"
+#include "GiftiFileTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
 #include "LookupTest.h"
@@ -43,6 +44,7 @@
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
+#include "WbsparseTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -69,6 +71,7 @@ int main(int argc, char** argv)
         SessionManager::createSessionManager();
         vector<TestInterface*> mytests;
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new GiftiFileTest("giftifile"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));
@@ -82,6 +85,7 @@ int main(int argc, char** argv)
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new WbsparseTest("wbsparse"));
         mytests.push_back(new XnatTest("xnat"));
         if (argc < 2)
         {
@@ -301,6 +301,32 @@ XmlWriter::writeElementNoSpace(const AString& localName, const AString& text)
    this->writeTextToOutputStream("</" + localName + ">\n");
 }
 
+/**
+ * Write an element with no spacing between start and end tags.
+ * The text is written as-is, without conversion, so it must only
+ * contain printable ASCII that needs no escaping, such as base64
+ * encoded data.
+ *
+ * @param localName - local name of tag to write.
+ * @param text - text to write.
+ * @throws XmlAttributes if an I/O error occurs.
+ */
+void
+XmlWriter::writeElementNoSpaceAscii(const AString& localName, const std::string& text)
+                                                 throw(XmlException) {
+   this->writeIndentation();
+   this->writeTextToOutputStream("<" + localName + ">");
+   switch (this->outputStreamType) {
+       case OUTPUT_STREAM_Q_TEXT_STREAM:
+           *qTextStreamWriter << QLatin1String(text.c_str());
+           break;
+       case OUTPUT_STREAM_STD_OUTPUT_STREAM:
+           stdOutputStreamWriter->write(text.data(), text.size());
+           break;
+   }
+   this->writeTextToOutputStream("</" + localName + ">\n");
+}
+
 /**
  * Writes a start tag to the output.
  *
@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <ostream>
 #include <stack>
+#include <string>
 
 #include "CaretObject.h"
 #include "XmlException.h"
@@ -79,6 +80,8 @@ namespace caret {
                                const AString& text) throw(XmlException);
         
         void writeElementNoSpace(const AString& localName, const AString& text) throw(XmlException);
+        void writeElementNoSpaceAscii(const AString& localName, const std::string& text) throw(XmlException);
+        
         void writeStartElement(const AString& localName) throw(XmlException);
         
         void writeStartElement(const AString& localName,